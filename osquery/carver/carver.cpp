@@ -24,12 +24,19 @@
 #include <osquery/remote/serializers/json.h>
 #include <osquery/utils/base64.h>
 #include <osquery/utils/conversions/split.h>
+#include <osquery/utils/conversions/tryto.h>
 #include <osquery/utils/json/json.h>
 #include <osquery/utils/system/system.h>
 #include <osquery/utils/system/time.h>
 
 #include <boost/algorithm/string.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
 namespace fs = boost::filesystem;
 
 namespace osquery {
@@ -67,11 +74,111 @@ CLI_FLAG(uint32,
          86400,
          "Seconds to store successful carve result metadata (in carves table)");
 
+/// Number of blocks to read, encode and POST concurrently.
+CLI_FLAG(uint32,
+         carver_upload_threads,
+         1,
+         "Number of carve blocks to POST concurrently (default 1)");
+
+/// Boolean if blocks should be POSTed without a JSON and base64 encoding.
+CLI_FLAG(bool,
+         carver_raw_blocks,
+         false,
+         "POST carve blocks as raw binary bodies, block details in the URI");
+
 DECLARE_bool(disable_carver);
-DECLARE_uint64(read_max);
+
+/// Number of attempts made to POST each carve block.
+const size_t kCarverBlockAttempts = 3;
 
 std::atomic<bool> CarverRunnable::running_{false};
 
+namespace {
+
+/// Percent-encode a value for use in a URI query.
+std::string escapeQueryValue(const std::string& value) {
+  std::ostringstream escaped;
+  escaped << std::hex << std::uppercase << std::setfill('0');
+  for (const auto c : value) {
+    if (isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '_' ||
+        c == '.' || c == '~') {
+      escaped << c;
+    } else {
+      escaped << '%' << std::setw(2)
+              << static_cast<int>(static_cast<unsigned char>(c));
+    }
+  }
+  return escaped.str();
+}
+
+std::string getBlockPrefix(const std::string& guid) {
+  return kCarverBlockDBPrefix + guid + ".";
+}
+
+/// Remove the upload session and uploaded block records of a carve.
+void clearUploadState(const std::string& guid) {
+  deleteDatabaseValue(kCarves, kCarverUploadDBPrefix + guid);
+
+  std::vector<std::string> blocks;
+  scanDatabaseKeys(kCarves, blocks, getBlockPrefix(guid));
+  if (!blocks.empty()) {
+    deleteDatabaseBatch(kCarves, blocks);
+  }
+}
+
+/**
+ * @brief Find the session of an interrupted upload of the same archive.
+ *
+ * Returns an empty session if there is nothing to resume, or if the archive
+ * changed since the upload started.
+ */
+std::string getResumableSession(const std::string& guid,
+                                const std::string& sha256,
+                                uint64_t size) {
+  std::string upload;
+  if (sha256 == "-1" ||
+      !getDatabaseValue(kCarves, kCarverUploadDBPrefix + guid, upload).ok()) {
+    return "";
+  }
+
+  JSON tree;
+  if (!tree.fromString(upload).ok() || !tree.doc().IsObject()) {
+    return "";
+  }
+
+  auto& doc = tree.doc();
+  if (!doc.HasMember("session_id") || !doc["session_id"].IsString() ||
+      !doc.HasMember("sha256") || !doc["sha256"].IsString() ||
+      !doc.HasMember("size") || !doc["size"].IsUint64() ||
+      !doc.HasMember("block_size") || !doc["block_size"].IsUint64()) {
+    return "";
+  }
+
+  if (sha256 != doc["sha256"].GetString() || size != doc["size"].GetUint64() ||
+      FLAGS_carver_block_size != doc["block_size"].GetUint64()) {
+    return "";
+  }
+  return doc["session_id"].GetString();
+}
+
+/// Get the IDs of the blocks of a carve that were uploaded.
+std::set<size_t> getUploadedBlocks(const std::string& guid) {
+  auto prefix = getBlockPrefix(guid);
+  std::vector<std::string> blocks;
+  scanDatabaseKeys(kCarves, blocks, prefix);
+
+  std::set<size_t> uploaded;
+  for (const auto& block : blocks) {
+    auto block_id = tryTo<size_t>(block.substr(prefix.size()));
+    if (block_id) {
+      uploaded.insert(block_id.take());
+    }
+  }
+  return uploaded;
+}
+
+} // namespace
+
 void CarverRunnable::start() {
   std::vector<std::string> carves;
   scanDatabaseKeys(kCarves, carves, kCarverDBPrefix);
@@ -112,7 +219,16 @@ void CarverRunnable::start() {
       }
     }
 
-    if (status != kCarverStatusScheduled) {
+    // Carves found uploading were interrupted, and resume their upload, as do
+    // the failed uploads that stored a session.
+    std::string upload;
+    auto resumable =
+        status == kCarverStatusScheduled || status == kCarverStatusUploading ||
+        (status == kCarverStatusPostFailed &&
+         getDatabaseValue(kCarves, kCarverUploadDBPrefix + guid, upload).ok());
+    if (!resumable) {
+      // A resumed carve may have failed before its upload started.
+      clearUploadState(guid);
       continue;
     }
 
@@ -182,51 +298,49 @@ Status Carver::carve() {
     return s;
   }
 
-  const auto carvedFiles = carveAll();
-  s = archive(carvedFiles, archivePath_, FLAGS_carver_block_size);
-  if (!s.ok()) {
-    VLOG(1) << "Failed to create carve archive: " << s.getMessage();
-    updateCarveValue(carveGuid_, "status", "ARCHIVE FAILED");
-    return s;
-  }
+  // Stream the carved files through the archive, optional compression and
+  // hash, a block at a time, into the single file that is uploaded.
+  auto uploadPath = (FLAGS_carver_compression) ? compressPath_ : archivePath_;
+  uint64_t uploadSize = 0;
+  {
+    PlatformFile uploadFile(uploadPath, PF_CREATE_ALWAYS | PF_WRITE);
+    if (!uploadFile.isValid()) {
+      updateCarveValue(carveGuid_, "status", "ARCHIVE FAILED");
+      return Status::failure("Failed to open carve archive for writing");
+    }
 
-  fs::path uploadPath;
-  if (FLAGS_carver_compression) {
-    uploadPath = compressPath_;
-    s = compress(archivePath_, compressPath_);
+    Hash hash(HashType::HASH_TYPE_SHA256);
+    s = archive(
+        getCarveEntries(),
+        [&uploadFile, &hash, &uploadSize](const void* data, size_t size) {
+          hash.update(data, size);
+          uploadSize += size;
+          return uploadFile.write(data, size) == static_cast<ssize_t>(size);
+        },
+        FLAGS_carver_compression,
+        FLAGS_carver_block_size);
     if (!s.ok()) {
-      VLOG(1) << "Failed to compress carve archive: " << s.getMessage();
-      updateCarveValue(carveGuid_, "status", "COMPRESS FAILED");
+      VLOG(1) << "Failed to create carve archive: " << s.getMessage();
+      updateCarveValue(carveGuid_, "status", "ARCHIVE FAILED");
       return s;
     }
-  } else {
-    uploadPath = archivePath_;
+    uploadHash_ = hash.digest();
   }
 
-  PlatformFile uploadFile(uploadPath, PF_OPEN_EXISTING | PF_READ);
-  updateCarveValue(carveGuid_, "size", std::to_string(uploadFile.size()));
-
-  std::string uploadHash =
-      (uploadFile.size() > FLAGS_read_max)
-          ? "-1"
-          : hashFromFile(HashType::HASH_TYPE_SHA256, uploadPath.string());
-  if (uploadHash == "-1") {
-    VLOG(1)
-        << "Archive file size exceeds read max, skipping integrity computation";
-  }
-  updateCarveValue(carveGuid_, "sha256", uploadHash);
+  updateCarveValue(carveGuid_, "size", std::to_string(uploadSize));
+  updateCarveValue(carveGuid_, "sha256", uploadHash_);
 
   s = postCarve(uploadPath);
   if (!s.ok()) {
     VLOG(1) << "Failed to post carve: " << s.getMessage();
-    updateCarveValue(carveGuid_, "status", "DATA POST FAILED");
+    updateCarveValue(carveGuid_, "status", kCarverStatusPostFailed);
     return s;
   }
   return Status::success();
 };
 
-std::set<fs::path> Carver::carveAll() {
-  std::set<fs::path> carvedFiles;
+std::map<std::string, fs::path> Carver::getCarveEntries() {
+  std::map<std::string, fs::path> entries;
   for (const auto& srcPath : carvePaths_) {
     // Ensure the file is a flat file on disk before carving
     PlatformFile src(srcPath, PF_OPEN_EXISTING | PF_READ);
@@ -235,73 +349,87 @@ std::set<fs::path> Carver::carveAll() {
       continue;
     }
 
-    fs::path dstPath;
+    // Entries are named as if the file was copied into the carve directory.
+    fs::path entryPath;
     if (srcPath.has_root_name()) {
       auto temp = srcPath.string();
       boost::erase_first(temp, ":");
-      dstPath = carveDir_ / fs::path(temp);
+      entryPath = carveDir_ / fs::path(temp);
     } else {
-      dstPath = carveDir_ / srcPath;
-    }
-    if (!fs::exists(dstPath.parent_path())) {
-      auto ret = fs::create_directories(dstPath.parent_path());
-      if (!ret) {
-        VLOG(1) << "Failed to create directories for: "
-                << dstPath.parent_path();
-        continue;
-      }
-    }
-
-    PlatformFile dst(dstPath, PF_CREATE_NEW | PF_WRITE);
-    if (!dst.isValid()) {
-      VLOG(1) << "Destination temporary file is invalid: " << dstPath;
-      continue;
-    }
-    Status s = blockwiseCopy(src, dst);
-    if (s.ok()) {
-      carvedFiles.insert(dstPath);
-    } else {
-      VLOG(1) << "Failed to copy file from " << srcPath << " to " << dstPath
-              << " " << s.getMessage();
+      entryPath = carveDir_ / srcPath;
     }
+    entries[entryPath.string()] = srcPath;
   }
-  return carvedFiles;
+  return entries;
 }
 
-Status Carver::blockwiseCopy(PlatformFile& src, PlatformFile& dst) {
-  auto blkCount = ceil(static_cast<double>(src.size()) /
-                       static_cast<double>(FLAGS_carver_block_size));
-
-  std::vector<char> inBuff(FLAGS_carver_block_size, 0);
-  for (size_t i = 0; i < blkCount; i++) {
-    auto bytesRead = src.read(inBuff.data(), FLAGS_carver_block_size);
-    if (bytesRead > 0) {
-      auto bytesWritten = dst.write(inBuff.data(), bytesRead);
-      if (bytesWritten < 0) {
-        return Status(1, "Error writing bytes to tmp fs");
-      }
+Status Carver::postCarve(const boost::filesystem::path& path) {
+  PlatformFile pFile(path, PF_OPEN_EXISTING | PF_READ);
+  auto blkCount =
+      static_cast<size_t>(ceil(static_cast<double>(pFile.size()) /
+                               static_cast<double>(FLAGS_carver_block_size)));
+
+  auto session_id = getResumableSession(carveGuid_, uploadHash_, pFile.size());
+  if (!session_id.empty()) {
+    VLOG(1) << "Resuming carve upload for GUID: " << carveGuid_;
+  } else {
+    clearUploadState(carveGuid_);
+
+    auto status = postStart(blkCount, pFile.size(), session_id);
+    if (!status.ok()) {
+      return status;
     }
+
+    // Store the session so an interrupted or failed upload may resume.
+    JSON upload;
+    upload.add("session_id", session_id);
+    upload.add("sha256", uploadHash_);
+    upload.add("size", pFile.size());
+    upload.add("block_size", size_t(FLAGS_carver_block_size));
+
+    std::string serialized;
+    upload.toString(serialized);
+    setDatabaseValue(kCarves, kCarverUploadDBPrefix + carveGuid_, serialized);
+  }
+  updateCarveValue(carveGuid_, "status", kCarverStatusUploading);
+
+  uint64_t bytes_sent = 0;
+  auto start = std::chrono::steady_clock::now();
+  auto status = postBlocks(path, session_id, blkCount, bytes_sent);
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+
+  // Report the upload throughput in bytes per second.
+  updateCarveValue(carveGuid_,
+                   "throughput",
+                   std::to_string(bytes_sent * 1000 /
+                                  std::max<uint64_t>(elapsed, 1)));
+
+  // A failed upload keeps its session and blocks, and is resumed by the next
+  // carver run.
+  if (!status.ok()) {
+    return status;
   }
 
+  clearUploadState(carveGuid_);
+  updateCarveValue(carveGuid_, "status", kCarverStatusSuccess);
   return Status::success();
 };
 
-Status Carver::postCarve(const boost::filesystem::path& path) {
+Status Carver::postStart(size_t block_count,
+                         uint64_t size,
+                         std::string& session_id) {
   // Construct the uri we post our data back to:
   auto startUri = TLSRequestHelper::makeURI(FLAGS_carver_start_endpoint);
   Request<TLSTransport, JSONSerializer> startRequest(startUri);
   startRequest.setOption("hostname", FLAGS_tls_hostname);
 
   // Perform the start request to get the session id
-  PlatformFile pFile(path, PF_OPEN_EXISTING | PF_READ);
-  auto blkCount =
-      static_cast<size_t>(ceil(static_cast<double>(pFile.size()) /
-                               static_cast<double>(FLAGS_carver_block_size)));
   JSON startParams;
-
-  startParams.add("block_count", blkCount);
+  startParams.add("block_count", block_count);
   startParams.add("block_size", size_t(FLAGS_carver_block_size));
-  startParams.add("carve_size", pFile.size());
+  startParams.add("carve_size", size);
   startParams.add("carve_id", carveGuid_);
   startParams.add("request_id", requestId_);
   startParams.add("node_key", getNodeKey("tls"));
@@ -326,41 +454,114 @@ Status Carver::postCarve(const boost::filesystem::path& path) {
     return Status(1, "Invalid session_id received from remote endpoint");
   }
 
-  std::string session_id = it->value.GetString();
+  session_id = it->value.GetString();
   if (session_id.empty()) {
     return Status(1, "Empty session_id received from remote endpoint");
   }
+  return Status::success();
+}
+
+Status Carver::postBlocks(const boost::filesystem::path& path,
+                          const std::string& session_id,
+                          size_t block_count,
+                          uint64_t& bytes_sent) {
+  auto prefix = getBlockPrefix(carveGuid_);
+  auto completed = getUploadedBlocks(carveGuid_);
+
+  // Each worker claims the next block to send, and reads it from its own file
+  // handle.
+  std::atomic<size_t> next_block{0};
+  std::atomic<size_t> failures{0};
+  std::atomic<uint64_t> sent{0};
+  auto worker = [&]() {
+    PlatformFile pFile(path, PF_OPEN_EXISTING | PF_READ);
+    if (!pFile.isValid()) {
+      failures++;
+      return;
+    }
 
-  auto contUri = TLSRequestHelper::makeURI(FLAGS_carver_continue_endpoint);
-  Request<TLSTransport, JSONSerializer> contRequest(contUri);
-  contRequest.setOption("hostname", FLAGS_tls_hostname);
-  for (size_t i = 0; i < blkCount; i++) {
     std::vector<char> block(FLAGS_carver_block_size, 0);
-    auto r = pFile.read(block.data(), FLAGS_carver_block_size);
+    for (auto i = next_block++; i < block_count; i = next_block++) {
+      if (completed.count(i) > 0) {
+        continue;
+      }
 
-    if (r != FLAGS_carver_block_size && r > 0) {
-      // resize the buffer to size we read as last block is likely smaller
-      block.resize(r);
-    }
+      pFile.seek(static_cast<off_t>(i) * FLAGS_carver_block_size,
+                 PF_SEEK_BEGIN);
+      auto r = pFile.read(block.data(), FLAGS_carver_block_size);
+      if (r < 0) {
+        VLOG(1) << "Read of carved block " << i << " failed";
+        failures++;
+        continue;
+      }
 
-    JSON params;
-    params.add("block_id", i);
-    params.add("session_id", session_id);
-    params.add("request_id", requestId_);
-    params.add("data", base64::encode(std::string(block.begin(), block.end())));
+      Status status;
+      std::string data(block.data(), static_cast<size_t>(r));
+      for (size_t attempt = 0; attempt < kCarverBlockAttempts; attempt++) {
+        status = postBlock(session_id, i, data);
+        if (status.ok()) {
+          break;
+        }
+      }
 
-    // TODO: Error sending files.
-    status = contRequest.call(params);
-    if (!status.ok()) {
-      VLOG(1) << "Post of carved block " << i
-              << " failed: " << status.getMessage();
-      continue;
+      if (!status.ok()) {
+        VLOG(1) << "Post of carved block " << i
+                << " failed: " << status.getMessage();
+        failures++;
+        continue;
+      }
+
+      sent += data.size();
+      setDatabaseValue(kCarves, prefix + std::to_string(i), "");
     }
+  };
+
+  auto threads = std::max<size_t>(
+      1, std::min<size_t>(FLAGS_carver_upload_threads, block_count));
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < threads; i++) {
+    workers.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : workers) {
+    thread.join();
   }
 
-  updateCarveValue(carveGuid_, "status", kCarverStatusSuccess);
+  bytes_sent = sent;
+  if (failures > 0) {
+    return Status::failure("Failed to post " + std::to_string(failures) +
+                           " carved blocks");
+  }
   return Status::success();
-};
+}
+
+Status Carver::postBlock(const std::string& session_id,
+                         size_t block_id,
+                         const std::string& block) {
+  auto contUri = TLSRequestHelper::makeURI(FLAGS_carver_continue_endpoint);
+  if (FLAGS_carver_raw_blocks) {
+    // The block is the request body, and its details are URI variables.
+    contUri += (contUri.find('?') != std::string::npos) ? "&" : "?";
+    contUri += "block_id=" + std::to_string(block_id) +
+               "&session_id=" + escapeQueryValue(session_id) +
+               "&request_id=" + escapeQueryValue(requestId_);
+
+    Request<TLSTransport, JSONSerializer> contRequest(contUri);
+    contRequest.setOption("hostname", FLAGS_tls_hostname);
+    contRequest.setOption("content_type", "application/octet-stream");
+    return contRequest.callSerialized(block);
+  }
+
+  Request<TLSTransport, JSONSerializer> contRequest(contUri);
+  contRequest.setOption("hostname", FLAGS_tls_hostname);
+
+  JSON params;
+  params.add("block_id", block_id);
+  params.add("session_id", session_id);
+  params.add("request_id", requestId_);
+  params.add("data", base64::encode(block));
+  return contRequest.call(params);
+}
 
 void scheduleCarves() {
   if (!FLAGS_disable_carver && kCarverPendingCarves &&
@@ -14,6 +14,7 @@
 #include <osquery/utils/status/status.h>
 
 #include <atomic>
+#include <map>
 #include <set>
 #include <string>
 
@@ -107,30 +108,57 @@ class Carver {
 
  protected:
   /**
-   * @brief A helper function that 'carves' all files from disk.
+   * @brief A helper function that finds all files to carve from disk.
    *
-   * This function copies all source files to a temporary directory and returns
-   * a list of all destination files.
+   * This function returns the archive entry name of each source file that
+   * exists and is not a directory. The files are read directly when the
+   * archive is streamed, they are not copied.
    */
-  std::set<boost::filesystem::path> carveAll();
-
-  /**
-   * @brief A helper function that does a blockwise copy from src to dst.
-   *
-   * This function copies the source file to the destination file, doing so
-   * by blocks specified with FLAGS_carver_block_size (defaults to 8K).
-   */
-  Status blockwiseCopy(PlatformFile& src, PlatformFile& dst);
+  std::map<std::string, boost::filesystem::path> getCarveEntries();
 
   /**
    * @brief Helper function to POST a carve to the graph endpoint.
    *
-   * Once all of the files have been carved and the tgz has been
+   * Once all of the files have been carved and the tar has been
    * created, we POST the carved file to an endpoint specified by the
    * carver_start_endpoint and carver_continue_endpoint.
    */
   virtual Status postCarve(const boost::filesystem::path& path);
 
+  /**
+   * @brief Helper function to POST the blocks of a carve.
+   *
+   * Blocks are read and POSTed by FLAGS_carver_upload_threads workers. Each
+   * uploaded block is recorded in the carves domain, and blocks already
+   * recorded for this carve are skipped, so an interrupted or failed upload
+   * resumes.
+   *
+   * @param path the archive to upload.
+   * @param session_id the session returned by the carver start endpoint.
+   * @param block_count the number of blocks in the archive.
+   * @param bytes_sent [output] the number of archive bytes POSTed.
+   */
+  Status postBlocks(const boost::filesystem::path& path,
+                    const std::string& session_id,
+                    size_t block_count,
+                    uint64_t& bytes_sent);
+
+  /**
+   * @brief POST the carve details to the carver start endpoint.
+   *
+   * @param block_count the number of blocks in the archive.
+   * @param size the size of the archive.
+   * @param session_id [output] the session returned by the endpoint.
+   */
+  virtual Status postStart(size_t block_count,
+                           uint64_t size,
+                           std::string& session_id);
+
+  /// POST a single block to the carver continue endpoint.
+  virtual Status postBlock(const std::string& session_id,
+                           size_t block_id,
+                           const std::string& block);
+
   /// Helper function to return the carve directory.
   boost::filesystem::path getCarveDir() {
     return carveDir_;
@@ -140,9 +168,8 @@ class Carver {
   /**
    * @brief a variable to keep track of the temp path used in carving.
    *
-   * This variable represents the location in which we store all of our carved
-   * files. When a carve has completed all of the desired files, as well
-   * as the tar archive should reside in this directory.
+   * This variable represents the location in which we store the archive
+   * streamed from the carved files, before it is uploaded.
    */
   boost::filesystem::path carveDir_;
 
@@ -157,16 +184,16 @@ class Carver {
   /**
    * @brief a helper variable for keeping track of the posix tar archive.
    *
-   * This variable is the absolute location of the tar archive created from
-   * tar'ing all of the carved files from the carve temp dir.
+   * This variable is the absolute location of the tar archive streamed from
+   * all of the carved files.
    */
   boost::filesystem::path archivePath_;
 
   /**
    * @brief a helper variable for keeping track of the compressed tar.
    *
-   * This variable is the absolute location of the tar archive created from
-   * zstd of the archive.
+   * This variable is the absolute location of the tar archive streamed from
+   * all of the carved files, when compressed with zstd.
    */
   boost::filesystem::path compressPath_;
 
@@ -186,6 +213,14 @@ class Carver {
    * aggregated, to tie together a distributed query with the carve data.
    */
   std::string requestId_;
+
+  /**
+   * @brief the SHA256 of the archive to upload.
+   *
+   * An interrupted upload is only resumed if the archive created again has
+   * the same hash.
+   */
+  std::string uploadHash_;
 };
 
 /**
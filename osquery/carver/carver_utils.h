@@ -26,12 +26,24 @@ const std::string kCarveNamePrefix = "carve_";
 /// Database prefix used to directly access and manipulate our carver entries.
 const std::string kCarverDBPrefix = "carves.";
 
+/// Database prefix for the upload session of an in-progress carve.
+const std::string kCarverUploadDBPrefix = "carve_uploads.";
+
+/// Database prefix for the blocks of an in-progress carve that were uploaded.
+const std::string kCarverBlockDBPrefix = "carve_blocks.";
+
+/// Internal carver 'status' indicating a carve upload that may be resumed.
+const std::string kCarverStatusUploading = "UPLOADING";
+
 /// Internal carver 'status' indicating a completed carve.
 const std::string kCarverStatusSuccess = "SUCCESS";
 
 /// Internal carver 'status' indicating a carve request scheduled.
 const std::string kCarverStatusScheduled = "SCHEDULED";
 
+/// Internal carver 'status' indicating a failed upload, resumed if possible.
+const std::string kCarverStatusPostFailed = "DATA POST FAILED";
+
 /**
  * @brief This flag is an optimization attempt used by the CarverRunner.
  *
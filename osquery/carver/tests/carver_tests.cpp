@@ -7,21 +7,28 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <mutex>
+
 #include <boost/filesystem.hpp>
 
 #include <gtest/gtest.h>
 
 #include <osquery/carver/carver.h>
 #include <osquery/carver/carver_utils.h>
+#include <osquery/core/flags.h>
 #include <osquery/core/system.h>
 #include <osquery/database/database.h>
 #include <osquery/filesystem/fileops.h>
 #include <osquery/hashing/hashing.h>
 #include <osquery/registry/registry.h>
 #include <osquery/utils/json/json.h>
+#include <osquery/utils/scope_guard.h>
 
 namespace osquery {
 
+DECLARE_uint32(carver_block_size);
+DECLARE_uint32(carver_upload_threads);
+
 namespace fs = boost::filesystem;
 
 /// Prefix used for posix tar archive.
@@ -45,6 +52,7 @@ class FakeCarver : public Carver {
   FRIEND_TEST(CarverTests, test_carve_files_locally);
   FRIEND_TEST(CarverTests, test_carve_start);
   FRIEND_TEST(CarverTests, test_carve_files_not_exists);
+  FRIEND_TEST(CarverTests, test_stream_compressed_archive);
 };
 
 class FakeCarverRunner : public CarverRunner<FakeCarver> {
@@ -52,6 +60,42 @@ class FakeCarverRunner : public CarverRunner<FakeCarver> {
   FakeCarverRunner() : CarverRunner() {}
 };
 
+/// Uploads through the real carver, with requests answered in memory.
+class FakeTransportCarver : public Carver {
+ public:
+  FakeTransportCarver(const std::set<std::string>& paths,
+                      const std::string& guid,
+                      const std::set<size_t>& failing_blocks)
+      : Carver(paths, guid, "request-id"), failing_blocks_(failing_blocks) {}
+
+  size_t starts{0};
+  std::set<size_t> posted_blocks;
+
+ protected:
+  Status postStart(size_t, uint64_t, std::string& session_id) override {
+    starts++;
+    session_id = "session-" + carveGuid_;
+    return Status::success();
+  }
+
+  Status postBlock(const std::string& session_id,
+                   size_t block_id,
+                   const std::string&) override {
+    EXPECT_EQ(session_id, "session-" + carveGuid_);
+    if (failing_blocks_.count(block_id) > 0) {
+      return Status::failure("Block rejected");
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    posted_blocks.insert(block_id);
+    return Status::success();
+  }
+
+ private:
+  std::set<size_t> failing_blocks_;
+  std::mutex mutex_;
+};
+
 class CarverTests : public testing::Test {
  public:
   std::set<std::string>& getCarvePaths() {
@@ -115,8 +159,13 @@ TEST_F(CarverTests, test_carve_files_locally) {
   FakeCarver carve(getCarvePaths(), guid, requestId);
 
   ASSERT_TRUE(carve.createPaths());
-  const auto carves = carve.carveAll();
-  EXPECT_EQ(carves.size(), 3U);
+  const auto entries = carve.getCarveEntries();
+  EXPECT_EQ(entries.size(), 3U);
+
+  std::set<fs::path> carves;
+  for (const auto& entry : entries) {
+    carves.insert(entry.second);
+  }
 
   const auto carveFSPath = carve.getCarveDir();
   const auto tarPath = carveFSPath / (kTestCarveNamePrefix + guid + ".tar");
@@ -128,6 +177,45 @@ TEST_F(CarverTests, test_carve_files_locally) {
   EXPECT_GT(tar.size(), 0U);
 }
 
+TEST_F(CarverTests, test_stream_compressed_archive) {
+  auto guid = createCarveGuid();
+  FakeCarver carve(getCarvePaths(), guid, "");
+  ASSERT_TRUE(carve.createPaths());
+  const auto entries = carve.getCarveEntries();
+
+  // The streamed archive, decompressed, matches the uncompressed archive.
+  std::string tar;
+  auto s = archive(
+      entries,
+      [&tar](const void* data, size_t size) {
+        tar.append(static_cast<const char*>(data), size);
+        return true;
+      },
+      false);
+  ASSERT_TRUE(s.ok()) << s.what();
+  EXPECT_EQ(tar.size() % 512, 0U);
+
+  const auto zstPath = carve.getCarveDir() / "stream.tar.zst";
+  {
+    PlatformFile zst(zstPath, PF_CREATE_ALWAYS | PF_WRITE);
+    s = archive(
+        entries,
+        [&zst](const void* data, size_t size) {
+          return zst.write(data, size) == static_cast<ssize_t>(size);
+        },
+        true);
+    ASSERT_TRUE(s.ok()) << s.what();
+  }
+
+  const auto tarPath = carve.getCarveDir() / "stream.tar";
+  s = decompress(zstPath, tarPath);
+  ASSERT_TRUE(s.ok()) << s.what();
+
+  std::string extracted;
+  ASSERT_TRUE(readFile(tarPath, extracted).ok());
+  EXPECT_EQ(extracted, tar);
+}
+
 TEST_F(CarverTests, test_carve) {
   auto guid = createCarveGuid();
   std::string requestId = createCarveGuid();
@@ -164,6 +252,126 @@ TEST_F(CarverTests, test_schedule_carves) {
   ASSERT_FALSE(FakeCarverRunner::running());
 }
 
+TEST_F(CarverTests, test_resume_uploading_carves) {
+  std::string new_carve_guid;
+  auto s = osquery::carvePaths(getCarvePaths(), "request-id", new_carve_guid);
+  ASSERT_TRUE(s.ok());
+
+  // A carve left uploading was interrupted, and is carved again.
+  updateCarveValue(new_carve_guid, "status", kCarverStatusUploading);
+  {
+    FakeCarverRunner runner;
+    runner.start();
+    EXPECT_EQ(runner.carves(), 1);
+  }
+
+  std::string carve;
+  s = getDatabaseValue(kCarves, kCarverDBPrefix + new_carve_guid, carve);
+  ASSERT_TRUE(s.ok());
+
+  JSON tree;
+  ASSERT_TRUE(tree.fromString(carve).ok());
+  EXPECT_EQ(std::string(tree.doc()["status"].GetString()),
+            kCarverStatusSuccess);
+}
+
+TEST_F(CarverTests, test_resume_failed_upload) {
+  auto const block_size = FLAGS_carver_block_size;
+  auto const upload_threads = FLAGS_carver_upload_threads;
+  auto const guard = scope_guard::create([block_size, upload_threads]() {
+    FLAGS_carver_block_size = block_size;
+    FLAGS_carver_upload_threads = upload_threads;
+  });
+  FLAGS_carver_block_size = 512;
+  FLAGS_carver_upload_threads = 2;
+
+  std::string guid;
+  ASSERT_TRUE(osquery::carvePaths(getCarvePaths(), "request-id", guid).ok());
+
+  auto getStatus = [&guid]() {
+    std::string carve;
+    getDatabaseValue(kCarves, kCarverDBPrefix + guid, carve);
+
+    JSON tree;
+    tree.fromString(carve);
+    return std::string(tree.doc()["status"].GetString());
+  };
+
+  auto getUploadKeys = [&guid]() {
+    std::vector<std::string> keys;
+    scanDatabaseKeys(kCarves, keys, kCarverBlockDBPrefix + guid + ".");
+
+    std::string upload;
+    if (getDatabaseValue(kCarves, kCarverUploadDBPrefix + guid, upload).ok()) {
+      keys.push_back(kCarverUploadDBPrefix + guid);
+    }
+    return keys;
+  };
+
+  size_t block_count{0};
+  {
+    FakeTransportCarver carver(getCarvePaths(), guid, {3});
+    EXPECT_FALSE(carver.carve().ok());
+    EXPECT_EQ(carver.starts, 1U);
+    EXPECT_EQ(carver.posted_blocks.count(3), 0U);
+    block_count = carver.posted_blocks.size() + 1;
+    EXPECT_GT(block_count, 4U);
+  }
+
+  // The session and the uploaded blocks are kept for the next attempt
+  EXPECT_EQ(getStatus(), kCarverStatusPostFailed);
+  EXPECT_EQ(getUploadKeys().size(), block_count);
+
+  {
+    FakeTransportCarver carver(getCarvePaths(), guid, {});
+    EXPECT_TRUE(carver.carve().ok());
+    EXPECT_EQ(carver.starts, 0U);
+    EXPECT_EQ(carver.posted_blocks, std::set<size_t>{3});
+  }
+
+  EXPECT_EQ(getStatus(), kCarverStatusSuccess);
+  EXPECT_TRUE(getUploadKeys().empty());
+
+  deleteDatabaseValue(kCarves, kCarverDBPrefix + guid);
+}
+
+TEST_F(CarverTests, test_resume_post_failed_carves) {
+  {
+    // Reset the carves.
+    std::vector<std::string> carves;
+    scanDatabaseKeys(kCarves, carves, kCarverDBPrefix);
+    for (const auto& key : carves) {
+      deleteDatabaseValue(kCarves, key);
+    }
+  }
+
+  std::string guid;
+  ASSERT_TRUE(osquery::carvePaths(getCarvePaths(), "request-id", guid).ok());
+  updateCarveValue(guid, "status", kCarverStatusPostFailed);
+
+  // Without an upload session the carve failed before its upload started
+  setDatabaseValue(kCarves, kCarverBlockDBPrefix + guid + ".0", "");
+  {
+    FakeCarverRunner runner;
+    runner.start();
+    EXPECT_EQ(runner.carves(), 0);
+  }
+
+  std::vector<std::string> keys;
+  scanDatabaseKeys(kCarves, keys, kCarverBlockDBPrefix + guid + ".");
+  EXPECT_TRUE(keys.empty());
+
+  setDatabaseValue(kCarves, kCarverUploadDBPrefix + guid, "{}");
+  {
+    FakeCarverRunner runner;
+    runner.start();
+    EXPECT_EQ(runner.carves(), 1);
+  }
+
+  deleteDatabaseValue(kCarves, kCarverDBPrefix + guid);
+  deleteDatabaseValue(kCarves, kCarverUploadDBPrefix + guid);
+}
+
 TEST_F(CarverTests, test_expiration) {
   {
     // Reset the carves.
@@ -259,8 +467,8 @@ TEST_F(CarverTests, test_carve_files_not_exists) {
   const std::set<std::string> notExistsCarvePaths = {
       (getFilesToCarveDir() / "not_exists").string()};
   FakeCarver carve(notExistsCarvePaths, guid, requestId);
-  const auto carves = carve.carveAll();
-  EXPECT_TRUE(carves.empty());
+  const auto entries = carve.getCarveEntries();
+  EXPECT_TRUE(entries.empty());
 }
 
 TEST_F(CarverTests, test_compression_decompression) {
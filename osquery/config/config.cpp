@@ -22,6 +22,7 @@
 #include <osquery/config/packs.h>
 #include <osquery/core/flagalias.h>
 #include <osquery/core/flags.h>
+#include <osquery/core/query.h>
 #include <osquery/core/shutdown.h>
 #include <osquery/core/system.h>
 #include <osquery/core/tables.h>
@@ -31,6 +32,7 @@
 #include <osquery/events/events.h>
 #include <osquery/hashing/hashing.h>
 #include <osquery/logger/logger.h>
+#include <osquery/process/process.h>
 #include <osquery/registry/registry.h>
 #include <osquery/utils/conversions/split.h>
 #include <osquery/utils/conversions/trim.h>
@@ -119,6 +121,18 @@ DECLARE_string(pack_delimiter);
 const std::string kExecutingQuery{"executing_query"};
 const std::string kFailedQueries{"failed_queries"};
 
+/// The executing query key of a scheduler worker, see setExecutingQuerySlot.
+thread_local std::string kWorkerExecutingQuery;
+
+void setExecutingQuerySlot(size_t slot) {
+  kWorkerExecutingQuery = kExecutingQuery + "." + std::to_string(slot);
+}
+
+const std::string& getExecutingQueryKey() {
+  return kWorkerExecutingQuery.empty() ? kExecutingQuery
+                                       : kWorkerExecutingQuery;
+}
+
 // The config may be accessed and updated asynchronously; use mutexes.
 Mutex config_hash_mutex_;
 Mutex config_refresh_mutex_;
@@ -320,13 +334,28 @@ Schedule::Schedule() {
   // Parse the schedule's query denylist from backing storage.
   restoreScheduleDenylist(denylist_);
 
-  // Check if any queries were executing when the tool last stopped.
-  getDatabaseValue(kPersistentSettings, kExecutingQuery, failed_query_);
-  if (!failed_query_.empty()) {
-    LOG(WARNING) << "Scheduled query may have failed: " << failed_query_;
-    setDatabaseValue(kPersistentSettings, kExecutingQuery, "");
-    // Add this query name to the denylist and save the denylist.
-    denylist_[failed_query_] = getUnixTime() + 86400;
+  // Check if any queries were executing when the tool last stopped. When the
+  // scheduler runs queries on workers, each worker slot has its own key.
+  std::vector<std::string> keys;
+  scanDatabaseKeys(kPersistentSettings, keys, kExecutingQuery);
+
+  bool failed = false;
+  for (const auto& key : keys) {
+    std::string query_name;
+    getDatabaseValue(kPersistentSettings, key, query_name);
+    if (query_name.empty()) {
+      continue;
+    }
+
+    LOG(WARNING) << "Scheduled query may have failed: " << query_name;
+    setDatabaseValue(kPersistentSettings, key, "");
+    // Add this query name to the denylist.
+    denylist_[query_name] = getUnixTime() + 86400;
+    failed_query_ = query_name;
+    failed = true;
+  }
+
+  if (failed) {
     saveScheduleDenylist(denylist_);
   }
 }
@@ -923,8 +952,7 @@ Status Config::update(const ConfigMap& config) {
 
 void Config::purge() {
   // The first use of purge is removing expired query results.
-  std::vector<std::string> saved_queries;
-  scanDatabaseKeys(kQueries, saved_queries);
+  auto saved_queries = Query::getStoredQueryNames();
 
   auto queryExists = [schedule = static_cast<const Schedule*>(schedule_.get())](
                          const std::string& query_name) {
@@ -967,8 +995,7 @@ void Config::purge() {
 
     if (last_executed < getUnixTime() - 592200) {
       // Query has not run in the last week, expire results and interval.
-      deleteDatabaseValue(kQueries, saved_query);
-      deleteDatabaseValue(kQueries, saved_query + "epoch");
+      Query::deleteStoredResults(saved_query);
       deleteDatabaseValue(kPersistentSettings, "interval." + saved_query);
       deleteDatabaseValue(kPersistentSettings, "timestamp." + saved_query);
       VLOG(1) << "Expiring results for scheduled query: " << saved_query;
@@ -1018,11 +1045,16 @@ void ConfigParserPlugin::reset() {
   data_ = std::move(doc);
 }
 
+/// The increase of a resource counter, or 0 if it did not increase.
+static inline uint64_t counterDiff(uint64_t before, uint64_t after) {
+  return (after > before) ? after - before : 0;
+}
+
 void Config::recordQueryPerformance(const std::string& name,
                                     uint64_t delay_ms,
                                     uint64_t size,
-                                    const Row& r0,
-                                    const Row& r1) {
+                                    const ProcessResourceUsage& r0,
+                                    const ProcessResourceUsage& r1) {
   RecursiveLock lock(config_performance_mutex_);
   if (performance_.count(name) == 0) {
     performance_[name] = QueryPerformance();
@@ -1030,38 +1062,34 @@ void Config::recordQueryPerformance(const std::string& name,
 
   // Grab access to the non-const schedule item.
   auto& query = performance_.at(name);
-  if (!r1.at("user_time").empty() && !r0.at("user_time").empty()) {
-    auto ut1 = tryTo<long long>(r1.at("user_time"));
-    auto ut0 = tryTo<long long>(r0.at("user_time"));
-    auto diff = (ut1 && ut0) ? ut1.take() - ut0.take() : 0;
-    if (diff > 0) {
-      query.user_time += diff;
-      query.last_user_time = diff;
-    }
+  auto diff = counterDiff(r0.user_time, r1.user_time);
+  if (diff > 0) {
+    query.user_time += diff;
+    query.last_user_time = diff;
   }
 
-  if (!r1.at("system_time").empty() && !r0.at("system_time").empty()) {
-    auto st1 = tryTo<long long>(r1.at("system_time"));
-    auto st0 = tryTo<long long>(r0.at("system_time"));
-    auto diff = (st1 && st0) ? st1.take() - st0.take() : 0;
-    if (diff > 0) {
-      query.system_time += diff;
-      query.last_system_time = diff;
-    }
+  diff = counterDiff(r0.system_time, r1.system_time);
+  if (diff > 0) {
+    query.system_time += diff;
+    query.last_system_time = diff;
   }
 
-  if (!r1.at("resident_size").empty() && !r0.at("resident_size").empty()) {
-    auto rs1 = tryTo<long long>(r1.at("resident_size"));
-    auto rs0 = tryTo<long long>(r0.at("resident_size"));
-    auto diff = (rs1 && rs0) ? rs1.take() - rs0.take() : 0;
-    if (diff > 0) {
-      // Memory is stored as an average of RSS changes between query executions.
-      query.average_memory = (query.average_memory * query.executions) + diff;
-      query.average_memory = (query.average_memory / (query.executions + 1));
-      query.last_memory = diff;
-    }
+  diff = counterDiff(r0.resident_size, r1.resident_size);
+  if (diff > 0) {
+    // Memory is stored as an average of RSS changes between query executions.
+    query.average_memory = (query.average_memory * query.executions) + diff;
+    query.average_memory = (query.average_memory / (query.executions + 1));
+    query.last_memory = diff;
   }
 
+  query.last_page_faults = counterDiff(r0.page_faults, r1.page_faults);
+  query.page_faults += query.last_page_faults;
+  query.last_voluntary_context_switches = counterDiff(
+      r0.voluntary_context_switches, r1.voluntary_context_switches);
+  query.voluntary_context_switches += query.last_voluntary_context_switches;
+  query.last_bytes_read = counterDiff(r0.bytes_read, r1.bytes_read);
+  query.bytes_read += query.last_bytes_read;
+
   query.last_wall_time_ms = delay_ms;
   query.wall_time_ms += delay_ms;
   query.wall_time += (delay_ms / 1000);
@@ -1073,13 +1101,22 @@ void Config::recordQueryPerformance(const std::string& name,
      This is used by the next worker execution to denylist a query
      that triggered a watchdog resource limit. */
   if (!Initializer::isResourceLimitHit()) {
-    setDatabaseValue(kPersistentSettings, kExecutingQuery, "");
+    setDatabaseValue(kPersistentSettings, getExecutingQueryKey(), "");
   }
 }
 
+void Config::recordQueryStatementCache(const std::string& name,
+                                       uint64_t hits,
+                                       uint64_t misses) {
+  RecursiveLock lock(config_performance_mutex_);
+  auto& query = performance_[name];
+  query.statement_cache_hits += hits;
+  query.statement_cache_misses += misses;
+}
+
 void Config::recordQueryStart(const std::string& name) {
-  // There should only ever be a single executing query in the schedule.
-  setDatabaseValue(kPersistentSettings, kExecutingQuery, name);
+  // There is a single executing query per thread running the schedule.
+  setDatabaseValue(kPersistentSettings, getExecutingQueryKey(), name);
   // Store the time this query name last executed for later results eviction.
   // When configuration updates occur the previous schedule is searched for
   // 'stale' query names, aka those that have week-old or longer last execute
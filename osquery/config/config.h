@@ -30,10 +30,23 @@ class Pack;
 class Schedule;
 class ConfigParserPlugin;
 class ConfigRefreshRunner;
+struct ProcessResourceUsage;
 
 /// The name of the executing query within the single-threaded schedule.
 extern const std::string kExecutingQuery;
 
+/**
+ * @brief Record the queries executed by this thread under a worker slot.
+ *
+ * Scheduler workers run queries concurrently. Each records its executing
+ * query under its own key, so that a crash is blamed on a query that was
+ * actually running rather than the last one to start.
+ */
+void setExecutingQuerySlot(size_t slot);
+
+/// The persistent settings key naming the query executing on this thread.
+const std::string& getExecutingQueryKey();
+
 /**
  * @brief The programmatic representation of osquery's configuration
  *
@@ -87,14 +100,25 @@ class Config : private boost::noncopyable {
    * @param name The unique name of the scheduled item
    * @param delay_ms Number of milliseconds (wall time) taken by the query
    * @param size Number of characters generated by query
-   * @param r0 the process row before the query
-   * @param r1 the process row after the query
+   * @param r0 the process resource usage before the query
+   * @param r1 the process resource usage after the query
    */
   void recordQueryPerformance(const std::string& name,
                               uint64_t delay_ms,
                               uint64_t size,
-                              const Row& r0,
-                              const Row& r1);
+                              const ProcessResourceUsage& r0,
+                              const ProcessResourceUsage& r1);
+
+  /**
+   * @brief Record the prepared statement cache use of a scheduled query.
+   *
+   * @param name The unique name of the scheduled item
+   * @param hits Number of statements reused from the cache
+   * @param misses Number of statements prepared
+   */
+  void recordQueryStatementCache(const std::string& name,
+                                 uint64_t hits,
+                                 uint64_t misses);
 
   /**
    * @brief Record a query 'initialization', meaning the query will run.
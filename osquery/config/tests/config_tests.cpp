@@ -356,6 +356,33 @@ TEST_F(ConfigTests, test_schedule_denylist) {
   EXPECT_EQ(denylist.size(), 1U);
 }
 
+TEST_F(ConfigTests, test_executing_query_slots) {
+  // A scheduler worker records its executing query under its own slot.
+  std::thread worker([this]() {
+    setExecutingQuerySlot(2);
+    EXPECT_EQ(getExecutingQueryKey(), kExecutingQuery + ".2");
+    get().recordQueryStart("worker_query");
+  });
+  worker.join();
+  EXPECT_EQ(getExecutingQueryKey(), kExecutingQuery);
+
+  std::string query_name;
+  getDatabaseValue(kPersistentSettings, kExecutingQuery + ".2", query_name);
+  EXPECT_EQ(query_name, "worker_query");
+  getDatabaseValue(kPersistentSettings, kExecutingQuery, query_name);
+  EXPECT_TRUE(query_name.empty());
+
+  // On resume, the queries left executing on any worker are denylisted.
+  get().reset();
+  std::map<std::string, uint64_t> denylist;
+  restoreScheduleDenylist(denylist);
+  EXPECT_EQ(denylist.count("worker_query"), 1U);
+
+  getDatabaseValue(kPersistentSettings, kExecutingQuery + ".2", query_name);
+  EXPECT_TRUE(query_name.empty());
+  saveScheduleDenylist({});
+}
+
 TEST_F(ConfigTests, test_pack_noninline) {
   auto& rf = RegistryFactory::get();
   rf.registry("config")->add("test", std::make_shared<TestConfigPlugin>());
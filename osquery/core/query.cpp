@@ -9,6 +9,8 @@
 
 #include <algorithm>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <osquery/core/flagalias.h>
@@ -16,6 +18,8 @@
 #include <osquery/core/query.h>
 #include <osquery/database/database.h>
 #include <osquery/logger/logger.h>
+#include <osquery/utils/conversions/tryto.h>
+#include <osquery/utils/mutex.h>
 
 #include <osquery/utils/json/json.h>
 
@@ -32,14 +36,130 @@ FLAG(bool,
      "Use numeric JSON syntax for numeric values");
 FLAG_ALIAS(bool, log_numerics_as_numbers, logger_numerics);
 
-uint64_t Query::getPreviousEpoch() const {
-  uint64_t epoch = 0;
+/**
+ * @brief Key prefix for the distinct rows of a differential query.
+ *
+ * Rows are stored at "rows.<name length>.<name>.<row hash>". The length keeps
+ * the rows of a query apart from those of a query whose name it prefixes.
+ */
+const std::string kQueryRowsPrefix{"rows."};
+
+/// Length of a stored row hash, see RowHash::toString.
+const size_t kQueryRowHashSize{32};
+
+/// Maximum number of rows written in one database batch.
+const size_t kQueryRowsBatchSize{256};
+
+namespace {
+
+/**
+ * @brief The stored metadata of a scheduled query.
+ *
+ * Each query's state is read from the database once and then served from
+ * memory. Every update is written through to the database.
+ */
+struct QueryState {
+  /// True if results are stored under the query name.
+  bool exists{false};
+
+  /// The epoch of the stored results.
+  uint64_t epoch{0};
+
+  /// True if a counter was stored.
+  bool has_counter{false};
+
+  /// The last stored execution counter.
+  uint64_t counter{0};
+
+  /// The query SQL used for the stored results.
+  std::string sql;
+};
+
+/// Protects the state of every query and the database generation.
+Mutex kQueryStatesMutex;
+
+/// In-memory state of each query, keyed by query name.
+std::unordered_map<std::string, QueryState> kQueryStates;
+
+/// The database generation kQueryStates was loaded from.
+size_t kQueryStatesGeneration{0};
+
+inline uint64_t parseStoredNumber(const std::string& raw) {
+  return tryTo<unsigned long long>(raw, 10).takeOr(0ULL);
+}
+
+QueryState loadQueryState(const std::string& name) {
+  QueryState state;
+
+  // Only keys starting with the query name are scanned.
+  std::vector<std::string> keys;
+  scanDatabaseKeys(kQueries, keys, name);
+  state.exists = std::find(keys.begin(), keys.end(), name) != keys.end();
+
   std::string raw;
-  auto status = getDatabaseValue(kQueries, name_ + "epoch", raw);
-  if (status.ok()) {
-    epoch = std::stoull(raw);
+  if (getDatabaseValue(kQueries, name + "epoch", raw).ok()) {
+    state.epoch = parseStoredNumber(raw);
+  }
+
+  raw.clear();
+  if (getDatabaseValue(kQueries, name + "counter", raw).ok()) {
+    state.has_counter = true;
+    state.counter = parseStoredNumber(raw);
+  }
+
+  getDatabaseValue(kQueries, "query." + name, state.sql);
+  return state;
+}
+
+/// Get a copy of a query's state, loading it from the database if needed.
+QueryState getQueryState(const std::string& name) {
+  auto generation = databaseGeneration();
+  {
+    WriteLock lock(kQueryStatesMutex);
+    if (kQueryStatesGeneration != generation) {
+      // The database was reset or reopened, the states are stale.
+      kQueryStates.clear();
+      kQueryStatesGeneration = generation;
+    }
+
+    auto it = kQueryStates.find(name);
+    if (it != kQueryStates.end()) {
+      return it->second;
+    }
+  }
+
+  auto state = loadQueryState(name);
+  WriteLock lock(kQueryStatesMutex);
+  return kQueryStates.emplace(name, std::move(state)).first->second;
+}
+
+/// Apply a change to a query's state after it was written to the database.
+template <typename Function>
+void updateQueryState(const std::string& name, Function update) {
+  getQueryState(name);
+  WriteLock lock(kQueryStatesMutex);
+  update(kQueryStates[name]);
+}
+
+inline std::string getRowKey(const std::string& name, const RowHash& hash) {
+  return Query::getStoredRowsPrefix(name) + hash.toString();
+}
+
+Status getStoredRow(const std::string& name,
+                    const RowHash& hash,
+                    RowTyped& row) {
+  std::string json;
+  auto status = getDatabaseValue(kQueries, getRowKey(name, hash), json);
+  if (!status.ok()) {
+    return status;
   }
-  return epoch;
+  return deserializeRowJSON(json, row);
+}
+
+} // namespace
+
+uint64_t Query::getPreviousEpoch() const {
+  return getQueryState(name_).epoch;
 }
 
 uint64_t Query::getQueryCounter(bool is_reset,
@@ -56,10 +176,9 @@ uint64_t Query::getQueryCounter(bool is_reset,
     }
   }
 
-  std::string raw;
-  auto status = getDatabaseValue(kQueries, name_ + "counter", raw);
-  if (status.ok()) {
-    counter = std::stoull(raw) + 1;
+  auto state = getQueryState(name_);
+  if (state.has_counter) {
+    counter = state.counter + 1;
   }
   return counter;
 }
@@ -71,42 +190,119 @@ Status Query::getPreviousQueryResults(QueryDataSet& results) const {
     return status;
   }
 
-  status = deserializeQueryDataJSON(raw, results);
+  if (!isRowHashIndex(raw)) {
+    // Results stored before the row hash index are a single JSON array.
+    return deserializeQueryDataJSON(raw, results);
+  }
+
+  RowHashIndex index;
+  status = deserializeRowHashIndex(raw, index);
   if (!status.ok()) {
     return status;
   }
+
+  for (const auto& item : index) {
+    RowTyped row;
+    status = getStoredRow(name_, item.first, row);
+    if (!status.ok()) {
+      return Status::failure("Missing stored row " + item.first.toString() +
+                             " for query " + name_);
+    }
+    for (size_t i = 0; i < item.second; i++) {
+      results.insert(row);
+    }
+  }
   return Status::success();
 }
 
 Status Query::saveQueryResults(const std::string& json, uint64_t epoch) const {
-  auto status = setDatabaseValue(kQueries, name_, json);
+  auto status = setDatabaseBatch(
+      kQueries,
+      {std::make_pair(name_, json),
+       std::make_pair(name_ + "epoch", std::to_string(epoch))});
   if (!status.ok()) {
     return status;
   }
 
-  return setDatabaseValue(kQueries, name_ + "epoch", std::to_string(epoch));
+  updateQueryState(name_, [epoch](QueryState& state) {
+    state.exists = true;
+    state.epoch = epoch;
+  });
+  return Status::success();
+}
+
+std::string Query::getStoredRowsPrefix(const std::string& name) {
+  return kQueryRowsPrefix + std::to_string(name.size()) + "." + name + ".";
+}
+
+bool Query::isStoredRowsKey(const std::string& key) {
+  if (key.compare(0, kQueryRowsPrefix.size(), kQueryRowsPrefix) != 0) {
+    return false;
+  }
+
+  // A query may be named "rows.", only keys in the exact layout are rows.
+  auto length_end = key.find('.', kQueryRowsPrefix.size());
+  if (length_end == std::string::npos) {
+    return false;
+  }
+
+  auto length = tryTo<unsigned long long>(
+      key.substr(kQueryRowsPrefix.size(), length_end - kQueryRowsPrefix.size()),
+      10);
+  if (length.isError() ||
+      key.size() != length_end + length.get() + kQueryRowHashSize + 2 ||
+      key[length_end + length.get() + 1] != '.') {
+    return false;
+  }
+
+  RowHash hash;
+  return RowHash::fromString(key.substr(key.size() - kQueryRowHashSize), hash);
+}
+
+Status Query::deleteStoredRows(const std::string& name) {
+  // Only keys ending with a row hash are within the range.
+  auto prefix = getStoredRowsPrefix(name);
+  return deleteDatabaseRange(kQueries,
+                             prefix + std::string(kQueryRowHashSize, '0'),
+                             prefix + std::string(kQueryRowHashSize, 'f'));
+}
+
+Status Query::deleteStoredResults(const std::string& name) {
+  deleteDatabaseValue(kQueries, name);
+  deleteDatabaseValue(kQueries, name + "epoch");
+  updateQueryState(name, [](QueryState& state) {
+    state.exists = false;
+    state.epoch = 0;
+  });
+  return deleteStoredRows(name);
 }
 
 std::vector<std::string> Query::getStoredQueryNames() {
+  std::vector<std::string> keys;
+  scanDatabaseKeys(kQueries, keys);
+
   std::vector<std::string> results;
-  scanDatabaseKeys(kQueries, results);
+  for (auto& key : keys) {
+    if (!isStoredRowsKey(key)) {
+      results.push_back(std::move(key));
+    }
+  }
   return results;
 }
 
 bool Query::isQueryNameInDatabase() const {
-  auto names = Query::getStoredQueryNames();
-  return std::find(names.begin(), names.end(), name_) != names.end();
+  return getQueryState(name_).exists;
 }
 
 static inline void saveQuery(const std::string& name,
                              const std::string& query) {
-  setDatabaseValue(kQueries, "query." + name, query);
+  if (setDatabaseValue(kQueries, "query." + name, query).ok()) {
+    updateQueryState(name, [&query](QueryState& state) { state.sql = query; });
+  }
 }
 
 bool Query::isNewQuerySql() const {
-  std::string query;
-  getDatabaseValue(kQueries, "query." + name_, query);
-  return (query != query_);
+  return (getQueryState(name_).sql != query_);
 }
 
 void Query::getQueryStatus(uint64_t epoch,
@@ -134,7 +330,17 @@ Status Query::incrementCounter(bool is_reset,
                                bool reset_has_all_records,
                                uint64_t& counter) const {
   counter = getQueryCounter(is_reset, reset_has_all_records);
-  return setDatabaseValue(kQueries, name_ + "counter", std::to_string(counter));
+  auto status =
+      setDatabaseValue(kQueries, name_ + "counter", std::to_string(counter));
+  if (!status.ok()) {
+    return status;
+  }
+
+  updateQueryState(name_, [counter](QueryState& state) {
+    state.has_counter = true;
+    state.counter = counter;
+  });
+  return Status::success();
 }
 
 Status Query::addNewEvents(QueryDataTyped current_qd,
@@ -168,46 +374,136 @@ Status Query::addNewResults(QueryDataTyped current_qd,
   bool new_query_sql = false;
   getQueryStatus(current_epoch, new_query_epoch, new_query_sql);
 
-  // Use a 'target' avoid copying the query data when serializing and saving.
-  // If a differential is requested and needed the target remains the original
-  // query data, otherwise the content is moved to the differential's added set.
-  const auto* target_gd = &current_qd;
-  bool update_db = true;
-  if (!new_query_epoch) {
-    // Get the rows from the last run of this query name.
-    QueryDataSet previous_qd;
-    auto status = getPreviousQueryResults(previous_qd);
+  // The stored index describes the rows persisted by the last run, even if
+  // the epoch changed, so only rows that changed are written or deleted.
+  std::string raw;
+  auto read_status = getDatabaseValue(kQueries, name_, raw);
+  if (!new_query_epoch && !read_status.ok()) {
+    return read_status;
+  }
+
+  RowHashIndex stored;
+  RowHashIndex legacy;
+  std::unordered_map<RowHash, RowTyped, RowHashHasher> legacy_rows;
+  bool has_index = isRowHashIndex(raw);
+  if (has_index) {
+    auto status = deserializeRowHashIndex(raw, stored);
     if (!status.ok()) {
       return status;
     }
+  } else {
+    // Results from before the row hash index are a JSON array, hash them
+    // once and store them using the new format below.
+    if (!new_query_epoch) {
+      QueryDataSet previous_qd;
+      auto status = deserializeQueryDataJSON(raw, previous_qd);
+      if (!status.ok()) {
+        return status;
+      }
+      for (auto& row : previous_qd) {
+        auto hash = hashRow(row);
+        legacy[hash]++;
+        legacy_rows.emplace(hash, row);
+      }
+    }
 
-    // Calculate the differential between previous and current query results.
-    dr = diff(previous_qd, current_qd);
+    // Only results stored before may have left rows behind.
+    if (read_status.ok()) {
+      deleteStoredRows(name_);
+    }
+  }
 
-    update_db = (!dr.added.empty() || !dr.removed.empty());
-  } else {
-    dr.added = std::move(current_qd);
-    target_gd = &dr.added;
+  // Calculate the differential between previous and current query results.
+  const RowHashIndex empty;
+  const auto& previous =
+      new_query_epoch ? empty : (has_index ? stored : legacy);
+  auto hd = diffRowHashes(previous, current_qd);
+
+  dr = DiffResults();
+  for (const auto& item : hd.removed) {
+    RowTyped row;
+    auto legacy_row = legacy_rows.find(item.first);
+    if (legacy_row != legacy_rows.end()) {
+      row = legacy_row->second;
+    } else if (!getStoredRow(name_, item.first, row).ok()) {
+      VLOG(1) << "Missing stored row " << item.first.toString()
+              << " for query " << name_;
+      continue;
+    }
+    for (size_t i = 0; i < item.second; i++) {
+      dr.removed.push_back(row);
+    }
   }
+  // Report removed rows in the same order as the ordered differential.
+  std::sort(dr.removed.begin(), dr.removed.end());
+
+  bool update_db =
+      new_query_epoch || !hd.added.empty() || !hd.removed.empty();
+  if (update_db || !has_index) {
+    // Write the distinct rows that are not stored yet, then the index, and
+    // finally delete rows no longer referenced.
+    std::unordered_set<RowHash, RowHashHasher> written;
+    DatabaseStringValueList batch;
+    for (size_t i = 0; i < current_qd.size(); i++) {
+      const auto& hash = hd.hashes[i];
+      if (stored.count(hash) > 0 || !written.insert(hash).second) {
+        continue;
+      }
 
-  if (update_db) {
-    // Replace the "previous" query data with the current.
-    std::string json;
-    auto status = serializeQueryDataJSON(*target_gd, json, true);
-    if (!status.ok()) {
-      return status;
+      std::string json;
+      auto status = serializeRowJSON(current_qd[i], json, true);
+      if (!status.ok()) {
+        return status;
+      }
+      batch.push_back(std::make_pair(getRowKey(name_, hash), std::move(json)));
+      if (batch.size() >= kQueryRowsBatchSize) {
+        status = setDatabaseBatch(kQueries, batch);
+        if (!status.ok()) {
+          return status;
+        }
+        batch.clear();
+      }
     }
 
-    status = saveQueryResults(json, current_epoch);
+    // The index, epoch, and counter are written together.
+    std::string index;
+    serializeRowHashIndex(hd.index, index);
+    batch.push_back(std::make_pair(name_, std::move(index)));
+    batch.push_back(
+        std::make_pair(name_ + "epoch", std::to_string(current_epoch)));
+    if (update_db) {
+      counter = getQueryCounter(new_query_epoch, true);
+      batch.push_back(
+          std::make_pair(name_ + "counter", std::to_string(counter)));
+    }
+    auto status = setDatabaseBatch(kQueries, batch);
     if (!status.ok()) {
       return status;
     }
+
+    updateQueryState(
+        name_, [current_epoch, update_db, counter](QueryState& state) {
+          state.exists = true;
+          state.epoch = current_epoch;
+          if (update_db) {
+            state.has_counter = true;
+            state.counter = counter;
+          }
+        });
+
+    for (const auto& item : stored) {
+      if (hd.index.count(item.first) == 0) {
+        deleteDatabaseValue(kQueries, getRowKey(name_, item.first));
+      }
+    }
   }
 
-  if (update_db || new_query_epoch) {
-    auto status = incrementCounter(new_query_epoch, true, counter);
-    if (!status.ok()) {
-      return status;
+  if (new_query_epoch) {
+    dr.added = std::move(current_qd);
+  } else {
+    dr.added.reserve(hd.added.size());
+    for (auto i : hd.added) {
+      dr.added.push_back(std::move(current_qd[i]));
     }
   }
   return Status::success();
@@ -248,6 +544,11 @@ inline void addLegacyFieldsAndDecorations(const QueryLogItem& item,
   // Apply field indicating if numerics are serialized as numbers
   doc.add("numerics", FLAGS_logger_numerics, obj);
 
+  // Only a chunked snapshot that failed partway carries this field.
+  if (item.incomplete) {
+    doc.add("incomplete", true, obj);
+  }
+
   // Append the decorations.
   if (!item.decorations.empty()) {
     auto dec_obj = doc.getObject();
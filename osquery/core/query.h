@@ -65,6 +65,9 @@ struct QueryLogItem {
   /// A set of additional fields to emit with the log line.
   std::map<std::string, std::string> decorations;
 
+  /// Set on the last chunk of a snapshot when the query failed partway.
+  bool incomplete{false};
+
   /// equals operator
   bool operator==(const QueryLogItem& comp) const {
     return (comp.results == results) && (comp.name == name);
@@ -142,6 +145,10 @@ class Query {
    * This method retrieves the data from RocksDB and returns the data in a
    * std::multiset, in-order to apply binary search in diff function.
    *
+   * Results are stored as a row hash index under the query name with each
+   * distinct row stored under getStoredRowsPrefix. Results stored as a single
+   * JSON array by previous versions are also accepted.
+   *
    * @param results the output QueryDataSet struct.
    *
    * @return the success or failure of the operation.
@@ -191,6 +198,9 @@ class Query {
   /**
    * @brief Check if a given scheduled query exists in the database.
    *
+   * The epoch, counter, SQL, and existence of a query are read from the
+   * database once, then served from memory and written through on change.
+   *
    * @return true if the scheduled query already exists in the database.
    */
   bool isQueryNameInDatabase() const;
@@ -220,6 +230,9 @@ class Query {
    * to the database using addNewResults and get back a data structure
    * indicating what rows in the query's results have changed.
    *
+   * The differential is computed using the stored row hash index, only rows
+   * that were added are written and only rows that were removed are read.
+   *
    * @param qd the QueryDataTyped object containing query results to store.
    * @param epoch the epoch associated with QueryData
    * @param counter the output that holds the query execution counter.
@@ -253,12 +266,24 @@ class Query {
    *
    * If you'd like to perform some database maintenance, getStoredQueryNames()
    * allows you to get a vector of the names of all queries which are
-   * currently stored in RocksDB
+   * currently stored in RocksDB. Keys holding stored rows are not included.
    *
    * @return a vector containing the string names of all scheduled queries.
    */
   static std::vector<std::string> getStoredQueryNames();
 
+  /// The kQueries key prefix for the distinct rows of a query.
+  static std::string getStoredRowsPrefix(const std::string& name);
+
+  /// Check if a kQueries key holds a stored row rather than a query name.
+  static bool isStoredRowsKey(const std::string& key);
+
+  /// Remove the distinct rows stored for a query.
+  static Status deleteStoredRows(const std::string& name);
+
+  /// Remove the stored results, epoch, and rows of a query.
+  static Status deleteStoredResults(const std::string& name);
+
  private:
   /// The scheduled query's query string.
   std::string query_;
@@ -75,6 +75,17 @@ enum class ColumnOptions {
 
   // This sets the collating sequence to NOCASE
   COLLATENOCASE = 32,
+
+  /*
+   * @brief Constraints on this INDEX or OPTIMIZED column only filter rows.
+   *
+   * By default a constrained INDEX or OPTIMIZED column may change what the
+   * table generates, for example processes reads /proc/<pid> for any pid,
+   * including threads it does not list. Set this when the table generates a
+   * subset of its unconstrained rows, so the constraint can be answered by
+   * filtering cached unconstrained results.
+   */
+  FILTER_ONLY = 64,
 };
 
 /// Treat column options as a set of flags.
@@ -9,10 +9,168 @@
 
 #include "diff_results.h"
 
+#include <cstring>
+
 namespace rj = rapidjson;
 
 namespace osquery {
 
+namespace {
+
+/// Marks stored content as a serialized RowHashIndex.
+const std::string kRowHashIndexHeader{"rowhash:1\n"};
+
+/// Read 8 bytes as a little-endian integer, whatever the host byte order.
+inline uint64_t readLittleEndian64(const uint8_t* bytes) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < sizeof(value); i++) {
+    value |= static_cast<uint64_t>(bytes[i]) << (i * 8);
+  }
+  return value;
+}
+
+/// Append an integer in little-endian order, so row hashes are portable.
+inline void appendLittleEndian64(std::string& buffer, uint64_t value) {
+  char bytes[sizeof(value)];
+  for (size_t i = 0; i < sizeof(value); i++) {
+    bytes[i] = static_cast<char>((value >> (i * 8)) & 0xff);
+  }
+  buffer.append(bytes, sizeof(bytes));
+}
+
+inline uint64_t rotl64(uint64_t x, int8_t r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t fmix64(uint64_t k) {
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ULL;
+  k ^= k >> 33;
+  return k;
+}
+
+/// MurmurHash3 x64 128-bit, the digest is not used for security purposes.
+RowHash murmur3(const std::string& data) {
+  const auto* bytes = reinterpret_cast<const uint8_t*>(data.data());
+  const size_t len = data.size();
+  const size_t nblocks = len / 16;
+  const uint64_t c1 = 0x87c37b91114253d5ULL;
+  const uint64_t c2 = 0x4cf5ad432745937fULL;
+
+  uint64_t h1 = 0;
+  uint64_t h2 = 0;
+  for (size_t i = 0; i < nblocks; i++) {
+    uint64_t k1 = readLittleEndian64(bytes + i * 16);
+    uint64_t k2 = readLittleEndian64(bytes + i * 16 + 8);
+
+    k1 *= c1;
+    k1 = rotl64(k1, 31);
+    k1 *= c2;
+    h1 ^= k1;
+    h1 = rotl64(h1, 27);
+    h1 += h2;
+    h1 = h1 * 5 + 0x52dce729;
+
+    k2 *= c2;
+    k2 = rotl64(k2, 33);
+    k2 *= c1;
+    h2 ^= k2;
+    h2 = rotl64(h2, 31);
+    h2 += h1;
+    h2 = h2 * 5 + 0x38495ab5;
+  }
+
+  const uint8_t* tail = bytes + nblocks * 16;
+  uint64_t k1 = 0;
+  uint64_t k2 = 0;
+  const size_t rem = len & 15;
+  for (size_t i = rem; i > 8; i--) {
+    k2 ^= static_cast<uint64_t>(tail[i - 1]) << ((i - 9) * 8);
+  }
+  if (rem > 8) {
+    k2 *= c2;
+    k2 = rotl64(k2, 33);
+    k2 *= c1;
+    h2 ^= k2;
+  }
+
+  for (size_t i = (rem > 8) ? 8 : rem; i > 0; i--) {
+    k1 ^= static_cast<uint64_t>(tail[i - 1]) << ((i - 1) * 8);
+  }
+  if (rem > 0) {
+    k1 *= c1;
+    k1 = rotl64(k1, 31);
+    k1 *= c2;
+    h1 ^= k1;
+  }
+
+  h1 ^= len;
+  h2 ^= len;
+  h1 += h2;
+  h2 += h1;
+  h1 = fmix64(h1);
+  h2 = fmix64(h2);
+  h1 += h2;
+  h2 += h1;
+
+  RowHash hash;
+  hash.high = h1;
+  hash.low = h2;
+  return hash;
+}
+
+inline void appendSized(std::string& buffer, const char* data, size_t size) {
+  appendLittleEndian64(buffer, size);
+  buffer.append(data, size);
+}
+
+/**
+ * @brief Append a column value and its type to the canonical row encoding.
+ *
+ * Numbers are encoded in a fixed byte order: stored row hashes must not
+ * depend on the host that computed them.
+ */
+class RowHashVisitor : public boost::static_visitor<void> {
+ public:
+  explicit RowHashVisitor(std::string& buffer) : buffer_(buffer) {}
+
+  void operator()(long long i) const {
+    buffer_.push_back('i');
+    appendLittleEndian64(buffer_, static_cast<uint64_t>(i));
+  }
+
+  void operator()(double d) const {
+    static_assert(sizeof(d) == sizeof(uint64_t), "double must be 64 bits");
+    uint64_t bits;
+    std::memcpy(&bits, &d, sizeof(bits));
+    buffer_.push_back('d');
+    appendLittleEndian64(buffer_, bits);
+  }
+
+  void operator()(const std::string& s) const {
+    buffer_.push_back('s');
+    appendSized(buffer_, s.data(), s.size());
+  }
+
+ private:
+  std::string& buffer_;
+};
+
+inline int hexValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  } else if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  } else if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+} // namespace
+
 Status serializeDiffResults(const DiffResults& d,
                             JSON& doc,
                             rj::Document& obj,
@@ -69,4 +227,123 @@ DiffResults diff(QueryDataSet& old, QueryDataTyped& current) {
   return r;
 }
 
+std::string RowHash::toString() const {
+  static const char kHex[] = "0123456789abcdef";
+  std::string hex(32, '0');
+  for (size_t i = 0; i < 16; i++) {
+    hex[15 - i] = kHex[(high >> (i * 4)) & 0xf];
+    hex[31 - i] = kHex[(low >> (i * 4)) & 0xf];
+  }
+  return hex;
+}
+
+bool RowHash::fromString(const std::string& hex, RowHash& hash) {
+  if (hex.size() != 32) {
+    return false;
+  }
+
+  RowHash parsed;
+  for (size_t i = 0; i < 32; i++) {
+    auto value = hexValue(hex[i]);
+    if (value < 0) {
+      return false;
+    }
+    auto& half = (i < 16) ? parsed.high : parsed.low;
+    half = (half << 4) | static_cast<uint64_t>(value);
+  }
+  hash = parsed;
+  return true;
+}
+
+RowHash hashRow(const RowTyped& r) {
+  // Reuse the encoding buffer, rows are hashed in tight loops.
+  thread_local std::string buffer;
+  buffer.clear();
+
+  RowHashVisitor visitor(buffer);
+  for (const auto& column : r) {
+    appendSized(buffer, column.first.data(), column.first.size());
+    boost::apply_visitor(visitor, column.second);
+  }
+  return murmur3(buffer);
+}
+
+RowHashDiff diffRowHashes(const RowHashIndex& old_, const QueryDataTyped& new_) {
+  RowHashDiff r;
+  r.hashes.reserve(new_.size());
+  r.index.reserve(new_.size());
+
+  // Each occurrence in the new results consumes one occurrence from the old.
+  // The remaining old occurrences were removed.
+  r.removed = old_;
+  for (size_t i = 0; i < new_.size(); i++) {
+    auto hash = hashRow(new_[i]);
+    r.hashes.push_back(hash);
+    r.index[hash]++;
+
+    auto item = r.removed.find(hash);
+    if (item != r.removed.end()) {
+      if (--item->second == 0) {
+        r.removed.erase(item);
+      }
+    } else {
+      r.added.push_back(i);
+    }
+  }
+
+  return r;
+}
+
+void serializeRowHashIndex(const RowHashIndex& index, std::string& content) {
+  content.clear();
+  content.reserve(kRowHashIndexHeader.size() + index.size() * 33);
+  content.append(kRowHashIndexHeader);
+  for (const auto& item : index) {
+    content.append(item.first.toString());
+    if (item.second > 1) {
+      content.push_back(' ');
+      content.append(std::to_string(item.second));
+    }
+    content.push_back('\n');
+  }
+}
+
+Status deserializeRowHashIndex(const std::string& content,
+                               RowHashIndex& index) {
+  if (!isRowHashIndex(content)) {
+    return Status::failure("Content is not a row hash index");
+  }
+
+  size_t pos = kRowHashIndexHeader.size();
+  while (pos < content.size()) {
+    auto end = content.find('\n', pos);
+    if (end == std::string::npos) {
+      end = content.size();
+    }
+
+    RowHash hash;
+    if (end - pos < 32 || !RowHash::fromString(content.substr(pos, 32), hash)) {
+      return Status::failure("Invalid row hash index entry");
+    }
+
+    size_t count = 1;
+    if (end - pos > 33) {
+      try {
+        count = std::stoull(content.substr(pos + 33, end - pos - 33));
+      } catch (const std::exception& /* e */) {
+        return Status::failure("Invalid row hash index count");
+      }
+    }
+
+    index[hash] += count;
+    pos = end + 1;
+  }
+  return Status::success();
+}
+
+bool isRowHashIndex(const std::string& content) {
+  return content.compare(
+             0, kRowHashIndexHeader.size(), kRowHashIndexHeader) == 0;
+}
+
 } // namespace osquery
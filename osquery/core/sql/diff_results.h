@@ -9,6 +9,11 @@
 
 #pragma once
 
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include <osquery/core/sql/query_data.h>
 
 namespace osquery {
@@ -96,4 +101,93 @@ Status serializeDiffResultsJSON(const DiffResults& d,
  */
 DiffResults diff(QueryDataSet& old_, QueryDataTyped& new_);
 
+/**
+ * @brief A 128-bit digest of a RowTyped.
+ *
+ * The digest covers each column name, value type, and value. Two rows with
+ * the same digest are treated as equal by the hashed differential.
+ */
+struct RowHash {
+  uint64_t high{0};
+  uint64_t low{0};
+
+  bool operator==(const RowHash& other) const {
+    return high == other.high && low == other.low;
+  }
+
+  bool operator!=(const RowHash& other) const {
+    return !(*this == other);
+  }
+
+  bool operator<(const RowHash& other) const {
+    return (high == other.high) ? low < other.low : high < other.high;
+  }
+
+  /// Lowercase, 32 character, hex representation.
+  std::string toString() const;
+
+  /// Inverse of toString, returns false if the input is not a valid digest.
+  static bool fromString(const std::string& hex, RowHash& hash);
+};
+
+/// std::hash-style functor for RowHash keyed containers.
+struct RowHashHasher {
+  size_t operator()(const RowHash& hash) const {
+    return static_cast<size_t>(hash.low ^ (hash.high * 0x9e3779b97f4a7c15ULL));
+  }
+};
+
+/// A multiset of rows represented by digest and number of occurrences.
+using RowHashIndex = std::unordered_map<RowHash, size_t, RowHashHasher>;
+
+/// Compute the digest of a row.
+RowHash hashRow(const RowTyped& r);
+
+/**
+ * @brief The differential of a row hash index and a new set of results.
+ *
+ * Only digests are compared, the previous rows are never materialized. Callers
+ * look up the content of removed rows using the digest.
+ */
+struct RowHashDiff {
+  /// Positions, in the new results, of rows that were added.
+  std::vector<size_t> added;
+
+  /// Digests no longer present and the number of occurrences removed.
+  RowHashIndex removed;
+
+  /// The index describing the new results.
+  RowHashIndex index;
+
+  /// The digest of each row in the new results, by position.
+  std::vector<RowHash> hashes;
+};
+
+/**
+ * @brief Diff a row hash index and QueryDataTyped object.
+ *
+ * This has the same multiset semantics as diff but runs in time linear to the
+ * number of rows and only needs the digests of the "old" results.
+ *
+ * @param old_ the index of the "old" set of results.
+ * @param new_ the "new" set of results.
+ *
+ * @return a RowHashDiff which indicates the change from old_ to new_
+ */
+RowHashDiff diffRowHashes(const RowHashIndex& old_, const QueryDataTyped& new_);
+
+/**
+ * @brief Serialize a row hash index into a compact string.
+ *
+ * The format is a header line followed by one line per digest, the digest
+ * is followed by the number of occurrences when a row repeats.
+ */
+void serializeRowHashIndex(const RowHashIndex& index, std::string& content);
+
+/// Inverse of serializeRowHashIndex.
+Status deserializeRowHashIndex(const std::string& content, RowHashIndex& index);
+
+/// Check if stored content uses the serializeRowHashIndex format.
+bool isRowHashIndex(const std::string& content);
+
 } // namespace osquery
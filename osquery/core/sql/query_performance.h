@@ -55,6 +55,30 @@ struct QueryPerformance {
 
   /// Total bytes for the query
   std::uint64_t output_size{0};
+
+  /// Total page faults
+  std::uint64_t page_faults{0};
+
+  /// Page faults of the latest execution
+  std::uint64_t last_page_faults{0};
+
+  /// Total voluntary context switches
+  std::uint64_t voluntary_context_switches{0};
+
+  /// Voluntary context switches of the latest execution
+  std::uint64_t last_voluntary_context_switches{0};
+
+  /// Total bytes read from storage
+  std::uint64_t bytes_read{0};
+
+  /// Bytes read from storage by the latest execution
+  std::uint64_t last_bytes_read{0};
+
+  /// Total statements executed from the prepared statement cache
+  std::uint64_t statement_cache_hits{0};
+
+  /// Total statements prepared because they were not cached
+  std::uint64_t statement_cache_misses{0};
 };
 
 } // namespace osquery
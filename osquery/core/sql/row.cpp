@@ -14,6 +14,42 @@ namespace rj = rapidjson;
 
 namespace osquery {
 
+namespace {
+
+/// Leading byte of a binary encoded row, JSON rows start with '{'.
+const char kRowBinaryVersion{'\x01'};
+
+/**
+ * Values are written offset by one so that an encoded row never contains a
+ * NUL byte outside of column values; some database plugins store text.
+ */
+inline void appendVarint(std::string& out, uint64_t value) {
+  value += 1;
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+inline bool readVarint(const std::string& in, size_t& pos, uint64_t& value) {
+  value = 0;
+  for (size_t shift = 0; shift < 64 && pos < in.size(); shift += 7) {
+    auto byte = static_cast<uint8_t>(in[pos++]);
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      if (value == 0) {
+        return false;
+      }
+      value -= 1;
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
 Status serializeRow(const Row& r,
                     const ColumnNames& cols,
                     JSON& doc,
@@ -143,4 +179,84 @@ Status deserializeRowJSON(const std::string& json, RowTyped& r) {
   return deserializeRow(doc.doc(), r);
 }
 
+size_t RowColumnDictionary::add(const std::string& column) {
+  auto it = ids_.find(column);
+  if (it != ids_.end()) {
+    return it->second;
+  }
+
+  auto id = names_.size();
+  names_.push_back(column);
+  ids_.emplace(column, id);
+  return id;
+}
+
+const std::string* RowColumnDictionary::name(size_t id) const {
+  return (id < names_.size()) ? &names_[id] : nullptr;
+}
+
+std::string RowColumnDictionary::serialize() const {
+  std::string content;
+  for (const auto& name : names_) {
+    content.append(name);
+    content.push_back('\n');
+  }
+  return content;
+}
+
+Status RowColumnDictionary::deserialize(const std::string& content) {
+  names_.clear();
+  ids_.clear();
+
+  size_t pos = 0;
+  while (pos < content.size()) {
+    auto end = content.find('\n', pos);
+    if (end == std::string::npos) {
+      return Status::failure("Truncated column dictionary");
+    }
+    add(content.substr(pos, end - pos));
+    pos = end + 1;
+  }
+  return Status::success();
+}
+
+void serializeRowBinary(const Row& r,
+                        RowColumnDictionary& dictionary,
+                        std::string& out) {
+  out.clear();
+  out.push_back(kRowBinaryVersion);
+  for (const auto& i : r) {
+    appendVarint(out, dictionary.add(i.first));
+    appendVarint(out, i.second.size());
+    out.append(i.second);
+  }
+}
+
+Status deserializeRowBinary(const std::string& in,
+                            const RowColumnDictionary& dictionary,
+                            Row& r) {
+  if (in.empty() || in[0] != kRowBinaryVersion) {
+    return Status::failure("Unknown row encoding");
+  }
+
+  size_t pos = 1;
+  while (pos < in.size()) {
+    uint64_t id = 0;
+    uint64_t length = 0;
+    if (!readVarint(in, pos, id) || !readVarint(in, pos, length) ||
+        length > in.size() - pos) {
+      return Status::failure("Truncated binary row");
+    }
+
+    const auto* name = dictionary.name(static_cast<size_t>(id));
+    if (name == nullptr) {
+      return Status::failure("Unknown column identifier in binary row");
+    }
+
+    r[*name] = in.substr(pos, static_cast<size_t>(length));
+    pos += static_cast<size_t>(length);
+  }
+  return Status::success();
+}
+
 } // namespace osquery
@@ -11,6 +11,7 @@
 
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <boost/lexical_cast.hpp>
@@ -145,4 +146,65 @@ Status deserializeRowJSON(const std::string& json, Row& r);
  */
 Status deserializeRowJSON(const std::string& json, RowTyped& r);
 
+/**
+ * @brief A dictionary of column names used by the binary Row encoding.
+ *
+ * Column names are stored once, encoded rows refer to each column by its
+ * position in the dictionary. Columns are only ever appended so a row
+ * encoded with an older dictionary can be decoded with a newer one.
+ */
+class RowColumnDictionary {
+ public:
+  /// Get the identifier of a column, adding the column if it is new.
+  size_t add(const std::string& column);
+
+  /// Get the name of a column identifier, nullptr if it is not known.
+  const std::string* name(size_t id) const;
+
+  /// The number of known columns.
+  size_t size() const {
+    return names_.size();
+  }
+
+  /// Serialize the dictionary as newline-separated column names.
+  std::string serialize() const;
+
+  /// Inverse of serialize, replaces the content of the dictionary.
+  Status deserialize(const std::string& content);
+
+ private:
+  /// Column names indexed by identifier.
+  std::vector<std::string> names_;
+
+  /// Column identifiers indexed by name.
+  std::unordered_map<std::string, size_t> ids_;
+};
+
+/**
+ * @brief Serialize a Row object into a compact binary string.
+ *
+ * Each column is written as a varint column identifier followed by a varint
+ * length and the value bytes. New column names are added to the dictionary.
+ *
+ * @param r the Row to serialize.
+ * @param dictionary the column dictionary, may be appended to.
+ * @param out [output] the output binary string.
+ */
+void serializeRowBinary(const Row& r,
+                        RowColumnDictionary& dictionary,
+                        std::string& out);
+
+/**
+ * @brief Deserialize a Row object from a binary string.
+ *
+ * @param in the input from serializeRowBinary.
+ * @param dictionary the column dictionary used when serializing.
+ * @param r [output] the output Row structure.
+ *
+ * @return Status indicating the success or failure of the operation
+ */
+Status deserializeRowBinary(const std::string& in,
+                            const RowColumnDictionary& dictionary,
+                            Row& r);
+
 } // namespace osquery
@@ -46,6 +46,16 @@ class TableRow {
    */
   virtual Status serialize(JSON& doc, rapidjson::Value& obj) const = 0;
 
+  /**
+   * Write the values of the given columns, in order, as a JSON array.
+   *
+   * Columns without a value are written as null. The default implementation
+   * writes the string values from the Row conversion.
+   */
+  virtual void serializeValues(
+      const std::vector<std::string>& columns,
+      rapidjson::Writer<rapidjson::StringBuffer>& writer) const;
+
   /**
    * Clone this row.
    */
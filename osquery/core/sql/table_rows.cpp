@@ -13,6 +13,23 @@ namespace rj = rapidjson;
 
 namespace osquery {
 
+void TableRow::serializeValues(
+    const std::vector<std::string>& columns,
+    rj::Writer<rj::StringBuffer>& writer) const {
+  auto row = static_cast<Row>(*this);
+  writer.StartArray();
+  for (const auto& column : columns) {
+    auto it = row.find(column);
+    if (it == row.end()) {
+      writer.Null();
+    } else {
+      writer.String(it->second.data(),
+                    static_cast<rj::SizeType>(it->second.size()));
+    }
+  }
+  writer.EndArray();
+}
+
 Status serializeTableRows(const TableRows& rows, JSON& doc, rj::Document& arr) {
   for (const auto& r : rows) {
     auto row_obj = doc.getObject();
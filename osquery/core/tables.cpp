@@ -11,21 +11,67 @@
 
 #include <osquery/core/flags.h>
 #include <osquery/core/tables.h>
-#include <osquery/database/database.h>
 #include <osquery/logger/logger.h>
 #include <osquery/registry/registry_factory.h>
 #include <osquery/utils/conversions/tryto.h>
+#include <osquery/utils/mutex.h>
 
+#include <algorithm>
+#include <chrono>
 #include <climits>
+#include <functional>
+#include <list>
+#include <unordered_map>
+
+#include <boost/noncopyable.hpp>
 
 namespace osquery {
 
 FLAG(bool, disable_caching, false, "Disable scheduled query caching");
 
+FLAG(uint64,
+     table_cache_max_size,
+     64 * 1024 * 1024,
+     "Maximum bytes of table results cached in memory within the schedule");
+
 CREATE_LAZY_REGISTRY(TablePlugin, "table");
 
-uint64_t TablePlugin::kCacheInterval = 0;
-uint64_t TablePlugin::kCacheStep = 0;
+/// Rows per generate_batch response when the request does not set a size.
+const size_t kTableBatchRows{4096};
+
+/// Seconds an unfinished generate_batch is kept without being read.
+const std::chrono::seconds kTableBatchExpiry{60};
+
+namespace {
+
+/// Rows generated for a generate_batch request, returned over several calls.
+struct TableBatch {
+  /// Table that generated the rows.
+  std::string table;
+
+  /// Names of the columns written, in value order.
+  std::vector<std::string> columns;
+
+  /// Generated rows, released as they are written.
+  TableRows rows;
+
+  /// Position of the next row to write.
+  size_t offset{0};
+
+  /// When the batch was last read, used to expire abandoned cursors.
+  std::chrono::steady_clock::time_point accessed;
+};
+
+/// Unfinished batches, keyed by the cursor returned to the caller.
+std::unordered_map<uint64_t, TableBatch> kTableBatches;
+
+/// Protect the unfinished batches.
+Mutex kTableBatchesMutex;
+
+/// Source of batch cursors.
+uint64_t kTableBatchCursor{0};
+
+} // namespace
 
 #define kDisableRowId "WITHOUT ROWID"
 
@@ -140,8 +186,20 @@ Status TablePlugin::call(const PluginRequest& request,
 
   if (action == "generate") {
     auto context = getContextFromRequest(request);
+    context.table_->schema =
+        ColumnarSchema::fromTable(columns(), columnAliases());
     TableRows result = generate(context);
     response = tableRowsToPluginResponse(result);
+  } else if (action == "generate_batch") {
+    return generateBatch(request, response);
+  } else if (action == "close_batch") {
+    auto cursor = tryTo<uint64_t>(request.count("cursor") > 0
+                                      ? request.at("cursor")
+                                      : std::string());
+    if (cursor) {
+      WriteLock lock(kTableBatchesMutex);
+      kTableBatches.erase(*cursor);
+    }
   } else if (action == "delete") {
     auto context = getContextFromRequest(request);
     response = delete_(context, request);
@@ -160,6 +218,103 @@ Status TablePlugin::call(const PluginRequest& request,
   return Status::success();
 }
 
+Status TablePlugin::generateBatch(const PluginRequest& request,
+                                  PluginResponse& response) {
+  auto batch_rows = kTableBatchRows;
+  if (request.count("batch_size") > 0) {
+    auto requested = tryTo<uint64_t>(request.at("batch_size"));
+    if (requested && *requested > 0) {
+      batch_rows = static_cast<size_t>(*requested);
+    }
+  }
+
+  TableBatch batch;
+  uint64_t cursor = 0;
+  bool first = (request.count("cursor") == 0);
+  auto now = std::chrono::steady_clock::now();
+  if (first) {
+    auto context = getContextFromRequest(request);
+    context.table_->schema =
+        ColumnarSchema::fromTable(columns(), columnAliases());
+    if (usesGenerator()) {
+      RowGenerator::pull_type source(std::bind(&TablePlugin::generator,
+                                               this,
+                                               std::placeholders::_1,
+                                               std::ref(context)));
+      while (source) {
+        batch.rows.push_back(source.get());
+        source();
+      }
+    } else {
+      batch.rows = generate(context);
+    }
+
+    // Only the columns SQLite reads are sent, keep rowid for writable tables.
+    for (const auto& column : columns()) {
+      const auto& name = std::get<0>(column);
+      if (context.isColumnUsed(name) || name == "rowid") {
+        batch.columns.push_back(name);
+      }
+    }
+    batch.table = getName();
+
+    WriteLock lock(kTableBatchesMutex);
+    cursor = ++kTableBatchCursor;
+    for (auto it = kTableBatches.begin(); it != kTableBatches.end();) {
+      if (now - it->second.accessed > kTableBatchExpiry) {
+        it = kTableBatches.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  } else {
+    auto requested = tryTo<uint64_t>(request.at("cursor"));
+    if (!requested) {
+      return Status::failure("Invalid table batch cursor");
+    }
+    cursor = *requested;
+
+    // Take the batch so the rows can be written without holding the lock.
+    WriteLock lock(kTableBatchesMutex);
+    auto it = kTableBatches.find(cursor);
+    if (it == kTableBatches.end() || it->second.table != getName()) {
+      return Status::failure("Unknown table batch cursor");
+    }
+    batch = std::move(it->second);
+    kTableBatches.erase(it);
+  }
+
+  rapidjson::StringBuffer buffer;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+  writer.StartArray();
+  auto end = std::min(batch.rows.size(), batch.offset + batch_rows);
+  for (; batch.offset < end; ++batch.offset) {
+    batch.rows[batch.offset]->serializeValues(batch.columns, writer);
+    batch.rows[batch.offset].reset();
+  }
+  writer.EndArray();
+
+  PluginResponse::value_type item;
+  item["rows"].assign(buffer.GetString(), buffer.GetSize());
+  if (first) {
+    auto doc = JSON::newArray();
+    for (const auto& name : batch.columns) {
+      doc.pushCopy(name);
+    }
+    doc.toString(item["columns"]);
+  }
+
+  if (batch.offset < batch.rows.size()) {
+    item["cursor"] = std::to_string(cursor);
+    batch.accessed = now;
+    WriteLock lock(kTableBatchesMutex);
+    kTableBatches[cursor] = std::move(batch);
+  }
+
+  response.push_back(std::move(item));
+  return Status::success();
+}
+
 std::string TablePlugin::columnDefinition(bool is_extension) const {
   return osquery::columnDefinition(columns(), is_extension);
 }
@@ -195,57 +350,320 @@ PluginResponse TablePlugin::routeInfo() const {
   return response;
 }
 
-static bool cacheAllowed(const TableColumns& cols, const QueryContext& ctx) {
-  if (!ctx.useCache() || !ctx.defaultColumnsUsed()) {
-    // The query execution did not request use of the warm cache.
+namespace {
+
+/// Estimated bookkeeping overhead of each cached row and value.
+const size_t kTableCacheRowOverhead{64};
+
+/// Generated results of a table for one constraint set and set of columns.
+struct TableCacheEntry {
+  std::string table;
+
+  /// Normalized constraints, empty if the results were not constrained.
+  std::string constraints;
+
+  /// The columns that were requested when the results were generated.
+  UsedColumnsBitset columns;
+
+  /// The schedule step and interval, which determine freshness.
+  uint64_t step{0};
+  uint64_t interval{0};
+
+  /// Estimated size in bytes of the rows.
+  size_t size{0};
+
+  TableRows rows;
+};
+
+/**
+ * @brief An in-memory cache of table results shared by all tables.
+ *
+ * Entries are kept in most recently used order and evicted when stale or
+ * when the total size exceeds table_cache_max_size.
+ */
+class TableResultsCache : private boost::noncopyable {
+ public:
+  static TableResultsCache& get() {
+    static TableResultsCache instance;
+    return instance;
+  }
+
+  /**
+   * @brief Find a fresh entry for a table.
+   *
+   * Entries are offered to the visitor, most recently used first, until the
+   * visitor accepts one. The accepted entry becomes the most recently used.
+   */
+  bool find(const std::string& table,
+            uint64_t step,
+            const std::function<bool(const TableCacheEntry&)>& visitor) {
+    WriteLock lock(mutex_);
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+      if (it->table != table || step >= it->step + it->interval) {
+        continue;
+      }
+
+      if (visitor(*it)) {
+        entries_.splice(entries_.begin(), entries_, it);
+        return true;
+      }
+    }
     return false;
   }
 
-  auto uncachable = ColumnOptions::INDEX | ColumnOptions::REQUIRED |
-                    ColumnOptions::ADDITIONAL | ColumnOptions::OPTIMIZED;
-  for (const auto& column : cols) {
-    auto opts = std::get<2>(column) & uncachable;
-    if (opts && ctx.constraints.at(std::get<0>(column)).exists()) {
+  /// Add an entry, replacing results for the same constraints and columns.
+  void insert(TableCacheEntry entry) {
+    WriteLock lock(mutex_);
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      bool replaced = it->table == entry.table &&
+                      it->constraints == entry.constraints &&
+                      it->columns == entry.columns;
+      if (replaced || entry.step >= it->step + it->interval) {
+        size_ -= it->size;
+        it = entries_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+
+    if (entry.size > FLAGS_table_cache_max_size) {
+      return;
+    }
+
+    while (!entries_.empty() &&
+           size_ + entry.size > FLAGS_table_cache_max_size) {
+      size_ -= entries_.back().size;
+      entries_.pop_back();
+    }
+
+    size_ += entry.size;
+    entries_.push_front(std::move(entry));
+  }
+
+ private:
+  Mutex mutex_;
+
+  /// Cached results, most recently used first.
+  std::list<TableCacheEntry> entries_;
+
+  /// Sum of the estimated entry sizes.
+  size_t size_{0};
+};
+
+bool cacheAllowed(const QueryContext& ctx) {
+  // The query execution did not request use of the warm cache.
+  return !FLAGS_disable_caching && ctx.useCache();
+}
+
+/// Order-independent representation of the constraints in a context.
+std::string normalizeConstraints(const QueryContext& ctx) {
+  std::string normalized;
+  for (const auto& column : ctx.constraints) {
+    if (!column.second.exists()) {
+      continue;
+    }
+
+    std::vector<std::string> items;
+    for (const auto& constraint : column.second.getAll()) {
+      items.push_back(std::to_string(constraint.op) + ":" + constraint.expr);
+    }
+    std::sort(items.begin(), items.end());
+
+    normalized += column.first;
+    for (const auto& item : items) {
+      normalized += '\x1f' + item;
+    }
+    normalized += '\x1e';
+  }
+  return normalized;
+}
+
+UsedColumnsBitset requestedColumns(const QueryContext& ctx) {
+  return ctx.colsUsedBitset ? *ctx.colsUsedBitset : UsedColumnsBitset().set();
+}
+
+/// Check if a constraint operand can be compared using the column affinity.
+bool isComparable(ColumnType affinity, const std::string& expr) {
+  if (affinity == TEXT_TYPE) {
+    return true;
+  } else if (affinity == INTEGER_TYPE) {
+    return tryTo<INTEGER_LITERAL>(expr).isValue();
+  } else if (affinity == BIGINT_TYPE) {
+    return tryTo<BIGINT_LITERAL>(expr).isValue();
+  } else if (affinity == UNSIGNED_BIGINT_TYPE) {
+    return tryTo<UNSIGNED_BIGINT_LITERAL>(expr).isValue();
+  }
+  return false;
+}
+
+/**
+ * @brief Select the constraints used to filter cached unconstrained results.
+ *
+ * SQLite evaluates every constraint again on the rows a table returns, so the
+ * filters only need to remove rows that certainly do not match. Constraints
+ * that cannot be evaluated exactly here are skipped. Constraints on columns
+ * that change what a table generates, beyond filtering, cannot be answered
+ * from unconstrained results. INDEX and OPTIMIZED columns are assumed to,
+ * unless the table marks them FILTER_ONLY.
+ *
+ * @return false if the unconstrained results are not a superset.
+ */
+bool getCacheFilters(const TableColumns& columns,
+                     const QueryContext& ctx,
+                     ConstraintMap& filters) {
+  for (const auto& constraint_list : ctx.constraints) {
+    const auto& list = constraint_list.second;
+    if (!list.exists()) {
+      continue;
+    }
+
+    auto column = std::find_if(
+        columns.begin(), columns.end(), [&constraint_list](const auto& c) {
+          return std::get<0>(c) == constraint_list.first;
+        });
+    if (column == columns.end()) {
+      return false;
+    }
+
+    const auto& options = std::get<2>(*column);
+    if (options & (ColumnOptions::REQUIRED | ColumnOptions::ADDITIONAL)) {
+      return false;
+    }
+
+    auto indexed = ColumnOptions::INDEX | ColumnOptions::OPTIMIZED;
+    if ((options & indexed) && !(options & ColumnOptions::FILTER_ONLY)) {
+      return false;
+    }
+
+    if (options & ColumnOptions::COLLATENOCASE) {
+      continue;
+    }
+
+    for (const auto& constraint : list.getAll()) {
+      if ((constraint.op == EQUALS || constraint.op == GREATER_THAN ||
+           constraint.op == LESS_THAN ||
+           constraint.op == GREATER_THAN_OR_EQUALS ||
+           constraint.op == LESS_THAN_OR_EQUALS) &&
+          isComparable(list.affinity, constraint.expr)) {
+        auto& filter = filters[constraint_list.first];
+        filter.affinity = list.affinity;
+        filter.add(constraint);
+      }
+    }
+  }
+  return true;
+}
+
+bool matchesCacheFilters(const ConstraintMap& filters, const Row& row) {
+  for (const auto& filter : filters) {
+    auto value = row.find(filter.first);
+    if (value == row.end() ||
+        !isComparable(filter.second.affinity, value->second)) {
+      continue;
+    }
+
+    if (!filter.second.matches(value->second)) {
       return false;
     }
   }
   return true;
 }
 
+} // namespace
+
 bool TablePlugin::isCached(uint64_t step, const QueryContext& ctx) const {
-  if (FLAGS_disable_caching) {
+  return findCache(step, ctx, nullptr);
+}
+
+bool TablePlugin::getCache(uint64_t step,
+                           const QueryContext& ctx,
+                           TableRows& results) const {
+  results.clear();
+  if (!findCache(step, ctx, &results)) {
     return false;
   }
 
-  // Perform the step comparison first, because it's easy.
-  return (step < last_cached_ + last_interval_ && cacheAllowed(columns(), ctx));
+  VLOG(1) << "Retrieving results from cache for table: " << getName();
+  return true;
 }
 
-TableRows TablePlugin::getCache() const {
-  VLOG(1) << "Retrieving results from cache for table: " << getName();
-  // Lookup results from database and deserialize.
-  std::string content;
-  getDatabaseValue(kQueries, "cache." + getName(), content);
-  TableRows results;
-  deserializeTableRowsJSON(content, results);
-  return results;
+bool TablePlugin::findCache(uint64_t step,
+                            const QueryContext& ctx,
+                            TableRows* results) const {
+  if (!cacheAllowed(ctx)) {
+    return false;
+  }
+
+  auto constraints = normalizeConstraints(ctx);
+  auto columns = requestedColumns(ctx);
+
+  // Prefer results generated for exactly the same constraints.
+  auto exact = TableResultsCache::get().find(
+      getName(), step, [&](const TableCacheEntry& entry) {
+        if (entry.constraints != constraints || entry.columns != columns) {
+          return false;
+        }
+
+        if (results != nullptr) {
+          for (const auto& row : entry.rows) {
+            results->push_back(row->clone());
+          }
+        }
+        return true;
+      });
+  if (exact || constraints.empty()) {
+    return exact;
+  }
+
+  // Otherwise filter the unconstrained results, a superset.
+  ConstraintMap filters;
+  if (!getCacheFilters(this->columns(), ctx, filters)) {
+    return false;
+  }
+
+  return TableResultsCache::get().find(
+      getName(), step, [&](const TableCacheEntry& entry) {
+        if (!entry.constraints.empty() || entry.columns != columns) {
+          return false;
+        }
+
+        if (results != nullptr) {
+          for (const auto& row : entry.rows) {
+            if (filters.empty() ||
+                matchesCacheFilters(filters, static_cast<Row>(*row))) {
+              results->push_back(row->clone());
+            }
+          }
+        }
+        return true;
+      });
 }
 
 void TablePlugin::setCache(uint64_t step,
                            uint64_t interval,
                            const QueryContext& ctx,
                            const TableRows& results) {
-  if (FLAGS_disable_caching || !cacheAllowed(columns(), ctx)) {
+  if (!cacheAllowed(ctx)) {
     return;
   }
 
-  // Serialize QueryData and save to database.
-  std::string content;
-  if (serializeTableRowsJSON(results, content)) {
-    last_cached_ = step;
-    last_interval_ = interval;
-    setDatabaseValue(kQueries, "cache." + getName(), content);
+  TableCacheEntry entry;
+  entry.table = getName();
+  entry.constraints = normalizeConstraints(ctx);
+  entry.columns = requestedColumns(ctx);
+  entry.step = step;
+  entry.interval = interval;
+  entry.rows.reserve(results.size());
+  for (const auto& row : results) {
+    entry.size += kTableCacheRowOverhead;
+    for (const auto& column : static_cast<Row>(*row)) {
+      entry.size +=
+          column.first.size() + column.second.size() + kTableCacheRowOverhead;
+    }
+    entry.rows.push_back(row->clone());
   }
+
+  TableResultsCache::get().insert(std::move(entry));
 }
 
 std::string columnDefinition(const TableColumns& columns, bool is_extension) {
@@ -508,6 +926,69 @@ void ConstraintList::deserialize(const rapidjson::Value& obj) {
   affinity = columnTypeName(affinity_name);
 }
 
+ColumnarSchema::ColumnarSchema(const TableColumns& columns,
+                               const std::map<std::string, size_t>& aliases) {
+  names_.reserve(columns.size());
+  types_.reserve(columns.size());
+  targets_.reserve(columns.size());
+  for (size_t i = 0; i < columns.size(); ++i) {
+    const auto& name = std::get<0>(columns[i]);
+    auto alias = aliases.find(name);
+    auto target = (alias != aliases.end()) ? alias->second : i;
+    names_.push_back(name);
+    targets_.push_back((target < columns.size()) ? target : i);
+    slots_.emplace(name, i);
+  }
+
+  // Alias columns are declared with an UNKNOWN_TYPE mask, use the target's.
+  for (size_t i = 0; i < columns.size(); ++i) {
+    types_.push_back(std::get<1>(columns[targets_[i]]));
+  }
+
+  rowid_slot_ = slot("rowid");
+}
+
+std::shared_ptr<const ColumnarSchema> ColumnarSchema::fromTable(
+    const TableColumns& columns, const ColumnAliasSet& aliases) {
+  // Mirror the layout created by the SQL layer when attaching the table:
+  // declared columns first, then each column alias as a HIDDEN column.
+  TableColumns layout = columns;
+  std::map<std::string, size_t> alias_targets;
+  for (const auto& target : aliases) {
+    size_t target_index = 0;
+    for (size_t i = 0; i < columns.size(); ++i) {
+      if (std::get<0>(columns[i]) == target.first) {
+        target_index = i;
+        break;
+      }
+    }
+
+    for (const auto& alias : target.second) {
+      layout.push_back(
+          std::make_tuple(alias, UNKNOWN_TYPE, ColumnOptions::HIDDEN));
+      alias_targets[alias] = target_index;
+    }
+  }
+
+  return std::make_shared<ColumnarSchema>(layout, alias_targets);
+}
+
+size_t ColumnarSchema::slot(const std::string& name) const {
+  auto it = slots_.find(name);
+  if (it == slots_.end()) {
+    return npos;
+  }
+  return targets_[it->second];
+}
+
+std::shared_ptr<const ColumnarSchema> QueryContext::rowSchema() const {
+  static const auto kEmptySchema = std::make_shared<const ColumnarSchema>();
+  if (table_ == nullptr || table_->schema == nullptr) {
+    return kEmptySchema;
+  }
+  return table_->schema;
+}
+
 bool QueryContext::isColumnUsed(const std::string& colName) const {
   return !colsUsed || colsUsed->find(colName) != colsUsed->end();
 }
@@ -535,6 +1016,19 @@ bool QueryContext::useCache() const {
   return use_cache_;
 }
 
+void QueryContext::setCacheStep(uint64_t step, uint64_t interval) {
+  cache_step_ = step;
+  cache_interval_ = interval;
+}
+
+uint64_t QueryContext::cacheStep() const {
+  return cache_step_;
+}
+
+uint64_t QueryContext::cacheInterval() const {
+  return cache_interval_;
+}
+
 void QueryContext::setCache(const std::string& index,
                             const TableRowHolder& cache) {
   table_->cache[index] = cache->clone();
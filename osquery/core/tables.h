@@ -11,6 +11,7 @@
 
 #include <bitset>
 #include <map>
+#include <memory>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
@@ -19,6 +20,7 @@
 
 #include <boost/core/ignore_unused.hpp>
 #include <boost/coroutine2/coroutine.hpp>
+#include <boost/noncopyable.hpp>
 #include <boost/optional.hpp>
 #include <sqlite3.h>
 
@@ -220,6 +222,84 @@ using AliasColumnMap = std::unordered_map<std::string, std::string>;
 /// Forward declaration of QueryContext for ConstraintList relationships.
 struct QueryContext;
 
+/**
+ * @brief Positional column layout of a virtual table.
+ *
+ * A ColumnarSchema assigns each column a slot equal to its position in the
+ * virtual table's TableColumns, including the HIDDEN alias columns appended
+ * when the table is created. Rows stored by slot (see ColumnarTableRow) can
+ * then be read by SQLite's xColumn without a column name lookup.
+ */
+class ColumnarSchema : private boost::noncopyable {
+ public:
+  /// Slot returned for a column name that is not part of the schema.
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+  ColumnarSchema() = default;
+
+  /**
+   * @brief Create a schema from a virtual table's column layout.
+   *
+   * @param columns The columns, in SQLite order, including alias columns.
+   * @param aliases A map of alias column name to the index of its target.
+   */
+  ColumnarSchema(const TableColumns& columns,
+                 const std::map<std::string, size_t>& aliases);
+
+  /// Build the same layout SQLite uses from a TablePlugin's declarations.
+  static std::shared_ptr<const ColumnarSchema> fromTable(
+      const TableColumns& columns, const ColumnAliasSet& aliases);
+
+  /// Return the (alias-resolved) slot for a column name, or npos.
+  size_t slot(const std::string& name) const;
+
+  /// Resolve an alias slot to the slot holding its value.
+  size_t target(size_t slot) const {
+    return (slot < targets_.size()) ? targets_[slot] : npos;
+  }
+
+  /// The number of slots, including alias slots.
+  size_t size() const {
+    return names_.size();
+  }
+
+  /// The name of the column at a slot.
+  const std::string& name(size_t slot) const {
+    return names_[slot];
+  }
+
+  /// The SQLite affinity of the column at a slot.
+  ColumnType type(size_t slot) const {
+    return types_[slot];
+  }
+
+  /// True if the slot belongs to a HIDDEN alias column.
+  bool isAlias(size_t slot) const {
+    return targets_[slot] != slot;
+  }
+
+  /// The slot of an optional "rowid" column, or npos.
+  size_t rowidSlot() const {
+    return rowid_slot_;
+  }
+
+ private:
+  /// Column names indexed by slot.
+  std::vector<std::string> names_;
+
+  /// Column affinities indexed by slot, alias slots use their target's type.
+  std::vector<ColumnType> types_;
+
+  /// Slot holding the value for each slot, differs only for aliases.
+  std::vector<size_t> targets_;
+
+  /// Name to slot index.
+  std::unordered_map<std::string, size_t> slots_;
+
+  /// Cached slot of the "rowid" column.
+  size_t rowid_slot_{npos};
+};
+
 /**
  * @brief A ConstraintList is a set of constraints for a column. This list
  * should be mapped to a left-hand-side column name.
@@ -414,6 +494,12 @@ struct VirtualTableContent {
    */
   std::map<std::string, size_t> aliases;
 
+  /// Positional layout of columns and aliases, created with the table.
+  std::shared_ptr<const ColumnarSchema> schema;
+
+  /// Cleared when an extension table does not support generate_batch.
+  bool batches{true};
+
   /// Transient set of virtual table access constraints.
   std::unordered_map<size_t, ConstraintSet> constraints;
 
@@ -473,6 +559,8 @@ struct QueryContext {
         colsUsed(std::move(other.colsUsed)),
         enable_cache_(other.enable_cache_),
         use_cache_(other.use_cache_),
+        cache_step_(other.cache_step_),
+        cache_interval_(other.cache_interval_),
         table_(other.table_) {
     other.enable_cache_ = false;
     other.table_ = nullptr;
@@ -484,6 +572,8 @@ struct QueryContext {
     std::swap(colsUsed, other.colsUsed);
     std::swap(enable_cache_, other.enable_cache_);
     std::swap(use_cache_, other.use_cache_);
+    std::swap(cache_step_, other.cache_step_);
+    std::swap(cache_interval_, other.cache_interval_);
     std::swap(table_, other.table_);
 
     return *this;
@@ -619,6 +709,15 @@ struct QueryContext {
     }
   }
 
+  /**
+   * @brief The positional column layout of the table being generated.
+   *
+   * Tables returning ColumnarTableRow%s should resolve the slots they write
+   * once per generate call. An ephemeral context without table content
+   * returns an empty schema.
+   */
+  std::shared_ptr<const ColumnarSchema> rowSchema() const;
+
   /// Check if a table-defined index exists within the query cache.
   bool isCached(const std::string& index) const;
 
@@ -631,6 +730,15 @@ struct QueryContext {
   /// Check if the query requested use of the warm query cache.
   bool useCache() const;
 
+  /// Set the schedule step and interval of the query using this context.
+  void setCacheStep(uint64_t step, uint64_t interval);
+
+  /// The schedule step, used by cacheable tables to judge freshness.
+  uint64_t cacheStep() const;
+
+  /// The scheduled interval of the query, cached results live this long.
+  uint64_t cacheInterval() const;
+
   /// Set the entire cache for an index.
   void setCache(const std::string& index, const TableRowHolder& _cache);
 
@@ -647,6 +755,10 @@ struct QueryContext {
   /// If the context is allowed to use the warm query cache.
   bool use_cache_{false};
 
+  /// The schedule step and interval of the query, see setCacheStep.
+  uint64_t cache_step_{0};
+  uint64_t cache_interval_{0};
+
   /// Persistent table content for table caching.
   std::shared_ptr<VirtualTableContent> table_;
 
@@ -803,38 +915,45 @@ class TablePlugin : public Plugin {
    * table "processes" at the interval 60. The first executed will cache results
    * and the second will use the cached results.
    *
-   * Table results are not cached if a QueryContext contains constraints or
-   * provides HOB (hand-off blocks) to additional tables within a query.
-   * Currently, the query scheduler cannot communicate to table implementations.
-   * An interval is set globally by the scheduler and passed to the table
-   * implementation as a future-proof API. There is no "shortcut" for caching
-   * when used in external tables. A cache lookup within an extension means
-   * a database call API and re-serialization to the virtual table APIs. In
-   * practice this does not perform well and is explicitly disabled.
+   * Results are kept in memory for the table, the normalized constraints and
+   * the columns used by the query. A query may use results generated for the
+   * same constraints and columns. If a query is constrained it may also use
+   * unconstrained results, which are filtered using the constraints. This
+   * does not apply to constraints on required or additional columns, nor on
+   * index or optimized columns unless they are marked FILTER_ONLY, since
+   * these may change what the table generates.
+   *
+   * There is no "shortcut" for caching when used in external tables. A cache
+   * lookup within an extension means re-serialization to the virtual table
+   * APIs. In practice this does not perform well and is explicitly disabled.
    *
-   * @param interval The interval this query expects the tables results.
+   * @param step The schedule step for which this query expects the results.
    * @param ctx The query context.
    * @return True if the cache contains fresh results, otherwise false.
    */
-  bool isCached(uint64_t interval, const QueryContext& ctx) const;
+  bool isCached(uint64_t step, const QueryContext& ctx) const;
 
   /**
-   * @brief Perform a database lookup of cached results and deserialize.
+   * @brief Retrieve fresh cached results for the query context.
    *
-   * If a query determined the table's cached results are fresh, it may ask the
-   * table to retrieve results from the database and deserialized them into
-   * table row data.
+   * The cached rows are cloned into results. If the results are answered from
+   * unconstrained results, rows that cannot match the constraints are removed.
    *
-   * @return The deserialized row data of cached results.
+   * @param step The schedule step for which this query expects the results.
+   * @param ctx The query context.
+   * @param results Output of the cached rows.
+   * @return True if fresh results were found, otherwise false.
    */
-  TableRows getCache() const;
+  bool getCache(uint64_t step,
+                const QueryContext& ctx,
+                TableRows& results) const;
 
   /**
    * @brief Similar to getCache, stores the results from generate.
    *
-   * Set will serialize and save the results as JSON to be retrieved later.
-   * It will inspect the query context, if any required/indexed/optimized or
-   * additional columns are used then the cache will not be saved.
+   * The rows are cloned and kept in memory for the interval. The cache size is
+   * limited by table_cache_max_size and least recently used results are
+   * evicted first.
    */
   void setCache(uint64_t step,
                 uint64_t interval,
@@ -842,24 +961,10 @@ class TablePlugin : public Plugin {
                 const TableRows& results);
 
  private:
-  /// The last time in seconds the table data results were saved to cache.
-  uint64_t last_cached_{0};
-
-  /// The last interval in seconds when the table data was cached.
-  uint64_t last_interval_{0};
-
- public:
-  /**
-   * @brief The scheduled interval for the executing query.
-   *
-   * Scheduled queries execute within a pseudo-mutex, and each may communicate
-   * their scheduled interval to internal TablePlugin implementations. If the
-   * table is cachable then the interval can be used to calculate freshness.
-   */
-  static uint64_t kCacheInterval;
-
-  /// The schedule step, this is the current position of the schedule.
-  static uint64_t kCacheStep;
+  /// Find fresh cached results, optionally copying them into results.
+  bool findCache(uint64_t step,
+                 const QueryContext& ctx,
+                 TableRows* results) const;
 
  public:
   /**
@@ -869,6 +974,8 @@ class TablePlugin : public Plugin {
    * handle requests and responses from extensions. The TablePlugin uses an
    * "action" key, which can be:
    *   - generate: call the plugin's row generate method (defined in spec).
+   *   - generate_batch: generate rows and return them in positional batches.
+   *   - close_batch: release the rows of an unfinished generate_batch.
    *   - columns: return a list of column name and SQLite types.
    *   - definition: return an SQL statement for table creation.
    *
@@ -902,6 +1009,17 @@ class TablePlugin : public Plugin {
   /// Helper data structure transformation methods.
   QueryContext getContextFromRequest(const PluginRequest& request) const;
 
+  /**
+   * @brief Return generated rows in batches for extension tables.
+   *
+   * The first request includes the "context" and generates every row. The
+   * response holds a single item with a JSON "columns" list of the used
+   * column names, the first "rows" as JSON arrays of values in that column
+   * order, and a "cursor" if rows remain. Each following request passes the
+   * "cursor" and receives the next "rows", and the "cursor" while rows remain.
+   */
+  Status generateBatch(const PluginRequest& request, PluginResponse& response);
+
   UsedColumnsBitset usedColumnsToBitset(const UsedColumns usedColumns) const;
   friend class RegistryFactory;
   FRIEND_TEST(VirtualTableTests, test_tableplugin_columndefinition);
@@ -910,7 +1028,9 @@ class TablePlugin : public Plugin {
   FRIEND_TEST(VirtualTableTests, test_indexing_costs);
   FRIEND_TEST(VirtualTableTests, test_table_results_cache);
   FRIEND_TEST(VirtualTableTests, test_table_results_cache_colcheck);
+  FRIEND_TEST(VirtualTableTests, test_table_results_cache_filter);
   FRIEND_TEST(VirtualTableTests, test_yield_generator);
+  FRIEND_TEST(VirtualTableTests, test_chunked_yield_generator);
 };
 
 /// Helper method to generate the virtual table CREATE statement.
@@ -14,6 +14,8 @@
 #include <osquery/utils/system/system.h>
 #endif
 
+#include <vector>
+
 #include <boost/format.hpp>
 
 #include <gtest/gtest.h>
@@ -153,6 +155,45 @@ TEST_F(ProcessTests, test_getpid) {
   EXPECT_EQ(process->pid(), pid);
 }
 
+TEST_F(ProcessTests, test_getResourceUsage) {
+  ProcessResourceUsage r0;
+  ASSERT_TRUE(platformGetResourceUsage(r0));
+
+  // The test binary is loaded, it has faulted pages in and is resident.
+  EXPECT_GT(r0.resident_size, 0U);
+  EXPECT_GT(r0.page_faults, 0U);
+
+  // Touch new memory and spin until some CPU time is accounted.
+  std::vector<char> buffer(16 * 1024 * 1024);
+  for (size_t i = 0; i < buffer.size(); i += 4096) {
+    buffer[i] = static_cast<char>(i);
+  }
+
+  ProcessResourceUsage r1;
+  volatile uint64_t counter = 0;
+  for (size_t i = 0; i < 10000; ++i) {
+    for (size_t j = 0; j < 100000; ++j) {
+      counter = counter + j;
+    }
+
+    ASSERT_TRUE(platformGetResourceUsage(r1));
+    if (r1.user_time + r1.system_time > r0.user_time + r0.system_time) {
+      break;
+    }
+  }
+
+  // The counters are totals for the process, they never go back.
+  EXPECT_GT(r1.user_time + r1.system_time, r0.user_time + r0.system_time);
+  EXPECT_GE(r1.user_time, r0.user_time);
+  EXPECT_GE(r1.system_time, r0.system_time);
+  EXPECT_GT(r1.page_faults, r0.page_faults);
+  EXPECT_GE(r1.voluntary_context_switches, r0.voluntary_context_switches);
+  EXPECT_GE(r1.bytes_read, r0.bytes_read);
+
+  // The touched pages are still resident, the sizes are in bytes.
+  EXPECT_GE(r1.resident_size, buffer.size() / 2);
+}
+
 TEST_F(ProcessTests, test_envVar) {
   auto val = getEnvVar("GTEST_OSQUERY");
   EXPECT_FALSE(val);
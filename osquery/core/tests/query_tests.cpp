@@ -170,6 +170,133 @@ TEST_F(QueryTests, test_get_query_results) {
   EXPECT_TRUE(status.ok());
 }
 
+TEST_F(QueryTests, test_add_results_from_legacy_json) {
+  // Results stored as a JSON array are read once and then stored by row.
+  auto query = getOsqueryScheduledQuery();
+  auto cf = Query("legacy_results", query);
+  uint64_t counter = 0;
+  DiffResults dr;
+  auto results = getTestDBExpectedResults();
+  ASSERT_TRUE(cf.addNewResults(results, 0, counter, dr).ok());
+
+  std::string json;
+  ASSERT_TRUE(serializeQueryDataJSON(results, json, true).ok());
+  ASSERT_TRUE(setDatabaseValue(kQueries, "legacy_results", json).ok());
+
+  // The same results yield an empty differential.
+  ASSERT_TRUE(cf.addNewResults(results, 0, counter, dr).ok());
+  EXPECT_TRUE(dr.hasNoResults());
+
+  std::string raw;
+  getDatabaseValue(kQueries, "legacy_results", raw);
+  EXPECT_TRUE(isRowHashIndex(raw));
+
+  // Removing a row only reports and deletes that row.
+  auto removed = results.back();
+  results.pop_back();
+  ASSERT_TRUE(cf.addNewResults(results, 0, counter, dr).ok());
+  EXPECT_TRUE(dr.added.empty());
+  ASSERT_EQ(dr.removed.size(), 1U);
+  EXPECT_EQ(dr.removed[0], removed);
+
+  std::vector<std::string> keys;
+  scanDatabaseKeys(
+      kQueries, keys, Query::getStoredRowsPrefix("legacy_results"));
+  EXPECT_EQ(keys.size(), results.size());
+
+  // Stored rows are not query names.
+  auto names = Query::getStoredQueryNames();
+  for (const auto& name : names) {
+    EXPECT_FALSE(Query::isStoredRowsKey(name));
+  }
+
+  ASSERT_TRUE(Query::deleteStoredRows("legacy_results").ok());
+  keys.clear();
+  scanDatabaseKeys(
+      kQueries, keys, Query::getStoredRowsPrefix("legacy_results"));
+  EXPECT_TRUE(keys.empty());
+}
+
+TEST_F(QueryTests, test_stored_rows_shared_prefix) {
+  auto query = getOsqueryScheduledQuery();
+  auto results = getTestDBExpectedResults();
+  uint64_t counter = 0;
+  DiffResults dr;
+
+  // Each name prefixes the next, the last one looks like a rows key.
+  const std::vector<std::string> names = {
+      "shared", "shared.pack", "rows.6.shared"};
+  for (const auto& name : names) {
+    auto cf = Query(name, query);
+    ASSERT_TRUE(cf.addNewResults(results, 0, counter, dr).ok());
+  }
+
+  ASSERT_TRUE(Query::deleteStoredRows("shared").ok());
+
+  std::vector<std::string> keys;
+  scanDatabaseKeys(kQueries, keys, Query::getStoredRowsPrefix("shared"));
+  EXPECT_TRUE(keys.empty());
+
+  for (const auto& name : {"shared.pack", "rows.6.shared"}) {
+    keys.clear();
+    scanDatabaseKeys(kQueries, keys, Query::getStoredRowsPrefix(name));
+    EXPECT_EQ(keys.size(), results.size());
+
+    QueryDataSet previous;
+    EXPECT_TRUE(Query(name, query).getPreviousQueryResults(previous).ok());
+    EXPECT_EQ(previous.size(), results.size());
+  }
+
+  // A query named like the rows prefix is still a query.
+  auto stored_names = Query::getStoredQueryNames();
+  EXPECT_NE(
+      std::find(stored_names.begin(), stored_names.end(), "rows.6.shared"),
+      stored_names.end());
+
+  for (const auto& name : names) {
+    Query::deleteStoredResults(name);
+  }
+}
+
+TEST_F(QueryTests, test_query_state_write_through) {
+  auto query = getOsqueryScheduledQuery();
+  auto cf = Query("state_query", query);
+  EXPECT_FALSE(cf.isQueryNameInDatabase());
+
+  uint64_t counter = 0;
+  DiffResults dr;
+  ASSERT_TRUE(cf.addNewResults(getTestDBExpectedResults(), 7, counter, dr).ok());
+  EXPECT_TRUE(cf.isQueryNameInDatabase());
+  EXPECT_FALSE(cf.isNewQuerySql());
+  EXPECT_EQ(cf.getPreviousEpoch(), 7U);
+  EXPECT_EQ(cf.getQueryCounter(false, false), 1U);
+
+  // Each update was written through to the database.
+  std::string raw;
+  getDatabaseValue(kQueries, "state_queryepoch", raw);
+  EXPECT_EQ(raw, "7");
+  getDatabaseValue(kQueries, "state_querycounter", raw);
+  EXPECT_EQ(raw, "0");
+  getDatabaseValue(kQueries, "query.state_query", raw);
+  EXPECT_EQ(raw, query.query);
+
+  // Reads are served from memory.
+  deleteDatabaseValue(kQueries, "state_queryepoch");
+  EXPECT_EQ(cf.getPreviousEpoch(), 7U);
+
+  ASSERT_TRUE(Query::deleteStoredResults("state_query").ok());
+  EXPECT_FALSE(cf.isQueryNameInDatabase());
+  EXPECT_EQ(cf.getPreviousEpoch(), 0U);
+
+  // A database reset invalidates the in-memory state.
+  setDatabaseValue(kQueries, "state_query", "[]");
+  EXPECT_FALSE(cf.isQueryNameInDatabase());
+  resetDatabase();
+  setDatabaseValue(kQueries, "state_query", "[]");
+  EXPECT_TRUE(cf.isQueryNameInDatabase());
+  EXPECT_TRUE(cf.isNewQuerySql());
+}
+
 TEST_F(QueryTests, test_query_name_not_found_in_db) {
   // Try to retrieve results from a query that has not executed.
   QueryDataSet previous_qd;
@@ -14,9 +14,12 @@
 #include <osquery/core/tables.h>
 #include <osquery/database/database.h>
 #include <osquery/registry/registry.h>
+#include <osquery/sql/dynamic_table_row.h>
 
 namespace osquery {
 
+DECLARE_uint64(table_cache_max_size);
+
 class TablesTests : public testing::Test {
 protected:
  void SetUp() {
@@ -169,11 +172,8 @@ TEST_F(TablesTests, test_caching) {
   // By default the interval and step is 0, so a step of 5 will not be cached.
   EXPECT_FALSE(test.testIsCached(5));
 
-  TablePlugin::kCacheInterval = 5;
-  TablePlugin::kCacheStep = 1;
-  EXPECT_FALSE(test.testIsCached(5));
   // Set the current time to 1, and the interval at 5.
-  test.testSetCache(TablePlugin::kCacheStep, TablePlugin::kCacheInterval);
+  test.testSetCache(1, 5);
   // Time at 1 is cached for an interval of 5, so at time 5 the cache is fresh.
   EXPECT_TRUE(test.testIsCached(5));
   // 6 is the end of the cache, it is not fresh.
@@ -182,11 +182,106 @@ TEST_F(TablesTests, test_caching) {
   EXPECT_FALSE(test.testIsCached(7));
 
   // Set the time at now to 2.
-  TablePlugin::kCacheStep = 2;
-  test.testSetCache(TablePlugin::kCacheStep, TablePlugin::kCacheInterval);
+  test.testSetCache(2, 5);
   EXPECT_TRUE(test.testIsCached(5));
   // Now 6 is within the freshness of 2 + 5.
   EXPECT_TRUE(test.testIsCached(6));
   EXPECT_FALSE(test.testIsCached(7));
 }
+
+class TestCachedTablePlugin : public TablePlugin {
+ public:
+  TableColumns columns() const override {
+    return {
+        std::make_tuple("pid", INTEGER_TYPE, ColumnOptions::DEFAULT),
+        std::make_tuple("name", TEXT_TYPE, ColumnOptions::DEFAULT),
+        std::make_tuple("path", TEXT_TYPE, ColumnOptions::ADDITIONAL),
+    };
+  }
+
+  void testSetCache(uint64_t step, const QueryContext& ctx) {
+    TableRows rows;
+    for (size_t i = 1; i <= 10; i++) {
+      auto r = make_table_row();
+      r["pid"] = INTEGER(i);
+      r["name"] = "process_" + std::to_string(i);
+      rows.push_back(std::move(r));
+    }
+    setCache(step, 5, ctx, rows);
+  }
+
+  bool testGetCache(uint64_t step, const QueryContext& ctx, QueryData& qd) {
+    TableRows rows;
+    if (!getCache(step, ctx, rows)) {
+      return false;
+    }
+
+    qd.clear();
+    for (const auto& row : rows) {
+      qd.push_back(static_cast<Row>(*row));
+    }
+    return true;
+  }
+};
+
+TEST_F(TablesTests, test_caching_constraints) {
+  TestCachedTablePlugin test;
+  test.setName("test_caching_constraints");
+
+  QueryContext all;
+  all.useCache(true);
+  test.testSetCache(1, all);
+
+  QueryData qd;
+  EXPECT_TRUE(test.testGetCache(2, all, qd));
+  EXPECT_EQ(qd.size(), 10U);
+
+  // Constrained queries are answered by filtering the unconstrained results.
+  QueryContext ctx;
+  ctx.useCache(true);
+  ctx.constraints["pid"].affinity = INTEGER_TYPE;
+  ctx.constraints["pid"].add(Constraint(GREATER_THAN, "7"));
+  EXPECT_TRUE(test.testGetCache(2, ctx, qd));
+  ASSERT_EQ(qd.size(), 3U);
+  EXPECT_EQ(qd[0]["pid"], "8");
+
+  ctx.constraints["name"].affinity = TEXT_TYPE;
+  ctx.constraints["name"].add(Constraint(EQUALS, "process_9"));
+  EXPECT_TRUE(test.testGetCache(2, ctx, qd));
+  ASSERT_EQ(qd.size(), 1U);
+  EXPECT_EQ(qd[0]["pid"], "9");
+
+  // Additional columns change what the table generates.
+  QueryContext additional;
+  additional.useCache(true);
+  additional.constraints["path"].affinity = TEXT_TYPE;
+  additional.constraints["path"].add(Constraint(EQUALS, "/bin/sh"));
+  EXPECT_FALSE(test.testGetCache(2, additional, qd));
+
+  // Results cached for the same constraints are returned as-is.
+  test.testSetCache(1, additional);
+  EXPECT_TRUE(test.testGetCache(2, additional, qd));
+  EXPECT_EQ(qd.size(), 10U);
+
+  // Neither result is fresh at the end of the interval.
+  EXPECT_FALSE(test.testGetCache(6, all, qd));
+  EXPECT_FALSE(test.testGetCache(6, additional, qd));
+}
+
+TEST_F(TablesTests, test_caching_max_size) {
+  auto max_size = FLAGS_table_cache_max_size;
+  FLAGS_table_cache_max_size = 1;
+
+  TestCachedTablePlugin test;
+  test.setName("test_caching_max_size");
+
+  QueryContext ctx;
+  ctx.useCache(true);
+  test.testSetCache(1, ctx);
+
+  // The results do not fit within the cache.
+  QueryData qd;
+  EXPECT_FALSE(test.testGetCache(2, ctx, qd));
+  FLAGS_table_cache_max_size = max_size;
+}
 }
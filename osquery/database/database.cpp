@@ -7,12 +7,16 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <algorithm>
+#include <set>
+
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/io/quoted.hpp>
 #include <boost/property_tree/json_parser.hpp>
 
 #include <osquery/core/flagalias.h>
 #include <osquery/core/flags.h>
+#include <osquery/core/sql/row.h>
 #include <osquery/database/database.h>
 #include <osquery/logger/logger.h>
 #include <osquery/process/process.h>
@@ -64,6 +68,7 @@ const std::vector<std::string> kDomains = {kPersistentSettings,
 std::atomic<bool> kDBAllowOpen(false);
 std::atomic<bool> kDBInitialized(false);
 std::atomic<bool> kDBChecking(false);
+std::atomic<size_t> kDBGeneration(0);
 
 /**
  * @brief A reader/writer mutex protecting database resets.
@@ -120,6 +125,74 @@ Status DatabasePlugin::scan(const std::string& domain,
   return Status::success();
 }
 
+Status DatabasePlugin::removeBatch(const std::string& domain,
+                                   const std::vector<std::string>& keys) {
+  for (const auto& key : keys) {
+    auto status = remove(domain, key);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  return Status::success();
+}
+
+Status DatabasePlugin::scanRange(const std::string& domain,
+                                 const std::string& low,
+                                 const std::string& high,
+                                 DatabaseStringValueList& results,
+                                 uint64_t max) const {
+  if (low > high) {
+    return Status::failure("Invalid range: low > high");
+  }
+
+  // Only keys sharing the common prefix of both bounds can be in range.
+  auto mismatch =
+      std::mismatch(low.begin(), low.end(), high.begin(), high.end());
+  std::string prefix(low.begin(), mismatch.first);
+
+  std::vector<std::string> keys;
+  auto status = scan(domain, keys, prefix, 0);
+  if (!status.ok()) {
+    return status;
+  }
+
+  std::sort(keys.begin(), keys.end());
+  for (const auto& key : keys) {
+    if (key < low) {
+      continue;
+    } else if (key > high) {
+      break;
+    }
+
+    std::string value;
+    if (get(domain, key, value).ok()) {
+      results.push_back(std::make_pair(key, std::move(value)));
+      if (max > 0 && results.size() >= max) {
+        break;
+      }
+    }
+  }
+  return Status::success();
+}
+
+Status DatabasePlugin::getRangeSize(const std::string& domain,
+                                    const std::string& low,
+                                    const std::string& high,
+                                    uint64_t& size) const {
+  size = 0;
+  return Status::success();
+}
+
+Status DatabasePlugin::compactRange(const std::string& domain,
+                                    const std::string& low,
+                                    const std::string& high) {
+  return Status::success();
+}
+
+Status DatabasePlugin::getStatistics(DatabaseStatistics& stats) const {
+  return Status::success();
+}
+
 Status DatabasePlugin::call(const PluginRequest& request,
                             PluginResponse& response) {
   if (request.count("action") == 0) {
@@ -211,6 +284,41 @@ Status DatabasePlugin::call(const PluginRequest& request,
       response.push_back({{"k", k}});
     }
     return status;
+  } else if (request.at("action") == "scan_range") {
+    auto key_high =
+        (request.count("key_high") > 0) ? request.at("key_high") : "";
+    uint64_t max = 0;
+    if (request.count("max") > 0) {
+      max = std::stoull(request.at("max"));
+    }
+
+    DatabaseStringValueList results;
+    auto status = this->scanRange(domain, key, key_high, results, max);
+    for (auto& item : results) {
+      response.push_back(
+          {{"k", std::move(item.first)}, {"v", std::move(item.second)}});
+    }
+    return status;
+  } else if (request.at("action") == "range_size") {
+    auto key_high =
+        (request.count("key_high") > 0) ? request.at("key_high") : "";
+    uint64_t size = 0;
+    auto status = this->getRangeSize(domain, key, key_high, size);
+    response.push_back({{"size", std::to_string(size)}});
+    return status;
+  } else if (request.at("action") == "compact_range") {
+    auto key_high =
+        (request.count("key_high") > 0) ? request.at("key_high") : "";
+    return this->compactRange(domain, key, key_high);
+  } else if (request.at("action") == "statistics") {
+    DatabaseStatistics stats;
+    auto status = this->getStatistics(stats);
+    for (auto& stat : stats) {
+      response.push_back({{"domain", std::move(stat.domain)},
+                          {"name", std::move(stat.name)},
+                          {"value", std::to_string(stat.value)}});
+    }
+    return status;
   }
 
   return Status(1, "Unknown database plugin action");
@@ -375,6 +483,33 @@ Status deleteDatabaseValue(const std::string& domain, const std::string& key) {
   }
 }
 
+Status deleteDatabaseBatch(const std::string& domain,
+                           const std::vector<std::string>& keys) {
+  if (domain.empty()) {
+    return Status(1, "Missing domain");
+  }
+
+  if (RegistryFactory::get().external()) {
+    // External registries (extensions) do not have databases active.
+    // It is not possible to use an extension-based database.
+    for (const auto& key : keys) {
+      auto status = deleteDatabaseValue(domain, key);
+      if (!status.ok()) {
+        return status;
+      }
+    }
+    return Status::success();
+  }
+
+  ReadLock lock(kDatabaseReset);
+  if (!kDBInitialized) {
+    throw std::runtime_error("Cannot delete database values");
+  } else {
+    auto plugin = getDatabasePlugin();
+    return plugin->removeBatch(domain, keys);
+  }
+}
+
 Status deleteDatabaseRange(const std::string& domain,
                            const std::string& low,
                            const std::string& high) {
@@ -444,9 +579,143 @@ Status scanDatabaseKeys(const std::string& domain,
   }
 }
 
+Status scanDatabaseRange(const std::string& domain,
+                         const std::string& low,
+                         const std::string& high,
+                         DatabaseStringValueList& results,
+                         uint64_t max) {
+  if (domain.empty()) {
+    return Status(1, "Missing domain");
+  }
+
+  if (RegistryFactory::get().external()) {
+    // External registries (extensions) do not have databases active.
+    // It is not possible to use an extension-based database.
+    PluginRequest request = {{"action", "scan_range"},
+                             {"domain", domain},
+                             {"key", low},
+                             {"key_high", high},
+                             {"max", std::to_string(max)}};
+    PluginResponse response;
+    auto status = Registry::call("database", request, response);
+
+    for (auto& item : response) {
+      if (item.count("k") > 0 && item.count("v") > 0) {
+        results.push_back(std::make_pair(item.at("k"), item.at("v")));
+      }
+    }
+    return status;
+  }
+
+  ReadLock lock(kDatabaseReset);
+  if (!kDBInitialized) {
+    throw std::runtime_error("Cannot scan database values: " + low + " - " +
+                             high);
+  } else {
+    auto plugin = getDatabasePlugin();
+    return plugin->scanRange(domain, low, high, results, max);
+  }
+}
+
+Status getDatabaseRangeSize(const std::string& domain,
+                            const std::string& low,
+                            const std::string& high,
+                            uint64_t& size) {
+  size = 0;
+  if (domain.empty()) {
+    return Status(1, "Missing domain");
+  }
+
+  if (RegistryFactory::get().external()) {
+    // External registries (extensions) do not have databases active.
+    // It is not possible to use an extension-based database.
+    PluginRequest request = {{"action", "range_size"},
+                             {"domain", domain},
+                             {"key", low},
+                             {"key_high", high}};
+    PluginResponse response;
+    auto status = Registry::call("database", request, response);
+    if (status.ok() && !response.empty() && response[0].count("size") > 0) {
+      size = tryTo<uint64_t>(response[0].at("size")).takeOr(uint64_t{0});
+    }
+    return status;
+  }
+
+  ReadLock lock(kDatabaseReset);
+  if (!kDBInitialized) {
+    throw std::runtime_error("Cannot size database values: " + low + " - " +
+                             high);
+  } else {
+    auto plugin = getDatabasePlugin();
+    return plugin->getRangeSize(domain, low, high, size);
+  }
+}
+
+Status compactDatabaseRange(const std::string& domain,
+                            const std::string& low,
+                            const std::string& high) {
+  if (domain.empty()) {
+    return Status(1, "Missing domain");
+  }
+
+  if (RegistryFactory::get().external()) {
+    // External registries (extensions) do not have databases active.
+    // It is not possible to use an extension-based database.
+    PluginRequest request = {{"action", "compact_range"},
+                             {"domain", domain},
+                             {"key", low},
+                             {"key_high", high}};
+    return Registry::call("database", request);
+  }
+
+  ReadLock lock(kDatabaseReset);
+  if (!kDBInitialized) {
+    throw std::runtime_error("Cannot compact database values: " + low +
+                             " - " + high);
+  } else {
+    auto plugin = getDatabasePlugin();
+    return plugin->compactRange(domain, low, high);
+  }
+}
+
+Status getDatabaseStatistics(DatabaseStatistics& stats) {
+  if (RegistryFactory::get().external()) {
+    // External registries (extensions) do not have databases active.
+    // It is not possible to use an extension-based database.
+    PluginRequest request = {{"action", "statistics"}};
+    PluginResponse response;
+    auto status = Registry::call("database", request, response);
+
+    for (const auto& item : response) {
+      if (item.count("name") == 0 || item.count("value") == 0) {
+        continue;
+      }
+
+      DatabaseStatistic stat;
+      stat.domain = (item.count("domain") > 0) ? item.at("domain") : "";
+      stat.name = item.at("name");
+      stat.value = tryTo<uint64_t>(item.at("value")).takeOr(uint64_t{0});
+      stats.push_back(std::move(stat));
+    }
+    return status;
+  }
+
+  ReadLock lock(kDatabaseReset);
+  if (!kDBInitialized) {
+    return Status(1, "Database is not initialized");
+  } else {
+    auto plugin = getDatabasePlugin();
+    if (plugin == nullptr) {
+      return Status(1, "Cannot find the active database plugin");
+    }
+    return plugin->getStatistics(stats);
+  }
+}
+
 void resetDatabase() {
   PluginRequest request = {{"action", "reset"}};
   Registry::call("database", request);
+  kDBGeneration++;
 }
 
 void dumpDatabase() {
@@ -493,6 +762,7 @@ Status initDatabasePlugin() {
   }
 
   kDBInitialized = status.ok();
+  kDBGeneration++;
   return status;
 }
 
@@ -509,11 +779,16 @@ bool databaseInitialized() {
   return kDBInitialized;
 }
 
+size_t databaseGeneration() {
+  return kDBGeneration;
+}
+
 void shutdownDatabase() {
   auto database_registry = RegistryFactory::get().registry("database");
   for (auto& plugin : RegistryFactory::get().names("database")) {
     database_registry->remove(plugin);
   }
+  kDBGeneration++;
 }
 
 Status ptreeToRapidJSON(const std::string& in, std::string& out) {
@@ -625,6 +900,177 @@ static Status migrateV1V2(void) {
   return Status::success();
 }
 
+/// Zero-pad an event time or EventID the same way event subscribers do.
+static std::string toEventIndex(uint64_t i) {
+  auto str_index = std::to_string(i);
+  if (str_index.size() < 10) {
+    str_index.insert(str_index.begin(), 10 - str_index.size(), '0');
+  }
+  return str_index;
+}
+
+/**
+ * @brief Check for the "data.<namespace>.<time>.<eid>" layout of version 3.
+ *
+ * A namespace may contain '.', so a legacy "data.<namespace>.<eid>" key can
+ * also end with two numbers. Keys are only read as version 3 when their
+ * namespace has the column dictionary that version 3 stores with its rows.
+ */
+static bool isEventDataKeyV3(const std::string& key,
+                             const std::set<std::string>& namespaces) {
+  const std::string data_prefix("data.");
+  auto is_index = [&key](size_t begin, size_t end) {
+    return begin < end &&
+           std::all_of(key.begin() + begin, key.begin() + end, [](char c) {
+             return c >= '0' && c <= '9';
+           });
+  };
+
+  auto eid_pos = key.rfind('.');
+  if (eid_pos == std::string::npos || eid_pos <= data_prefix.size()) {
+    return false;
+  }
+
+  auto time_pos = key.rfind('.', eid_pos - 1);
+  if (time_pos == std::string::npos || time_pos <= data_prefix.size()) {
+    return false;
+  }
+
+  return is_index(time_pos + 1, eid_pos) &&
+         is_index(eid_pos + 1, key.size()) &&
+         namespaces.count(key.substr(
+             data_prefix.size(), time_pos - data_prefix.size())) > 0;
+}
+
+static Status migrateV2V3(void) {
+  // Event data moves from "data.<namespace>.<eid>" JSON rows to binary rows
+  // stored at "data.<namespace>.<time>.<eid>" with a per-namespace dictionary.
+  // A previous run may have been interrupted before the version was stored:
+  // rows already in the new layout are kept along with their dictionary.
+  const std::string data_prefix("data.");
+  const size_t batch_size{1024};
+
+  std::vector<std::string> keys;
+  auto s = scanDatabaseKeys(kEvents, keys, data_prefix);
+  if (!s.ok()) {
+    return Status::failure("Failed to scan event keys from database: " +
+                           s.what());
+  }
+
+  // The namespaces that already have rows in the new layout.
+  const std::string columns_prefix("columns.");
+  std::vector<std::string> columns_keys;
+  s = scanDatabaseKeys(kEvents, columns_keys, columns_prefix);
+  if (!s.ok()) {
+    return Status::failure("Failed to scan event keys from database: " +
+                           s.what());
+  }
+
+  std::set<std::string> v3_namespaces;
+  for (const auto& key : columns_keys) {
+    v3_namespaces.insert(key.substr(columns_prefix.size()));
+  }
+
+  std::map<std::string, RowColumnDictionary> dictionaries;
+  DatabaseStringValueList batch;
+  std::vector<std::string> migrated_keys;
+
+  auto flush = [&batch, &dictionaries]() {
+    if (batch.empty()) {
+      return Status::success();
+    }
+
+    // Store the dictionaries with each batch of rows that may reference them.
+    for (const auto& dictionary : dictionaries) {
+      batch.push_back(
+          std::make_pair("columns." + dictionary.first,
+                         dictionary.second.serialize()));
+    }
+    auto status = setDatabaseBatch(kEvents, batch);
+    batch.clear();
+    return status;
+  };
+
+  for (const auto& key : keys) {
+    if (isEventDataKeyV3(key, v3_namespaces)) {
+      continue;
+    }
+
+    auto pos = key.rfind('.');
+    if (pos == std::string::npos || pos <= data_prefix.size()) {
+      migrated_keys.push_back(key);
+      continue;
+    }
+
+    auto ns = key.substr(data_prefix.size(), pos - data_prefix.size());
+    auto eid = tryTo<uint64_t>(key.substr(pos + 1), 10);
+
+    std::string value;
+    Row row;
+    if (eid.isError() || !getDatabaseValue(kEvents, key, value).ok() ||
+        !deserializeRowJSON(value, row).ok() || row.count("time") == 0) {
+      // Subscribers drop events they cannot parse, do the same here.
+      migrated_keys.push_back(key);
+      continue;
+    }
+
+    auto time = tryTo<uint64_t>(row.at("time"), 10);
+    if (time.isError()) {
+      migrated_keys.push_back(key);
+      continue;
+    }
+
+    auto dictionary_it = dictionaries.find(ns);
+    if (dictionary_it == dictionaries.end()) {
+      // Extend the dictionary used by the rows that were already migrated.
+      RowColumnDictionary dictionary;
+      std::string serialized_dictionary;
+      if (getDatabaseValue(kEvents, "columns." + ns, serialized_dictionary)
+              .ok() &&
+          !dictionary.deserialize(serialized_dictionary).ok()) {
+        LOG(WARNING) << "Discarding the invalid column dictionary of " << ns;
+        dictionary = RowColumnDictionary();
+      }
+      dictionary_it = dictionaries.emplace(ns, std::move(dictionary)).first;
+    }
+
+    std::string serialized_row;
+    serializeRowBinary(row, dictionary_it->second, serialized_row);
+    batch.push_back(std::make_pair(data_prefix + ns + "." +
+                                       toEventIndex(time.get()) + "." +
+                                       toEventIndex(eid.get()),
+                                   std::move(serialized_row)));
+    migrated_keys.push_back(key);
+
+    if (batch.size() >= batch_size) {
+      s = flush();
+      if (!s.ok()) {
+        return Status::failure("Failed to write migrated events: " +
+                               s.what());
+      }
+    }
+  }
+
+  s = flush();
+  if (!s.ok()) {
+    return Status::failure("Failed to write migrated events: " + s.what());
+  }
+
+  // The legacy keys are only removed once every row has been rewritten.
+  size_t error_count{0};
+  for (const auto& key : migrated_keys) {
+    if (!deleteDatabaseValue(kEvents, key).ok()) {
+      ++error_count;
+    }
+  }
+
+  if (error_count > 0) {
+    LOG(WARNING) << "Failed to delete " << error_count
+                 << " legacy event keys after migration";
+  }
+  return Status::success();
+}
+
 Status upgradeDatabase(int to_version) {
   std::string value;
   Status st = getDatabaseValue(kPersistentSettings, kDbVersionKey, value);
@@ -656,6 +1102,10 @@ Status upgradeDatabase(int to_version) {
       migrate_status = migrateV1V2();
       break;
 
+    case 2:
+      migrate_status = migrateV2V3();
+      break;
+
     default:
       LOG(ERROR) << "Logic error: the migration code is broken!";
       migrate_status = Status::failure("Migration code broken.");
@@ -742,6 +1192,27 @@ class OsqueryDatabase final : public IDatabaseInterface {
                                   size_t max) const override {
     return osquery::scanDatabaseKeys(domain, keys, prefix, max);
   }
+
+  virtual Status scanDatabaseRange(const std::string& domain,
+                                   const std::string& low,
+                                   const std::string& high,
+                                   DatabaseStringValueList& results,
+                                   size_t max) const override {
+    return osquery::scanDatabaseRange(domain, low, high, results, max);
+  }
+
+  virtual Status getDatabaseRangeSize(const std::string& domain,
+                                      const std::string& low,
+                                      const std::string& high,
+                                      uint64_t& size) const override {
+    return osquery::getDatabaseRangeSize(domain, low, high, size);
+  }
+
+  virtual Status compactDatabaseRange(const std::string& domain,
+                                      const std::string& low,
+                                      const std::string& high) const override {
+    return osquery::compactDatabaseRange(domain, low, high);
+  }
 };
 
 IDatabaseInterface& getOsqueryDatabase() {
@@ -59,7 +59,7 @@ extern const std::string kDistributedQueries;
 extern const std::string kDistributedRunningQueries;
 
 /// The running version of our database schema
-const int kDbCurrentVersion = 2;
+const int kDbCurrentVersion = 3;
 
 /**
  * @brief The "domain" where buffered log results are stored.
@@ -74,6 +74,19 @@ extern const std::string kLogs;
 using DatabaseStringValueList =
     std::vector<std::pair<std::string, std::string>>;
 
+/// A counter or property reported by the backing store.
+struct DatabaseStatistic {
+  /// The domain the value describes, empty if it covers the whole store.
+  std::string domain;
+
+  /// The plugin-specific statistic name.
+  std::string name;
+
+  uint64_t value{0};
+};
+
+using DatabaseStatistics = std::vector<DatabaseStatistic>;
+
 /**
  * @brief An osquery backing storage (database) type that persists executions.
  *
@@ -140,11 +153,68 @@ class DatabasePlugin : public Plugin {
                              const std::string& low,
                              const std::string& high) = 0;
 
+  /**
+   * @brief Remove a list of keys.
+   *
+   * The default implementation removes each key, plugins that can apply
+   * several writes at once should override this with a single batch write.
+   */
+  virtual Status removeBatch(const std::string& domain,
+                             const std::vector<std::string>& keys);
+
   virtual Status scan(const std::string& domain,
                       std::vector<std::string>& results,
                       const std::string& prefix,
                       uint64_t max) const;
 
+  /**
+   * @brief Retrieve the keys and values within a range, in key order.
+   *
+   * Both bounds are inclusive. The default implementation scans the keys
+   * sharing the bounds' common prefix and performs a lookup for each, plugins
+   * with ordered iteration should override this with a single range scan.
+   *
+   * @param domain A string value representing abstract storage indexing.
+   * @param low The lowest key to include.
+   * @param high The highest key to include.
+   * @param results [output] Key and value pairs appended in key order.
+   * @param max If non-zero, the maximum number of pairs to return.
+   */
+  virtual Status scanRange(const std::string& domain,
+                           const std::string& low,
+                           const std::string& high,
+                           DatabaseStringValueList& results,
+                           uint64_t max) const;
+
+  /**
+   * @brief Estimate the bytes used by the keys and values within a range.
+   *
+   * Both bounds are inclusive. The default implementation reports a size of
+   * 0, plugins should only override this with an inexpensive estimate.
+   */
+  virtual Status getRangeSize(const std::string& domain,
+                              const std::string& low,
+                              const std::string& high,
+                              uint64_t& size) const;
+
+  /**
+   * @brief Hint that most of the keys within a range have been removed.
+   *
+   * Plugins with background compaction may use the hint to reclaim the space
+   * used by the removed keys sooner. The default implementation does nothing.
+   */
+  virtual Status compactRange(const std::string& domain,
+                              const std::string& low,
+                              const std::string& high);
+
+  /**
+   * @brief Report the backing store's internal counters and properties.
+   *
+   * These are meant for inspecting cache and compaction behavior, the names
+   * and meaning are plugin-specific. The default implementation reports none.
+   */
+  virtual Status getStatistics(DatabaseStatistics& stats) const;
+
   /**
    * @brief Shutdown the database and release initialization resources.
    *
@@ -229,7 +299,11 @@ Status setDatabaseBatch(const std::string& domain,
 /// Remove a domain/key identified value from backing-store.
 Status deleteDatabaseValue(const std::string& domain, const std::string& key);
 
-/// Remove a range of keys in domain.
+/// Remove a list of domain/key identified values from backing-store.
+Status deleteDatabaseBatch(const std::string& domain,
+                           const std::vector<std::string>& keys);
+
+/// Remove the keys between low and high (inclusive) in domain.
 Status deleteDatabaseRange(const std::string& domain,
                            const std::string& low,
                            const std::string& high);
@@ -245,6 +319,27 @@ Status scanDatabaseKeys(const std::string& domain,
                         const std::string& prefix,
                         uint64_t max = 0);
 
+/// Get the keys and values between low and high (inclusive), in key order.
+Status scanDatabaseRange(const std::string& domain,
+                         const std::string& low,
+                         const std::string& high,
+                         DatabaseStringValueList& results,
+                         uint64_t max = 0);
+
+/// Estimate the bytes stored between low and high (inclusive).
+Status getDatabaseRangeSize(const std::string& domain,
+                            const std::string& low,
+                            const std::string& high,
+                            uint64_t& size);
+
+/// Hint that the keys between low and high (inclusive) were mostly removed.
+Status compactDatabaseRange(const std::string& domain,
+                            const std::string& low,
+                            const std::string& high);
+
+/// Get the active database plugin's counters and properties.
+Status getDatabaseStatistics(DatabaseStatistics& stats);
+
 /// Allow callers to reload or reset the database plugin.
 void resetDatabase();
 
@@ -275,6 +370,14 @@ Status initDatabasePluginForTesting();
 /// Check if the database has been initialized successfully.
 bool databaseInitialized();
 
+/**
+ * @brief A value that changes each time the database is reset or reopened.
+ *
+ * Components keeping an in-memory copy of stored values compare this to
+ * know when their copy must be reloaded.
+ */
+size_t databaseGeneration();
+
 /// Allow shutdown before exit.
 void shutdownDatabase();
 
@@ -65,6 +65,19 @@ class EphemeralDatabasePlugin : public DatabasePlugin {
               const std::string& prefix,
               uint64_t max) const override;
 
+  /// Key and value range lookup method.
+  Status scanRange(const std::string& domain,
+                   const std::string& low,
+                   const std::string& high,
+                   DatabaseStringValueList& results,
+                   uint64_t max) const override;
+
+  /// Key range size method.
+  Status getRangeSize(const std::string& domain,
+                      const std::string& low,
+                      const std::string& high,
+                      uint64_t& size) const override;
+
  public:
   /// Database workflow: open and setup.
   Status setUp() override {
@@ -199,4 +212,63 @@ Status EphemeralDatabasePlugin::scan(const std::string& domain,
   }
   return Status(0);
 }
+
+Status EphemeralDatabasePlugin::scanRange(const std::string& domain,
+                                          const std::string& low,
+                                          const std::string& high,
+                                          DatabaseStringValueList& results,
+                                          uint64_t max) const {
+  if (low > high) {
+    return Status::failure("Invalid range: low > high");
+  }
+
+  if (db_.count(domain) == 0) {
+    return Status(0);
+  }
+
+  const auto& values = db_.at(domain);
+  size_t count = 0;
+  for (auto it = values.lower_bound(low);
+       it != values.end() && it->first <= high;
+       ++it) {
+    if (it->second.type() == typeid(int)) {
+      results.push_back(std::make_pair(
+          it->first, std::to_string(boost::get<int>(it->second))));
+    } else {
+      results.push_back(
+          std::make_pair(it->first, boost::get<std::string>(it->second)));
+    }
+    if (max > 0 && ++count >= max) {
+      break;
+    }
+  }
+  return Status(0);
+}
+
+Status EphemeralDatabasePlugin::getRangeSize(const std::string& domain,
+                                             const std::string& low,
+                                             const std::string& high,
+                                             uint64_t& size) const {
+  size = 0;
+  if (low > high) {
+    return Status::failure("Invalid range: low > high");
+  }
+
+  if (db_.count(domain) == 0) {
+    return Status(0);
+  }
+
+  const auto& values = db_.at(domain);
+  for (auto it = values.lower_bound(low);
+       it != values.end() && it->first <= high;
+       ++it) {
+    size += it->first.size();
+    if (it->second.type() == typeid(int)) {
+      size += sizeof(int);
+    } else {
+      size += boost::get<std::string>(it->second).size();
+    }
+  }
+  return Status(0);
+}
 } // namespace osquery
@@ -60,6 +60,21 @@ class IDatabaseInterface {
                                   const std::string& prefix,
                                   size_t max) const = 0;
 
+  virtual Status scanDatabaseRange(const std::string& domain,
+                                   const std::string& low,
+                                   const std::string& high,
+                                   DatabaseStringValueList& results,
+                                   size_t max) const = 0;
+
+  virtual Status getDatabaseRangeSize(const std::string& domain,
+                                      const std::string& low,
+                                      const std::string& high,
+                                      uint64_t& size) const = 0;
+
+  virtual Status compactDatabaseRange(const std::string& domain,
+                                      const std::string& low,
+                                      const std::string& high) const = 0;
+
   IDatabaseInterface(const IDatabaseInterface&) = delete;
   IDatabaseInterface& operator=(const IDatabaseInterface&) = delete;
 };
@@ -8,6 +8,7 @@
  */
 
 #include <osquery/core/flags.h>
+#include <osquery/core/sql/row.h>
 #include <osquery/core/system.h>
 #include <osquery/database/database.h>
 #include <osquery/registry/registry.h>
@@ -16,6 +17,7 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <limits>
 
 namespace rj = rapidjson;
@@ -294,4 +296,160 @@ TEST_F(DatabaseTests, test_migration_v1v2) {
   EXPECT_EQ(value, "event_data");
 }
 
+TEST_F(DatabaseTests, test_migration_v2v3) {
+  /* Testing migration from 2 to 3 */
+  Status status = setDatabaseValue(kPersistentSettings, kDbVersionKey, "2");
+  ASSERT_TRUE(status.ok());
+
+  status = setDatabaseValue(
+      kEvents,
+      "data.auditeventpublisher.process_events.0000000042",
+      R"({"path":"/bin/ls","time":"1600000000","eid":"0000000042"})");
+  ASSERT_TRUE(status.ok());
+
+  status = setDatabaseValue(
+      kEvents, "data.auditeventpublisher.process_events.0000000043", "broken");
+  ASSERT_TRUE(status.ok());
+
+  status = upgradeDatabase(3);
+  ASSERT_TRUE(status.ok());
+
+  std::string value;
+  status = getDatabaseValue(kPersistentSettings, kDbVersionKey, value);
+  EXPECT_EQ(value, "3");
+
+  // Both legacy keys are removed, only the valid event is rewritten.
+  std::vector<std::string> keys;
+  scanDatabaseKeys(kEvents, keys, "data.auditeventpublisher.process_events.");
+  ASSERT_EQ(keys.size(), 1U);
+  EXPECT_EQ(keys[0],
+            "data.auditeventpublisher.process_events.1600000000.0000000042");
+
+  std::string serialized_dictionary;
+  status = getDatabaseValue(kEvents,
+                            "columns.auditeventpublisher.process_events",
+                            serialized_dictionary);
+  ASSERT_TRUE(status.ok());
+
+  RowColumnDictionary dictionary;
+  ASSERT_TRUE(dictionary.deserialize(serialized_dictionary).ok());
+
+  status = getDatabaseValue(kEvents, keys[0], value);
+  ASSERT_TRUE(status.ok());
+
+  Row row;
+  ASSERT_TRUE(deserializeRowBinary(value, dictionary, row).ok());
+  Row expected = {
+      {"path", "/bin/ls"}, {"time", "1600000000"}, {"eid", "0000000042"}};
+  EXPECT_EQ(row, expected);
+}
+
+TEST_F(DatabaseTests, test_migration_v2v3_dotted_namespace) {
+  /* Testing migration from 2 to 3 of a namespace ending with a number */
+  Status status = setDatabaseValue(kPersistentSettings, kDbVersionKey, "2");
+  ASSERT_TRUE(status.ok());
+
+  // The legacy key ends with two numbers, like the keys of version 3
+  status = setDatabaseValue(
+      kEvents,
+      "data.auditeventpublisher.process_events.1600000000.0000000042",
+      R"({"path":"/bin/ls","time":"1600000001","eid":"0000000042"})");
+  ASSERT_TRUE(status.ok());
+
+  ASSERT_TRUE(upgradeDatabase(3).ok());
+
+  const std::string migrated_key(
+      "data.auditeventpublisher.process_events.1600000000.1600000001."
+      "0000000042");
+  auto check_migrated_rows = [&migrated_key]() {
+    std::vector<std::string> keys;
+    scanDatabaseKeys(kEvents, keys, "data.auditeventpublisher.");
+    ASSERT_EQ(keys, std::vector<std::string>{migrated_key});
+
+    // The namespace keeps its last part, it is not read as an event time
+    std::string serialized_dictionary;
+    ASSERT_TRUE(getDatabaseValue(kEvents,
+                                 "columns.auditeventpublisher.process_events."
+                                 "1600000000",
+                                 serialized_dictionary)
+                    .ok());
+  };
+  check_migrated_rows();
+
+  // The migrated row is recognized by its namespace when running again
+  ASSERT_TRUE(setDatabaseValue(kPersistentSettings, kDbVersionKey, "2").ok());
+  ASSERT_TRUE(upgradeDatabase(3).ok());
+  check_migrated_rows();
+}
+
+TEST_F(DatabaseTests, test_migration_v2v3_rerun) {
+  /* Testing a migration from 2 to 3 that was interrupted before */
+  Status status = setDatabaseValue(kPersistentSettings, kDbVersionKey, "2");
+  ASSERT_TRUE(status.ok());
+
+  // The previous run stored a row and its dictionary, the columns are not in
+  // the order that a new dictionary would assign them
+  RowColumnDictionary previous_dictionary;
+  Row migrated_row = {
+      {"time", "1600000000"}, {"uid", "0"}, {"eid", "0000000041"}};
+  std::string serialized_row;
+  serializeRowBinary(migrated_row, previous_dictionary, serialized_row);
+
+  const std::string migrated_key(
+      "data.auditeventpublisher.process_events.1600000000.0000000041");
+  ASSERT_TRUE(setDatabaseValue(kEvents, migrated_key, serialized_row).ok());
+  ASSERT_TRUE(setDatabaseValue(kEvents,
+                               "columns.auditeventpublisher.process_events",
+                               previous_dictionary.serialize())
+                  .ok());
+
+  // And it did not get to delete this legacy row
+  status = setDatabaseValue(
+      kEvents,
+      "data.auditeventpublisher.process_events.0000000042",
+      R"({"path":"/bin/ls","time":"1600000001","eid":"0000000042"})");
+  ASSERT_TRUE(status.ok());
+
+  auto check_migrated_rows = [&migrated_key, &migrated_row]() {
+    std::vector<std::string> keys;
+    scanDatabaseKeys(kEvents, keys, "data.auditeventpublisher.process_events.");
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<std::string> expected_keys = {
+        migrated_key,
+        "data.auditeventpublisher.process_events.1600000001.0000000042"};
+    ASSERT_EQ(keys, expected_keys);
+
+    std::string serialized_dictionary;
+    ASSERT_TRUE(getDatabaseValue(kEvents,
+                                 "columns.auditeventpublisher.process_events",
+                                 serialized_dictionary)
+                    .ok());
+
+    RowColumnDictionary dictionary;
+    ASSERT_TRUE(dictionary.deserialize(serialized_dictionary).ok());
+
+    std::string value;
+    Row row;
+    ASSERT_TRUE(getDatabaseValue(kEvents, keys[0], value).ok());
+    ASSERT_TRUE(deserializeRowBinary(value, dictionary, row).ok());
+    EXPECT_EQ(row, migrated_row);
+
+    row.clear();
+    ASSERT_TRUE(getDatabaseValue(kEvents, keys[1], value).ok());
+    ASSERT_TRUE(deserializeRowBinary(value, dictionary, row).ok());
+    Row expected = {
+        {"path", "/bin/ls"}, {"time", "1600000001"}, {"eid", "0000000042"}};
+    EXPECT_EQ(row, expected);
+  };
+
+  ASSERT_TRUE(upgradeDatabase(3).ok());
+  check_migrated_rows();
+
+  // Running the migration again over fully migrated data changes nothing
+  ASSERT_TRUE(setDatabaseValue(kPersistentSettings, kDbVersionKey, "2").ok());
+  ASSERT_TRUE(upgradeDatabase(3).ok());
+  check_migrated_rows();
+}
+
 } // namespace osquery
@@ -36,6 +36,78 @@ TEST_F(ResultsTests, test_simple_diff) {
   EXPECT_EQ(results.removed, o);
 }
 
+TEST_F(ResultsTests, test_row_hash_diff) {
+  RowTyped r1;
+  r1["foo"] = "bar";
+  RowTyped r2;
+  r2["foo"] = 1LL;
+  RowTyped r3;
+  r3["foo"] = "1";
+
+  // Values of different types must not share a digest.
+  EXPECT_NE(hashRow(r2), hashRow(r3));
+  EXPECT_EQ(hashRow(r1), hashRow(RowTyped(r1)));
+
+  RowHashIndex old_index;
+  old_index[hashRow(r1)] = 2;
+  old_index[hashRow(r2)] = 1;
+
+  QueryDataTyped n = {r1, r3, r3};
+  auto results = diffRowHashes(old_index, n);
+  ASSERT_EQ(results.added.size(), 2U);
+  EXPECT_EQ(results.added[0], 1U);
+  EXPECT_EQ(results.added[1], 2U);
+  ASSERT_EQ(results.removed.size(), 2U);
+  EXPECT_EQ(results.removed[hashRow(r1)], 1U);
+  EXPECT_EQ(results.removed[hashRow(r2)], 1U);
+  EXPECT_EQ(results.index[hashRow(r3)], 2U);
+  EXPECT_EQ(results.hashes.size(), n.size());
+
+  // The ordered differential reports the same rows.
+  QueryDataSet os = {r1, r1, r2};
+  auto expected = diff(os, n);
+  EXPECT_EQ(expected.added.size(), results.added.size());
+  EXPECT_EQ(expected.removed.size(), 2U);
+}
+
+TEST_F(ResultsTests, test_row_hash_index_serialization) {
+  RowTyped r1;
+  r1["foo"] = "bar";
+  RowTyped r2;
+  r2["foo"] = 1.5;
+
+  RowHashIndex index;
+  index[hashRow(r1)] = 1;
+  index[hashRow(r2)] = 3;
+
+  std::string content;
+  serializeRowHashIndex(index, content);
+  EXPECT_TRUE(isRowHashIndex(content));
+
+  RowHashIndex output;
+  ASSERT_TRUE(deserializeRowHashIndex(content, output).ok());
+  EXPECT_EQ(output, index);
+
+  // Results stored as a JSON array are not an index.
+  EXPECT_FALSE(isRowHashIndex("[]"));
+  EXPECT_FALSE(deserializeRowHashIndex("[]", output).ok());
+
+  RowHash hash;
+  EXPECT_TRUE(RowHash::fromString(hashRow(r1).toString(), hash));
+  EXPECT_EQ(hash, hashRow(r1));
+  EXPECT_FALSE(RowHash::fromString("not a digest", hash));
+}
+
+TEST_F(ResultsTests, test_row_hash_portable) {
+  // Stored row hashes are the same whatever the byte order of the host.
+  RowTyped r;
+  r["name"] = "osquery";
+  r["path"] = "/usr/local/bin/osqueryd with a long path";
+  r["pid"] = -42LL;
+  r["ratio"] = 0.5;
+  EXPECT_EQ(hashRow(r).toString(), "a81c8427d513b6d088d9743846b22f01");
+}
+
 TEST_F(ResultsTests, test_serialize_row) {
   auto results = getSerializedRow();
   auto doc = JSON::newObject();
@@ -59,6 +131,34 @@ TEST_F(ResultsTests, test_deserialize_row_json) {
   EXPECT_EQ(output, results.second);
 }
 
+TEST_F(ResultsTests, test_row_binary) {
+  Row input = {{"path", "/bin/ls"}, {"empty", ""}, {"pid", "1234"}};
+
+  RowColumnDictionary dictionary;
+  std::string encoded;
+  serializeRowBinary(input, dictionary, encoded);
+  EXPECT_EQ(dictionary.size(), 3U);
+  // The encoding never includes NUL bytes outside of values.
+  EXPECT_EQ(encoded.find('\0'), std::string::npos);
+
+  // A dictionary restored from storage decodes the same row.
+  RowColumnDictionary stored;
+  ASSERT_TRUE(stored.deserialize(dictionary.serialize()).ok());
+
+  Row output;
+  auto s = deserializeRowBinary(encoded, stored, output);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(output, input);
+
+  // Columns are reused, and rows with unknown columns are rejected.
+  serializeRowBinary({{"path", "/bin/ps"}}, dictionary, encoded);
+  EXPECT_EQ(dictionary.size(), 3U);
+  serializeRowBinary({{"uid", "0"}}, dictionary, encoded);
+  EXPECT_EQ(dictionary.size(), 4U);
+  EXPECT_FALSE(deserializeRowBinary(encoded, stored, output).ok());
+  EXPECT_FALSE(deserializeRowBinary("{}", stored, output).ok());
+}
+
 TEST_F(ResultsTests, test_serialize_query_data) {
   auto results = getSerializedQueryData();
   auto doc = JSON::newArray();
@@ -126,6 +226,32 @@ TEST_F(ResultsTests, test_serialize_query_log_item_json) {
   EXPECT_EQ(results.first, json);
 }
 
+TEST_F(ResultsTests, test_serialize_incomplete_snapshot) {
+  auto results = getSerializedQueryLogItem();
+  auto& item = results.second;
+  item.isSnapshot = true;
+  item.snapshot_results = getSerializedQueryData().second;
+
+  // A complete snapshot does not carry the field.
+  auto doc = JSON::newObject();
+  ASSERT_TRUE(serializeQueryLogItem(item, doc).ok());
+  EXPECT_FALSE(doc.doc().HasMember("incomplete"));
+
+  item.incomplete = true;
+  doc = JSON::newObject();
+  ASSERT_TRUE(serializeQueryLogItem(item, doc).ok());
+  ASSERT_TRUE(doc.doc().HasMember("incomplete"));
+  EXPECT_TRUE(doc.doc()["incomplete"].GetBool());
+
+  // Each event of the partial snapshot is marked.
+  std::vector<std::string> events;
+  ASSERT_TRUE(serializeQueryLogItemAsEventsJSON(item, events).ok());
+  ASSERT_EQ(events.size(), item.snapshot_results.size());
+  for (const auto& event : events) {
+    EXPECT_NE(event.find("\"incomplete\":true"), std::string::npos);
+  }
+}
+
 TEST_F(ResultsTests, test_adding_duplicate_rows_to_query_data) {
   RowTyped r1, r2, r3;
   r1["foo"] = "bar";
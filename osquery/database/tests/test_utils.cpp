@@ -241,6 +241,22 @@ void DatabasePluginTests::testDeleteRange() {
   EXPECT_FALSE(s.ok());
 }
 
+void DatabasePluginTests::testDeleteBatch() {
+  getPlugin()->put(kQueries, "test_batch1", "1");
+  getPlugin()->put(kQueries, "test_batch2", "2");
+  getPlugin()->put(kQueries, "test_batch3", "3");
+  auto s = getPlugin()->removeBatch(kQueries, {"test_batch1", "test_batch3"});
+  EXPECT_TRUE(s.ok());
+
+  std::string r;
+  s = getPlugin()->get(kQueries, "test_batch1", r);
+  EXPECT_FALSE(s.ok());
+  s = getPlugin()->get(kQueries, "test_batch3", r);
+  EXPECT_FALSE(s.ok());
+  getPlugin()->get(kQueries, "test_batch2", r);
+  EXPECT_EQ(r, "2");
+}
+
 void DatabasePluginTests::testScan() {
   getPlugin()->put(kQueries, "test_scan_foo1", "baz");
   getPlugin()->put(kQueries, "test_scan_foo2", "baz");
@@ -269,4 +285,53 @@ void DatabasePluginTests::testScanLimit() {
   EXPECT_EQ(s.getMessage(), "OK");
   EXPECT_EQ(keys.size(), 2U);
 }
+
+void DatabasePluginTests::testScanRange() {
+  getPlugin()->put(kQueries, "test_range_1", "a");
+  getPlugin()->put(kQueries, "test_range_2", "b");
+  getPlugin()->put(kQueries, "test_range_3", "c");
+  getPlugin()->put(kQueries, "test_range_4", "d");
+
+  DatabaseStringValueList results;
+  auto s = getPlugin()->scanRange(
+      kQueries, "test_range_2", "test_range_3", results, 0);
+  EXPECT_TRUE(s.ok());
+  DatabaseStringValueList expected = {{"test_range_2", "b"},
+                                      {"test_range_3", "c"}};
+  EXPECT_EQ(results, expected);
+
+  results.clear();
+  s = getPlugin()->scanRange(
+      kQueries, "test_range_", "test_range_~", results, 3);
+  EXPECT_TRUE(s.ok());
+  ASSERT_EQ(results.size(), 3U);
+  EXPECT_EQ(results[0].first, "test_range_1");
+  EXPECT_EQ(results[2].first, "test_range_3");
+
+  results.clear();
+  s = getPlugin()->scanRange(
+      kQueries, "test_range_3", "test_range_2", results, 0);
+  EXPECT_FALSE(s.ok());
+  EXPECT_TRUE(results.empty());
+
+  // Keys and values are bytes, compared and returned with their full length
+  const std::string nul_key("test_range_5\0a", 14);
+  const std::string binary_value("\x01\0\x02", 3);
+  getPlugin()->put(kQueries, nul_key, binary_value);
+  getPlugin()->put(kQueries, "test_range_5\xff", "e");
+
+  std::string value;
+  EXPECT_TRUE(getPlugin()->get(kQueries, nul_key, value).ok());
+  EXPECT_EQ(value, binary_value);
+
+  results.clear();
+  s = getPlugin()->scanRange(kQueries,
+                             std::string("test_range_5\0", 13),
+                             "test_range_5\xff",
+                             results,
+                             0);
+  EXPECT_TRUE(s.ok());
+  expected = {{nul_key, binary_value}, {"test_range_5\xff", "e"}};
+  EXPECT_EQ(results, expected);
+}
 } // namespace osquery
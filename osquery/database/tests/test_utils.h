@@ -36,11 +36,17 @@
   TEST_F(n, test_delete_range) {                                               \
     testDeleteRange();                                                         \
   }                                                                            \
+  TEST_F(n, test_delete_batch) {                                               \
+    testDeleteBatch();                                                         \
+  }                                                                            \
   TEST_F(n, test_scan) {                                                       \
     testScan();                                                                \
   }                                                                            \
   TEST_F(n, test_scan_limit) {                                                 \
     testScanLimit();                                                           \
+  }                                                                            \
+  TEST_F(n, test_scan_range) {                                                 \
+    testScanRange();                                                           \
   }
 
 namespace osquery {
@@ -93,7 +99,9 @@ class DatabasePluginTests : public testing::Test {
   void testGet();
   void testDelete();
   void testDeleteRange();
+  void testDeleteBatch();
   void testScan();
   void testScanLimit();
+  void testScanRange();
 };
 } // namespace osquery
@@ -27,6 +27,8 @@
 #include <osquery/process/process.h>
 #include <osquery/profiler/code_profiler.h>
 #include <osquery/sql/sqlite_util.h>
+#include <osquery/utils/conversions/split.h>
+#include <osquery/utils/conversions/tryto.h>
 #include <osquery/utils/expected/expected.h>
 #include <osquery/utils/system/time.h>
 #include <osquery/worker/system/memory.h>
@@ -58,12 +60,49 @@ HIDDEN_FLAG(bool,
             false,
             "Reload the SQL implementation during schedule reload");
 
+FLAG(uint64,
+     schedule_workers,
+     0,
+     "Number of threads running scheduled queries concurrently (0 = in order)");
+
+FLAG(string,
+     schedule_table_limits,
+     "yara:1,carves:1",
+     "Comma-delimited table:limit pairs used when schedule_workers is set");
+
+FLAG(uint64,
+     schedule_snapshot_chunk_size,
+     0,
+     "Log snapshot query results in chunks of rows as they are read (0 = off)");
+
 /// Used to bypass (optimize-out) the set-differential of query results.
 DECLARE_bool(events_optimize);
 DECLARE_bool(enable_numeric_monitoring);
 DECLARE_bool(verbose);
 
-SQLInternal monitor(const std::string& name, const ScheduledQuery& query) {
+static inline SQLInternal runScheduledSQL(const ScheduledQuery& query,
+                                          uint64_t step,
+                                          const SQLiteDBInstanceRef& dbc,
+                                          const RowChunkCallback& callback) {
+  auto instance = (dbc == nullptr) ? SQLiteDBManager::get() : dbc;
+
+  // Cacheable tables judge freshness with the step and interval of the query.
+  instance->setCacheStep(step, query.splayed_interval);
+  if (callback != nullptr) {
+    return SQLInternal(query.query,
+                       instance,
+                       true,
+                       FLAGS_schedule_snapshot_chunk_size,
+                       callback);
+  }
+  return SQLInternal(query.query, instance, true);
+}
+
+SQLInternal monitor(const std::string& name,
+                    const ScheduledQuery& query,
+                    uint64_t step,
+                    const SQLiteDBInstanceRef& dbc,
+                    const RowChunkCallback& callback) {
   if (FLAGS_enable_numeric_monitoring) {
     CodeProfiler profiler(
         {(boost::format("scheduler.pack.%s") % query.pack_name).str(),
@@ -78,43 +117,106 @@ SQLInternal monitor(const std::string& name, const ScheduledQuery& query) {
           monitoring::hostIdentifierKeys().scheme % query.pack_name %
           query.name)
              .str()});
-    return SQLInternal(query.query, true);
+    auto sql = runScheduledSQL(query, step, dbc, callback);
+    Config::get().recordQueryStatementCache(
+        name, sql.statementCacheHits(), sql.statementCacheMisses());
+    return sql;
   } else {
     // Snapshot the performance and times for the worker before running.
-    auto pid = std::to_string(PlatformProcess::getCurrentPid());
-    auto r0 = SQL::selectFrom({"resident_size", "user_time", "system_time"},
-                              "processes",
-                              "pid",
-                              EQUALS,
-                              pid);
+    ProcessResourceUsage r0;
+    auto sampled = platformGetResourceUsage(r0);
 
     using namespace std::chrono;
     auto t0 = steady_clock::now();
     Config::get().recordQueryStart(name);
-    SQLInternal sql(query.query, true);
+    auto sql = runScheduledSQL(query, step, dbc, callback);
+    Config::get().recordQueryStatementCache(
+        name, sql.statementCacheHits(), sql.statementCacheMisses());
 
     // Snapshot the performance after, and compare.
     auto t1 = steady_clock::now();
-    auto r1 = SQL::selectFrom({"resident_size", "user_time", "system_time"},
-                              "processes",
-                              "pid",
-                              EQUALS,
-                              pid);
-    if (r0.size() > 0 && r1.size() > 0) {
-      // Always called while processes table is working.
+    ProcessResourceUsage r1;
+    if (sampled && platformGetResourceUsage(r1)) {
       uint64_t size = sql.getSize();
       Config::get().recordQueryPerformance(
-          name,
-          duration_cast<milliseconds>(t1 - t0).count(),
-          size,
-          r0[0],
-          r1[0]);
+          name, duration_cast<milliseconds>(t1 - t0).count(), size, r0, r1);
     }
     return sql;
   }
 }
 
-Status launchQuery(const std::string& name, const ScheduledQuery& query) {
+/// Create a log item with the query metadata and host identifier.
+static QueryLogItem getQueryLogItem(const std::string& name) {
+  QueryLogItem item;
+  item.name = name;
+  item.identifier = getHostIdentifier();
+  item.time = osquery::getUnixTime();
+  item.epoch = FLAGS_schedule_epoch;
+  item.calendar_time = osquery::getAsciiTime();
+  item.isSnapshot = false;
+  getDecorations(item.decorations);
+  return item;
+}
+
+/**
+ * @brief Run a snapshot query and log the results as they are read.
+ *
+ * Each chunk of schedule_snapshot_chunk_size rows is logged as a snapshot
+ * log item. The newest chunk is held back until the next one is read, so if
+ * the query fails partway the last logged chunk is marked as incomplete.
+ */
+static Status launchChunkedSnapshotQuery(const std::string& name,
+                                         const ScheduledQuery& query,
+                                         uint64_t step,
+                                         const SQLiteDBInstanceRef& dbc) {
+  auto item = getQueryLogItem(name);
+  item.isSnapshot = true;
+
+  Status status;
+  size_t chunks = 0;
+  bool pending = false;
+  auto sql = monitor(name, query, step, dbc, [&](QueryDataTyped& rows) {
+    if (pending) {
+      status = logSnapshotQuery(item, chunks++ == 0);
+      if (!status.ok()) {
+        return status;
+      }
+    }
+    // Keep the new chunk and hand back the logged rows to reuse them.
+    std::swap(item.snapshot_results, rows);
+    pending = true;
+    return status;
+  });
+
+  if (status.ok() && (pending || sql.getStatus().ok())) {
+    // Log the held back chunk, or an empty snapshot as when results are not
+    // chunked. A failed query only logs the chunk if others were logged.
+    item.incomplete = !sql.getStatus().ok();
+    if (!item.incomplete || chunks > 0) {
+      status = logSnapshotQuery(item, chunks == 0);
+    }
+  }
+
+  if (!status.ok()) {
+    // If log directory is not available, then the daemon shouldn't continue.
+    std::string message = "Error logging the results of query: " + name +
+                          ": " + status.toString();
+    requestShutdown(EXIT_CATASTROPHIC, message);
+    return status;
+  }
+
+  if (!sql.getStatus().ok()) {
+    LOG(ERROR) << "Error executing scheduled query " << name << ": "
+               << sql.getStatus().toString();
+    return Status::failure("Error executing scheduled query");
+  }
+  return status;
+}
+
+Status launchQuery(const std::string& name,
+                   const ScheduledQuery& query,
+                   uint64_t step,
+                   const SQLiteDBInstanceRef& dbc) {
   // Execute the scheduled query and create a named query object.
   if (FLAGS_verbose) {
     VLOG(1) << "Executing scheduled query " << name << ": " << query.query;
@@ -123,26 +225,20 @@ Status launchQuery(const std::string& name, const ScheduledQuery& query) {
   }
   runDecorators(DECORATE_ALWAYS);
 
-  auto sql = monitor(name, query);
+  if (query.isSnapshotQuery() && FLAGS_schedule_snapshot_chunk_size > 0) {
+    return launchChunkedSnapshotQuery(name, query, step, dbc);
+  }
+
+  auto sql = monitor(name, query, step, dbc);
   if (!sql.getStatus().ok()) {
     LOG(ERROR) << "Error executing scheduled query " << name << ": "
                << sql.getStatus().toString();
     return Status::failure("Error executing scheduled query");
   }
 
-  // Fill in a host identifier fields based on configuration or availability.
-  std::string ident = getHostIdentifier();
-
   // A query log item contains an optional set of differential results or
   // a copy of the most-recent execution alongside some query metadata.
-  QueryLogItem item;
-  item.name = name;
-  item.identifier = ident;
-  item.time = osquery::getUnixTime();
-  item.epoch = FLAGS_schedule_epoch;
-  item.calendar_time = osquery::getAsciiTime();
-  item.isSnapshot = false;
-  getDecorations(item.decorations);
+  auto item = getQueryLogItem(name);
 
   if (query.isSnapshotQuery()) {
     // This is a snapshot query, emit results without a differential or state.
@@ -210,6 +306,186 @@ Status launchQuery(const std::string& name, const ScheduledQuery& query) {
   return status;
 }
 
+static void runScheduledQuery(const std::string& name,
+                              const ScheduledQuery& query,
+                              uint64_t step,
+                              const SQLiteDBInstanceRef& dbc) {
+  const auto status = launchQuery(name, query, step, dbc);
+  monitoring::record((boost::format("scheduler.query.%s.%s.status.%s") %
+                      query.pack_name % query.name %
+                      (status.ok() ? "success" : "failure"))
+                         .str(),
+                     1,
+                     monitoring::PreAggregationType::Sum,
+                     true);
+
+#ifdef OSQUERY_LINUX
+  // Attempt to release some unused memory kept by malloc internal caching
+  releaseRetainedMemory();
+#endif
+}
+
+SchedulerPool::SchedulerPool(size_t workers, const std::string& table_limits)
+    : table_limits_(parseTableLimits(table_limits)) {
+  for (size_t i = 0; i < workers; ++i) {
+    workers_.emplace_back([this, i]() { run(i); });
+  }
+}
+
+SchedulerPool::~SchedulerPool() {
+  stop();
+}
+
+std::map<std::string, size_t> SchedulerPool::parseTableLimits(
+    const std::string& table_limits) {
+  std::map<std::string, size_t> limits;
+  for (const auto& item : split(table_limits, ",")) {
+    auto pair = split(item, ":");
+    if (pair.size() == 2) {
+      auto limit = tryTo<std::size_t>(pair[1]);
+      if (limit.isValue() && limit.get() > 0) {
+        limits[pair[0]] = limit.take();
+        continue;
+      }
+    }
+    LOG(WARNING) << "Invalid scheduled table limit: " << item;
+  }
+  return limits;
+}
+
+std::vector<std::string> SchedulerPool::limitedTables(
+    const std::string& query) {
+  if (table_limits_.empty()) {
+    return {};
+  }
+
+  // Only the dispatching thread reads and writes the query table lookup.
+  auto it = query_tables_.find(query);
+  if (it != query_tables_.end()) {
+    return it->second;
+  }
+
+  std::set<std::string> tables;
+  QueryPlanner planner(query);
+  for (const auto& table : planner.tables()) {
+    if (table_limits_.count(table) > 0) {
+      tables.insert(table);
+    }
+  }
+
+  auto& limited = query_tables_[query];
+  limited.assign(tables.begin(), tables.end());
+  return limited;
+}
+
+bool SchedulerPool::dispatch(const std::string& name,
+                             const ScheduledQuery& query,
+                             uint64_t step) {
+  Task task;
+  task.name = name;
+  task.step = step;
+  task.query = ScheduledQuery(query.pack_name, query.name, query.query);
+  task.query.oncall = query.oncall;
+  task.query.interval = query.interval;
+  task.query.splayed_interval = query.splayed_interval;
+  task.query.denylisted = query.denylisted;
+  task.query.options = query.options;
+  task.limited_tables = limitedTables(query.query);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_ || pending_.count(name) > 0) {
+      return false;
+    }
+    pending_.insert(name);
+    queue_.push_back(std::move(task));
+  }
+  cv_.notify_all();
+  return true;
+}
+
+std::deque<SchedulerPool::Task>::iterator SchedulerPool::nextRunnable() {
+  return std::find_if(queue_.begin(), queue_.end(), [this](const Task& task) {
+    for (const auto& table : task.limited_tables) {
+      if (table_running_[table] >= table_limits_.at(table)) {
+        return false;
+      }
+    }
+    return true;
+  });
+}
+
+void SchedulerPool::run(size_t slot) {
+  // Queries running concurrently are each recorded under their worker's slot.
+  setExecutingQuerySlot(slot);
+
+  // Each worker keeps a connection, and its prepared statements, until tables
+  // are attached or detached.
+  SQLiteDBInstanceRef dbc;
+  size_t generation = 0;
+
+  while (true) {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this]() {
+        return stopping_ || nextRunnable() != queue_.end();
+      });
+      if (stopping_) {
+        break;
+      }
+
+      auto it = nextRunnable();
+      task = std::move(*it);
+      queue_.erase(it);
+      for (const auto& table : task.limited_tables) {
+        table_running_[table]++;
+      }
+      running_++;
+    }
+
+    if (dbc == nullptr || generation != SQLiteDBManager::attachGeneration()) {
+      generation = SQLiteDBManager::attachGeneration();
+      dbc = SQLiteDBManager::getUnique();
+    }
+    runScheduledQuery(task.name, task.query, task.step, dbc);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (const auto& table : task.limited_tables) {
+        table_running_[table]--;
+      }
+      pending_.erase(task.name);
+      running_--;
+    }
+    cv_.notify_all();
+  }
+}
+
+void SchedulerPool::wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait(lock, [this]() { return queue_.empty() && running_ == 0; });
+}
+
+void SchedulerPool::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+    for (const auto& task : queue_) {
+      pending_.erase(task.name);
+    }
+    queue_.clear();
+  }
+  cv_.notify_all();
+
+  for (auto& worker : workers_) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+  workers_.clear();
+}
+
 void SchedulerRunner::calculateTimeDriftAndMaybePause(
     std::chrono::milliseconds loop_step_duration) {
   if (loop_step_duration + time_drift_ < interval_) {
@@ -250,6 +526,11 @@ void SchedulerRunner::maybeReloadSchedule(uint64_t time_step) {
        happen due to the exclusive lock. */
     waitLogRelay();
 
+    // Queries running on the pool must not use the database while it resets.
+    if (pool_ != nullptr) {
+      pool_->wait();
+    }
+
     if (FLAGS_schedule_reload_sql) {
       SQLiteDBManager::resetPrimary();
     }
@@ -271,34 +552,47 @@ void SchedulerRunner::maybeFlushLogs(uint64_t time_step) {
   }
 }
 
+void SchedulerRunner::runQueries(uint64_t time_step) {
+  Config::get().scheduledQueries(([this, time_step](
+                                      const std::string& name,
+                                      const ScheduledQuery& query) {
+    if (query.splayed_interval == 0 ||
+        time_step % query.splayed_interval != 0) {
+      return;
+    }
+
+    if (pool_ == nullptr) {
+      runScheduledQuery(name, query, time_step, nullptr);
+      return;
+    }
+
+    // The previous execution must finish before the query is queued again.
+    if (!pool_->dispatch(name, query, time_step)) {
+      VLOG(1) << "Scheduled query " << name << " is still pending, skipping";
+      monitoring::record((boost::format("scheduler.query.%s.%s.status.%s") %
+                          query.pack_name % query.name % "skipped")
+                             .str(),
+                         1,
+                         monitoring::PreAggregationType::Sum,
+                         true);
+    }
+  }));
+}
+
 void SchedulerRunner::start() {
   // Start the counter at the second.
   auto i = osquery::getUnixTime();
   // Timeout is the number of seconds from starting.
   auto end = (timeout_ == 0) ? 0 : timeout_ + i;
 
+  if (FLAGS_schedule_workers > 0) {
+    pool_ = std::make_unique<SchedulerPool>(FLAGS_schedule_workers,
+                                            FLAGS_schedule_table_limits);
+  }
+
   for (; (end == 0) || (i <= end); ++i) {
     auto start_time_point = std::chrono::steady_clock::now();
-    Config::get().scheduledQueries(([&i](const std::string& name,
-                                         const ScheduledQuery& query) {
-      if (query.splayed_interval > 0 && i % query.splayed_interval == 0) {
-        TablePlugin::kCacheInterval = query.splayed_interval;
-        TablePlugin::kCacheStep = i;
-        const auto status = launchQuery(name, query);
-        monitoring::record((boost::format("scheduler.query.%s.%s.status.%s") %
-                            query.pack_name % query.name %
-                            (status.ok() ? "success" : "failure"))
-                               .str(),
-                           1,
-                           monitoring::PreAggregationType::Sum,
-                           true);
-
-#ifdef OSQUERY_LINUX
-        // Attempt to release some unused memory kept by malloc internal caching
-        releaseRetainedMemory();
-#endif
-      }
-    }));
+    runQueries(i);
 
     maybeRunDecorators(i);
     maybeReloadSchedule(i);
@@ -314,6 +608,15 @@ void SchedulerRunner::start() {
     }
   }
 
+  if (pool_ != nullptr) {
+    // Finish dispatched queries unless the scheduler was interrupted.
+    if (!interrupted()) {
+      pool_->wait();
+    }
+    pool_->stop();
+    pool_.reset();
+  }
+
   /* Wait for the thread relaying/flushing the logs,
      to prevent race conditions on shutdown */
   waitLogRelay();
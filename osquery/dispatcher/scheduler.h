@@ -10,14 +10,119 @@
 #pragma once
 
 #include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <map>
-
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <osquery/core/sql/scheduled_query.h>
 #include <osquery/dispatcher/dispatcher.h>
 
 #include "osquery/sql/sqlite_util.h"
 
 namespace osquery {
 
+/**
+ * @brief A bounded pool of threads running scheduled queries concurrently.
+ *
+ * Each worker owns a transient SQLiteDBInstance so queries do not contend
+ * for the primary database. Two executions of the same scheduled query are
+ * never queued or running at once, which keeps the ordering expected by
+ * Query::addNewResults and the epoch/counter bookkeeping.
+ *
+ * Tables that cannot be generated concurrently may be given a limit. A query
+ * using such a table stays queued until a slot for every limited table it
+ * scans is available, other queries are run meanwhile.
+ */
+class SchedulerPool : private boost::noncopyable {
+ public:
+  /**
+   * @brief Start the worker threads.
+   *
+   * @param workers The number of worker threads and SQLite connections.
+   * @param table_limits Comma-delimited list of table:limit pairs.
+   */
+  SchedulerPool(size_t workers, const std::string& table_limits);
+  ~SchedulerPool();
+
+  /**
+   * @brief Queue a due scheduled query.
+   *
+   * @param step The schedule step the query is due at.
+   * @return false if an execution of the same query is still pending.
+   */
+  bool dispatch(const std::string& name,
+                const ScheduledQuery& query,
+                uint64_t step);
+
+  /// Block until every dispatched query has finished.
+  void wait();
+
+  /// Drop queued queries and join the workers once running queries finish.
+  void stop();
+
+  /// Parse a comma-delimited list of table:limit pairs.
+  static std::map<std::string, size_t> parseTableLimits(
+      const std::string& table_limits);
+
+ private:
+  struct Task {
+    std::string name;
+    ScheduledQuery query;
+
+    /// The schedule step the query was dispatched at.
+    uint64_t step{0};
+
+    /// The tables scanned by the query that have a concurrency limit.
+    std::vector<std::string> limited_tables;
+  };
+
+  /// The worker thread entry point, slot is the index of the worker.
+  void run(size_t slot);
+
+  /// Find the first queued task whose limited tables have a free slot.
+  std::deque<Task>::iterator nextRunnable();
+
+  /// Lookup the limited tables scanned by a query.
+  std::vector<std::string> limitedTables(const std::string& query);
+
+ private:
+  /// Worker threads, each with a SQLite connection.
+  std::vector<std::thread> workers_;
+
+  /// Queries waiting for a worker, in schedule order.
+  std::deque<Task> queue_;
+
+  /// Names of queued or running queries.
+  std::set<std::string> pending_;
+
+  /// Concurrency limits for tables.
+  std::map<std::string, size_t> table_limits_;
+
+  /// Number of running queries scanning each limited table.
+  std::map<std::string, size_t> table_running_;
+
+  /// Limited tables scanned by each query, keyed by SQL text.
+  std::map<std::string, std::vector<std::string>> query_tables_;
+
+  /// Number of queries running on workers.
+  size_t running_{0};
+
+  /// Set when the workers should exit.
+  bool stopping_{false};
+
+  /// Protects all of the pool state.
+  std::mutex mutex_;
+
+  /// Signaled when a query is queued or finished, or the pool stops.
+  std::condition_variable cv_;
+};
+
 /// A Dispatcher service thread that watches an ExtensionManagerHandler.
 class SchedulerRunner : public InternalRunnable {
  public:
@@ -57,6 +162,9 @@ class SchedulerRunner : public InternalRunnable {
   /// Check if carve requests should be scheduled.
   void maybeScheduleCarves(uint64_t time_step);
 
+  /// Run the due queries for a step, or hand them to the pool.
+  void runQueries(uint64_t time_step);
+
  private:
   /// Interval in seconds between schedule steps.
   const std::chrono::milliseconds interval_;
@@ -71,13 +179,30 @@ class SchedulerRunner : public InternalRunnable {
 
   const std::chrono::milliseconds max_time_drift_;
 
+  /// Workers for concurrent queries, only used if schedule_workers is set.
+  std::unique_ptr<SchedulerPool> pool_;
+
   /// Tests should not always trigger a shutdown when the scheduler expires,
   /// so let tests decide when this should happen.
   FRIEND_TEST(TLSConfigTests, test_runner_and_scheduler);
   bool request_shutdown_on_expiration{true};
 };
 
-SQLInternal monitor(const std::string& name, const ScheduledQuery& query);
+/**
+ * @brief Run a scheduled query and record its performance.
+ *
+ * @param name The unique name of the scheduled query.
+ * @param query The scheduled query.
+ * @param step [optional] The schedule step, used by cacheable tables.
+ * @param dbc [optional] The SQLite connection, otherwise the manager decides.
+ * @param callback [optional] Stream the rows to a callback in chunks of
+ * schedule_snapshot_chunk_size rows instead of keeping them.
+ */
+SQLInternal monitor(const std::string& name,
+                    const ScheduledQuery& query,
+                    uint64_t step = 0,
+                    const SQLiteDBInstanceRef& dbc = nullptr,
+                    const RowChunkCallback& callback = nullptr);
 
 /// Start querying according to the config's schedule
 void startScheduler();
@@ -23,6 +23,7 @@ namespace osquery {
 
 DECLARE_bool(disable_logging);
 DECLARE_uint64(schedule_reload);
+DECLARE_uint64(schedule_workers);
 
 class SchedulerTests : public testing::Test {
   void SetUp() override {
@@ -32,17 +33,20 @@ class SchedulerTests : public testing::Test {
 
     logging_ = FLAGS_disable_logging;
     FLAGS_disable_logging = true;
+    workers_ = FLAGS_schedule_workers;
     Config::get().reset();
   }
 
   void TearDown() override {
     FLAGS_disable_logging = logging_;
+    FLAGS_schedule_workers = workers_;
     Config::get().reset();
     resetShutdown();
   }
 
  private:
   bool logging_{false};
+  uint64_t workers_{0};
 };
 
 TEST_F(SchedulerTests, test_monitor) {
@@ -175,13 +179,6 @@ TEST_F(SchedulerTests, test_config_results_purge) {
 }
 
 TEST_F(SchedulerTests, test_scheduler) {
-  auto backup_step = TablePlugin::kCacheStep;
-  auto backup_interval = TablePlugin::kCacheInterval;
-
-  // Start the scheduler now.
-  auto now = osquery::getUnixTime();
-  TablePlugin::kCacheStep = now;
-
   // Update the config with a pack/schedule that contains several queries.
   std::string config =
       "{"
@@ -202,22 +199,68 @@ TEST_F(SchedulerTests, test_scheduler) {
   SchedulerRunner runner(static_cast<unsigned long int>(1), 1);
   runner.start();
 
-  // If a query was executed the cache step will have been advanced.
-  EXPECT_GT(TablePlugin::kCacheStep, now);
+  // Every query was executed.
+  for (const auto& name : {"1", "2", "3", "4"}) {
+    QueryPerformance perf;
+    Config::get().getPerformanceStats(
+        std::string("pack_scheduler_") + name,
+        ([&perf](const QueryPerformance& r) { perf = r; }));
+    EXPECT_GT(perf.executions, 0U);
+  }
+}
+
+TEST_F(SchedulerTests, test_scheduler_pool) {
+  FLAGS_schedule_workers = 2;
+
+  std::string config = R"config(
+  {
+    "packs": {
+      "scheduler": {
+        "queries": {
+          "1": {"query": "select * from osquery_info", "interval": 1},
+          "2": {"query": "select * from time", "interval": 1},
+          "3": {"query": "select 3 as number", "interval": 1}
+        }
+      }
+    }
+  })config";
+  Config::get().update({{"data", config}});
+
+  SchedulerRunner runner(static_cast<unsigned long int>(1), 1);
+  runner.start();
 
-  // Restore plugin settings.
-  TablePlugin::kCacheStep = backup_step;
-  TablePlugin::kCacheInterval = backup_interval;
+  // Every query was run by a worker and finished before the runner ended.
+  for (const auto& name : {"1", "2", "3"}) {
+    QueryPerformance perf;
+    Config::get().getPerformanceStats(
+        std::string("pack_scheduler_") + name,
+        ([&perf](const QueryPerformance& r) { perf = r; }));
+    EXPECT_GT(perf.statement_cache_hits + perf.statement_cache_misses, 0U);
+  }
 }
 
-TEST_F(SchedulerTests, test_scheduler_zero_drift) {
-  const auto backup_step = TablePlugin::kCacheStep;
-  const auto backup_interval = TablePlugin::kCacheInterval;
+TEST_F(SchedulerTests, test_scheduler_pool_pending) {
+  // Without workers nothing is dequeued, so pending queries stay pending.
+  SchedulerPool pool(0, "");
 
-  // Start the scheduler now.
-  const auto now = osquery::getUnixTime();
-  TablePlugin::kCacheStep = now;
+  ScheduledQuery query("pack", "name", "select 1");
+  EXPECT_TRUE(pool.dispatch("pack_name", query, 1));
+  EXPECT_FALSE(pool.dispatch("pack_name", query, 2));
+  EXPECT_TRUE(pool.dispatch("pack_other", query, 2));
+
+  // Stopping drops the queued queries.
+  pool.stop();
+  EXPECT_FALSE(pool.dispatch("pack_name", query, 3));
+}
 
+TEST_F(SchedulerTests, test_scheduler_table_limits) {
+  auto limits = SchedulerPool::parseTableLimits("yara:1, hash:2,bad,zero:0");
+  ASSERT_EQ(limits.size(), 2U);
+  EXPECT_EQ(limits["yara"], 1U);
+  EXPECT_EQ(limits["hash"], 2U);
+}
+
+TEST_F(SchedulerTests, test_scheduler_zero_drift) {
   // Update the config with a pack/schedule that contains several queries.
   std::string config = R"config(
   {
@@ -238,20 +281,9 @@ TEST_F(SchedulerTests, test_scheduler_zero_drift) {
   runner.start();
 
   EXPECT_EQ(runner.getCurrentTimeDrift(), std::chrono::milliseconds::zero());
-
-  // Restore plugin settings.
-  TablePlugin::kCacheStep = backup_step;
-  TablePlugin::kCacheInterval = backup_interval;
 }
 
 TEST_F(SchedulerTests, test_scheduler_drift_accumulation) {
-  const auto backup_step = TablePlugin::kCacheStep;
-  const auto backup_interval = TablePlugin::kCacheInterval;
-
-  // Start the scheduler now.
-  const auto now = osquery::getUnixTime();
-  TablePlugin::kCacheStep = now;
-
   // Update the config with a pack/schedule that contains several queries.
   std::string config = R"config(
   {
@@ -277,10 +309,6 @@ TEST_F(SchedulerTests, test_scheduler_drift_accumulation) {
   runner.start();
 
   EXPECT_GE(runner.getCurrentTimeDrift(), std::chrono::milliseconds{1});
-
-  // Restore plugin settings.
-  TablePlugin::kCacheStep = backup_step;
-  TablePlugin::kCacheInterval = backup_interval;
 }
 
 TEST_F(SchedulerTests, test_scheduler_reload) {
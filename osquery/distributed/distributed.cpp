@@ -381,12 +381,8 @@ void Distributed::setCurrentRequestId(const std::string& cReqId) {
 SQL Distributed::monitorNonnumeric(const std::string& name,
                                    const std::string& query) {
   // Snapshot the performance and times for the worker before running.
-  auto pid = std::to_string(PlatformProcess::getCurrentPid());
-  auto r0 = SQL::selectFrom({"resident_size", "user_time", "system_time"},
-                            "processes",
-                            "pid",
-                            EQUALS,
-                            pid);
+  ProcessResourceUsage r0;
+  auto sampled = platformGetResourceUsage(r0);
 
   using namespace std::chrono;
   auto t0 = steady_clock::now();
@@ -394,16 +390,11 @@ SQL Distributed::monitorNonnumeric(const std::string& name,
 
   // Snapshot the performance after, and compare.
   auto t1 = steady_clock::now();
-  auto r1 = SQL::selectFrom({"resident_size", "user_time", "system_time"},
-                            "processes",
-                            "pid",
-                            EQUALS,
-                            pid);
-  if (r0.size() > 0 && r1.size() > 0) {
-    // Always called while processes table is working.
+  ProcessResourceUsage r1;
+  if (sampled && platformGetResourceUsage(r1)) {
     uint64_t size = sql.rows().size();
     recordQueryPerformance(
-        name, duration_cast<milliseconds>(t1 - t0).count(), size, r0[0], r1[0]);
+        name, duration_cast<milliseconds>(t1 - t0).count(), size, r0, r1);
   }
   return sql;
 }
@@ -411,38 +402,21 @@ SQL Distributed::monitorNonnumeric(const std::string& name,
 void Distributed::recordQueryPerformance(const std::string& name,
                                          uint64_t delay_ms,
                                          uint64_t size,
-                                         const Row& r0,
-                                         const Row& r1) {
+                                         const ProcessResourceUsage& r0,
+                                         const ProcessResourceUsage& r1) {
   performance_[name] = QueryPerformance();
 
   auto& query = performance_.at(name);
-  if (!r1.at("user_time").empty() && !r0.at("user_time").empty()) {
-    auto ut1 = tryTo<long long>(r1.at("user_time"));
-    auto ut0 = tryTo<long long>(r0.at("user_time"));
-    auto diff = (ut1 && ut0) ? ut1.take() - ut0.take() : 0;
-    if (diff > 0) {
-      query.user_time = diff;
-    }
-  }
-
-  if (!r1.at("system_time").empty() && !r0.at("system_time").empty()) {
-    auto st1 = tryTo<long long>(r1.at("system_time"));
-    auto st0 = tryTo<long long>(r0.at("system_time"));
-    auto diff = (st1 && st0) ? st1.take() - st0.take() : 0;
-    if (diff > 0) {
-      query.system_time = diff;
-    }
-  }
-
-  if (!r1.at("resident_size").empty() && !r0.at("resident_size").empty()) {
-    auto rs1 = tryTo<long long>(r1.at("resident_size"));
-    auto rs0 = tryTo<long long>(r0.at("resident_size"));
-    auto diff = (rs1 && rs0) ? rs1.take() - rs0.take() : 0;
-    if (diff > 0) {
-      query.last_memory = diff;
-    }
-  }
-
+  auto diff = [](uint64_t before, uint64_t after) -> uint64_t {
+    return (after > before) ? after - before : 0;
+  };
+  query.user_time = diff(r0.user_time, r1.user_time);
+  query.system_time = diff(r0.system_time, r1.system_time);
+  query.last_memory = diff(r0.resident_size, r1.resident_size);
+  query.page_faults = diff(r0.page_faults, r1.page_faults);
+  query.voluntary_context_switches =
+      diff(r0.voluntary_context_switches, r1.voluntary_context_switches);
+  query.bytes_read = diff(r0.bytes_read, r1.bytes_read);
   query.wall_time_ms = delay_ms;
 }
 
@@ -20,6 +20,8 @@
 
 namespace osquery {
 
+struct ProcessResourceUsage;
+
 /**
  * @brief Small struct containing the query and ID information for a
  * distributed query
@@ -350,14 +352,14 @@ class Distributed {
    * @param name Query name, as sent by the server
    * @param delay_ms Time taken for query to run
    * @param size number of rows output
-   * @param r0 Row generated from first call to the processes table
-   * @param r1 Row generated from second call to the processes table
+   * @param r0 Process resource usage sampled before the query
+   * @param r1 Process resource usage sampled after the query
    */
   void recordQueryPerformance(const std::string& name,
                               uint64_t delay_ms,
                               uint64_t size,
-                              const Row& r0,
-                              const Row& r1);
+                              const ProcessResourceUsage& r0,
+                              const ProcessResourceUsage& r1);
 
   std::vector<DistributedQueryResult> results_;
 
@@ -0,0 +1,91 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "osquery/events/linux/auditdnetlink.h"
+
+namespace osquery {
+namespace {
+
+const std::vector<std::pair<int, std::string>> kAuditRecordList = {
+    {AUDIT_SYSCALL,
+     "audit(1502125323.756:6): arch=c000003e syscall=59 success=yes exit=0 "
+     "a0=23eb8e0 a1=23ebbc0 a2=23c9860 a3=7ffe18d32ed0 items=2 ppid=6882 "
+     "pid=7841 auid=1000 uid=1000 gid=1000 euid=1000 suid=1000 fsuid=1000 "
+     "egid=1000 sgid=1000 fsgid=1000 tty=pts1 ses=2 comm=\"sh\" "
+     "exe=\"/usr/bin/bash\" subj=unconfined_u:unconfined_r:unconfined_t:s0"
+     "-s0:c0.c1023 key=(null)"},
+    {AUDIT_EXECVE,
+     "audit(1502125323.756:6): argc=4 a0=\"sh\" a1=\"-c\" a2=\"sleep 1\" "
+     "a3=\"--\""},
+    {AUDIT_CWD, "audit(1502125323.756:6): cwd=\"/home/alessandro\""},
+    {AUDIT_PATH,
+     "audit(1502125323.756:6): item=0 name=\"/usr/bin/sh\" inode=45506 "
+     "dev=fd:00 mode=0100755 ouid=0 ogid=0 rdev=00:00 "
+     "obj=system_u:object_r:shell_exec_t:s0 nametype=NORMAL"},
+    {AUDIT_EOE, "audit(1502125323.756:6): "},
+};
+
+} // namespace
+
+static void AUDIT_parse_reply(benchmark::State& state) {
+  std::vector<audit_reply> reply_list;
+  for (const auto& record : kAuditRecordList) {
+    audit_reply reply{};
+    reply.type = record.first;
+    reply.len = static_cast<int>(record.second.size());
+    reply.message = const_cast<char*>(record.second.data());
+    reply_list.push_back(reply);
+  }
+
+  AuditEventRecord audit_event_record = {};
+  while (state.KeepRunning()) {
+    for (const auto& reply : reply_list) {
+      AuditdNetlinkParser::ParseAuditReply(reply, audit_event_record);
+      benchmark::DoNotOptimize(audit_event_record);
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * reply_list.size());
+}
+
+BENCHMARK(AUDIT_parse_reply);
+
+static void AUDIT_parse_shared_buffer(benchmark::State& state) {
+  // All the records share a single buffer, as done by the parser service
+  auto buffer = std::make_shared<std::string>();
+  for (const auto& record : kAuditRecordList) {
+    buffer->append(record.second);
+  }
+  std::shared_ptr<const std::string> shared_buffer = std::move(buffer);
+
+  AuditEventRecord audit_event_record = {};
+  while (state.KeepRunning()) {
+    std::size_t offset{0U};
+    for (const auto& record : kAuditRecordList) {
+      std::string_view message(shared_buffer->data() + offset,
+                               record.second.size());
+      offset += record.second.size();
+
+      AuditdNetlinkParser::ParseAuditMessage(
+          record.first, message, shared_buffer, audit_event_record);
+      benchmark::DoNotOptimize(audit_event_record);
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * kAuditRecordList.size());
+}
+
+BENCHMARK(AUDIT_parse_shared_buffer);
+} // namespace osquery
@@ -0,0 +1,40 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <osquery/events/linux/bpf/systemstatetracker.h>
+
+#include "osquery/events/tests/linux/bpf/bpfeventfixtures.h"
+#include "osquery/events/tests/linux/bpf/mockedprocesscontextfactory.h"
+
+namespace osquery {
+
+static void BPF_process_event_fixtures(benchmark::State& state) {
+  auto state_tracker = SystemStateTracker::create(
+      IProcessContextFactory::Ref(new MockedProcessContextFactory));
+
+  const auto& fixture_list = getBPFEventFixtureList();
+
+  while (state.KeepRunning()) {
+    for (const auto& fixture : fixture_list) {
+      auto succeeded = fixture.event_handler(*state_tracker, fixture.event);
+      benchmark::DoNotOptimize(succeeded);
+    }
+
+    // Do not let the emitted events accumulate across iterations
+    auto event_list = state_tracker->eventList();
+    benchmark::DoNotOptimize(event_list);
+  }
+
+  state.SetItemsProcessed(state.iterations() * fixture_list.size());
+}
+
+BENCHMARK(BPF_process_event_fixtures);
+} // namespace osquery
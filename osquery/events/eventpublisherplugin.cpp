@@ -7,14 +7,27 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <osquery/core/flags.h>
 #include <osquery/events/eventfactory.h>
 #include <osquery/events/eventpublisherplugin.h>
 #include <osquery/events/eventsubscriber.h>
+#include <osquery/numeric_monitoring/numeric_monitoring.h>
 #include <osquery/registry/registry_factory.h>
 #include <osquery/utils/system/time.h>
 
 namespace osquery {
 
+DECLARE_bool(enable_numeric_monitoring);
+
+namespace {
+
+monitoring::ValueType toMicroseconds(EventClock::duration duration) {
+  return static_cast<monitoring::ValueType>(
+      std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+}
+
+} // namespace
+
 CREATE_REGISTRY(EventPublisherPlugin, "event_publisher");
 
 const std::string EventPublisherPlugin::type() const {
@@ -41,6 +54,31 @@ size_t EventPublisherPlugin::restartCount() const {
   return restart_count_;
 }
 
+const EventStatistics& EventPublisherPlugin::statistics() const {
+  return statistics_;
+}
+
+void EventPublisherPlugin::recordQueueDepth(std::size_t depth) {
+  statistics_.setQueueDepth(depth);
+  if (FLAGS_enable_numeric_monitoring) {
+    monitoring::record("events." + type() + ".queue_depth",
+                       static_cast<monitoring::ValueType>(depth),
+                       monitoring::PreAggregationType::Max);
+  }
+}
+
+void EventPublisherPlugin::recordDroppedEvents(std::uint64_t count) {
+  if (count == 0) {
+    return;
+  }
+  statistics_.addDroppedEvents(count);
+  if (FLAGS_enable_numeric_monitoring) {
+    monitoring::record("events." + type() + ".dropped",
+                       static_cast<monitoring::ValueType>(count),
+                       monitoring::PreAggregationType::Sum);
+  }
+}
+
 bool EventPublisherPlugin::interrupted() {
   // Warning: deprecated. Use isEnding() instead
   return false;
@@ -73,6 +111,9 @@ void EventPublisherPlugin::fire(const EventContextRef& ec, EventTime time) {
       }
       ec->time = time;
     }
+    if (ec->received_time == EventClock::time_point{}) {
+      ec->received_time = EventClock::now();
+    }
   }
 
   ReadLock lock(subscription_lock_);
@@ -80,8 +121,26 @@ void EventPublisherPlugin::fire(const EventContextRef& ec, EventTime time) {
     auto es = EventFactory::getEventSubscriber(subscription->subscriber_name);
     if (es != nullptr && es->state() == EventState::EVENT_RUNNING) {
       fireCallback(subscription, ec);
+      if (ec != nullptr) {
+        // Subscribers store their rows from within the callback.
+        es->recordLatency(EventClock::now() - ec->received_time);
+      }
     }
   }
+
+  if (ec == nullptr) {
+    return;
+  }
+  auto latency = EventClock::now() - ec->received_time;
+  statistics_.recordLatency(latency);
+  if (FLAGS_enable_numeric_monitoring) {
+    auto metric_prefix = "events." + type();
+    monitoring::record(
+        metric_prefix + ".fired", 1, monitoring::PreAggregationType::Sum);
+    monitoring::record(metric_prefix + ".latency_micros",
+                       toMicroseconds(latency),
+                       monitoring::PreAggregationType::Histogram);
+  }
 }
 
 uint64_t EventPublisherPlugin::getTime() const {
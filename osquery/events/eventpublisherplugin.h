@@ -12,6 +12,7 @@
 #include <osquery/core/plugins/plugin.h>
 #include <osquery/dispatcher/dispatcher.h>
 #include <osquery/events/eventer.h>
+#include <osquery/events/eventstatistics.h>
 #include <osquery/events/subscription.h>
 #include <osquery/events/types.h>
 
@@ -123,6 +124,9 @@ class EventPublisherPlugin : public Plugin,
   /// Get the number of publisher restarts.
   size_t restartCount() const;
 
+  /// Ingest latency, queue depth and dropped events of this publisher.
+  const EventStatistics& statistics() const;
+
   explicit EventPublisherPlugin(EventPublisherPlugin const&) = delete;
   EventPublisherPlugin& operator=(EventPublisherPlugin const&) = delete;
 
@@ -145,6 +149,12 @@ class EventPublisherPlugin : public Plugin,
   /// Return the current time (included to assist testing).
   virtual uint64_t getTime() const;
 
+  /// Report the number of events waiting in the publisher's own queues.
+  void recordQueueDepth(std::size_t depth);
+
+  /// Report events lost before they could be fired, e.g. by the kernel.
+  void recordDroppedEvents(std::uint64_t count);
+
   /// A lock for subscription manipulation.
   mutable Mutex subscription_lock_;
 
@@ -165,6 +175,9 @@ class EventPublisherPlugin : public Plugin,
   /// A helper count of event publisher runloop iterations.
   std::atomic<size_t> restart_count_{0};
 
+  /// Ingest instrumentation, latencies are recorded by fire.
+  EventStatistics statistics_;
+
   // clang-format off
   [[deprecated("Do not check for interrupted, instead use isEnding.")]]
   // clang-format on
@@ -176,5 +189,6 @@ class EventPublisherPlugin : public Plugin,
 
   FRIEND_TEST(EventsTests, test_event_publisher);
   FRIEND_TEST(EventsTests, test_fire_event);
+  FRIEND_TEST(EventsTests, test_event_statistics);
 };
 } // namespace osquery
@@ -0,0 +1,26 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <osquery/events/eventstatistics.h>
+
+namespace osquery {
+
+void EventStatistics::recordLatency(EventClock::duration latency) {
+  auto micros =
+      std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+  std::lock_guard<std::mutex> lock(latency_mutex_);
+  latency_.record(static_cast<monitoring::ValueType>(micros));
+}
+
+monitoring::Histogram EventStatistics::latency() const {
+  std::lock_guard<std::mutex> lock(latency_mutex_);
+  return latency_;
+}
+
+} // namespace osquery
@@ -0,0 +1,62 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include <osquery/events/types.h>
+#include <osquery/numeric_monitoring/histogram.h>
+
+namespace osquery {
+
+/**
+ * @brief Ingest instrumentation kept by every publisher and subscriber.
+ *
+ * The latency of an event is the time between its publisher receiving it and
+ * the subscriber callbacks returning, by then subscribers have stored their
+ * rows with addBatch. All values are kept since osquery started.
+ */
+class EventStatistics final {
+ public:
+  /// Count the latency of one fired event, in microseconds.
+  void recordLatency(EventClock::duration latency);
+
+  /// Count events that were lost before they could be stored.
+  void addDroppedEvents(std::uint64_t count) {
+    dropped_events_ += count;
+  }
+
+  /// Set the number of events waiting in the intermediate queues.
+  void setQueueDepth(std::size_t depth) {
+    queue_depth_ = depth;
+  }
+
+  std::uint64_t droppedEvents() const {
+    return dropped_events_;
+  }
+
+  std::size_t queueDepth() const {
+    return queue_depth_;
+  }
+
+  /// A copy of the latency histogram, in microseconds.
+  monitoring::Histogram latency() const;
+
+ private:
+  std::atomic<std::uint64_t> dropped_events_{0};
+  std::atomic<std::size_t> queue_depth_{0};
+
+  mutable std::mutex latency_mutex_;
+  monitoring::Histogram latency_;
+};
+
+} // namespace osquery
@@ -13,6 +13,7 @@
 #include <osquery/events/eventfactory.h>
 #include <osquery/events/eventsubscriberplugin.h>
 #include <osquery/logger/logger.h>
+#include <osquery/numeric_monitoring/numeric_monitoring.h>
 #include <osquery/registry/registry_factory.h>
 #include <osquery/sql/dynamic_table_row.h>
 #include <osquery/utils/conversions/tryto.h>
@@ -26,6 +27,41 @@ namespace {
 /// Checkpoint interval to inspect max event buffering.
 const EventContextID kEventsCheckpoint{256U};
 
+/// Number of event rows read from the database per range scan.
+const std::size_t kEventsScanPageSize{4096U};
+
+/// Removing at least this many events at once is followed by a compaction hint.
+const std::size_t kEventsCompactionThreshold{10000U};
+
+/// Parse the "<time>.<eid>" suffix of an event data key.
+bool parseEventDataKey(const std::string& key,
+                       std::size_t prefix_size,
+                       EventTime& event_time,
+                       EventID& event_id) {
+  if (key.size() <= prefix_size) {
+    return false;
+  }
+
+  const char* string_event_time = &key[prefix_size];
+  char* separator = nullptr;
+  auto time_value = std::strtoull(string_event_time, &separator, 10);
+  if (separator == string_event_time || *separator != '.') {
+    return false;
+  }
+
+  const char* string_event_id = separator + 1;
+  char* null_terminator = nullptr;
+  auto id_value = std::strtoull(string_event_id, &null_terminator, 10);
+  if (id_value == 0U || null_terminator == string_event_id ||
+      *null_terminator != '\0') {
+    return false;
+  }
+
+  event_time = static_cast<EventTime>(time_value);
+  event_id = static_cast<EventID>(id_value);
+  return true;
+}
+
 void removeDeprecatedEventKeysOnceHelper() {
   std::vector<std::string> key_list;
   auto status = scanDatabaseKeys(kEvents, key_list);
@@ -68,6 +104,55 @@ void removeDeprecatedEventKeysOnce() {
   std::call_once(f, removeDeprecatedEventKeysOnceHelper);
 }
 
+/**
+ * @brief Remove every stored event up to and including an event time.
+ *
+ * Event keys are ordered by time so this is a single range removal. Large
+ * removals hint the database to compact the range, and the estimated number
+ * of reclaimed bytes is recorded as a numeric monitoring metric.
+ */
+Status removeEventsUntil(EventSubscriberPlugin::Context& context,
+                         IDatabaseInterface& db_interface,
+                         EventTime last_time,
+                         std::size_t event_count) {
+  auto low = "data." + context.database_namespace + ".";
+  auto high = low + EventSubscriberPlugin::toIndex(last_time) + ".~";
+
+  uint64_t reclaimed_bytes{0U};
+  db_interface.getDatabaseRangeSize(kEvents, low, high, reclaimed_bytes);
+
+  auto status = db_interface.deleteDatabaseRange(kEvents, low, high);
+  if (!status.ok()) {
+    return status;
+  }
+
+  if (event_count >= kEventsCompactionThreshold) {
+    status = db_interface.compactDatabaseRange(kEvents, low, high);
+    if (!status.ok()) {
+      VLOG(1) << "Cannot compact expired events for subscriber "
+              << context.database_namespace << ": " << status.getMessage();
+    }
+  }
+
+  auto metric_prefix = "events." + context.database_namespace;
+  monitoring::record(metric_prefix + ".removed_events",
+                     static_cast<monitoring::ValueType>(event_count),
+                     monitoring::PreAggregationType::Sum);
+  monitoring::record(metric_prefix + ".reclaimed_bytes",
+                     static_cast<monitoring::ValueType>(reclaimed_bytes),
+                     monitoring::PreAggregationType::Sum);
+  return Status::success();
+}
+
+/// Count the events referenced by a list of event batches.
+std::size_t countEvents(const EventIndex& event_batch_list) {
+  std::size_t event_count{0U};
+  for (const auto& p : event_batch_list) {
+    event_count += p.second.size();
+  }
+  return event_count;
+}
+
 } // namespace
 
 FLAG(bool,
@@ -86,6 +171,13 @@ FLAG(uint64,
      50000,
      "Maximum number of event batches per type to buffer");
 
+FLAG(uint64,
+     events_expiry_bucket,
+     60,
+     "Seconds of events expired together with a single range removal");
+
+DECLARE_bool(enable_numeric_monitoring);
+
 CREATE_REGISTRY(EventSubscriberPlugin, "event_subscriber");
 
 EventSubscriberPlugin::EventSubscriberPlugin(bool enabled)
@@ -105,15 +197,16 @@ Status EventSubscriberPlugin::add(const Row& r) {
 }
 
 Status EventSubscriberPlugin::addBatch(std::vector<Row>& row_list) {
-  return addBatch(row_list, getUnixTime());
+  return addBatch(row_list, getTime());
 }
 
 Status EventSubscriberPlugin::addBatch(std::vector<Row>& row_list,
                                        EventTime custom_event_time) {
   removeDeprecatedEventKeysOnce();
 
-  DatabaseStringValueList database_data;
-  database_data.reserve(row_list.size());
+  if (row_list.empty()) {
+    return Status(1, "Failed to process the rows");
+  }
 
   EventIDList event_id_list;
   event_id_list.reserve(row_list.size());
@@ -121,40 +214,31 @@ Status EventSubscriberPlugin::addBatch(std::vector<Row>& row_list,
   auto event_time = custom_event_time != 0 ? custom_event_time : getTime();
   auto string_event_time = std::to_string(event_time);
 
+  // Logger plugins may request events to be forwarded directly.
+  // If no active logger is marked 'usesLogEvent' then this is a no-op.
+  auto forward_events = EventFactory::hasForwarders();
+
   for (auto& row : row_list) {
     auto event_identifier = getEventID();
     event_id_list.push_back(event_identifier);
 
-    auto string_event_identifier = toIndex(event_identifier);
-
     row["time"] = string_event_time;
-    row["eid"] = string_event_identifier;
+    row["eid"] = toIndex(event_identifier);
 
-    // Serialize and store the row data, for query-time retrieval.
-    std::string serialized_row;
-    auto status = serializeRowJSON(row, serialized_row);
-    if (!status.ok()) {
-      VLOG(1) << status.getMessage();
-      continue;
-    }
+    if (forward_events) {
+      std::string serialized_row;
+      auto status = serializeRowJSON(row, serialized_row);
+      if (!status.ok()) {
+        VLOG(1) << status.getMessage();
+        continue;
+      }
 
-    // Then remove the newline.
-    if (serialized_row.size() > 0 && serialized_row.back() == '\n') {
-      serialized_row.pop_back();
+      // Then remove the newline.
+      if (serialized_row.size() > 0 && serialized_row.back() == '\n') {
+        serialized_row.pop_back();
+      }
+      EventFactory::forwardEvent(serialized_row);
     }
-
-    // Logger plugins may request events to be forwarded directly.
-    // If no active logger is marked 'usesLogEvent' then this is a no-op.
-    EventFactory::forwardEvent(serialized_row);
-
-    // Store the event data in the batch
-    database_data.push_back(
-        std::make_pair("data." + dbNamespace() + "." + string_event_identifier,
-                       serialized_row));
-  }
-
-  if (database_data.empty()) {
-    return Status(1, "Failed to process the rows");
   }
 
   // Save the batched data inside the database and update the event index
@@ -163,10 +247,43 @@ Status EventSubscriberPlugin::addBatch(std::vector<Row>& row_list,
   {
     WriteLock lock(event_id_lock_);
 
+    // Rows are encoded while holding the write lock so a batch referencing a
+    // new column is never stored before the dictionary that defines it.
+    DatabaseStringValueList database_data;
+    database_data.reserve(row_list.size() + 1);
+
+    std::size_t column_count{0U};
+    {
+      WriteLock dictionary_lock(context.column_dictionary_mutex);
+      auto& dictionary = context.column_dictionary;
+
+      auto key_prefix =
+          "data." + dbNamespace() + "." + toIndex(event_time) + ".";
+      for (std::size_t i = 0; i < row_list.size(); ++i) {
+        std::string serialized_row;
+        serializeRowBinary(row_list[i], dictionary, serialized_row);
+        database_data.push_back(std::make_pair(
+            key_prefix + toIndex(event_id_list[i]), std::move(serialized_row)));
+      }
+
+      column_count = dictionary.size();
+      if (column_count != context.stored_column_count) {
+        database_data.push_back(std::make_pair(
+            "columns." + dbNamespace(), dictionary.serialize()));
+      }
+    }
+
     auto status = setDatabaseBatch(kEvents, database_data);
     if (!status.ok()) {
+      statistics_.addDroppedEvents(row_list.size());
+      if (FLAGS_enable_numeric_monitoring) {
+        monitoring::record("events." + dbNamespace() + ".dropped",
+                           static_cast<monitoring::ValueType>(row_list.size()),
+                           monitoring::PreAggregationType::Sum);
+      }
       return status;
     }
+    context.stored_column_count = column_count;
 
     auto it = context.event_index.find(event_time);
     if (it == context.event_index.end()) {
@@ -188,7 +305,9 @@ Status EventSubscriberPlugin::addBatch(std::vector<Row>& row_list,
   if (cleanup_events) {
     removeOverflowingEventBatches(context, getDatabase(), getEventBatchesMax());
 
-    expireEventBatches(context, getDatabase(), getMinExpiry(), getTime());
+    // Do not expire events past the optimize watermark of the queries, the
+    // range removal would drop events they have not read yet.
+    expireEventBatches(context, getDatabase(), getMinExpiry(), getExpireTime());
   }
 
   return Status::success();
@@ -329,6 +448,30 @@ EventContextID EventSubscriberPlugin::numEvents() const {
   return event_count_;
 }
 
+const EventStatistics& EventSubscriberPlugin::statistics() const {
+  return statistics_;
+}
+
+void EventSubscriberPlugin::recordQueueDepth(std::size_t depth) {
+  statistics_.setQueueDepth(depth);
+  if (FLAGS_enable_numeric_monitoring) {
+    monitoring::record("events." + dbNamespace() + ".queue_depth",
+                       static_cast<monitoring::ValueType>(depth),
+                       monitoring::PreAggregationType::Max);
+  }
+}
+
+void EventSubscriberPlugin::recordLatency(EventClock::duration latency) {
+  statistics_.recordLatency(latency);
+  if (FLAGS_enable_numeric_monitoring) {
+    auto micros =
+        std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+    monitoring::record("events." + dbNamespace() + ".latency_micros",
+                       static_cast<monitoring::ValueType>(micros),
+                       monitoring::PreAggregationType::Histogram);
+  }
+}
+
 bool EventSubscriberPlugin::executedAllQueries() const {
   ReadLock lock(event_query_record_);
   return queries_.size() >= query_count_;
@@ -348,7 +491,7 @@ void EventSubscriberPlugin::setOptimizeData(IDatabaseInterface& db_interface,
   // Store the optimization time and eid.
   std::string query_name;
   db_interface.getDatabaseValue(
-      kPersistentSettings, kExecutingQuery, query_name);
+      kPersistentSettings, getExecutingQueryKey(), query_name);
   if (query_name.empty()) {
     return;
   }
@@ -371,7 +514,7 @@ void EventSubscriberPlugin::getOptimizeData(IDatabaseInterface& db_interface,
                                             std::string& query_name) {
   // Read the optimization time for the current executing query.
   db_interface.getDatabaseValue(
-      kPersistentSettings, kExecutingQuery, query_name);
+      kPersistentSettings, getExecutingQueryKey(), query_name);
 
   if (query_name.empty()) {
     o_time = 0;
@@ -414,67 +557,47 @@ Status EventSubscriberPlugin::generateEventDataIndex(
     return status;
   }
 
+  {
+    // Rows are decoded with the dictionary that was stored with them.
+    std::string serialized_dictionary;
+    db_interface.getDatabaseValue(kEvents,
+                                  databaseKeyForColumnDictionary(context),
+                                  serialized_dictionary);
+
+    WriteLock lock(context.column_dictionary_mutex);
+    status = context.column_dictionary.deserialize(serialized_dictionary);
+    if (!status.ok()) {
+      LOG(ERROR) << "Invalid event column dictionary for subscriber "
+                 << context.database_namespace;
+    }
+    context.stored_column_count = context.column_dictionary.size();
+  }
+
   std::vector<std::string> invalid_data_key_list;
   std::size_t event_count{0U};
 
   EventID last_event_id{1U};
   EventIndex event_index;
 
+  // The event time and EventID are both part of the key, rows are not read.
   for (const auto& key : key_list) {
-    auto string_event_id = &key[prefix.size()];
-
+    EventTime event_time = {};
     EventID event_identifier = {};
-
-    {
-      char* null_terminator = nullptr;
-      auto int_value = std::strtoull(string_event_id, &null_terminator, 10);
-      if (int_value == 0U || null_terminator == nullptr ||
-          *null_terminator != '\0') {
-        invalid_data_key_list.push_back(key);
-        continue;
-      }
-
-      event_identifier = static_cast<EventID>(int_value);
+    if (!parseEventDataKey(key, prefix.size(), event_time, event_identifier)) {
+      invalid_data_key_list.push_back(key);
+      continue;
     }
 
     last_event_id = std::max(last_event_id, event_identifier);
-
-    EventTime event_time = {};
-
-    {
-      std::string serialized_row;
-      status = db_interface.getDatabaseValue(kEvents, key, serialized_row);
-      if (!status.ok()) {
-        invalid_data_key_list.push_back(key);
-        continue;
-      }
-
-      Row row;
-      if (!deserializeRowJSON(serialized_row, row)) {
-        invalid_data_key_list.push_back(key);
-        continue;
-      }
-
-      if (row.count("time") == 0) {
-        invalid_data_key_list.push_back(key);
-        continue;
-      }
-
-      event_time = boost::lexical_cast<EventTime>(row.at("time"));
-    }
-
-    auto it = event_index.find(event_time);
-    if (it == event_index.end()) {
-      auto insert_status = event_index.insert({event_time, {}});
-      it = insert_status.first;
-    }
-
-    auto& event_id_list = it->second;
-    event_id_list.push_back(event_identifier);
-
+    event_index[event_time].push_back(event_identifier);
     ++event_count;
   }
 
+  // Keep the per-time lists in EventID order, the key scan may be unordered.
+  for (auto& p : event_index) {
+    std::sort(p.second.begin(), p.second.end());
+  }
+
   if (!invalid_data_key_list.empty()) {
     VLOG(1) << "Found " << invalid_data_key_list.size()
             << " invalid events for subscriber " << context.database_namespace;
@@ -500,11 +623,15 @@ Status EventSubscriberPlugin::generateEventDataIndex(
 }
 
 std::string EventSubscriberPlugin::databaseKeyForEventId(Context& context,
+                                                         EventTime event_time,
                                                          EventID event_id) {
-  auto string_event_id = toIndex(event_id);
-
   return std::string("data.") + context.database_namespace + "." +
-         string_event_id;
+         toIndex(event_time) + "." + toIndex(event_id);
+}
+
+std::string EventSubscriberPlugin::databaseKeyForColumnDictionary(
+    Context& context) {
+  return std::string("columns.") + context.database_namespace;
 }
 
 void EventSubscriberPlugin::removeOverflowingEventBatches(
@@ -553,26 +680,18 @@ void EventSubscriberPlugin::removeOverflowingEventBatches(
     string_last_query_time = buffer.data();
   }
 
-  std::size_t batches_removed{};
-  for (const auto& p : excess_event_batch_list) {
-    const auto& event_identifier_list = p.second;
-
-    for (auto event_id : event_identifier_list) {
-      auto key = databaseKeyForEventId(context, event_id);
-      auto status = db_interface.deleteDatabaseValue(kEvents, key);
-      if (status.ok()) {
-        ++batches_removed;
-      }
-    }
-  }
-
-  auto failed_delete_count = (excess_event_batch_list.size() - batches_removed);
+  auto status = removeEventsUntil(context,
+                                  db_interface,
+                                  excess_event_batch_list.rbegin()->first,
+                                  countEvents(excess_event_batch_list));
 
   std::stringstream message;
-  message << "Removed " << batches_removed << " event batches ";
-
-  if (failed_delete_count > 0U) {
-    message << "(with " << failed_delete_count << " delete errors)  ";
+  if (status.ok()) {
+    message << "Removed " << excess_event_batch_list.size()
+            << " event batches ";
+  } else {
+    message << "Failed to remove " << excess_event_batch_list.size()
+            << " event batches (" << status.getMessage() << ") ";
   }
 
   message << "for subscriber: " << context.database_namespace
@@ -605,8 +724,16 @@ void EventSubscriberPlugin::expireEventBatches(Context& context,
       return;
     }
 
+    // Only whole buckets are expired, so each bucket is removed by a single
+    // range removal rather than one removal per checkpoint.
+    auto bucket_size = std::max<std::size_t>(context.expiry_bucket_size, 1U);
+    auto expire_before = ((oldest_valid_time + 1) / bucket_size) * bucket_size;
+
     auto range_start = context.event_index.begin();
-    auto range_end = context.event_index.upper_bound(oldest_valid_time);
+    auto range_end = context.event_index.lower_bound(expire_before);
+    if (range_start == range_end) {
+      return;
+    }
 
     expired_event_batch_list.insert(std::make_move_iterator(range_start),
                                     std::make_move_iterator(range_end));
@@ -614,24 +741,14 @@ void EventSubscriberPlugin::expireEventBatches(Context& context,
     context.event_index.erase(range_start, range_end);
   }
 
-  // TODO(alessandro): Implement deleteDatabaseBatch
-  std::size_t error_count{};
-
-  for (const auto& p : expired_event_batch_list) {
-    const auto& event_identifier_list = p.second;
-
-    for (const auto& event_identifier : event_identifier_list) {
-      auto key = databaseKeyForEventId(context, event_identifier);
-      auto status = db_interface.deleteDatabaseValue(kEvents, key);
-      if (!status.ok()) {
-        ++error_count;
-      }
-    }
-  }
-
-  if (error_count > 0U) {
-    LOG(ERROR) << "Failed to expire " << error_count
-               << " events due to database errors";
+  auto event_count = countEvents(expired_event_batch_list);
+  auto status = removeEventsUntil(context,
+                                  db_interface,
+                                  expired_event_batch_list.rbegin()->first,
+                                  event_count);
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to expire " << event_count
+               << " events due to database errors: " << status.getMessage();
   }
 }
 
@@ -662,26 +779,65 @@ EventIndex::iterator EventSubscriberPlugin::generateRows(
                             ? context.event_index.end()
                             : context.event_index.upper_bound(end_time);
 
+  if (lower_bound_it == upper_bound_it) {
+    return last;
+  }
+  last = std::prev(upper_bound_it);
+
+  // Event keys are ordered by time so the events within the index bounds are
+  // read with range scans rather than one lookup per EventID.
+  auto prefix = std::string("data.") + context.database_namespace + ".";
+  auto low = prefix + toIndex(lower_bound_it->first) + ".";
+  auto high = prefix + toIndex(last->first) + ".~";
+
   std::vector<std::string> invalid_key_list;
-  for (auto it = lower_bound_it; it != upper_bound_it; ++it) {
-    const auto& event_id_list = it->second;
+  DatabaseStringValueList page;
+  std::string previous_key;
+  for (;;) {
+    page.clear();
+    auto status = db_interface.scanDatabaseRange(
+        kEvents, low, high, page, kEventsScanPageSize);
+    if (!status.ok()) {
+      LOG(ERROR) << "Failed to scan events for subscriber "
+                 << context.database_namespace << ": " << status.getMessage();
 
-    for (const auto& event_identifier : event_id_list) {
-      if (last_eid >= event_identifier) {
-        // A previous optimized query has already visited this event.
+      // The events past this page were not read, keep the optimize watermark.
+      last = context.event_index.end();
+      break;
+    }
+
+    // New columns may have been added by rows stored after the last page.
+    RowColumnDictionary dictionary;
+    {
+      ReadLock lock(context.column_dictionary_mutex);
+      dictionary = context.column_dictionary;
+    }
+
+    for (const auto& p : page) {
+      const auto& key = p.first;
+      const auto& serialized_row = p.second;
+      if (key == previous_key) {
+        // Pages are inclusive of the last key of the previous page.
         continue;
       }
-      auto key = databaseKeyForEventId(context, event_identifier);
 
-      std::string serialized_row;
-      auto status = db_interface.getDatabaseValue(kEvents, key, serialized_row);
-      if (serialized_row.empty()) {
+      EventTime event_time = {};
+      EventID event_identifier = {};
+      if (!parseEventDataKey(
+              key, prefix.size(), event_time, event_identifier)) {
         invalid_key_list.push_back(key);
         continue;
       }
 
+      if (last_eid >= event_identifier) {
+        // A previous optimized query has already visited this event.
+        continue;
+      }
+
       Row row = {};
-      status = deserializeRowJSON(serialized_row, row);
+      status = (!serialized_row.empty() && serialized_row[0] == '{')
+                   ? deserializeRowJSON(serialized_row, row)
+                   : deserializeRowBinary(serialized_row, dictionary, row);
       if (!status.ok()) {
         invalid_key_list.push_back(key);
         continue;
@@ -689,7 +845,12 @@ EventIndex::iterator EventSubscriberPlugin::generateRows(
 
       callback(std::move(row));
     }
-    last = it;
+
+    if (page.size() < kEventsScanPageSize) {
+      break;
+    }
+    previous_key = page.back().first;
+    low = previous_key;
   }
 
   if (!invalid_key_list.empty()) {
@@ -741,6 +902,7 @@ void EventSubscriberPlugin::setDatabaseNamespace() {
 
 Status EventSubscriberPlugin::setUp() {
   setDatabaseNamespace();
+  context.expiry_bucket_size = FLAGS_events_expiry_bucket;
   generateEventDataIndex();
 
   expireEventBatches(context, getDatabase(), getMinExpiry(), getTime());
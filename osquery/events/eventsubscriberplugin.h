@@ -12,9 +12,11 @@
 #include <gtest/gtest_prod.h>
 
 #include <osquery/core/plugins/plugin.h>
+#include <osquery/core/sql/row.h>
 #include <osquery/core/tables.h>
 #include <osquery/database/database.h>
 #include <osquery/events/eventer.h>
+#include <osquery/events/eventstatistics.h>
 #include <osquery/events/types.h>
 #include <osquery/utils/mutex.h>
 
@@ -179,6 +181,9 @@ class EventSubscriberPlugin : public Plugin, public Eventer {
   /// The number of events this EventSubscriber has received.
   EventContextID numEvents() const;
 
+  /// Ingest latency and the number of events that could not be stored.
+  const EventStatistics& statistics() const;
+
   /// Compare the number of queries run against the queries configured.
   virtual bool executedAllQueries() const;
 
@@ -189,6 +194,16 @@ class EventSubscriberPlugin : public Plugin, public Eventer {
 
     std::size_t last_query_time{0U};
     std::atomic<EventID> last_event_id{0U};
+
+    /// Events are expired in whole buckets of this many seconds.
+    std::size_t expiry_bucket_size{1U};
+
+    /// Column names referenced by the binary encoded event rows.
+    RowColumnDictionary column_dictionary;
+    mutable Mutex column_dictionary_mutex;
+
+    /// Number of dictionary columns known to be stored in the database.
+    std::size_t stored_column_count{0U};
   };
 
   static std::string toIndex(std::uint64_t i);
@@ -213,12 +228,26 @@ class EventSubscriberPlugin : public Plugin, public Eventer {
   static Status generateEventDataIndex(Context& context,
                                        IDatabaseInterface& db_interface);
 
-  static std::string databaseKeyForEventId(Context& context, EventID event_id);
+  /// Event data keys are ordered by event time then by EventID.
+  static std::string databaseKeyForEventId(Context& context,
+                                           EventTime event_time,
+                                           EventID event_id);
+
+  /// The key storing the column dictionary used to encode event rows.
+  static std::string databaseKeyForColumnDictionary(Context& context);
 
   static void removeOverflowingEventBatches(Context& context,
                                             IDatabaseInterface& db_interface,
                                             std::size_t max_event_batches);
 
+  /**
+   * @brief Remove the event batches older than events_expiry.
+   *
+   * Expired events are removed with a single range, so events stored late
+   * with a time inside the range are removed too, even if they have not been
+   * indexed or read yet. Callers bound current_time by the oldest time the
+   * optimized queries start reading from, see getExpireTime.
+   */
   static void expireEventBatches(Context& context,
                                  IDatabaseInterface& db_interface,
                                  std::size_t events_expiry,
@@ -235,7 +264,8 @@ class EventSubscriberPlugin : public Plugin, public Eventer {
    * @param start_time Inclusive lower bound time limit.
    * @param end_time Inclusive upper bound time limit.
    * @param last_eid (optional) The last visited event id.
-   * @return The upper bound time or 0 if there were no events in the range.
+   * @return The last index entry read, or the end of the index if there were
+   * no events in the range or they could not all be read.
    */
   static EventIndex::iterator generateRows(Context& context,
                                            IDatabaseInterface& db_interface,
@@ -277,6 +307,9 @@ class EventSubscriberPlugin : public Plugin, public Eventer {
   /// Set the subscriber type and name on the managed context.
   void setDatabaseNamespace();
 
+  /// Report the number of events waiting in the subscriber's own queues.
+  void recordQueueDepth(std::size_t depth);
+
   /// A helper value counting the number of fired events tracked by publishers.
   EventContextID event_count_{0};
 
@@ -286,6 +319,12 @@ class EventSubscriberPlugin : public Plugin, public Eventer {
  private:
   Status setUp() override;
 
+  /// Count the latency of an event fired to this subscriber.
+  void recordLatency(EventClock::duration latency);
+
+  /// Ingest instrumentation, latencies are recorded by the publisher fire.
+  EventStatistics statistics_;
+
   /// Do not respond to periodic/scheduled/triggered event expiration requests.
   bool expire_events_{true};
 
@@ -328,9 +367,12 @@ class EventSubscriberPlugin : public Plugin, public Eventer {
   FRIEND_TEST(EventsTests, test_event_subscriber_configure);
   FRIEND_TEST(EventsTests, test_event_toggle_subscribers);
   FRIEND_TEST(EventSubscriberPluginTests, getExpireTime);
+  FRIEND_TEST(EventSubscriberPluginTests, expireEventBatchesAtWatermark);
   FRIEND_TEST(EventSubscriberPluginTests, getEventsExpiry);
   FRIEND_TEST(EventSubscriberPluginTests, generateRowsWithExpiry);
   FRIEND_TEST(EventSubscriberPluginTests, generateRowsWithOptimize);
+  FRIEND_TEST(EventSubscriberPluginTests,
+              generateRowsWithOptimizeScanFailure);
 
   friend class DBFakeEventSubscriber;
   friend class BenchmarkEventSubscriber;
@@ -13,10 +13,12 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <chrono>
+#include <cstring>
+#include <functional>
 #include <iostream>
-
-#include <boost/utility/string_ref.hpp>
+#include <stdexcept>
 
 #include <osquery/core/flags.h>
 #include <osquery/events/linux/apparmor_events.h>
@@ -29,6 +31,7 @@
 #include <osquery/utils/conversions/tryto.h>
 #include <osquery/utils/expected/expected.h>
 #include <osquery/utils/system/time.h>
+#include <osquery/utils/system/worker_pool.h>
 
 namespace osquery {
 /// Control the audit subsystem by electing to be the single process sink.
@@ -56,6 +59,11 @@ FLAG(int32, audit_backlog_wait_time, 0, "The audit backlog wait time");
 /// This value is passed directly to the audit API.
 FLAG(int32, audit_backlog_limit, 4096, "The audit backlog limit");
 
+FLAG(uint32,
+     audit_parser_threads,
+     2,
+     "Number of threads parsing audit records when the queue is large");
+
 // External flags; they are used to determine which rules need to be installed
 DECLARE_bool(audit_allow_config);
 DECLARE_bool(audit_allow_fim_events);
@@ -76,40 +84,50 @@ constexpr std::uint64_t kUnprocessedRecordsThreshold{4096};
 constexpr std::uint64_t kThrottlingMessageInterval{60};
 // How much to wait for each throttling loop in millseconds
 constexpr std::uint64_t kThrottlingDuration{100};
+// Smaller batches of records are parsed by the parser service alone
+constexpr std::size_t kParallelParsingThreshold{256};
+
+/// The message of an adjusted audit_reply, without the trailing terminator.
+std::string_view GetAuditReplyMessage(const audit_reply& reply) noexcept {
+  if (reply.message == nullptr) {
+    return {};
+  }
 
-bool IsSELinuxRecord(const audit_reply& reply) noexcept {
+  auto length = static_cast<std::size_t>(reply.len);
+  return std::string_view(reply.message, ::strnlen(reply.message, length));
+}
+
+bool IsSELinuxRecord(int type, std::string_view message) noexcept {
   static const auto& selinux_event_set = kSELinuxEventList;
-  return (selinux_event_set.find(reply.type) != selinux_event_set.end()) &&
-         (std::string(reply.message).find(kAppArmorRecordMarker) ==
-          std::string::npos);
+  return (selinux_event_set.find(type) != selinux_event_set.end()) &&
+         (message.find(kAppArmorRecordMarker) == std::string_view::npos);
 }
 
-bool isAppArmorRecord(const audit_reply& reply) noexcept {
+bool isAppArmorRecord(int type, std::string_view message) noexcept {
   static const auto& apparmor_event_set = kAppArmorEventSet;
 
-  return (apparmor_event_set.find(reply.type) != apparmor_event_set.end()) &&
-         (std::string(reply.message).find(kAppArmorRecordMarker) !=
-          std::string::npos);
+  return (apparmor_event_set.find(type) != apparmor_event_set.end()) &&
+         (message.find(kAppArmorRecordMarker) != std::string_view::npos);
 }
 
 /**
  * User messages should be filtered. Also, we should handle the 2nd user
  * message type.
  */
-bool ShouldHandle(const audit_reply& reply) noexcept {
-  if (isAppArmorRecord(reply)) {
+bool ShouldHandle(int type, std::string_view message) noexcept {
+  if (isAppArmorRecord(type, message)) {
     return FLAGS_audit_allow_apparmor_events;
   }
 
-  if (IsSELinuxRecord(reply)) {
+  if (IsSELinuxRecord(type, message)) {
     return FLAGS_audit_allow_selinux_events;
   }
 
-  if (reply.type == AUDIT_SECCOMP) {
+  if (type == AUDIT_SECCOMP) {
     return FLAGS_audit_allow_seccomp_events;
   }
 
-  switch (reply.type) {
+  switch (type) {
   case NLMSG_NOOP:
   case NLMSG_DONE:
   case NLMSG_ERROR:
@@ -125,8 +143,188 @@ bool ShouldHandle(const audit_reply& reply) noexcept {
     return true;
   }
 }
+
+/// A record waiting to be parsed, the message views the received reply.
+struct AuditRawRecord final {
+  std::size_t index;
+  int type;
+  std::string_view message;
+};
+
+/// The records of a batch assigned to one parser shard.
+struct AuditParserShard final {
+  std::vector<AuditRawRecord> records;
+  std::size_t message_size{0U};
+};
+
+using AuditParsedRecords =
+    std::vector<std::pair<std::size_t, AuditEventRecord>>;
+
+/// Records of the same audit event always go to the same shard.
+std::size_t GetAuditParserShard(std::string_view message,
+                                std::size_t shard_count) noexcept {
+  auto preamble_end = message.find("): ");
+  auto audit_id = message.substr(0, preamble_end);
+  return std::hash<std::string_view>{}(audit_id) % shard_count;
+}
+
+/**
+ * @brief Parse the records of a shard.
+ *
+ * The messages are first copied into a single buffer, shared by the parsed
+ * records, so that the received replies can be released.
+ */
+AuditParsedRecords ParseAuditParserShard(const AuditParserShard& shard) {
+  auto buffer = std::make_shared<std::string>();
+  buffer->reserve(shard.message_size);
+  for (const auto& raw_record : shard.records) {
+    buffer->append(raw_record.message);
+  }
+  std::shared_ptr<const std::string> shared_buffer = std::move(buffer);
+
+  AuditParsedRecords parsed_records;
+  parsed_records.reserve(shard.records.size());
+
+  std::size_t offset{0U};
+  for (const auto& raw_record : shard.records) {
+    std::string_view message(shared_buffer->data() + offset,
+                             raw_record.message.size());
+    offset += raw_record.message.size();
+
+    AuditEventRecord audit_event_record = {};
+    if (!AuditdNetlinkParser::ParseAuditMessage(
+            raw_record.type, message, shared_buffer, audit_event_record)) {
+      VLOG(1) << "Malformed audit record received";
+      continue;
+    }
+
+    parsed_records.emplace_back(raw_record.index,
+                                std::move(audit_event_record));
+  }
+
+  return parsed_records;
+}
+
+/// Parse every shard, spreading the shards across the worker pool.
+std::vector<AuditEventRecord> ParseAuditParserShards(
+    const std::vector<AuditParserShard>& shard_list) {
+  std::vector<AuditParsedRecords> parsed_shard_list(shard_list.size());
+
+  WorkerPool::instance().run(
+      shard_list.size(), [&shard_list, &parsed_shard_list](std::size_t i) {
+        parsed_shard_list[i] = ParseAuditParserShard(shard_list[i]);
+      });
+
+  // Merge the shards back into the order the records were received in, the
+  // subscribers track state across events (e.g. file descriptors)
+  std::size_t record_count{0U};
+  for (const auto& parsed_shard : parsed_shard_list) {
+    record_count += parsed_shard.size();
+  }
+
+  std::vector<AuditEventRecord> audit_event_record_queue;
+  audit_event_record_queue.reserve(record_count);
+
+  std::vector<std::size_t> position_list(parsed_shard_list.size(), 0U);
+  while (audit_event_record_queue.size() < record_count) {
+    std::size_t next_shard = parsed_shard_list.size();
+    for (std::size_t i = 0; i < parsed_shard_list.size(); ++i) {
+      if (position_list[i] == parsed_shard_list[i].size()) {
+        continue;
+      }
+
+      if (next_shard == parsed_shard_list.size() ||
+          parsed_shard_list[i][position_list[i]].first <
+              parsed_shard_list[next_shard][position_list[next_shard]].first) {
+        next_shard = i;
+      }
+    }
+
+    auto& parsed_record =
+        parsed_shard_list[next_shard][position_list[next_shard]++];
+    audit_event_record_queue.push_back(std::move(parsed_record.second));
+  }
+
+  return audit_event_record_queue;
+}
 } // namespace
 
+AuditFieldList::const_iterator AuditFieldList::find(
+    std::string_view key) const noexcept {
+  return std::find_if(fields_.begin(),
+                      fields_.end(),
+                      [key](const Field& field) { return field.first == key; });
+}
+
+std::string_view AuditFieldList::at(std::string_view key) const {
+  auto field_it = find(key);
+  if (field_it == fields_.end()) {
+    throw std::out_of_range("Missing audit field: " + std::string(key));
+  }
+
+  return field_it->second;
+}
+
+void AuditFieldList::retain(std::shared_ptr<const std::string> buffer) {
+  if (buffer != nullptr) {
+    buffers_.push_back(std::move(buffer));
+    detached_ = false;
+  }
+}
+
+void AuditFieldList::detach(std::string_view* view) {
+  if (detached_) {
+    return;
+  }
+
+  std::size_t buffer_size = view != nullptr ? view->size() : 0U;
+  for (const auto& field : fields_) {
+    buffer_size += field.first.size() + field.second.size();
+  }
+
+  auto buffer = std::make_shared<std::string>();
+  buffer->reserve(buffer_size);
+
+  // The buffer has been reserved, the views stay valid while appending
+  auto copy_view = [&buffer](std::string_view& value) {
+    auto offset = buffer->size();
+    buffer->append(value);
+    value = std::string_view(buffer->data() + offset, value.size());
+  };
+
+  for (auto& field : fields_) {
+    copy_view(field.first);
+    copy_view(field.second);
+  }
+
+  if (view != nullptr) {
+    copy_view(*view);
+  }
+
+  buffers_.clear();
+  buffers_.push_back(std::move(buffer));
+  detached_ = true;
+}
+
+void AuditFieldList::set(std::string_view key, std::string_view value) {
+  auto buffer = std::make_shared<const std::string>(std::string(key) +
+                                                    std::string(value));
+  std::string_view new_key(buffer->data(), key.size());
+  std::string_view new_value(buffer->data() + key.size(), value.size());
+  buffers_.push_back(std::move(buffer));
+
+  auto field_it = std::find_if(
+      fields_.begin(), fields_.end(), [new_key](const Field& field) {
+        return field.first == new_key;
+      });
+
+  if (field_it != fields_.end()) {
+    field_it->second = new_value;
+  } else {
+    fields_.emplace_back(new_key, new_value);
+  }
+}
+
 enum AuditStatus {
   AUDIT_DISABLED = 0,
   AUDIT_ENABLED = 1,
@@ -150,7 +348,8 @@ AuditdNetlink::AuditdNetlink() {
   }
 }
 
-std::vector<AuditEventRecord> AuditdNetlink::getEvents() noexcept {
+std::vector<AuditEventRecord> AuditdNetlink::getEvents(
+    EventClock::time_point& received_time) noexcept {
   std::vector<AuditEventRecord> record_list;
 
   {
@@ -168,12 +367,22 @@ std::vector<AuditEventRecord> AuditdNetlink::getEvents() noexcept {
       record_list = std::move(auditd_context_->processed_events);
       auditd_context_->processed_events.clear();
       auditd_context_->processed_records_backlog = 0;
+      received_time = auditd_context_->processed_events_time;
     }
   }
 
   return record_list;
 }
 
+std::size_t AuditdNetlink::queueDepth() const noexcept {
+  return auditd_context_->unprocessed_records_amount +
+         auditd_context_->processed_records_backlog;
+}
+
+std::uint32_t AuditdNetlink::lostRecords() const noexcept {
+  return auditd_context_->lost_records;
+}
+
 AuditdNetlinkReader::AuditdNetlinkReader(AuditdContextRef context)
     : InternalRunnable("AuditdNetlinkReader"),
       auditd_context_(std::move(context)),
@@ -253,6 +462,7 @@ bool AuditdNetlinkReader::acquireMessages() noexcept {
 
   bool reset_handle = false;
   size_t events_received = 0;
+  EventClock::time_point first_received_time{};
 
   // Attempt to read as many messages as possible before we exit, and terminate
   // early if we have been asked to terminate
@@ -315,6 +525,9 @@ bool AuditdNetlinkReader::acquireMessages() noexcept {
       break;
     }
 
+    if (events_received == 0) {
+      first_received_time = EventClock::now();
+    }
     read_buffer_[events_received] = reply;
   }
 
@@ -322,6 +535,10 @@ bool AuditdNetlinkReader::acquireMessages() noexcept {
     std::unique_lock<std::mutex> lock(
         auditd_context_->unprocessed_records_mutex);
 
+    if (auditd_context_->unprocessed_records.empty()) {
+      auditd_context_->unprocessed_records_time = first_received_time;
+    }
+
     auditd_context_->unprocessed_records.reserve(
         auditd_context_->unprocessed_records.size() + events_received);
 
@@ -726,9 +943,26 @@ AuditdNetlinkParser::AuditdNetlinkParser(AuditdContextRef context)
     : InternalRunnable("AuditdNetlinkParser"),
       auditd_context_(std::move(context)) {}
 
+std::vector<AuditEventRecord> AuditdNetlinkParser::ParseAuditMessages(
+    const std::vector<AuditMessage>& message_list, std::size_t shard_count) {
+  std::vector<AuditParserShard> shard_list(
+      std::max<std::size_t>(shard_count, 1U));
+
+  for (std::size_t index = 0; index < message_list.size(); ++index) {
+    const auto& message = message_list[index].second;
+
+    auto& shard = shard_list[GetAuditParserShard(message, shard_list.size())];
+    shard.records.push_back({index, message_list[index].first, message});
+    shard.message_size += message.size();
+  }
+
+  return ParseAuditParserShards(shard_list);
+}
+
 void AuditdNetlinkParser::start() {
   while (!interrupted()) {
     std::vector<audit_reply> queue;
+    EventClock::time_point queue_received_time{};
 
     {
       std::unique_lock<std::mutex> lock(
@@ -745,10 +979,18 @@ void AuditdNetlinkParser::start() {
 
       queue = std::move(auditd_context_->unprocessed_records);
       auditd_context_->unprocessed_records.clear();
+      queue_received_time = auditd_context_->unprocessed_records_time;
+    }
+
+    // Large batches are split by audit event id across the parser threads
+    std::size_t shard_count{1U};
+    if (queue.size() >= kParallelParsingThreshold &&
+        FLAGS_audit_parser_threads > 1U) {
+      shard_count = FLAGS_audit_parser_threads;
     }
 
-    std::vector<AuditEventRecord> audit_event_record_queue;
-    audit_event_record_queue.reserve(queue.size());
+    std::vector<AuditMessage> message_list;
+    message_list.reserve(queue.size());
 
     for (auto& reply : queue) {
       if (interrupted()) {
@@ -763,6 +1005,7 @@ void AuditdNetlinkParser::start() {
       if (reply.type == AUDIT_GET) {
         reply.status = static_cast<struct audit_status*>(NLMSG_DATA(reply.nlh));
         auto new_pid = static_cast<pid_t>(reply.status->pid);
+        auditd_context_->lost_records = reply.status->lost;
 
         if (new_pid != getpid()) {
           VLOG(1) << "Audit control lost to pid: " << new_pid;
@@ -778,32 +1021,34 @@ void AuditdNetlinkParser::start() {
 
       // We are not interested in all messages; only get the ones related to
       // user events, seccomp, syscalls, SELinux events and AppArmor events
-      if (!ShouldHandle(reply)) {
+      auto message = GetAuditReplyMessage(reply);
+      if (!ShouldHandle(reply.type, message)) {
         continue;
       }
 
-      AuditEventRecord audit_event_record = {};
-      if (!ParseAuditReply(reply, audit_event_record)) {
-        VLOG(1) << "Malformed audit record received";
-        continue;
-      }
-
-      audit_event_record_queue.push_back(audit_event_record);
+      message_list.emplace_back(reply.type, message);
     }
 
+    auto audit_event_record_queue =
+        ParseAuditMessages(message_list, shard_count);
+
     // Save the new records and notify the reader
     if (!audit_event_record_queue.empty()) {
       std::lock_guard<std::mutex> queue_lock(
           auditd_context_->processed_events_mutex);
 
+      if (auditd_context_->processed_events.empty()) {
+        auditd_context_->processed_events_time = queue_received_time;
+      }
+
       auditd_context_->processed_events.reserve(
           auditd_context_->processed_events.size() +
           audit_event_record_queue.size());
 
       auditd_context_->processed_events.insert(
           auditd_context_->processed_events.end(),
-          audit_event_record_queue.begin(),
-          audit_event_record_queue.end());
+          std::make_move_iterator(audit_event_record_queue.begin()),
+          std::make_move_iterator(audit_event_record_queue.end()));
 
       auditd_context_->processed_records_backlog =
           auditd_context_->processed_events.size();
@@ -849,95 +1094,118 @@ void AuditdNetlinkParser::start() {
 
 bool AuditdNetlinkParser::ParseAuditReply(
     const audit_reply& reply, AuditEventRecord& event_record) noexcept {
+  std::shared_ptr<const std::string> buffer;
+
+  try {
+    buffer = std::make_shared<const std::string>(GetAuditReplyMessage(reply));
+  } catch (const std::bad_alloc&) {
+    return false;
+  }
+
+  std::string_view message(*buffer);
+  return ParseAuditMessage(reply.type, message, buffer, event_record);
+}
+
+bool AuditdNetlinkParser::ParseAuditMessage(
+    int type,
+    std::string_view message,
+    std::shared_ptr<const std::string> buffer,
+    AuditEventRecord& event_record) noexcept {
   event_record = {};
 
   if (FLAGS_audit_debug) {
-    VLOG(1) << reply.type << ", " << std::string(reply.message, reply.len);
+    VLOG(1) << type << ", " << message;
   }
 
-  // Parse the record header
-  event_record.type = reply.type;
-  boost::string_ref message_view(reply.message,
-                                 static_cast<unsigned int>(reply.len));
+  try {
+    event_record.fields.retain(std::move(buffer));
 
-  auto preamble_end = message_view.find("): ");
-  if (preamble_end == std::string::npos) {
-    return false;
-  }
+    // Parse the record header
+    event_record.type = type;
 
-  event_record.time =
-      tryTo<unsigned long int>(message_view.substr(6, 10).to_string(), 10)
-          .takeOr(event_record.time);
-  event_record.audit_id = message_view.substr(6, preamble_end - 6).to_string();
+    auto preamble_end = message.find("): ");
+    if (preamble_end == std::string_view::npos || preamble_end < 6) {
+      return false;
+    }
 
-  // SELinux doesn't output valid audit records; just save them as they are
-  if (IsSELinuxRecord(reply)) {
-    event_record.raw_data = reply.message;
-    return true;
-  }
+    event_record.time =
+        tryTo<unsigned long int>(std::string(message.substr(6, 10)), 10)
+            .takeOr(event_record.time);
+    event_record.audit_id = message.substr(6, preamble_end - 6);
 
-  // Save the whole message for AppArmor too
-  if (isAppArmorRecord(reply)) {
-    event_record.raw_data = reply.message;
-  }
+    // SELinux doesn't output valid audit records; just save them as they are
+    if (IsSELinuxRecord(type, message)) {
+      event_record.raw_data = std::string(message);
+      return true;
+    }
 
-  // Tokenize the message
-  boost::string_ref field_view(message_view.substr(preamble_end + 3));
+    // Save the whole message for AppArmor too
+    if (isAppArmorRecord(type, message)) {
+      event_record.raw_data = std::string(message);
+    }
+
+    // Tokenize the message; keys and values are views into the message
+    auto field_view = message.substr(preamble_end + 3);
 
-  // The linear search will construct series of key value pairs.
-  std::string key, value;
-  key.reserve(20);
-  value.reserve(256);
+    // There are several ways of representing value data (enclosed strings,
+    // etc).
+    bool found_assignment{false};
+    bool found_enclose{false};
 
-  // There are several ways of representing value data (enclosed strings,
-  // etc).
-  bool found_assignment{false};
-  bool found_enclose{false};
+    std::size_t key_begin{0U};
+    std::size_t key_end{0U};
+    std::size_t value_begin{0U};
 
-  for (const auto& c : field_view) {
-    // Iterate over each character in the audit message.
-    if ((found_enclose && c == '"') || (!found_enclose && c == ' ')) {
-      if (c == '"') {
-        value += c;
+    auto L_emplaceField = [&](std::size_t value_end) {
+      if (key_end == key_begin) {
+        return;
       }
 
-      // This is a terminating sequence, the end of an enclosure or space
-      // tok.
-      if (!key.empty()) {
-        // Multiple space tokens are supported.
-        event_record.fields.emplace(
-            std::make_pair(std::move(key), std::move(value)));
+      auto key = field_view.substr(key_begin, key_end - key_begin);
+
+      std::string_view value;
+      if (found_assignment) {
+        value = field_view.substr(value_begin, value_end - value_begin);
       }
 
-      found_enclose = false;
-      found_assignment = false;
+      event_record.fields.emplace(key, value);
+    };
 
-      key.clear();
-      value.clear();
+    for (std::size_t i = 0U; i < field_view.size(); ++i) {
+      // Iterate over each character in the audit message.
+      auto c = field_view[i];
 
-    } else if (!found_assignment && c == ' ') {
-      // A field tokenizer.
+      if ((found_enclose && c == '"') || (!found_enclose && c == ' ')) {
+        // This is a terminating sequence, the end of an enclosure or space
+        // tok. The closing quote is part of the value.
+        // Multiple space tokens are supported.
+        L_emplaceField(c == '"' ? i + 1U : i);
 
-    } else if (found_assignment) {
-      // Enclosure sequences appear immediately following assignment.
-      if (c == '"') {
-        found_enclose = true;
-      }
+        found_enclose = false;
+        found_assignment = false;
+
+        key_begin = key_end = i + 1U;
 
-      value += c;
+      } else if (found_assignment) {
+        // Enclosure sequences appear immediately following assignment.
+        if (c == '"') {
+          found_enclose = true;
+        }
 
-    } else if (c == '=') {
-      found_assignment = true;
+      } else if (c == '=') {
+        found_assignment = true;
+        value_begin = i + 1U;
 
-    } else {
-      key += c;
+      } else {
+        key_end = i + 1U;
+      }
     }
-  }
 
-  // Last step, if there was no trailing tokenizer.
-  if (!key.empty()) {
-    event_record.fields.emplace(
-        std::make_pair(std::move(key), std::move(value)));
+    // Last step, if there was no trailing tokenizer.
+    L_emplaceField(field_view.size());
+
+  } catch (const std::exception&) {
+    return false;
   }
 
   return true;
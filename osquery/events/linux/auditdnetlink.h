@@ -14,15 +14,19 @@
 #include <atomic>
 #include <condition_variable>
 #include <future>
+#include <iterator>
 #include <map>
 #include <memory>
 #include <set>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
 #include <boost/algorithm/hex.hpp>
+#include <boost/container/small_vector.hpp>
 
 #include <osquery/dispatcher/dispatcher.h>
+#include <osquery/events/types.h>
 
 namespace osquery {
 
@@ -32,6 +36,74 @@ enum class NetlinkStatus { ActiveMutable, ActiveImmutable, Disabled, Error };
 /// Contains an audit_rule_data structure
 using AuditRuleDataObject = std::vector<std::uint8_t>;
 
+/**
+ * @brief The key/value fields of an audit record, in the order received.
+ *
+ * Keys and values are views into immutable buffers shared by every copy of
+ * the list, usually the buffer holding the raw messages of the parsed batch.
+ * Lookups are linear, records have few fields and this is cheaper than
+ * building a map for each one of them.
+ */
+class AuditFieldList final {
+ public:
+  using Field = std::pair<std::string_view, std::string_view>;
+  using FieldVector = boost::container::small_vector<Field, 16>;
+  using const_iterator = FieldVector::const_iterator;
+
+  const_iterator begin() const noexcept {
+    return fields_.begin();
+  }
+
+  const_iterator end() const noexcept {
+    return fields_.end();
+  }
+
+  std::size_t size() const noexcept {
+    return fields_.size();
+  }
+
+  bool empty() const noexcept {
+    return fields_.empty();
+  }
+
+  /// Return the first field with the given key, or end().
+  const_iterator find(std::string_view key) const noexcept;
+
+  std::size_t count(std::string_view key) const noexcept {
+    return find(key) != end() ? 1U : 0U;
+  }
+
+  /// Return the value of a field, throws std::out_of_range if missing.
+  std::string_view at(std::string_view key) const;
+
+  /// Append a field viewing a buffer that has been retained by this list.
+  void emplace(std::string_view key, std::string_view value) {
+    fields_.emplace_back(key, value);
+  }
+
+  /// Keep a buffer alive for as long as this list or a copy of it exists.
+  void retain(std::shared_ptr<const std::string> buffer);
+
+  /// Set a field to a copy of the given value, replacing a previous value.
+  void set(std::string_view key, std::string_view value);
+
+  /**
+   * @brief Copy the fields into a buffer owned by this list.
+   *
+   * The retained buffers are released, a record waiting for the rest of its
+   * event would otherwise keep the messages of its whole batch alive. The
+   * optional view is copied and updated along with the fields.
+   */
+  void detach(std::string_view* view = nullptr);
+
+ private:
+  FieldVector fields_;
+  std::vector<std::shared_ptr<const std::string>> buffers_;
+
+  /// Set once the fields only view a buffer owned by this list.
+  bool detached_{false};
+};
+
 /// A single, prepared audit event record.
 struct AuditEventRecord final {
   /// Record type (i.e.: AUDIT_SYSCALL, AUDIT_PATH, ...)
@@ -41,15 +113,21 @@ struct AuditEventRecord final {
   unsigned long int time;
 
   /// Audit event id that owns this record. Remember: PRIMARY KEY(id, timestamp)
-  std::string audit_id;
+  /// This views the same buffer as the fields.
+  std::string_view audit_id;
 
   /// The field list for this record. Valid for everything except SELinux and
   /// AppArmor records
-  std::map<std::string, std::string> fields;
+  AuditFieldList fields;
 
   /// The raw message, only valid for SELinux and AppArmor records (because they
   /// have broken syntax)
   std::string raw_data;
+
+  /// Stop viewing the buffer of the parsed batch, see AuditFieldList::detach.
+  void detach() {
+    fields.detach(&audit_id);
+  }
 };
 
 static_assert(std::is_move_constructible<AuditEventRecord>::value,
@@ -64,6 +142,9 @@ struct AuditdContext final {
       std::is_move_constructible<decltype(unprocessed_records)>::value,
       "not move constructible");
 
+  /// When the oldest of the unprocessed records was received
+  EventClock::time_point unprocessed_records_time{};
+
   /// Mutex for the list of unprocessed records
   std::mutex unprocessed_records_mutex;
 
@@ -73,6 +154,9 @@ struct AuditdContext final {
   /// This queue contains processed events
   std::vector<AuditEventRecord> processed_events;
 
+  /// When the oldest of the processed events was received
+  EventClock::time_point processed_events_time{};
+
   /// Processed events queue mutex.
   std::mutex processed_events_mutex;
 
@@ -91,6 +175,9 @@ struct AuditdContext final {
   /// publisher cannot empty the backlog fast enough
   std::atomic<std::size_t> processed_records_backlog{};
 
+  /// Records the kernel reported as lost in the last audit status reply
+  std::atomic<std::uint32_t> lost_records{};
+
   /// Timestamp of the last Netlink records reading throttling message
   std::uint64_t last_netlink_throttling_message_time{};
 
@@ -161,9 +248,33 @@ class AuditdNetlinkParser final : public InternalRunnable {
   static bool ParseAuditReply(const audit_reply& reply,
                               AuditEventRecord& event_record) noexcept;
 
+  /**
+   * @brief Parses an audit message into an AuditEventRecord object.
+   *
+   * The record fields are views into the message, which must be stored in
+   * the given buffer. The record retains the buffer.
+   */
+  static bool ParseAuditMessage(int type,
+                                std::string_view message,
+                                std::shared_ptr<const std::string> buffer,
+                                AuditEventRecord& event_record) noexcept;
+
   /// Adjusts the internal pointers of the audit_reply object
   static void AdjustAuditReply(audit_reply& reply) noexcept;
 
+  /// An audit message along with its record type.
+  using AuditMessage = std::pair<int, std::string_view>;
+
+  /**
+   * @brief Parses a batch of audit messages, split across shard_count shards.
+   *
+   * The records of an audit event are always parsed by the same shard, and
+   * the records are returned in the order of the messages. Malformed messages
+   * are skipped.
+   */
+  static std::vector<AuditEventRecord> ParseAuditMessages(
+      const std::vector<AuditMessage>& message_list, std::size_t shard_count);
+
  private:
   /// Shared data
   AuditdContextRef auditd_context_;
@@ -175,8 +286,19 @@ class AuditdNetlink final : private boost::noncopyable {
   AuditdNetlink();
   virtual ~AuditdNetlink() = default;
 
-  /// Prepares the raw audit event records stored in the given context.
-  std::vector<AuditEventRecord> getEvents() noexcept;
+  /**
+   * @brief Prepares the raw audit event records stored in the given context.
+   *
+   * @param received_time Set to when the oldest returned record was received.
+   */
+  std::vector<AuditEventRecord> getEvents(
+      EventClock::time_point& received_time) noexcept;
+
+  /// Number of records that are yet to be parsed or published.
+  std::size_t queueDepth() const noexcept;
+
+  /// Records lost by the kernel since the audit service was configured.
+  std::uint32_t lostRecords() const noexcept;
 
  private:
   /// Shared data
@@ -184,15 +306,17 @@ class AuditdNetlink final : private boost::noncopyable {
 };
 
 /// Handle quote and hex-encoded audit field content.
-inline std::string DecodeAuditPathValues(const std::string& s) {
+inline std::string DecodeAuditPathValues(std::string_view s) {
   if (s.size() > 1 && s[0] == '"') {
-    return s.substr(1, s.size() - 2);
+    return std::string(s.substr(1, s.size() - 2));
   }
 
   try {
-    return boost::algorithm::unhex(s);
+    std::string decoded;
+    boost::algorithm::unhex(s.begin(), s.end(), std::back_inserter(decoded));
+    return decoded;
   } catch (const boost::algorithm::hex_decode_error& e) {
-    return s;
+    return std::string(s);
   }
 }
 } // namespace osquery
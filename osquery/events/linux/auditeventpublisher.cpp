@@ -98,9 +98,22 @@ Status AuditEventPublisher::run() {
     return Status(1, "Publisher disabled via configuration");
   }
 
-  auto audit_event_record_queue = audit_netlink_->getEvents();
+  auto received_time = EventClock::time_point{};
+  auto audit_event_record_queue = audit_netlink_->getEvents(received_time);
+
+  recordQueueDepth(audit_netlink_->queueDepth());
+
+  // The kernel counter restarts when the audit service is reconfigured.
+  auto lost_records = audit_netlink_->lostRecords();
+  if (lost_records != last_lost_records_) {
+    recordDroppedEvents(lost_records > last_lost_records_
+                            ? lost_records - last_lost_records_
+                            : lost_records);
+    last_lost_records_ = lost_records;
+  }
 
   auto event_context = createEventContext();
+  event_context->received_time = received_time;
 
   // This is a simple estimate based on the process_file_events_tests.cpp
   // records
@@ -362,7 +375,8 @@ void AuditEventPublisher::ProcessEvents(
       data.process_sgid = static_cast<gid_t>(process_sgid);
 
       audit_event.record_list.push_back(audit_event_record);
-      trace_context[audit_event_record.audit_id] = std::move(audit_event);
+      trace_context[std::string(audit_event_record.audit_id)] =
+          std::move(audit_event);
 
       // This is the terminator for multi-record audit events
     } else if (audit_event_record.type == AUDIT_EOE) {
@@ -412,9 +426,16 @@ void AuditEventPublisher::ProcessEvents(
 
     if (current_time - event_timestamp >= 300) {
       event_it = trace_context.erase(event_it);
-    } else {
-      event_it++;
+      continue;
     }
+
+    // The event is kept for the next batches, stop sharing the buffers of
+    // this one so that they can be released
+    for (auto& audit_event_record : event_it->second.record_list) {
+      audit_event_record.detach();
+    }
+
+    event_it++;
   }
 }
 
@@ -434,7 +455,7 @@ const AuditEventRecord* GetEventRecord(const AuditEvent& event,
 };
 
 bool GetStringFieldFromMap(std::string& value,
-                           const std::map<std::string, std::string>& fields,
+                           const AuditFieldList& fields,
                            const std::string& name,
                            const std::string& default_value) noexcept {
   auto it = fields.find(name);
@@ -443,12 +464,12 @@ bool GetStringFieldFromMap(std::string& value,
     return false;
   }
 
-  value = it->second;
+  value = std::string(it->second);
   return true;
 }
 
 bool GetIntegerFieldFromMap(std::uint64_t& value,
-                            const std::map<std::string, std::string>& field_map,
+                            const AuditFieldList& field_map,
                             const std::string& field_name,
                             std::size_t base,
                             std::uint64_t default_value) noexcept {
@@ -463,7 +484,7 @@ bool GetIntegerFieldFromMap(std::uint64_t& value,
 }
 
 void CopyFieldFromMap(Row& row,
-                      const std::map<std::string, std::string>& fields,
+                      const AuditFieldList& fields,
                       const std::string& name,
                       const std::string& default_value) noexcept {
   GetStringFieldFromMap(row[name], fields, name, default_value);
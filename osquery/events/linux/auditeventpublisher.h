@@ -131,7 +131,7 @@ using AuditEventContextRef = std::shared_ptr<AuditEventContext>;
 using AuditSubscriptionContextRef = std::shared_ptr<AuditSubscriptionContext>;
 
 /// This type maps audit event id with the corresponding audit event object
-using AuditTraceContext = std::map<std::string, AuditEvent>;
+using AuditTraceContext = std::map<std::string, AuditEvent, std::less<>>;
 
 class AuditEventPublisher final
     : public EventPublisher<AuditSubscriptionContext, AuditEventContext> {
@@ -166,32 +166,35 @@ class AuditEventPublisher final
 
   /// Syscalls allowed to fail (captured even if success=no)
   std::set<int> syscalls_allowed_to_fail_;
+
+  /// Last lost records counter reported by the kernel
+  std::uint32_t last_lost_records_{0U};
 };
 
 /// Extracts the specified audit event record from the given audit event
 const AuditEventRecord* GetEventRecord(const AuditEvent& event,
                                        int record_type) noexcept;
 
-/// Extracts the specified string key from the given string map
+/// Extracts the specified string key from the given field list
 bool GetStringFieldFromMap(
     std::string& value,
-    const std::map<std::string, std::string>& fields,
+    const AuditFieldList& fields,
     const std::string& name,
     const std::string& default_value = std::string()) noexcept;
 
-/// Extracts the specified integer key from the given string map
+/// Extracts the specified integer key from the given field list
 bool GetIntegerFieldFromMap(
     std::uint64_t& value,
-    const std::map<std::string, std::string>& field_map,
+    const AuditFieldList& field_map,
     const std::string& field_name,
     std::size_t base = 10,
     std::uint64_t default_value =
         std::numeric_limits<std::uint64_t>::max()) noexcept;
 
-/// Copies a named field from the 'fields' map to the specified row
+/// Copies a named field from the 'fields' list to the specified row
 void CopyFieldFromMap(
     Row& row,
-    const std::map<std::string, std::string>& fields,
+    const AuditFieldList& fields,
     const std::string& name,
     const std::string& default_value = std::string()) noexcept;
 
@@ -0,0 +1,75 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <string_view>
+#include <variant>
+
+#include <ebpfpub/ifunctiontracer.h>
+
+namespace osquery {
+
+/// \brief A typed slot for one of the fields of a traced function event
+/// Event handlers declare their slots as members of an accessor struct, so
+/// each field name is resolved to a slot once rather than looked up for
+/// every event. Bound values are referenced, not copied, and are only
+/// valid as long as the event they have been bound to
+template <typename T>
+class BPFEventField final {
+ public:
+  constexpr explicit BPFEventField(std::string_view name) noexcept
+      : name_(name) {}
+
+  /// Binds this slot if the given event field has the same name
+  void bind(std::string_view name,
+            const tob::ebpfpub::IFunctionTracer::Event::Field& field) noexcept {
+    if (found_ || name != name_) {
+      return;
+    }
+
+    found_ = true;
+    value_ = std::get_if<T>(&field.data_var);
+  }
+
+  /// Returns true if the event had a field with this name, whatever its type
+  bool found() const noexcept {
+    return found_;
+  }
+
+  /// Returns true if the field has been found and holds a value of type T
+  bool valid() const noexcept {
+    return value_ != nullptr;
+  }
+
+  /// Returns the bound value; only valid if valid() returns true
+  const T& get() const noexcept {
+    return *value_;
+  }
+
+ private:
+  std::string_view name_;
+  const T* value_{nullptr};
+  bool found_{false};
+};
+
+/// \brief Binds the given slots with a single pass over the field map
+/// Returns true if every slot has been found with the expected type
+template <typename... FieldTypes>
+bool bindBPFEventFields(
+    const tob::ebpfpub::IFunctionTracer::Event::FieldMap& field_map,
+    BPFEventField<FieldTypes>&... field_list) noexcept {
+  for (const auto& field_map_entry : field_map) {
+    (field_list.bind(field_map_entry.first, field_map_entry.second), ...);
+  }
+
+  return (field_list.valid() && ...);
+}
+
+} // namespace osquery
@@ -9,6 +9,7 @@
 
 #include <osquery/core/flags.h>
 #include <osquery/events/linux/bpf/bpferrorstate.h>
+#include <osquery/events/linux/bpf/bpfeventfields.h>
 #include <osquery/events/linux/bpf/bpfeventpublisher.h>
 #include <osquery/events/linux/bpf/serializers.h>
 #include <osquery/events/linux/bpf/setrlimit.h>
@@ -98,6 +99,223 @@ const FunctionTracerAllocatorList kFunctionTracerAllocators = {
      false},
     {"execve", &BPFEventPublisher::processExecveEvent, 3U, true},
     {"execveat", &BPFEventPublisher::processExecveatEvent, 3U, true}};
+
+using Argv = ebpfpub::IFunctionTracer::Event::Field::Argv;
+using Buffer = ebpfpub::IFunctionTracer::Event::Field::Buffer;
+
+struct CloneEventFields final {
+  BPFEventField<std::uint64_t> clone_flags{"clone_flags"};
+
+  bool bind(const ebpfpub::IFunctionTracer::Event& event) noexcept {
+    return bindBPFEventFields(event.in_field_map, clone_flags);
+  }
+};
+
+struct ExecveEventFields final {
+  BPFEventField<std::string> filename{"filename"};
+  BPFEventField<Argv> argv{"argv"};
+
+  bool bind(const ebpfpub::IFunctionTracer::Event& event) noexcept {
+    return bindBPFEventFields(event.in_field_map, filename, argv);
+  }
+};
+
+struct ExecveatEventFields final {
+  BPFEventField<std::string> filename{"filename"};
+  BPFEventField<Argv> argv{"argv"};
+  BPFEventField<std::uint64_t> flags{"flags"};
+  BPFEventField<std::uint64_t> fd{"fd"};
+
+  bool bind(const ebpfpub::IFunctionTracer::Event& event) noexcept {
+    return bindBPFEventFields(event.in_field_map, filename, argv, flags, fd);
+  }
+};
+
+struct CloseEventFields final {
+  BPFEventField<std::uint64_t> fd{"fd"};
+
+  bool bind(const ebpfpub::IFunctionTracer::Event& event) noexcept {
+    return bindBPFEventFields(event.in_field_map, fd);
+  }
+};
+
+struct DupEventFields final {
+  BPFEventField<std::uint64_t> fildes{"fildes"};
+
+  bool bind(const ebpfpub::IFunctionTracer::Event& event) noexcept {
+    return bindBPFEventFields(event.in_field_map, fildes);
+  }
+};
+
+struct Dup2EventFields final {
+  BPFEventField<std::uint64_t> oldfd{"oldfd"};
+  BPFEventField<std::uint64_t> newfd{"newfd"};
+
+  bool bind(const ebpfpub::IFunctionTracer::Event& event) noexcept {
+    return bindBPFEventFields(event.in_field_map, oldfd, newfd);
+  }
+};
+
+struct Dup3EventFields final {
+  BPFEventField<std::uint64_t> oldfd{"oldfd"};
+  BPFEventField<std::uint64_t> newfd{"newfd"};
+  BPFEventField<std::uint64_t> flags{"flags"};
+
+  bool bind(const ebpfpub::IFunctionTracer::Event& event) noexcept {
+    return bindBPFEventFields(event.in_field_map, oldfd, newfd, flags);
+  }
+};
+
+struct CreatEventFields final {
+  BPFEventField<std::string> pathname{"pathname"};
+
+  bool bind(const ebpfpub::IFunctionTracer::Event& event) noexcept {
+    return bindBPFEventFields(event.out_field_map, pathname);
+  }
+};
+
+struct MknodatEventFields final {
+  BPFEventField<std::uint64_t> mode{"mode"};
+  BPFEventField<std::uint64_t> dirfd{"dirfd"};
+  BPFEventField<std::string> filename{"filename"};
+
+  // The dirfd parameter is only present in mknodat
+  bool bind(const ebpfpub::IFunctionTracer::Event& event) noexcept {
+    bindBPFEventFields(event.in_field_map, mode, dirfd);
+    bindBPFEventFields(event.out_field_map, filename);
+
+    return mode.valid() && (!dirfd.found() || dirfd.valid()) &&
+           filename.valid();
+  }
+};
+
+struct NameToHandleAtEventFields final {
+  BPFEventField<std::uint64_t> dfd{"dfd"};
+  BPFEventField<std::uint64_t> flag{"flag"};
+  BPFEventField<std::string> name{"name"};
+  BPFEventField<Buffer> handle{"handle"};
+  BPFEventField<std::uint64_t> mnt_id{"mnt_id"};
+
+  bool bind(const ebpfpub::IFunctionTracer::Event& event) noexcept {
+    return bindBPFEventFields(event.in_field_map, dfd, flag) &&
+           bindBPFEventFields(event.out_field_map, name, handle, mnt_id);
+  }
+};
+
+struct OpenByHandleAtEventFields final {
+  BPFEventField<std::uint64_t> mountdirfd{"mountdirfd"};
+  BPFEventField<Buffer> handle{"handle"};
+
+  bool bind(const ebpfpub::IFunctionTracer::Event& event) noexcept {
+    return bindBPFEventFields(event.in_field_map, mountdirfd, handle);
+  }
+};
+
+struct OpenEventFields final {
+  BPFEventField<std::uint64_t> flags{"flags"};
+  BPFEventField<std::string> filename{"filename"};
+
+  bool bind(const ebpfpub::IFunctionTracer::Event& event) noexcept {
+    return bindBPFEventFields(event.in_field_map, flags) &&
+           bindBPFEventFields(event.out_field_map, filename);
+  }
+};
+
+struct OpenatEventFields final {
+  BPFEventField<std::uint64_t> flags{"flags"};
+  BPFEventField<std::uint64_t> dfd{"dfd"};
+  BPFEventField<std::string> filename{"filename"};
+
+  bool bind(const ebpfpub::IFunctionTracer::Event& event) noexcept {
+    return bindBPFEventFields(event.in_field_map, flags, dfd) &&
+           bindBPFEventFields(event.out_field_map, filename);
+  }
+};
+
+struct Openat2EventFields final {
+  BPFEventField<std::uint64_t> dfd{"dfd"};
+  BPFEventField<Buffer> how{"how"};
+  BPFEventField<std::string> filename{"filename"};
+
+  bool bind(const ebpfpub::IFunctionTracer::Event& event) noexcept {
+    return bindBPFEventFields(event.in_field_map, dfd, how) &&
+           bindBPFEventFields(event.out_field_map, filename);
+  }
+};
+
+struct ChdirEventFields final {
+  BPFEventField<std::string> filename{"filename"};
+
+  bool bind(const ebpfpub::IFunctionTracer::Event& event) noexcept {
+    return bindBPFEventFields(event.out_field_map, filename);
+  }
+};
+
+struct FchdirEventFields final {
+  BPFEventField<std::uint64_t> fd{"fd"};
+
+  bool bind(const ebpfpub::IFunctionTracer::Event& event) noexcept {
+    return bindBPFEventFields(event.in_field_map, fd);
+  }
+};
+
+struct SocketEventFields final {
+  BPFEventField<std::uint64_t> family{"family"};
+  BPFEventField<std::uint64_t> type{"type"};
+  BPFEventField<std::uint64_t> protocol{"protocol"};
+
+  bool bind(const ebpfpub::IFunctionTracer::Event& event) noexcept {
+    return bindBPFEventFields(event.in_field_map, family, type, protocol);
+  }
+};
+
+struct FcntlEventFields final {
+  BPFEventField<std::uint64_t> cmd{"cmd"};
+  BPFEventField<std::uint64_t> fd{"fd"};
+
+  bool bind(const ebpfpub::IFunctionTracer::Event& event) noexcept {
+    return bindBPFEventFields(event.in_field_map, cmd, fd);
+  }
+};
+
+struct ConnectEventFields final {
+  BPFEventField<std::uint64_t> fd{"fd"};
+  BPFEventField<Buffer> uservaddr{"uservaddr"};
+
+  bool bind(const ebpfpub::IFunctionTracer::Event& event) noexcept {
+    return bindBPFEventFields(event.in_field_map, fd, uservaddr);
+  }
+};
+
+struct AcceptEventFields final {
+  BPFEventField<std::uint64_t> fd{"fd"};
+  BPFEventField<std::uint64_t> flags{"flags"};
+  BPFEventField<Buffer> upeer_sockaddr{"upeer_sockaddr"};
+
+  // The flags parameter is only present in accept4
+  bool bind(const ebpfpub::IFunctionTracer::Event& event) noexcept {
+    bindBPFEventFields(event.in_field_map, fd, flags);
+    return bindBPFEventFields(event.out_field_map, upeer_sockaddr) &&
+           fd.valid();
+  }
+};
+
+struct BindEventFields final {
+  BPFEventField<std::uint64_t> fd{"fd"};
+  BPFEventField<Buffer> umyaddr{"umyaddr"};
+
+  bool bind(const ebpfpub::IFunctionTracer::Event& event) noexcept {
+    return bindBPFEventFields(event.in_field_map, fd, umyaddr);
+  }
+};
+
+struct ListenEventFields final {
+  BPFEventField<std::uint64_t> fd{"fd"};
+
+  bool bind(const ebpfpub::IFunctionTracer::Event& event) noexcept {
+    return bindBPFEventFields(event.in_field_map, fd);
+  }
+};
 } // namespace
 
 FLAG(bool,
@@ -341,6 +559,7 @@ Status BPFEventPublisher::run() {
             const ebpfpub::IPerfEventReader::ErrorCounters&
                 perf_error_counters) {
           updateBpfErrorState(bpf_error_state, perf_error_counters);
+          recordDroppedEvents(perf_error_counters.lost_events);
 
           for (auto& event : event_list) {
             if (event.header.probe_error) {
@@ -363,6 +582,10 @@ Status BPFEventPublisher::run() {
     struct sysinfo system_info {};
     sysinfo(&system_info);
 
+    // Event timestamps come from the monotonic clock the kernel uses for
+    // bpf_ktime_get_ns, so they double as the event received time.
+    EventClock::time_point received_time{};
+
     for (auto event_it = d->event_queue.begin();
          event_it != d->event_queue.end();) {
       const auto& rel_timestamp = event_it->first / 1000000000ULL;
@@ -371,6 +594,12 @@ Status BPFEventPublisher::run() {
         continue;
       }
 
+      if (received_time == EventClock::time_point{}) {
+        auto since_boot = std::chrono::nanoseconds(event_it->first);
+        received_time = EventClock::time_point(
+            std::chrono::duration_cast<EventClock::duration>(since_boot));
+      }
+
       auto event = std::move(event_it->second);
       event_it = d->event_queue.erase(event_it);
 
@@ -387,10 +616,13 @@ Status BPFEventPublisher::run() {
       }
     }
 
+    recordQueueDepth(d->event_queue.size());
+
     auto event_list = state.eventList();
     if (!event_list.empty()) {
       auto event_context = createEventContext();
       event_context->event_list = std::move(event_list);
+      event_context->received_time = received_time;
 
       fire(event_context);
     }
@@ -423,12 +655,12 @@ bool BPFEventPublisher::processVforkEvent(
 
 bool BPFEventPublisher::processCloneEvent(
     ISystemStateTracker& state, const ebpfpub::IFunctionTracer::Event& event) {
-  std::uint64_t clone_flags{};
-  if (!getEventMapValue(clone_flags, event.in_field_map, "clone_flags")) {
+  CloneEventFields fields;
+  if (!fields.bind(event)) {
     return false;
   }
 
-  if ((clone_flags & CLONE_THREAD) != 0) {
+  if ((fields.clone_flags.get() & CLONE_THREAD) != 0) {
     return true;
   }
 
@@ -437,13 +669,8 @@ bool BPFEventPublisher::processCloneEvent(
 
 bool BPFEventPublisher::processExecveEvent(
     ISystemStateTracker& state, const ebpfpub::IFunctionTracer::Event& event) {
-  std::string binary_path;
-  if (!getEventMapValue(binary_path, event.in_field_map, "filename")) {
-    return false;
-  }
-
-  ebpfpub::IFunctionTracer::Event::Field::Argv argv;
-  if (!getEventMapValue(argv, event.in_field_map, "argv")) {
+  ExecveEventFields fields;
+  if (!fields.bind(event)) {
     return false;
   }
 
@@ -452,29 +679,18 @@ bool BPFEventPublisher::processExecveEvent(
   static constexpr int kNoDirfd{AT_FDCWD};
   static constexpr int kNoExecveFlags{0};
 
-  return state.executeBinary(
-      event.header, process_id, kNoDirfd, kNoExecveFlags, binary_path, argv);
+  return state.executeBinary(event.header,
+                             process_id,
+                             kNoDirfd,
+                             kNoExecveFlags,
+                             fields.filename.get(),
+                             fields.argv.get());
 }
 
 bool BPFEventPublisher::processExecveatEvent(
     ISystemStateTracker& state, const ebpfpub::IFunctionTracer::Event& event) {
-  std::string binary_path;
-  if (!getEventMapValue(binary_path, event.in_field_map, "filename")) {
-    return false;
-  }
-
-  ebpfpub::IFunctionTracer::Event::Field::Argv argv;
-  if (!getEventMapValue(argv, event.in_field_map, "argv")) {
-    return false;
-  }
-
-  std::uint64_t flags{};
-  if (!getEventMapValue(flags, event.in_field_map, "flags")) {
-    return false;
-  }
-
-  std::uint64_t dirfd{};
-  if (!getEventMapValue(dirfd, event.in_field_map, "fd")) {
+  ExecveatEventFields fields;
+  if (!fields.bind(event)) {
     return false;
   }
 
@@ -482,20 +698,20 @@ bool BPFEventPublisher::processExecveatEvent(
 
   return state.executeBinary(event.header,
                              process_id,
-                             static_cast<int>(dirfd),
-                             static_cast<int>(flags),
-                             binary_path,
-                             argv);
+                             static_cast<int>(fields.fd.get()),
+                             static_cast<int>(fields.flags.get()),
+                             fields.filename.get(),
+                             fields.argv.get());
 }
 
 bool BPFEventPublisher::processCloseEvent(
     ISystemStateTracker& state, const ebpfpub::IFunctionTracer::Event& event) {
-  std::uint64_t fd_value{};
-  if (!getEventMapValue(fd_value, event.in_field_map, "fd")) {
+  CloseEventFields fields;
+  if (!fields.bind(event)) {
     return false;
   }
 
-  auto fd = static_cast<int>(fd_value);
+  auto fd = static_cast<int>(fields.fd.get());
   if (fd == -1) {
     return true;
   }
@@ -511,12 +727,12 @@ bool BPFEventPublisher::processCloseEvent(
 
 bool BPFEventPublisher::processDupEvent(
     ISystemStateTracker& state, const ebpfpub::IFunctionTracer::Event& event) {
-  std::uint64_t fildes_value{};
-  if (!getEventMapValue(fildes_value, event.in_field_map, "fildes")) {
+  DupEventFields fields;
+  if (!fields.bind(event)) {
     return false;
   }
 
-  auto fildes = static_cast<int>(fildes_value);
+  auto fildes = static_cast<int>(fields.fildes.get());
   if (fildes == -1) {
     return true;
   }
@@ -547,18 +763,13 @@ bool BPFEventPublisher::processDup2Event(
     return true;
   }
 
-  std::uint64_t fd_value{};
-  if (!getEventMapValue(fd_value, event.in_field_map, "oldfd")) {
+  Dup2EventFields fields;
+  if (!fields.bind(event)) {
     return false;
   }
 
-  auto oldfd = static_cast<int>(fd_value);
-
-  if (!getEventMapValue(fd_value, event.in_field_map, "newfd")) {
-    return false;
-  }
-
-  auto newfd = static_cast<int>(fd_value);
+  auto oldfd = static_cast<int>(fields.oldfd.get());
+  auto newfd = static_cast<int>(fields.newfd.get());
   if (newfd == oldfd) {
     return true;
   }
@@ -582,29 +793,19 @@ bool BPFEventPublisher::processDup3Event(
     return true;
   }
 
-  std::uint64_t fd_value{};
-  if (!getEventMapValue(fd_value, event.in_field_map, "oldfd")) {
+  Dup3EventFields fields;
+  if (!fields.bind(event)) {
     return false;
   }
 
-  auto oldfd = static_cast<int>(fd_value);
-
-  if (!getEventMapValue(fd_value, event.in_field_map, "newfd")) {
-    return false;
-  }
-
-  auto newfd = static_cast<int>(fd_value);
+  auto oldfd = static_cast<int>(fields.oldfd.get());
+  auto newfd = static_cast<int>(fields.newfd.get());
   if (newfd == oldfd) {
     return true;
   }
 
-  std::uint64_t flags{};
-  if (!getEventMapValue(flags, event.in_field_map, "flags")) {
-    return false;
-  }
-
   auto process_id = static_cast<pid_t>(event.header.process_id);
-  auto close_on_exec = (flags & O_CLOEXEC) != 0;
+  auto close_on_exec = (fields.flags.get() & O_CLOEXEC) != 0;
 
   // Ignore whether the operation has succeeded or not
   auto status = state.duplicateHandle(process_id, oldfd, newfd, close_on_exec);
@@ -622,8 +823,8 @@ bool BPFEventPublisher::processCreatEvent(
     return true;
   }
 
-  std::string path;
-  if (!getEventMapValue(path, event.out_field_map, "pathname")) {
+  CreatEventFields fields;
+  if (!fields.bind(event)) {
     return false;
   }
 
@@ -631,7 +832,8 @@ bool BPFEventPublisher::processCreatEvent(
   static constexpr int kNoDirfd{AT_FDCWD};
   static constexpr int kOpenFlags{O_CREAT | O_WRONLY | O_TRUNC};
 
-  return state.openFile(process_id, kNoDirfd, newfd, path, kOpenFlags);
+  return state.openFile(
+      process_id, kNoDirfd, newfd, fields.pathname.get(), kOpenFlags);
 }
 
 bool BPFEventPublisher::processMknodatEvent(
@@ -643,11 +845,15 @@ bool BPFEventPublisher::processMknodatEvent(
     return true;
   }
 
-  std::uint64_t mode{};
-  if (!getEventMapValue(mode, event.in_field_map, "mode")) {
+  MknodatEventFields fields;
+  fields.bind(event);
+
+  if (!fields.mode.valid()) {
     return false;
   }
 
+  auto mode = fields.mode.get();
+
   const auto kModeMask = S_IFREG | S_IFCHR | S_IFBLK | S_IFIFO | S_IFSOCK;
   if ((mode & kModeMask) == 0) {
     mode |= S_IFREG;
@@ -659,24 +865,23 @@ bool BPFEventPublisher::processMknodatEvent(
   }
 
   int dirfd{AT_FDCWD};
-  if (event.in_field_map.count("dirfd")) {
-    std::uint64_t dirfd_value{};
-    if (!getEventMapValue(dirfd_value, event.in_field_map, "dirfd")) {
+  if (fields.dirfd.found()) {
+    if (!fields.dirfd.valid()) {
       return false;
     }
 
-    dirfd = static_cast<int>(dirfd_value);
+    dirfd = static_cast<int>(fields.dirfd.get());
   }
 
-  std::string pathname;
-  if (!getEventMapValue(pathname, event.out_field_map, "filename")) {
+  if (!fields.filename.valid()) {
     return false;
   }
 
   auto process_id = static_cast<pid_t>(event.header.process_id);
   const int kEmptyFlags{};
 
-  return state.openFile(process_id, dirfd, newfd, pathname, kEmptyFlags);
+  return state.openFile(
+      process_id, dirfd, newfd, fields.filename.get(), kEmptyFlags);
 }
 
 bool BPFEventPublisher::processNameToHandleAtEvent(
@@ -686,33 +891,14 @@ bool BPFEventPublisher::processNameToHandleAtEvent(
     return true;
   }
 
-  std::uint64_t dfd{};
-  if (!getEventMapValue(dfd, event.in_field_map, "dfd")) {
-    return false;
-  }
-
-  std::string name;
-  if (!getEventMapValue(name, event.out_field_map, "name")) {
-    return false;
-  }
-
-  std::vector<std::uint8_t> handle;
-  if (!getEventMapValue(handle, event.out_field_map, "handle")) {
-    return false;
-  }
-
-  std::uint64_t mnt_id{};
-  if (!getEventMapValue(mnt_id, event.out_field_map, "mnt_id")) {
-    return false;
-  }
-
-  std::uint64_t flag{};
-  if (!getEventMapValue(mnt_id, event.in_field_map, "flag")) {
+  NameToHandleAtEventFields fields;
+  if (!fields.bind(event)) {
     return false;
   }
 
   // Validate the structure size; we at least need 6 bytes for the
   // header
+  const auto& handle = fields.handle.get();
   if (handle.size() < 8U) {
     return true;
   }
@@ -737,7 +923,13 @@ bool BPFEventPublisher::processNameToHandleAtEvent(
   f_handle.resize(handle_size);
   std::memcpy(f_handle.data(), handle.data() + 8U, f_handle.size());
 
-  state.nameToHandleAt(dfd, name, handle_type, f_handle, mnt_id, flag);
+  state.nameToHandleAt(fields.dfd.get(),
+                       fields.name.get(),
+                       handle_type,
+                       f_handle,
+                       fields.mnt_id.get(),
+                       fields.flag.get());
+
   return true;
 }
 
@@ -750,15 +942,12 @@ bool BPFEventPublisher::processOpenByHandleAtEvent(
     return true;
   }
 
-  std::uint64_t mountdirfd{};
-  if (!getEventMapValue(mountdirfd, event.in_field_map, "mountdirfd")) {
+  OpenByHandleAtEventFields fields;
+  if (!fields.bind(event)) {
     return false;
   }
 
-  std::vector<std::uint8_t> handle{};
-  if (!getEventMapValue(handle, event.in_field_map, "handle")) {
-    return false;
-  }
+  const auto& handle = fields.handle.get();
 
   std::uint32_t handle_size{};
   std::memcpy(&handle_size, handle.data(), sizeof(handle_size));
@@ -782,7 +971,7 @@ bool BPFEventPublisher::processOpenByHandleAtEvent(
 
   auto process_id = static_cast<pid_t>(event.header.process_id);
   return state.openByHandleAt(
-      process_id, mountdirfd, handle_type, handle_data, newfd);
+      process_id, fields.mountdirfd.get(), handle_type, handle_data, newfd);
 }
 
 bool BPFEventPublisher::processOpenEvent(
@@ -794,21 +983,19 @@ bool BPFEventPublisher::processOpenEvent(
     return true;
   }
 
-  std::uint64_t flags;
-  if (!getEventMapValue(flags, event.in_field_map, "flags")) {
-    return false;
-  }
-
-  std::string filename;
-  if (!getEventMapValue(filename, event.out_field_map, "filename")) {
+  OpenEventFields fields;
+  if (!fields.bind(event)) {
     return false;
   }
 
   auto process_id = static_cast<pid_t>(event.header.process_id);
   static constexpr int kNoDirfd{AT_FDCWD};
 
-  return state.openFile(
-      process_id, kNoDirfd, newfd, filename, static_cast<int>(flags));
+  return state.openFile(process_id,
+                        kNoDirfd,
+                        newfd,
+                        fields.filename.get(),
+                        static_cast<int>(fields.flags.get()));
 }
 
 bool BPFEventPublisher::processOpenatEvent(
@@ -820,27 +1007,17 @@ bool BPFEventPublisher::processOpenatEvent(
     return true;
   }
 
-  std::uint64_t flags;
-  if (!getEventMapValue(flags, event.in_field_map, "flags")) {
-    return false;
-  }
-
-  std::uint64_t dirfd;
-  if (!getEventMapValue(dirfd, event.in_field_map, "dfd")) {
-    return false;
-  }
-
-  std::string filename;
-  if (!getEventMapValue(filename, event.out_field_map, "filename")) {
+  OpenatEventFields fields;
+  if (!fields.bind(event)) {
     return false;
   }
 
   auto process_id = static_cast<pid_t>(event.header.process_id);
   return state.openFile(process_id,
-                        static_cast<int>(dirfd),
+                        static_cast<int>(fields.dfd.get()),
                         newfd,
-                        filename,
-                        static_cast<int>(flags));
+                        fields.filename.get(),
+                        static_cast<int>(fields.flags.get()));
 }
 
 bool BPFEventPublisher::processOpenat2Event(
@@ -852,18 +1029,8 @@ bool BPFEventPublisher::processOpenat2Event(
     return true;
   }
 
-  std::uint64_t dirfd;
-  if (!getEventMapValue(dirfd, event.in_field_map, "dfd")) {
-    return false;
-  }
-
-  std::string filename;
-  if (!getEventMapValue(filename, event.out_field_map, "filename")) {
-    return false;
-  }
-
-  ebpfpub::IFunctionTracer::Event::Field::Buffer buffer;
-  if (!getEventMapValue(buffer, event.in_field_map, "how")) {
+  Openat2EventFields fields;
+  if (!fields.bind(event)) {
     return false;
   }
 
@@ -873,14 +1040,15 @@ bool BPFEventPublisher::processOpenat2Event(
     std::uint64_t resolve;
   } openat_arguments;
 
+  const auto& buffer = fields.how.get();
   auto size = std::min(sizeof(openat_arguments), buffer.size());
   std::memcpy(&openat_arguments, buffer.data(), size);
 
   auto process_id = static_cast<pid_t>(event.header.process_id);
   return state.openFile(process_id,
-                        static_cast<int>(dirfd),
+                        static_cast<int>(fields.dfd.get()),
                         newfd,
-                        filename,
+                        fields.filename.get(),
                         static_cast<int>(openat_arguments.flags));
 }
 
@@ -890,13 +1058,13 @@ bool BPFEventPublisher::processChdirEvent(
     return true;
   }
 
-  std::string filename;
-  if (!getEventMapValue(filename, event.out_field_map, "filename")) {
+  ChdirEventFields fields;
+  if (!fields.bind(event)) {
     return false;
   }
 
   auto process_id = static_cast<pid_t>(event.header.process_id);
-  return state.setWorkingDirectory(process_id, filename);
+  return state.setWorkingDirectory(process_id, fields.filename.get());
 }
 
 bool BPFEventPublisher::processFchdirEvent(
@@ -905,13 +1073,14 @@ bool BPFEventPublisher::processFchdirEvent(
     return true;
   }
 
-  std::uint64_t dirfd{};
-  if (!getEventMapValue(dirfd, event.in_field_map, "fd")) {
+  FchdirEventFields fields;
+  if (!fields.bind(event)) {
     return false;
   }
 
   auto process_id = static_cast<pid_t>(event.header.process_id);
-  return state.setWorkingDirectory(process_id, static_cast<int>(dirfd));
+  return state.setWorkingDirectory(process_id,
+                                   static_cast<int>(fields.fd.get()));
 }
 
 bool BPFEventPublisher::processSocketEvent(
@@ -924,23 +1093,17 @@ bool BPFEventPublisher::processSocketEvent(
 
   int fd = static_cast<int>(event.header.exit_code);
 
-  std::uint64_t domain{};
-  if (!getEventMapValue(domain, event.in_field_map, "family")) {
-    return false;
-  }
-
-  std::uint64_t type{};
-  if (!getEventMapValue(type, event.in_field_map, "type")) {
-    return false;
-  }
-
-  std::uint64_t protocol{};
-  if (!getEventMapValue(protocol, event.in_field_map, "protocol")) {
+  SocketEventFields fields;
+  if (!fields.bind(event)) {
     return false;
   }
 
   auto process_id = static_cast<pid_t>(event.header.process_id);
-  return state.createSocket(process_id, domain, type, protocol, fd);
+  return state.createSocket(process_id,
+                            fields.family.get(),
+                            fields.type.get(),
+                            fields.protocol.get(),
+                            fd);
 }
 
 bool BPFEventPublisher::processFcntlEvent(
@@ -952,17 +1115,19 @@ bool BPFEventPublisher::processFcntlEvent(
     return true;
   }
 
-  std::uint64_t cmd{};
-  if (!getEventMapValue(cmd, event.in_field_map, "cmd")) {
+  FcntlEventFields fields;
+  fields.bind(event);
+
+  if (!fields.cmd.valid()) {
     return false;
   }
 
+  auto cmd = fields.cmd.get();
   if (cmd != F_DUPFD && cmd != F_DUPFD_CLOEXEC) {
     return true;
   }
 
-  std::uint64_t fd{};
-  if (!getEventMapValue(fd, event.in_field_map, "fd")) {
+  if (!fields.fd.valid()) {
     return false;
   }
 
@@ -970,7 +1135,7 @@ bool BPFEventPublisher::processFcntlEvent(
 
   // Ignore whether the operation has succeeded or not
   auto close_on_exec = (cmd == F_DUPFD_CLOEXEC);
-  auto old_fd = static_cast<int>(fd);
+  auto old_fd = static_cast<int>(fields.fd.get());
 
   auto status =
       state.duplicateHandle(process_id, old_fd, new_fd, close_on_exec);
@@ -983,19 +1148,16 @@ bool BPFEventPublisher::processConnectEvent(
     ISystemStateTracker& state, const ebpfpub::IFunctionTracer::Event& event) {
   // Do not check for the exit code; this could be a non-blocking socket
   // that causes the syscall to always return -1
-  std::uint64_t fd{};
-  if (!getEventMapValue(fd, event.in_field_map, "fd")) {
-    return false;
-  }
-
-  ebpfpub::IFunctionTracer::Event::Field::Buffer uservaddr;
-  if (!getEventMapValue(uservaddr, event.in_field_map, "uservaddr")) {
+  ConnectEventFields fields;
+  if (!fields.bind(event)) {
     return false;
   }
 
   auto process_id = static_cast<pid_t>(event.header.process_id);
-  return state.connect(
-      event.header, process_id, static_cast<int>(fd), uservaddr);
+  return state.connect(event.header,
+                       process_id,
+                       static_cast<int>(fields.fd.get()),
+                       fields.uservaddr.get());
 }
 
 bool BPFEventPublisher::processAcceptEvent(
@@ -1007,20 +1169,18 @@ bool BPFEventPublisher::processAcceptEvent(
     return true;
   }
 
-  std::uint64_t fd{};
-  if (!getEventMapValue(fd, event.in_field_map, "fd")) {
-    return false;
-  }
-
-  ebpfpub::IFunctionTracer::Event::Field::Buffer upeer_sockaddr;
-  if (!getEventMapValue(
-          upeer_sockaddr, event.out_field_map, "upeer_sockaddr")) {
+  AcceptEventFields fields;
+  if (!fields.bind(event)) {
     return false;
   }
 
   auto process_id = static_cast<pid_t>(event.header.process_id);
-  auto status = state.accept(
-      event.header, process_id, static_cast<int>(fd), upeer_sockaddr, newfd, 0);
+  auto status = state.accept(event.header,
+                             process_id,
+                             static_cast<int>(fields.fd.get()),
+                             fields.upeer_sockaddr.get(),
+                             newfd,
+                             0);
 
   static_cast<void>(status);
   return true;
@@ -1035,29 +1195,18 @@ bool BPFEventPublisher::processAccept4Event(
     return true;
   }
 
-  std::uint64_t fd{};
-  if (!getEventMapValue(fd, event.in_field_map, "fd")) {
-    return false;
-  }
-
-  ebpfpub::IFunctionTracer::Event::Field::Buffer upeer_sockaddr;
-  if (!getEventMapValue(
-          upeer_sockaddr, event.out_field_map, "upeer_sockaddr")) {
-    return false;
-  }
-
-  std::uint64_t flags{};
-  if (!getEventMapValue(flags, event.in_field_map, "flags")) {
+  AcceptEventFields fields;
+  if (!fields.bind(event) || !fields.flags.valid()) {
     return false;
   }
 
   auto process_id = static_cast<pid_t>(event.header.process_id);
   auto status = state.accept(event.header,
                              process_id,
-                             static_cast<int>(fd),
-                             upeer_sockaddr,
+                             static_cast<int>(fields.fd.get()),
+                             fields.upeer_sockaddr.get(),
                              newfd,
-                             static_cast<int>(flags));
+                             static_cast<int>(fields.flags.get()));
 
   static_cast<void>(status);
   return true;
@@ -1069,18 +1218,16 @@ bool BPFEventPublisher::processBindEvent(
     return true;
   }
 
-  std::uint64_t fd{};
-  if (!getEventMapValue(fd, event.in_field_map, "fd")) {
-    return false;
-  }
-
-  ebpfpub::IFunctionTracer::Event::Field::Buffer uservaddr;
-  if (!getEventMapValue(uservaddr, event.in_field_map, "umyaddr")) {
+  BindEventFields fields;
+  if (!fields.bind(event)) {
     return false;
   }
 
   auto process_id = static_cast<pid_t>(event.header.process_id);
-  return state.bind(event.header, process_id, static_cast<int>(fd), uservaddr);
+  return state.bind(event.header,
+                    process_id,
+                    static_cast<int>(fields.fd.get()),
+                    fields.umyaddr.get());
 }
 
 bool BPFEventPublisher::processListenEvent(
@@ -1089,12 +1236,13 @@ bool BPFEventPublisher::processListenEvent(
     return true;
   }
 
-  std::uint64_t fd{};
-  if (!getEventMapValue(fd, event.in_field_map, "fd")) {
+  ListenEventFields fields;
+  if (!fields.bind(event)) {
     return false;
   }
 
   auto process_id = static_cast<pid_t>(event.header.process_id);
-  return state.listen(event.header, process_id, static_cast<int>(fd));
+  return state.listen(
+      event.header, process_id, static_cast<int>(fields.fd.get()));
 }
 } // namespace osquery
@@ -45,25 +45,6 @@ class BPFEventPublisher final : public EventPublisher<BPFEventSC, BPFEventEC> {
   std::unique_ptr<PrivateData> d;
 
  public:
-  template <typename T>
-  static bool getEventMapValue(
-      T& value,
-      const tob::ebpfpub::IFunctionTracer::Event::FieldMap& field_map,
-      const std::string& key) {
-    auto field_it = field_map.find(key);
-    if (field_it == field_map.end()) {
-      return false;
-    }
-
-    const auto& var = field_it->second.data_var;
-    if (!std::holds_alternative<T>(var)) {
-      return false;
-    }
-
-    value = std::get<T>(var);
-    return true;
-  }
-
   static bool processForkEvent(
       ISystemStateTracker& state,
       const tob::ebpfpub::IFunctionTracer::Event& event);
@@ -221,6 +221,9 @@ void INotifyEventPublisher::tearDown() {
 }
 
 void INotifyEventPublisher::handleOverflow() {
+  // The kernel does not report how many events were lost, count the overflow.
+  recordDroppedEvents(1);
+
   if (inotify_events_ < kINotifyMaxEvents) {
     VLOG(1) << "inotify was overflown: increasing scratch buffer";
     // Exponential increment.
@@ -553,6 +553,51 @@ TEST_F(EventsTests, test_fire_event) {
   EXPECT_TRUE(status.ok());
 }
 
+TEST_F(EventsTests, test_event_statistics) {
+  auto pub = std::make_shared<BasicEventPublisher>();
+  pub->setName("BasicPublisher");
+  auto status = EventFactory::registerEventPublisher(pub);
+  ASSERT_TRUE(status.ok());
+
+  auto sub = std::make_shared<FakeEventSubscriber>();
+  status = EventFactory::registerEventSubscriber(sub);
+  ASSERT_TRUE(status.ok());
+
+  auto subscription = Subscription::create("fake_events");
+  subscription->callback = TestTheeCallback;
+  status = EventFactory::addSubscription("BasicPublisher", subscription);
+  ASSERT_TRUE(status.ok());
+  pub->configure();
+
+  // The publisher received this event 5 milliseconds before firing it.
+  auto ec = pub->createEventContext();
+  ec->received_time = EventClock::now() - std::chrono::milliseconds(5);
+  pub->fire(ec, 0);
+
+  auto latency = pub->statistics().latency();
+  EXPECT_EQ(latency.count(), 1U);
+  EXPECT_GE(latency.quantile(0.5), 5000);
+  EXPECT_EQ(sub->statistics().latency().count(), 1U);
+
+  // Events without a received time are measured from the fire.
+  auto now_ec = pub->createEventContext();
+  pub->fire(now_ec, 0);
+  EXPECT_NE(now_ec->received_time, EventClock::time_point{});
+  EXPECT_EQ(pub->statistics().latency().count(), 2U);
+
+  pub->recordQueueDepth(12);
+  pub->recordDroppedEvents(3);
+  pub->recordDroppedEvents(4);
+  EXPECT_EQ(pub->statistics().queueDepth(), 12U);
+  EXPECT_EQ(pub->statistics().droppedEvents(), 7U);
+
+  status = EventFactory::deregisterEventSubscriber(sub->getName());
+  EXPECT_TRUE(status.ok());
+
+  status = EventFactory::deregisterEventPublisher(pub->type());
+  EXPECT_TRUE(status.ok());
+}
+
 class SubFakeEventSubscriber : public FakeEventSubscriber {
  public:
   SubFakeEventSubscriber() : FakeEventSubscriber(true) {
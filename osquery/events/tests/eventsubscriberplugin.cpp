@@ -35,10 +35,10 @@ TEST_F(EventSubscriberPluginTests, setDatabaseNamespace) {
 }
 
 TEST_F(EventSubscriberPluginTests, generateEventDataIndex) {
-  // We start with 10 good keys and 10 malformed ones
+  // We start with 10 good keys, 10 malformed ones and the column dictionary
   MockedOsqueryDatabase mocked_database;
   mocked_database.generateEvents("type", "name");
-  EXPECT_EQ(mocked_database.key_map.size(), 20U);
+  EXPECT_EQ(mocked_database.key_map.size(), 21U);
 
   EventSubscriberPlugin::Context context;
   EventSubscriberPlugin::setDatabaseNamespace(context, "type", "name");
@@ -51,8 +51,9 @@ TEST_F(EventSubscriberPluginTests, generateEventDataIndex) {
   // Make sure we have found the 10 keys and that the broken ones
   // have been deleted
   EXPECT_TRUE(status.ok());
-  EXPECT_EQ(mocked_database.key_map.size(), 10U);
+  EXPECT_EQ(mocked_database.key_map.size(), 11U);
   EXPECT_EQ(context.event_index.size(), 10U);
+  EXPECT_EQ(context.column_dictionary.size(), 6U);
 }
 
 TEST_F(EventSubscriberPluginTests, toIndex) {
@@ -63,14 +64,14 @@ TEST_F(EventSubscriberPluginTests, toIndex) {
 TEST_F(EventSubscriberPluginTests, setOptimizeData) {
   MockedOsqueryDatabase mocked_database;
   mocked_database.generateEvents("type", "name");
-  EXPECT_EQ(mocked_database.key_map.size(), 20U);
+  EXPECT_EQ(mocked_database.key_map.size(), 21U);
 
   const EventTime kEventTime{10U};
   const std::size_t kEventIdentifier{20U};
   EventSubscriberPlugin::setOptimizeData(
       mocked_database, kEventTime, kEventIdentifier);
 
-  EXPECT_EQ(mocked_database.key_map.size(), 22U);
+  EXPECT_EQ(mocked_database.key_map.size(), 23U);
 
   ASSERT_EQ(mocked_database.key_map.count("optimize.test_query"), 1U);
   EXPECT_EQ(mocked_database.key_map.at("optimize.test_query"),
@@ -95,7 +96,7 @@ TEST_F(EventSubscriberPluginTests, timeFromRecord) {
 TEST_F(EventSubscriberPluginTests, getOptimizeData) {
   MockedOsqueryDatabase mocked_database;
   mocked_database.generateEvents("type", "name");
-  EXPECT_EQ(mocked_database.key_map.size(), 20U);
+  EXPECT_EQ(mocked_database.key_map.size(), 21U);
 
   const EventTime kEventTime{10U};
   const std::size_t kEventIdentifier{20U};
@@ -117,22 +118,29 @@ TEST_F(EventSubscriberPluginTests, databaseKeyForEventId) {
   EventSubscriberPlugin::Context context;
   EventSubscriberPlugin::setDatabaseNamespace(context, "type", "name");
 
+  const EventTime kEventTime{1600000000U};
   const std::size_t kEventIdentifier{1000};
 
   std::stringstream expected_key;
-  expected_key << "data." << context.database_namespace << "."
-               << std::setfill('0') << std::setw(10) << kEventIdentifier;
+  expected_key << "data." << context.database_namespace << "." << kEventTime
+               << "." << std::setfill('0') << std::setw(10)
+               << kEventIdentifier;
 
-  auto key =
-      EventSubscriberPlugin::databaseKeyForEventId(context, kEventIdentifier);
+  auto key = EventSubscriberPlugin::databaseKeyForEventId(
+      context, kEventTime, kEventIdentifier);
 
   EXPECT_EQ(key, expected_key.str());
+
+  // Keys sort by event time before EventID.
+  auto earlier_key = EventSubscriberPlugin::databaseKeyForEventId(
+      context, kEventTime - 1, kEventIdentifier + 1);
+  EXPECT_LT(earlier_key, key);
 }
 
 TEST_F(EventSubscriberPluginTests, removeOverflowingEventBatches) {
   MockedOsqueryDatabase mocked_database;
   mocked_database.generateEvents("type", "name");
-  EXPECT_EQ(mocked_database.key_map.size(), 20U);
+  EXPECT_EQ(mocked_database.key_map.size(), 21U);
 
   EventSubscriberPlugin::Context context;
   EventSubscriberPlugin::setDatabaseNamespace(context, "type", "name");
@@ -172,7 +180,7 @@ TEST_F(EventSubscriberPluginTests, removeOverflowingEventBatches) {
 TEST_F(EventSubscriberPluginTests, expireEventBatches) {
   MockedOsqueryDatabase mocked_database;
   mocked_database.generateEvents("type", "name");
-  EXPECT_EQ(mocked_database.key_map.size(), 20U);
+  EXPECT_EQ(mocked_database.key_map.size(), 21U);
 
   EventSubscriberPlugin::Context context;
   EventSubscriberPlugin::setDatabaseNamespace(context, "type", "name");
@@ -191,12 +199,62 @@ TEST_F(EventSubscriberPluginTests, expireEventBatches) {
 
   EventSubscriberPlugin::expireEventBatches(context, mocked_database, 1, 5);
   EXPECT_EQ(context.event_index.size(), 5U);
+
+  // The expired events are removed from the database with a single range.
+  EXPECT_EQ(mocked_database.key_map.size(), 6U);
+}
+
+TEST_F(EventSubscriberPluginTests, expireEventBatchesWithBuckets) {
+  MockedOsqueryDatabase mocked_database;
+  mocked_database.generateEvents("type", "name");
+
+  EventSubscriberPlugin::Context context;
+  EventSubscriberPlugin::setDatabaseNamespace(context, "type", "name");
+  context.expiry_bucket_size = 4U;
+
+  auto status =
+      EventSubscriberPlugin::generateEventDataIndex(context, mocked_database);
+  ASSERT_TRUE(status.ok());
+  EXPECT_EQ(context.event_index.size(), 10U);
+
+  // Events older than time 2 have expired, but the first bucket is not over.
+  EventSubscriberPlugin::expireEventBatches(context, mocked_database, 1, 3);
+  EXPECT_EQ(context.event_index.size(), 10U);
+
+  // Events up to time 6 have expired, only the first bucket [0, 4) is removed.
+  EventSubscriberPlugin::expireEventBatches(context, mocked_database, 1, 7);
+  EXPECT_EQ(context.event_index.size(), 6U);
+  EXPECT_EQ(context.event_index.begin()->first, 4U);
+  EXPECT_EQ(mocked_database.key_map.size(), 7U);
+}
+
+TEST_F(EventSubscriberPluginTests, expireEventBatchesLateEvents) {
+  MockedOsqueryDatabase mocked_database;
+  mocked_database.generateEvents("type", "name");
+
+  EventSubscriberPlugin::Context context;
+  EventSubscriberPlugin::setDatabaseNamespace(context, "type", "name");
+
+  auto status =
+      EventSubscriberPlugin::generateEventDataIndex(context, mocked_database);
+  ASSERT_TRUE(status.ok());
+
+  // An event stored late with an older time, and not yet indexed
+  auto late_key =
+      EventSubscriberPlugin::databaseKeyForEventId(context, 2U, 1000U);
+  mocked_database.key_map.insert({late_key, "late_serialized_value"});
+
+  // It is inside the expired range, and is removed along with it
+  EventSubscriberPlugin::expireEventBatches(context, mocked_database, 1, 5);
+  EXPECT_EQ(context.event_index.size(), 5U);
+  EXPECT_EQ(mocked_database.key_map.count(late_key), 0U);
+  EXPECT_EQ(mocked_database.key_map.size(), 6U);
 }
 
 TEST_F(EventSubscriberPluginTests, generateRows) {
   MockedOsqueryDatabase mocked_database;
   mocked_database.generateEvents("type", "name");
-  EXPECT_EQ(mocked_database.key_map.size(), 20U);
+  EXPECT_EQ(mocked_database.key_map.size(), 21U);
 
   EventSubscriberPlugin::Context context;
   EventSubscriberPlugin::setDatabaseNamespace(context, "type", "name");
@@ -208,7 +266,11 @@ TEST_F(EventSubscriberPluginTests, generateRows) {
   EXPECT_EQ(context.event_index.size(), 10U);
 
   std::size_t callback_count{0U};
-  auto callback = [&callback_count](Row) { ++callback_count; };
+  auto callback = [&callback_count](Row row) {
+    // Rows are decoded with the stored column dictionary.
+    EXPECT_EQ(row["key1"], "value1");
+    ++callback_count;
+  };
 
   EventIndex::iterator last;
   last = EventSubscriberPlugin::generateRows(
@@ -235,6 +297,13 @@ TEST_F(EventSubscriberPluginTests, generateRows) {
       context, mocked_database, callback, 10, 15);
   EXPECT_EQ(callback_count, 20U);
   EXPECT_EQ(last, context.event_index.end());
+
+  // Events that could not be read are not reported as read.
+  mocked_database.fail_scans = true;
+  last = EventSubscriberPlugin::generateRows(
+      context, mocked_database, callback, 0, 0);
+  EXPECT_EQ(callback_count, 20U);
+  EXPECT_EQ(last, context.event_index.end());
 }
 
 class FakeEventSubscriberPlugin : public EventSubscriberPlugin {
@@ -310,6 +379,30 @@ TEST_F(EventSubscriberPluginTests, getExpireTime) {
   EXPECT_EQ(5U, expire_time);
 }
 
+TEST_F(EventSubscriberPluginTests, expireEventBatchesAtWatermark) {
+  MockedOsqueryDatabase mocked_database;
+  FakeEventSubscriberPlugin subscriber(mocked_database);
+  mocked_database.generateEvents(subscriber.getType(), subscriber.getName());
+
+  subscriber.setDatabaseNamespace();
+  subscriber.generateEventDataIndex();
+  subscriber.setTime(20);
+
+  // One of the two queries has only read the events up to time 5
+  subscriber.resetQueryCount(2);
+  subscriber.setExecutedQuery("test1", 5);
+  subscriber.setExecutedQuery("test2", 20);
+
+  // Every event has expired, but only the ones before the watermark go
+  auto expire_time = subscriber.getExpireTime();
+  EXPECT_EQ(5U, expire_time);
+
+  EventSubscriberPlugin::expireEventBatches(
+      subscriber.context, mocked_database, 1, expire_time);
+  ASSERT_EQ(subscriber.context.event_index.size(), 5U);
+  EXPECT_EQ(subscriber.context.event_index.begin()->first, 5U);
+}
+
 TEST_F(EventSubscriberPluginTests, getEventsExpiry) {
   MockedOsqueryDatabase mocked_database;
   FakeEventSubscriberPlugin subscriber(mocked_database);
@@ -391,4 +484,36 @@ TEST_F(EventSubscriberPluginTests, generateRowsWithOptimize) {
   ASSERT_FALSE(subscriber.executedAllQueries());
   EXPECT_EQ(0U, callback_count);
 }
+
+TEST_F(EventSubscriberPluginTests, generateRowsWithOptimizeScanFailure) {
+  MockedOsqueryDatabase mocked_database;
+  FakeEventSubscriberPlugin subscriber(mocked_database);
+  mocked_database.generateEvents(subscriber.getType(), subscriber.getName());
+
+  subscriber.setDatabaseNamespace();
+  subscriber.generateEventDataIndex();
+  subscriber.resetQueryCount(2);
+  subscriber.setShouldOptimize(true);
+  subscriber.setOptimizeData(mocked_database, 0U, 0U);
+
+  size_t callback_count{0U};
+  auto callback = [&callback_count](Row) { ++callback_count; };
+
+  // A failed scan does not move the watermark past the unread events.
+  mocked_database.fail_scans = true;
+  subscriber.generateRows(callback, true, 0, 0);
+  EXPECT_EQ(0U, callback_count);
+
+  EventTime optimize_time{0U};
+  EventID optimize_eid{0U};
+  std::string query_name;
+  subscriber.getOptimizeData(
+      mocked_database, optimize_time, optimize_eid, query_name);
+  EXPECT_EQ(0U, optimize_time);
+  EXPECT_EQ(0U, optimize_eid);
+
+  mocked_database.fail_scans = false;
+  subscriber.generateRows(callback, true, 0, 0);
+  EXPECT_EQ(10U, callback_count);
+}
 } // namespace osquery
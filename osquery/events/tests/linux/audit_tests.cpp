@@ -13,6 +13,7 @@
 
 #include <cstdint>
 #include <ctime>
+#include <memory>
 
 #include <sstream>
 
@@ -20,6 +21,7 @@
 #include <osquery/core/tables.h>
 
 #include "osquery/events/linux/auditdnetlink.h"
+#include "osquery/events/linux/auditeventpublisher.h"
 #include "osquery/tests/test_util.h"
 
 namespace osquery {
@@ -70,10 +72,183 @@ TEST_F(AuditTests, test_handle_reply) {
   EXPECT_EQ("1440542781.644:403030", audit_event_record.audit_id);
   EXPECT_EQ(audit_event_record.fields.size(), 4U);
   EXPECT_EQ(audit_event_record.fields.count("argc"), 1U);
-  EXPECT_EQ(audit_event_record.fields["argc"], "3");
-  EXPECT_EQ(audit_event_record.fields["a0"], "\"H=1 \"");
-  EXPECT_EQ(audit_event_record.fields["a1"], "\"/bin/sh\"");
-  EXPECT_EQ(audit_event_record.fields["a2"], "c");
+  EXPECT_EQ(audit_event_record.fields.at("argc"), "3");
+  EXPECT_EQ(audit_event_record.fields.at("a0"), "\"H=1 \"");
+  EXPECT_EQ(audit_event_record.fields.at("a1"), "\"/bin/sh\"");
+  EXPECT_EQ(audit_event_record.fields.at("a2"), "c");
+}
+
+TEST_F(AuditTests, test_parse_audit_message) {
+  AuditEventRecord audit_event_record = {};
+
+  {
+    auto buffer = std::make_shared<const std::string>(
+        "audit(1440542781.644:403031): a0=\"ls\" a1=\"-l\" argc=2 a2 "
+        "a1=\"-a\"");
+
+    bool parser_status = AuditdNetlinkParser::ParseAuditMessage(
+        1, std::string_view(*buffer), buffer, audit_event_record);
+    EXPECT_TRUE(parser_status);
+  }
+
+  // The record keeps the buffer alive and fields stay in the received order
+  EXPECT_EQ("1440542781.644:403031", audit_event_record.audit_id);
+  ASSERT_EQ(audit_event_record.fields.size(), 5U);
+
+  auto field_it = audit_event_record.fields.begin();
+  EXPECT_EQ(field_it->first, "a0");
+  EXPECT_EQ((++field_it)->first, "a1");
+  EXPECT_EQ((++field_it)->first, "argc");
+  EXPECT_EQ((++field_it)->first, "a2");
+  EXPECT_TRUE(field_it->second.empty());
+
+  // Lookups return the first field with a given key
+  EXPECT_EQ(audit_event_record.fields.at("a1"), "\"-l\"");
+  EXPECT_EQ(audit_event_record.fields.count("a3"), 0U);
+  EXPECT_THROW(audit_event_record.fields.at("a3"), std::out_of_range);
+
+  audit_event_record.fields.set("argc", std::to_string(3));
+  audit_event_record.fields.set("a3", "\"-h\"");
+  EXPECT_EQ(audit_event_record.fields.size(), 6U);
+  EXPECT_EQ(audit_event_record.fields.at("argc"), "3");
+  EXPECT_EQ(audit_event_record.fields.at("a3"), "\"-h\"");
+
+  // A message without the preamble terminator is malformed
+  auto buffer = std::make_shared<const std::string>("audit(1440542781.644");
+  EXPECT_FALSE(AuditdNetlinkParser::ParseAuditMessage(
+      1, std::string_view(*buffer), buffer, audit_event_record));
+}
+
+TEST_F(AuditTests, test_parse_audit_messages) {
+  // Interleave the records of several events, along with a malformed one
+  std::vector<std::pair<int, std::string>> message_storage;
+  std::vector<std::pair<int, std::string>> expected_record_list;
+  for (std::uint32_t i = 0; i < 64U; ++i) {
+    auto type = 1300 + static_cast<int>(i % 8U);
+    auto audit_id = generateAuditId(1000U + (i % 8U));
+
+    message_storage.emplace_back(
+        type, "audit(" + audit_id + "): seq=" + std::to_string(i));
+    expected_record_list.emplace_back(type, audit_id);
+
+    if (i == 10U) {
+      message_storage.emplace_back(type, "audit(" + audit_id);
+    }
+  }
+
+  std::vector<AuditdNetlinkParser::AuditMessage> message_list;
+  for (const auto& message : message_storage) {
+    message_list.emplace_back(message.first, message.second);
+  }
+
+  // The records merged from the shards are in the order of the messages
+  for (std::size_t shard_count : {1U, 3U, 8U}) {
+    auto record_list =
+        AuditdNetlinkParser::ParseAuditMessages(message_list, shard_count);
+    ASSERT_EQ(record_list.size(), expected_record_list.size());
+
+    for (std::size_t i = 0; i < record_list.size(); ++i) {
+      EXPECT_EQ(record_list[i].type, expected_record_list[i].first);
+      EXPECT_EQ(record_list[i].audit_id, expected_record_list[i].second);
+      EXPECT_EQ(record_list[i].fields.at("seq"), std::to_string(i));
+    }
+  }
+
+  EXPECT_TRUE(AuditdNetlinkParser::ParseAuditMessages({}, 4U).empty());
+}
+
+TEST_F(AuditTests, test_detach_record) {
+  AuditEventRecord audit_event_record = {};
+  std::weak_ptr<const std::string> weak_buffer;
+
+  {
+    auto buffer = std::make_shared<const std::string>(
+        "audit(1440542781.644:403032): cwd=\"/root\" argc=1");
+    weak_buffer = buffer;
+
+    EXPECT_TRUE(AuditdNetlinkParser::ParseAuditMessage(
+        1, std::string_view(*buffer), buffer, audit_event_record));
+  }
+
+  audit_event_record.fields.set("argc", "2");
+  EXPECT_FALSE(weak_buffer.expired());
+
+  // The copies stay valid once the parsed buffer has been released
+  auto record_copy = audit_event_record;
+  audit_event_record.detach();
+  record_copy = {};
+  EXPECT_TRUE(weak_buffer.expired());
+
+  EXPECT_EQ("1440542781.644:403032", audit_event_record.audit_id);
+  ASSERT_EQ(audit_event_record.fields.size(), 2U);
+  EXPECT_EQ(audit_event_record.fields.at("cwd"), "\"/root\"");
+  EXPECT_EQ(audit_event_record.fields.at("argc"), "2");
+}
+
+TEST_F(AuditTests, test_pending_events_release_buffer) {
+  auto pending_audit_id = generateAuditId(2000U);
+  auto completed_audit_id = generateAuditId(2001U);
+
+  auto syscall_record = [](const std::string& audit_id) {
+    return "audit(" + audit_id +
+           "): arch=c000003e syscall=2 success=yes exit=3 a0=0 a1=0 a2=1 "
+           "a3=0 items=1 ppid=4316 pid=5581 auid=1000 uid=0 gid=0 euid=0 "
+           "suid=0 fsuid=0 egid=0 sgid=0 fsgid=0 tty=pts1 ses=1 "
+           "comm=\"mytest\" exe=\"/usr/bin/mytest\" key=(null)";
+  };
+
+  std::vector<std::pair<int, std::string>> message_list = {
+      {AUDIT_SYSCALL, syscall_record(pending_audit_id)},
+      {AUDIT_SYSCALL, syscall_record(completed_audit_id)},
+      {AUDIT_CWD, "audit(" + pending_audit_id + "): cwd=\"/root\""},
+      {AUDIT_EOE, "audit(" + completed_audit_id + "): "}};
+
+  // Every record of the batch views the same buffer
+  std::string batch_messages;
+  for (const auto& message : message_list) {
+    batch_messages += message.second;
+  }
+
+  auto buffer = std::make_shared<const std::string>(std::move(batch_messages));
+  std::weak_ptr<const std::string> weak_buffer = buffer;
+
+  std::vector<AuditEventRecord> record_list;
+  std::size_t offset{0U};
+  for (const auto& message : message_list) {
+    AuditEventRecord audit_event_record = {};
+    EXPECT_TRUE(AuditdNetlinkParser::ParseAuditMessage(
+        message.first,
+        std::string_view(*buffer).substr(offset, message.second.size()),
+        buffer,
+        audit_event_record));
+
+    offset += message.second.size();
+    record_list.push_back(std::move(audit_event_record));
+  }
+
+  buffer.reset();
+
+  auto event_context = std::make_shared<AuditEventContext>();
+  AuditTraceContext audit_trace_context;
+  AuditEventPublisher::ProcessEvents(
+      event_context, record_list, audit_trace_context, {});
+
+  ASSERT_EQ(event_context->audit_events.size(), 1U);
+  ASSERT_EQ(audit_trace_context.size(), 1U);
+
+  // Only the pending event outlives the batch, and it no longer needs its
+  // buffer once the published events and the batch are gone
+  record_list.clear();
+  event_context.reset();
+  EXPECT_TRUE(weak_buffer.expired());
+
+  const auto& pending_event = audit_trace_context.begin()->second;
+  EXPECT_EQ(audit_trace_context.begin()->first, pending_audit_id);
+  ASSERT_EQ(pending_event.record_list.size(), 2U);
+  EXPECT_EQ(pending_event.record_list[0].audit_id, pending_audit_id);
+  EXPECT_EQ(pending_event.record_list[0].fields.at("exe"),
+            "\"/usr/bin/mytest\"");
+  EXPECT_EQ(pending_event.record_list[1].fields.at("cwd"), "\"/root\"");
 }
 
 TEST_F(AuditTests, test_audit_value_decode) {
@@ -0,0 +1,165 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include "bpfeventfixtures.h"
+
+#include <osquery/events/linux/bpf/bpfeventpublisher.h>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/socket.h>
+
+#include <cstring>
+
+namespace osquery {
+
+namespace {
+
+using Event = tob::ebpfpub::IFunctionTracer::Event;
+using Field = Event::Field;
+
+Event createEvent(const std::string& name,
+                  pid_t process_id,
+                  std::uint64_t exit_code,
+                  std::vector<Field> in_field_list,
+                  std::vector<Field> out_field_list = {}) {
+  static std::uint64_t timestamp{1234567890ULL};
+  timestamp += 1000ULL;
+
+  Event event = {};
+  event.identifier = 1;
+  event.name = name;
+
+  event.header.timestamp = timestamp;
+  event.header.thread_id = process_id;
+  event.header.process_id = process_id;
+  event.header.exit_code = exit_code;
+  event.header.probe_error = false;
+
+  for (auto& field : in_field_list) {
+    auto field_name = field.name;
+    event.in_field_map.insert({std::move(field_name), std::move(field)});
+  }
+
+  for (auto& field : out_field_list) {
+    auto field_name = field.name;
+    event.out_field_map.insert({std::move(field_name), std::move(field)});
+  }
+
+  return event;
+}
+
+Field::Buffer createInetSockaddr(const char* address, std::uint16_t port) {
+  sockaddr_in sockaddr = {};
+  sockaddr.sin_family = AF_INET;
+  sockaddr.sin_port = htons(port);
+  inet_pton(AF_INET, address, &sockaddr.sin_addr);
+
+  Field::Buffer buffer(sizeof(sockaddr));
+  std::memcpy(buffer.data(), &sockaddr, sizeof(sockaddr));
+
+  return buffer;
+}
+
+BPFEventFixtureList createBPFEventFixtureList() {
+  // Process 2 is the shell, process 1000 is the child running curl
+  BPFEventFixtureList fixture_list;
+
+  fixture_list.push_back(
+      {&BPFEventPublisher::processCloneEvent,
+       createEvent("clone",
+                   2,
+                   1000ULL,
+                   {{"clone_flags", true, std::uint64_t{SIGCHLD}}})});
+
+  fixture_list.push_back(
+      {&BPFEventPublisher::processExecveEvent,
+       createEvent("execve",
+                   1000,
+                   0ULL,
+                   {{"filename", true, std::string("/usr/bin/curl")},
+                    {"argv",
+                     true,
+                     Field::Argv{"curl", "-o", "index.html", "osquery.io"}}})});
+
+  fixture_list.push_back(
+      {&BPFEventPublisher::processOpenatEvent,
+       createEvent(
+           "openat",
+           1000,
+           16ULL,
+           {{"dfd", true, static_cast<std::uint64_t>(AT_FDCWD)},
+            {"flags",
+             true,
+             static_cast<std::uint64_t>(O_WRONLY | O_CREAT | O_TRUNC)}},
+           {{"filename", false, std::string("index.html")}})});
+
+  fixture_list.push_back(
+      {&BPFEventPublisher::processDup2Event,
+       createEvent("dup2",
+                   1000,
+                   3ULL,
+                   {{"oldfd", true, std::uint64_t{16}},
+                    {"newfd", true, std::uint64_t{3}}})});
+
+  fixture_list.push_back(
+      {&BPFEventPublisher::processCloseEvent,
+       createEvent("close", 1000, 0ULL, {{"fd", true, std::uint64_t{16}}})});
+
+  fixture_list.push_back(
+      {&BPFEventPublisher::processSocketEvent,
+       createEvent("socket",
+                   1000,
+                   16ULL,
+                   {{"family", true, std::uint64_t{AF_INET}},
+                    {"type", true, std::uint64_t{SOCK_STREAM}},
+                    {"protocol", true, std::uint64_t{IPPROTO_TCP}}})});
+
+  fixture_list.push_back(
+      {&BPFEventPublisher::processFcntlEvent,
+       createEvent("fcntl",
+                   1000,
+                   17ULL,
+                   {{"fd", true, std::uint64_t{16}},
+                    {"cmd", true, std::uint64_t{F_DUPFD_CLOEXEC}},
+                    {"arg", true, std::uint64_t{17}}})});
+
+  fixture_list.push_back(
+      {&BPFEventPublisher::processConnectEvent,
+       createEvent("connect",
+                   1000,
+                   0ULL,
+                   {{"fd", true, std::uint64_t{16}},
+                    {"uservaddr",
+                     true,
+                     createInetSockaddr("104.18.24.159", 443)},
+                    {"addrlen", true, std::uint64_t{sizeof(sockaddr_in)}}})});
+
+  fixture_list.push_back(
+      {&BPFEventPublisher::processChdirEvent,
+       createEvent("chdir",
+                   2,
+                   0ULL,
+                   {},
+                   {{"filename", false, std::string("/tmp")}})});
+
+  return fixture_list;
+}
+
+} // namespace
+
+const BPFEventFixtureList& getBPFEventFixtureList() {
+  static const auto kFixtureList = createBPFEventFixtureList();
+  return kFixtureList;
+}
+
+} // namespace osquery
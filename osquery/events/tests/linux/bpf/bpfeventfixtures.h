@@ -0,0 +1,37 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <osquery/events/linux/bpf/isystemstatetracker.h>
+
+#include <ebpfpub/ifunctiontracer.h>
+
+#include <vector>
+
+namespace osquery {
+
+struct BPFEventFixture final {
+  using EventHandler = bool (*)(ISystemStateTracker& state,
+                                const tob::ebpfpub::IFunctionTracer::Event&);
+
+  EventHandler event_handler;
+  tob::ebpfpub::IFunctionTracer::Event event;
+};
+
+using BPFEventFixtureList = std::vector<BPFEventFixture>;
+
+/// Handwritten events describing a shell session, they were not captured
+/// from a live system: the process forks, executes curl, opens files,
+/// duplicates handles and connects to a remote host. Every event is
+/// expected to be handled successfully, in order, starting from the
+/// mocked process context factory state
+const BPFEventFixtureList& getBPFEventFixtureList();
+
+} // namespace osquery
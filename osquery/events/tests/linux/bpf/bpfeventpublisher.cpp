@@ -7,6 +7,7 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include "bpfeventfixtures.h"
 #include "bpftestsmain.h"
 #include "mockedprocesscontextfactory.h"
 #include "utils.h"
@@ -17,6 +18,8 @@
 #include <fcntl.h>
 #include <sys/un.h>
 
+#include <cstring>
+
 namespace osquery {
 
 namespace {
@@ -72,8 +75,145 @@ IProcessContextFactory::Ref getMockedProcessContextFactory() {
   return IProcessContextFactory::Ref(new MockedProcessContextFactory);
 }
 
+/// Records the arguments passed to nameToHandleAt, ignores everything else
+class NameToHandleAtRecorder final : public ISystemStateTracker {
+ public:
+  struct Call final {
+    int dfd{};
+    std::string name;
+    int handle_type{};
+    std::vector<std::uint8_t> handle;
+    int mnt_id{};
+    int flag{};
+  };
+
+  std::vector<Call> call_list;
+
+  Status restart() override {
+    return Status::success();
+  }
+
+  bool createProcess(const tob::ebpfpub::IFunctionTracer::Event::Header&,
+                     pid_t,
+                     pid_t) override {
+    return true;
+  }
+
+  bool executeBinary(
+      const tob::ebpfpub::IFunctionTracer::Event::Header&,
+      pid_t,
+      int,
+      int,
+      const std::string&,
+      const tob::ebpfpub::IFunctionTracer::Event::Field::Argv&) override {
+    return true;
+  }
+
+  bool setWorkingDirectory(pid_t, int) override {
+    return true;
+  }
+
+  bool setWorkingDirectory(pid_t, const std::string&) override {
+    return true;
+  }
+
+  bool openFile(pid_t, int, int, const std::string&, int) override {
+    return true;
+  }
+
+  bool duplicateHandle(pid_t, int, int, bool) override {
+    return true;
+  }
+
+  bool closeHandle(pid_t, int) override {
+    return true;
+  }
+
+  bool createSocket(pid_t, int, int, int, int) override {
+    return true;
+  }
+
+  bool bind(const tob::ebpfpub::IFunctionTracer::Event::Header&,
+            pid_t,
+            int,
+            const std::vector<std::uint8_t>&) override {
+    return true;
+  }
+
+  bool listen(const tob::ebpfpub::IFunctionTracer::Event::Header&,
+              pid_t,
+              int) override {
+    return true;
+  }
+
+  bool connect(const tob::ebpfpub::IFunctionTracer::Event::Header&,
+               pid_t,
+               int,
+               const std::vector<std::uint8_t>&) override {
+    return true;
+  }
+
+  bool accept(const tob::ebpfpub::IFunctionTracer::Event::Header&,
+              pid_t,
+              int,
+              const std::vector<std::uint8_t>&,
+              int,
+              int) override {
+    return true;
+  }
+
+  void nameToHandleAt(int dfd,
+                      const std::string& name,
+                      int handle_type,
+                      const std::vector<std::uint8_t>& handle,
+                      int mnt_id,
+                      int flag) override {
+    call_list.push_back({dfd, name, handle_type, handle, mnt_id, flag});
+  }
+
+  bool openByHandleAt(pid_t,
+                      int,
+                      int,
+                      const std::vector<std::uint8_t>&,
+                      int) override {
+    return true;
+  }
+
+  EventList eventList() override {
+    return {};
+  }
+};
+
 } // namespace
 
+TEST_F(BPFEventPublisherTests, processEventFixtures) {
+  auto state_tracker_ref =
+      SystemStateTracker::create(getMockedProcessContextFactory());
+
+  auto& state_tracker =
+      static_cast<SystemStateTracker&>(*state_tracker_ref.get());
+
+  for (const auto& fixture : getBPFEventFixtureList()) {
+    auto succeeded = fixture.event_handler(state_tracker, fixture.event);
+    EXPECT_TRUE(succeeded) << "Failed to process the fixture event: "
+                           << fixture.event.name;
+  }
+
+  // clone, execve, connect
+  EXPECT_EQ(state_tracker.eventList().size(), 3U);
+
+  auto process_map = state_tracker.getContextCopy().process_map;
+  ASSERT_EQ(process_map.count(1000), 1U);
+
+  const auto& process_context = process_map.at(1000);
+  EXPECT_EQ(process_context.binary_path, "/usr/bin/curl");
+  EXPECT_TRUE(validateFileDescriptor(
+      process_context, 3, false, "/home/alessandro/index.html"));
+  EXPECT_EQ(process_context.fd_map.count(17), 1U);
+
+  EXPECT_EQ(process_map.at(2).cwd, "/tmp");
+}
+
 TEST_F(BPFEventPublisherTests, processForkEvent_and_processVforkEvent) {
   auto state_tracker_ref =
       SystemStateTracker::create(getMockedProcessContextFactory());
@@ -1699,4 +1839,70 @@ TEST_F(BPFEventPublisherTests, processListenEvent) {
   EXPECT_TRUE(succeeded);
 }
 
+TEST_F(BPFEventPublisherTests, processNameToHandleAtEvent) {
+  NameToHandleAtRecorder state_tracker;
+
+  auto bpf_event = kBaseBPFEvent;
+  bpf_event.name = "name_to_handle_at";
+  bpf_event.header.process_id = 2;
+
+  // Processing should fail until we pass all parameters
+  auto succeeded =
+      BPFEventPublisher::processNameToHandleAtEvent(state_tracker, bpf_event);
+
+  EXPECT_FALSE(succeeded);
+  EXPECT_TRUE(state_tracker.call_list.empty());
+
+  // The file_handle struct: handle_bytes, handle_type, f_handle
+  const std::uint32_t kHandleSize{8U};
+  const int kHandleType{1};
+
+  tob::ebpfpub::IFunctionTracer::Event::Field::Buffer handle(24U, 0U);
+  std::memcpy(handle.data(), &kHandleSize, sizeof(kHandleSize));
+  std::memcpy(handle.data() + 4U, &kHandleType, sizeof(kHandleType));
+  for (std::size_t i = 0U; i < kHandleSize; ++i) {
+    handle[8U + i] = static_cast<std::uint8_t>(0xA0U + i);
+  }
+
+  // Use distinct values for the mount id and the flags, so that one
+  // can't be mistaken for the other
+  // clang-format off
+  bpf_event.in_field_map = {
+    { "dfd", { "dfd", true, static_cast<std::uint64_t>(AT_FDCWD) } },
+    { "flag", { "flag", true, static_cast<std::uint64_t>(AT_EMPTY_PATH) } }
+  };
+
+  bpf_event.out_field_map = {
+    { "name", { "name", false, std::string("/etc/hosts") } },
+    { "handle", { "handle", false, handle } },
+    { "mnt_id", { "mnt_id", false, 42ULL } }
+  };
+  // clang-format on
+
+  // Failed syscalls are ignored
+  bpf_event.header.exit_code = static_cast<std::uint64_t>(-1);
+  succeeded =
+      BPFEventPublisher::processNameToHandleAtEvent(state_tracker, bpf_event);
+
+  EXPECT_TRUE(succeeded);
+  EXPECT_TRUE(state_tracker.call_list.empty());
+
+  bpf_event.header.exit_code = 0ULL;
+  succeeded =
+      BPFEventPublisher::processNameToHandleAtEvent(state_tracker, bpf_event);
+
+  EXPECT_TRUE(succeeded);
+  ASSERT_EQ(state_tracker.call_list.size(), 1U);
+
+  const auto& call = state_tracker.call_list.front();
+  EXPECT_EQ(call.dfd, AT_FDCWD);
+  EXPECT_EQ(call.name, "/etc/hosts");
+  EXPECT_EQ(call.handle_type, kHandleType);
+  EXPECT_EQ(call.handle,
+            std::vector<std::uint8_t>(handle.begin() + 8U,
+                                      handle.begin() + 8U + kHandleSize));
+  EXPECT_EQ(call.mnt_id, 42);
+  EXPECT_EQ(call.flag, AT_EMPTY_PATH);
+}
+
 } // namespace osquery
@@ -85,8 +85,8 @@ TEST_F(SocketEventsTableTests, failed_blocking_connect_syscall) {
   auto& syscall_data = boost::get<SyscallAuditEventData>(audit_event.data);
 
   syscall_data.succeeded = false;
-  audit_event.record_list.at(0).fields["success"] = "no";
-  audit_event.record_list.at(0).fields["exit"] = std::to_string(-EBADF);
+  audit_event.record_list.at(0).fields.set("success", "no");
+  audit_event.record_list.at(0).fields.set("exit", std::to_string(-EBADF));
 
   for (const auto& allow_failed_events : {true, false}) {
     std::vector<Row> emitted_row_list;
@@ -119,8 +119,9 @@ TEST_F(SocketEventsTableTests, succeeded_non_blocking_connect_syscall) {
   auto& syscall_data = boost::get<SyscallAuditEventData>(audit_event.data);
 
   syscall_data.succeeded = false;
-  audit_event.record_list.at(0).fields["success"] = "no";
-  audit_event.record_list.at(0).fields["exit"] = std::to_string(-EINPROGRESS);
+  audit_event.record_list.at(0).fields.set("success", "no");
+  audit_event.record_list.at(0).fields.set("exit",
+                                           std::to_string(-EINPROGRESS));
 
   for (const auto& allow_failed_events : {true, false}) {
     std::vector<Row> emitted_row_list;
@@ -168,10 +169,11 @@ TEST_F(SocketEventsTableTests, failed_bind_syscall) {
   auto& syscall_data = boost::get<SyscallAuditEventData>(audit_event.data);
 
   syscall_data.succeeded = false;
-  audit_event.record_list.at(0).fields["success"] = "no";
+  audit_event.record_list.at(0).fields.set("success", "no");
 
   for (const auto& errno_value : {-EINPROGRESS, -EBADF}) {
-    audit_event.record_list.at(0).fields["exit"] = std::to_string(errno_value);
+    audit_event.record_list.at(0).fields.set("exit",
+                                             std::to_string(errno_value));
 
     for (const auto& allow_failed_events : {true, false}) {
       std::vector<Row> emitted_row_list;
@@ -207,8 +209,8 @@ TEST_F(SocketEventsTableTests, succeeded_accept_syscall) {
 
   for (const auto& syscall_number : {__NR_accept, __NR_accept4}) {
     for (const auto& allow_accept_events : {false, true}) {
-      audit_event.record_list.at(0).fields["syscall"] =
-          std::to_string(syscall_number);
+      audit_event.record_list.at(0).fields.set("syscall",
+                                               std::to_string(syscall_number));
 
       syscall_data.syscall_number = syscall_number;
 
@@ -244,13 +246,13 @@ TEST_F(SocketEventsTableTests, failed_accept_syscall) {
   auto& syscall_data = boost::get<SyscallAuditEventData>(audit_event.data);
 
   syscall_data.succeeded = false;
-  audit_event.record_list.at(0).fields["success"] = "no";
-  audit_event.record_list.at(0).fields["exit"] = std::to_string(-EBADF);
+  audit_event.record_list.at(0).fields.set("success", "no");
+  audit_event.record_list.at(0).fields.set("exit", std::to_string(-EBADF));
 
   for (const auto& syscall_number : {__NR_accept, __NR_accept4}) {
     for (const auto& allow_failed_events : {false, true}) {
-      audit_event.record_list.at(0).fields["syscall"] =
-          std::to_string(syscall_number);
+      audit_event.record_list.at(0).fields.set("syscall",
+                                               std::to_string(syscall_number));
 
       syscall_data.syscall_number = syscall_number;
 
@@ -288,21 +290,21 @@ TEST_F(SocketEventsTableTests, succeeded_non_blocking_accept_syscall) {
   for (const auto& syscall_number : {__NR_accept, __NR_accept4}) {
     for (const auto& no_incoming_connection : {true, false}) {
       for (const auto& allow_null_accept_events : {true, false}) {
-        audit_event.record_list.at(0).fields["syscall"] =
-            std::to_string(syscall_number);
+        audit_event.record_list.at(0).fields.set(
+            "syscall", std::to_string(syscall_number));
 
         syscall_data.syscall_number = syscall_number;
 
         if (no_incoming_connection) {
           syscall_data.succeeded = false;
-          audit_event.record_list.at(0).fields["success"] = "no";
-          audit_event.record_list.at(0).fields["exit"] =
-              std::to_string(-EAGAIN);
+          audit_event.record_list.at(0).fields.set("success", "no");
+          audit_event.record_list.at(0).fields.set("exit",
+                                                   std::to_string(-EAGAIN));
 
         } else {
           syscall_data.succeeded = true;
-          audit_event.record_list.at(0).fields["success"] = "yes";
-          audit_event.record_list.at(0).fields["exit"] = "10";
+          audit_event.record_list.at(0).fields.set("success", "yes");
+          audit_event.record_list.at(0).fields.set("exit", "10");
         }
 
         std::vector<Row> emitted_row_list;
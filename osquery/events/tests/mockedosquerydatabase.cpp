@@ -43,20 +43,22 @@ void MockedOsqueryDatabase::generateEvents(const std::string& publisher,
     row.insert({"eid", std::to_string(event_id)});
 
     std::string serialized_row;
-    auto status = serializeRowJSON(row, serialized_row);
-    if (!status.ok()) {
-      throw std::runtime_error(
-          "MockedOsqueryDatabase: Failed to serialize the row");
-    }
+    serializeRowBinary(row, context.column_dictionary, serialized_row);
 
-    auto key = EventSubscriberPlugin::databaseKeyForEventId(context, event_id);
+    auto key =
+        EventSubscriberPlugin::databaseKeyForEventId(context, i, event_id);
     key_map.insert({key, std::move(serialized_row)});
 
-    // this value can't be deserialized and should be skipped
+    // this key can't be parsed and should be skipped
     event_id = EventSubscriberPlugin::generateEventIdentifier(context);
-    key = EventSubscriberPlugin::databaseKeyForEventId(context, event_id);
+    key = "data." + context.database_namespace + ".broken_key_" +
+          std::to_string(event_id);
     key_map.insert({key, "broken_serialized_value"});
   }
+
+  key_map.insert(
+      {EventSubscriberPlugin::databaseKeyForColumnDictionary(context),
+       context.column_dictionary.serialize()});
 }
 
 Status MockedOsqueryDatabase::getDatabaseValue(const std::string& domain,
@@ -155,8 +157,20 @@ Status MockedOsqueryDatabase::deleteDatabaseRange(
     const std::string& domain,
     const std::string& low,
     const std::string& high) const {
-  return Status::failure(
-      "MockedOsqueryDatabase: Unsupported deleteDatabaseRange call");
+  if (domain != kEvents) {
+    throw std::logic_error(
+        "MockedOsqueryDatabase: Invalid domain passed to "
+        "deleteDatabaseRange: " +
+        domain);
+  }
+
+  // Like the database plugins, high is included and the bounds are checked.
+  if (low > high) {
+    return Status::failure("Invalid range: low > high");
+  }
+
+  key_map.erase(key_map.lower_bound(low), key_map.upper_bound(high));
+  return Status::success();
 }
 
 Status MockedOsqueryDatabase::scanDatabaseKeys(const std::string& domain,
@@ -190,4 +204,53 @@ Status MockedOsqueryDatabase::scanDatabaseKeys(const std::string& domain,
   return Status::success();
 }
 
+Status MockedOsqueryDatabase::scanDatabaseRange(
+    const std::string& domain,
+    const std::string& low,
+    const std::string& high,
+    DatabaseStringValueList& results,
+    size_t max) const {
+  if (domain != kEvents) {
+    throw std::logic_error(
+        "MockedOsqueryDatabase: Invalid domain passed to scanDatabaseRange: " +
+        domain);
+  }
+
+  if (fail_scans) {
+    return Status::failure("MockedOsqueryDatabase: Failed scanDatabaseRange");
+  }
+
+  for (auto it = key_map.lower_bound(low);
+       it != key_map.end() && it->first <= high;
+       ++it) {
+    results.push_back(*it);
+    if (max > 0 && results.size() >= max) {
+      break;
+    }
+  }
+
+  return Status::success();
+}
+
+Status MockedOsqueryDatabase::getDatabaseRangeSize(const std::string& domain,
+                                                   const std::string& low,
+                                                   const std::string& high,
+                                                   uint64_t& size) const {
+  size = 0;
+  for (auto it = key_map.lower_bound(low);
+       it != key_map.end() && it->first <= high;
+       ++it) {
+    size += it->first.size() + it->second.size();
+  }
+
+  return Status::success();
+}
+
+Status MockedOsqueryDatabase::compactDatabaseRange(
+    const std::string& domain,
+    const std::string& low,
+    const std::string& high) const {
+  return Status::success();
+}
+
 } // namespace osquery
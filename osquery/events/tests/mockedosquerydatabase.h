@@ -17,6 +17,9 @@ class MockedOsqueryDatabase final : public IDatabaseInterface {
  public:
   mutable std::map<std::string, std::string> key_map;
 
+  /// Fail the range scans, as a database error would.
+  bool fail_scans{false};
+
   MockedOsqueryDatabase() = default;
   virtual ~MockedOsqueryDatabase() override = default;
 
@@ -57,6 +60,21 @@ class MockedOsqueryDatabase final : public IDatabaseInterface {
                                   std::vector<std::string>& keys,
                                   const std::string& prefix,
                                   size_t max) const override;
+
+  virtual Status scanDatabaseRange(const std::string& domain,
+                                   const std::string& low,
+                                   const std::string& high,
+                                   DatabaseStringValueList& results,
+                                   size_t max) const override;
+
+  virtual Status getDatabaseRangeSize(const std::string& domain,
+                                      const std::string& low,
+                                      const std::string& high,
+                                      uint64_t& size) const override;
+
+  virtual Status compactDatabaseRange(const std::string& domain,
+                                      const std::string& low,
+                                      const std::string& high) const override;
 };
 
 } // namespace osquery
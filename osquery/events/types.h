@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <map>
 #include <memory>
 #include <string>
@@ -25,6 +26,9 @@ using EventID = std::uint64_t;
 using EventIDList = std::vector<EventID>;
 using EventIndex = std::map<EventTime, EventIDList>;
 
+/// Monotonic clock used to measure how long events wait before being stored.
+using EventClock = std::chrono::steady_clock;
+
 /**
  * @brief An EventSubscriber EventCallback method will receive an EventContext.
  *
@@ -41,6 +45,9 @@ struct EventContext : private boost::noncopyable {
 
   /// The time the event occurred, as determined by the publisher.
   EventTime time{0};
+
+  /// When the publisher received the event, set to the fire time if empty.
+  EventClock::time_point received_time{};
 };
 
 using EventContextRef = std::shared_ptr<EventContext>;
@@ -9,6 +9,8 @@
 
 #include <osquery/utils/system/system.h>
 
+#include <algorithm>
+
 // This define is required for Windows static linking of libarchive
 #define LIBARCHIVE_STATIC
 #include <archive.h>
@@ -161,43 +163,178 @@ Status decompress(const boost::filesystem::path& in,
   return Status(0);
 }
 
-Status archive(const std::set<boost::filesystem::path>& paths,
-               const boost::filesystem::path& out,
+namespace {
+
+/// State of the libarchive write callback for a streamed archive.
+struct ArchiveStream {
+  explicit ArchiveStream(const ArchiveWriter& w) : writer(w) {}
+
+  const ArchiveWriter& writer;
+
+  /// Optional compression stream, applied before the writer.
+  ZSTD_CStream* cstream{nullptr};
+
+  /// Compression output buffer.
+  std::vector<char> out;
+
+  /// Reason the stream was stopped.
+  std::string error;
+};
+
+la_ssize_t archiveStreamWrite(struct archive* /* arch */,
+                              void* client_data,
+                              const void* buffer,
+                              size_t length) {
+  auto stream = static_cast<ArchiveStream*>(client_data);
+  if (stream->cstream == nullptr) {
+    if (!stream->writer(buffer, length)) {
+      stream->error = "Archive writer failed";
+      return -1;
+    }
+    return static_cast<la_ssize_t>(length);
+  }
+
+  ZSTD_inBuffer input = {buffer, length, 0};
+  while (input.pos < input.size) {
+    ZSTD_outBuffer output = {stream->out.data(), stream->out.size(), 0};
+    auto ret = ZSTD_compressStream(stream->cstream, &output, &input);
+    if (ZSTD_isError(ret)) {
+      stream->error = "ZSTD_compressStream() error : " +
+                      std::string(ZSTD_getErrorName(ret));
+      return -1;
+    }
+    if (output.pos > 0 && !stream->writer(stream->out.data(), output.pos)) {
+      stream->error = "Archive writer failed";
+      return -1;
+    }
+  }
+  return static_cast<la_ssize_t>(length);
+}
+
+/// Flush the end of the compression stream to the writer.
+Status finishArchiveStream(ArchiveStream& stream) {
+  size_t remaining = 0;
+  do {
+    ZSTD_outBuffer output = {stream.out.data(), stream.out.size(), 0};
+    remaining = ZSTD_endStream(stream.cstream, &output);
+    if (ZSTD_isError(remaining)) {
+      return Status(1,
+                    "ZSTD_endStream() error : " +
+                        std::string(ZSTD_getErrorName(remaining)));
+    }
+    if (output.pos > 0 && !stream.writer(stream.out.data(), output.pos)) {
+      return Status(1, "Archive writer failed");
+    }
+  } while (remaining > 0);
+  return Status::success();
+}
+
+Status writeArchiveEntries(
+    struct archive* arch,
+    const std::map<std::string, boost::filesystem::path>& entries,
+    std::size_t block_size) {
+  std::vector<char> block(block_size, 0);
+  for (const auto& entry : entries) {
+    PlatformFile pFile(entry.second, PF_OPEN_EXISTING | PF_READ);
+    if (!pFile.isValid()) {
+      continue;
+    }
+
+    // The entry size is fixed by the header, read at most that many bytes.
+    // If the file shrinks while it is read the entry is padded with zeros.
+    auto size = static_cast<size_t>(pFile.size());
+    auto header = archive_entry_new();
+    archive_entry_set_pathname(header, entry.first.c_str());
+    archive_entry_set_size(header, size);
+    archive_entry_set_filetype(header, AE_IFREG);
+    archive_entry_set_perm(header, 0644);
+    auto ret = archive_write_header(arch, header);
+    archive_entry_free(header);
+    if (ret < ARCHIVE_WARN) {
+      return Status(1, "Failed to write tar header for " + entry.first);
+    }
+
+    while (size > 0) {
+      auto r = pFile.read(block.data(), std::min(block_size, size));
+      if (r <= 0) {
+        break;
+      }
+      if (archive_write_data(arch, block.data(), static_cast<size_t>(r)) < 0) {
+        return Status(1, "Failed to write tar data for " + entry.first);
+      }
+      size -= static_cast<size_t>(r);
+    }
+  }
+  return Status::success();
+}
+
+} // namespace
+
+Status archive(const std::map<std::string, boost::filesystem::path>& entries,
+               const ArchiveWriter& writer,
+               bool compress,
                std::size_t block_size) {
+  ArchiveStream stream(writer);
+  if (compress) {
+    stream.cstream = ZSTD_createCStream();
+    if (stream.cstream == nullptr) {
+      return Status(1, "Couldn't create compression stream");
+    }
+
+    if (ZSTD_isError(ZSTD_initCStream(stream.cstream, 1))) {
+      ZSTD_freeCStream(stream.cstream);
+      return Status(1, "Couldn't initialize compression stream");
+    }
+    stream.out.resize(ZSTD_CStreamOutSize());
+  }
+
   auto arch = archive_write_new();
   if (arch == nullptr) {
+    ZSTD_freeCStream(stream.cstream);
     return Status(1, "Failed to create tar archive");
   }
+
   archive_write_set_format_pax_restricted(arch);
-  auto ret = archive_write_open_filename(arch, out.string().c_str());
+  auto ret =
+      archive_write_open(arch, &stream, nullptr, archiveStreamWrite, nullptr);
   if (ret == ARCHIVE_FATAL) {
     archive_write_free(arch);
+    ZSTD_freeCStream(stream.cstream);
     return Status(1, "Failed to open tar archive for writing");
   }
-  for (const auto& f : paths) {
-    PlatformFile pFile(f, PF_OPEN_EXISTING | PF_READ);
-
-    auto entry = archive_entry_new();
-    archive_entry_set_pathname(entry, f.string().c_str());
-    archive_entry_set_size(entry, pFile.size());
-    archive_entry_set_filetype(entry, AE_IFREG);
-    archive_entry_set_perm(entry, 0644);
-    archive_write_header(arch, entry);
-
-    auto blkCount = static_cast<size_t>(ceil(static_cast<double>(pFile.size()) /
-                                             static_cast<double>(block_size)));
-    for (size_t i = 0; i < blkCount; i++) {
-      std::vector<char> block(block_size, 0);
-      auto r = pFile.read(block.data(), block_size);
-      if (r > 0 && static_cast<std::size_t>(r) != block_size) {
-        // resize the buffer to size we read as last block is likely smaller
-        block.resize(static_cast<std::size_t>(r));
-      }
-      archive_write_data(arch, block.data(), block.size());
-    }
-    archive_entry_free(entry);
+
+  auto status = writeArchiveEntries(arch, entries, block_size);
+  if (archive_write_close(arch) != ARCHIVE_OK && status.ok()) {
+    status = Status(1, "Failed to close tar archive: " + stream.error);
   }
   archive_write_free(arch);
-  return Status::success();
+
+  if (status.ok() && stream.cstream != nullptr) {
+    status = finishArchiveStream(stream);
+  }
+  ZSTD_freeCStream(stream.cstream);
+  return status;
+}
+
+Status archive(const std::set<boost::filesystem::path>& paths,
+               const boost::filesystem::path& out,
+               std::size_t block_size) {
+  PlatformFile outFile(out, PF_CREATE_ALWAYS | PF_WRITE);
+  if (!outFile.isValid()) {
+    return Status(1, "Failed to open tar archive for writing");
+  }
+
+  std::map<std::string, boost::filesystem::path> entries;
+  for (const auto& path : paths) {
+    entries[path.string()] = path;
+  }
+
+  return archive(
+      entries,
+      [&outFile](const void* data, size_t size) {
+        return outFile.write(data, size) == static_cast<ssize_t>(size);
+      },
+      false,
+      block_size);
 };
 } // namespace osquery
@@ -11,6 +11,7 @@
 
 #include <osquery/filesystem/fileops.h>
 
+#include <functional>
 #include <map>
 #include <set>
 #include <string>
@@ -378,6 +379,27 @@ Status readRawMem(size_t base, size_t length, void** buffer);
 Status archive(const std::set<boost::filesystem::path>& path,
                const boost::filesystem::path& out, std::size_t block_size = 8192);
 
+/// Receives the output of a streamed archive, returns false to stop.
+using ArchiveWriter = std::function<bool(const void* data, size_t size)>;
+
+/*
+ * @brief A function to stream files into a tar archive, in a single pass
+ *
+ * Each file is read once, a block at a time, and the tar framing and the
+ * optional zstd compression are applied as the archive is passed to writer.
+ * No temporary files are used and memory is bounded by the block size.
+ *
+ * @param entries The archive entry names mapped to the files to read
+ * @param writer Receives the archive (or compressed archive) in order
+ * @param compress Set true to compress the archive with zstd
+ * @param block_size The size of reads from each file
+ * @return A status containing the success or failure of the operation
+ */
+Status archive(const std::map<std::string, boost::filesystem::path>& entries,
+               const ArchiveWriter& writer,
+               bool compress,
+               std::size_t block_size = 8192);
+
 /*
  * @brief Given a path, compress it with zstd and save to out.
  *
@@ -0,0 +1,162 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include <osquery/filesystem/linux/proc_enumerator.h>
+#include <osquery/filesystem/linux/proc_reader.h>
+
+namespace fs = boost::filesystem;
+
+namespace osquery {
+namespace {
+
+const std::size_t kSyntheticProcessCount{4096U};
+const std::size_t kSyntheticDescriptorCount{16U};
+
+/// A fake procfs tree, holding the files read by the process tables
+class SyntheticProcTree final {
+ public:
+  SyntheticProcTree()
+      : root_(fs::temp_directory_path() /
+              fs::unique_path("osquery-proc-%%%%-%%%%")) {
+    for (std::size_t pid = 1U; pid <= kSyntheticProcessCount; ++pid) {
+      auto name = std::to_string(pid);
+      auto process_path = root_ / name;
+      fs::create_directories(process_path / "fd");
+
+      writeFile(process_path / "stat",
+                name + " (worker) S 1 " + name + " " + name +
+                    " 0 -1 4194560 1024 0 0 0 12 34 0 0 20 0 1 0 5678 "
+                    "12345678 1024 18446744073709551615 1 1 0 0 0 0 0 0 0 0 "
+                    "0 0 17 3 0 0 0 0 0\n");
+      writeFile(process_path / "status",
+                "Name:\tworker\nUmask:\t0022\nState:\tS (sleeping)\n"
+                "Tgid:\t" +
+                    name + "\nPid:\t" + name +
+                    "\nPPid:\t1\nUid:\t1000\t1000\t1000\t1000\n"
+                    "Gid:\t1000\t1000\t1000\t1000\nVmSize:\t   12345 kB\n"
+                    "VmRSS:\t    1024 kB\nThreads:\t1\n");
+      writeFile(process_path / "cmdline",
+                std::string("/usr/bin/worker\0--id\0", 22) + name);
+      writeFile(process_path / "io",
+                "rchar: 1234\nwchar: 5678\nsyscr: 12\nsyscw: 34\n"
+                "read_bytes: 4096\nwrite_bytes: 8192\n"
+                "cancelled_write_bytes: 0\n");
+
+      for (std::size_t fd = 0U; fd < kSyntheticDescriptorCount; ++fd) {
+        fs::create_symlink("socket:[" + std::to_string(pid * 100U + fd) + "]",
+                           process_path / "fd" / std::to_string(fd));
+      }
+
+      pid_list_.insert(name);
+    }
+  }
+
+  ~SyntheticProcTree() {
+    boost::system::error_code error;
+    fs::remove_all(root_, error);
+  }
+
+  std::string root() const {
+    return root_.string();
+  }
+
+  const std::set<std::string>& pidList() const {
+    return pid_list_;
+  }
+
+ private:
+  static void writeFile(const fs::path& path, const std::string& content) {
+    fs::ofstream stream(path, std::ios::binary);
+    stream << content;
+  }
+
+  fs::path root_;
+  std::set<std::string> pid_list_;
+};
+
+const SyntheticProcTree& getSyntheticProcTree() {
+  static const SyntheticProcTree tree;
+  return tree;
+}
+
+/// Reads the same files as the processes and process_open_files tables
+void readSyntheticProcess(const std::string& root,
+                          const std::string& pid,
+                          std::size_t& field_count) {
+  ProcReader reader(root, pid);
+  if (!reader.isOpen()) {
+    return;
+  }
+
+  std::vector<std::string_view> field_list;
+  std::string_view content;
+  if (reader.read("stat", content).ok()) {
+    procSplitFields(content, field_list);
+    field_count += field_list.size();
+  }
+
+  for (auto name : {"status", "io"}) {
+    if (!reader.read(name, content).ok()) {
+      continue;
+    }
+
+    std::string_view line;
+    std::string_view key;
+    std::string_view value;
+    while (procNextLine(content, line)) {
+      if (procSplitKeyValue(line, key, value)) {
+        ++field_count;
+      }
+    }
+  }
+
+  if (reader.read("cmdline", content).ok()) {
+    ++field_count;
+  }
+
+  std::map<std::string, std::string> descriptors;
+  if (reader.getDescriptors(descriptors).ok()) {
+    field_count += descriptors.size();
+  }
+}
+
+} // namespace
+
+static void PROC_enumerate_synthetic(benchmark::State& state) {
+  const auto& tree = getSyntheticProcTree();
+  auto root = tree.root();
+  auto thread_count = static_cast<std::size_t>(state.range(0));
+
+  while (state.KeepRunning()) {
+    auto shard_list = procEnumerateShards<std::size_t>(
+        tree.pidList(),
+        thread_count,
+        [&root](const std::string& pid, std::size_t& field_count) {
+          readSyntheticProcess(root, pid, field_count);
+        });
+
+    benchmark::DoNotOptimize(shard_list);
+  }
+
+  state.SetItemsProcessed(state.iterations() * tree.pidList().size());
+}
+
+BENCHMARK(PROC_enumerate_synthetic)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->UseRealTime();
+
+} // namespace osquery
@@ -24,6 +24,9 @@
 namespace osquery {
 const std::string kLinuxProcPath = "/proc";
 
+/// Names of the namespaces found under /proc/<pid>/ns
+extern const std::vector<std::string> kUserNamespaceList;
+
 struct SocketInfo final {
   std::string socket;
   ino_t net_ns;
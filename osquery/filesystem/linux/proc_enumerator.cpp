@@ -0,0 +1,53 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <algorithm>
+#include <thread>
+
+#include <osquery/core/flags.h>
+#include <osquery/filesystem/linux/proc_enumerator.h>
+
+namespace osquery {
+
+FLAG(uint32,
+     proc_enumeration_threads,
+     1,
+     "Number of threads the process tables use to read /proc (1 disables)");
+
+namespace {
+
+/// Smaller shards cost more in thread startup than they save
+const std::size_t kProcMinShardSize{64U};
+
+} // namespace
+
+std::size_t procGetEnumerationThreadCount() {
+  return procGetEnumerationThreadCount(std::thread::hardware_concurrency());
+}
+
+std::size_t procGetEnumerationThreadCount(std::size_t cpu_count) {
+  std::size_t thread_count = FLAGS_proc_enumeration_threads;
+  if (thread_count <= 1U) {
+    return 1U;
+  }
+
+  if (cpu_count != 0U) {
+    thread_count = std::min(thread_count, cpu_count);
+  }
+
+  return thread_count;
+}
+
+std::size_t procGetShardCount(std::size_t pid_count,
+                              std::size_t thread_count) {
+  auto shard_count = std::min(thread_count, pid_count / kProcMinShardSize);
+  return std::max<std::size_t>(shard_count, 1U);
+}
+
+} // namespace osquery
@@ -0,0 +1,91 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <osquery/utils/system/worker_pool.h>
+
+namespace osquery {
+
+/**
+ * @brief Returns how many threads the process tables may use to read /proc
+ *
+ * This is the value of --proc_enumeration_threads, capped by the number of
+ * CPUs. The watchdog does not lower it: it measures the CPU time the worker
+ * uses over its check interval, and reading /proc costs the same CPU time
+ * whether it is spread across threads or not.
+ */
+std::size_t procGetEnumerationThreadCount();
+
+/// Same as above for a given number of CPUs, 0 if it is unknown
+std::size_t procGetEnumerationThreadCount(std::size_t cpu_count);
+
+/// Returns how many shards a list of pid_count pids should be split into
+std::size_t procGetShardCount(std::size_t pid_count, std::size_t thread_count);
+
+/**
+ * @brief Calls the callback for every pid, spreading the pids across threads
+ *
+ * The pid list is split into contiguous shards, and each shard fills its own
+ * result so that the callback does not need any locking. The shard results are
+ * returned in the order of the pid list: appending them one after the other
+ * yields what a sequential enumeration would have produced. The shards run on
+ * the shared WorkerPool, the calling thread included.
+ *
+ * The callback is invoked as callback(pid, result) and must be safe to call
+ * from several threads at once.
+ */
+template <typename Result, typename Callback>
+std::vector<Result> procEnumerateShards(const std::set<std::string>& pid_list,
+                                        std::size_t thread_count,
+                                        const Callback& callback) {
+  using PidRange = std::pair<std::set<std::string>::const_iterator,
+                             std::set<std::string>::const_iterator>;
+
+  auto shard_count = procGetShardCount(pid_list.size(), thread_count);
+
+  std::vector<PidRange> range_list;
+  auto range_begin = pid_list.begin();
+  for (std::size_t i = 0; i < shard_count; ++i) {
+    // The first shards take the remainder, one pid each
+    auto range_size = pid_list.size() / shard_count +
+                      (i < pid_list.size() % shard_count ? 1U : 0U);
+
+    auto range_end = std::next(range_begin, range_size);
+    range_list.emplace_back(range_begin, range_end);
+    range_begin = range_end;
+  }
+
+  auto enumerate_shard = [&callback](const PidRange& range) -> Result {
+    Result result{};
+    for (auto it = range.first; it != range.second; ++it) {
+      callback(*it, result);
+    }
+
+    return result;
+  };
+
+  std::vector<Result> result_list(range_list.size());
+  WorkerPool::instance().run(
+      range_list.size(),
+      [&enumerate_shard, &range_list, &result_list](std::size_t i) {
+        result_list[i] = enumerate_shard(range_list[i]);
+      });
+
+  return result_list;
+}
+
+} // namespace osquery
@@ -0,0 +1,229 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <cerrno>
+#include <cstring>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/limits.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <osquery/filesystem/linux/proc.h>
+#include <osquery/filesystem/linux/proc_reader.h>
+#include <osquery/utils/conversions/trim.h>
+
+namespace osquery {
+
+namespace {
+
+/// Initial size of the per-thread read buffer
+const std::size_t kProcReaderBufferSize{4096U};
+
+/// Buffers grown past this size (e.g. by a large maps file) are released
+const std::size_t kProcReaderMaxRetainedSize{1024U * 1024U};
+
+const char* kProcFieldSeparators{" \t\n"};
+
+std::string& getProcReaderBuffer() {
+  static thread_local std::string buffer;
+
+  if (buffer.size() < kProcReaderBufferSize ||
+      buffer.size() > kProcReaderMaxRetainedSize) {
+    std::string(kProcReaderBufferSize, '\0').swap(buffer);
+  }
+
+  return buffer;
+}
+
+Status readLinkAt(int dir_fd, const char* name, std::string& target) {
+  char buffer[PATH_MAX];
+
+  auto size = readlinkat(dir_fd, name, buffer, sizeof(buffer));
+  if (size < 0) {
+    return Status::failure("Could not call readlinkat on " +
+                           std::string(name) + ": " +
+                           std::string(std::strerror(errno)));
+  }
+
+  // Same as readlink(2), longer targets are truncated
+  target.assign(buffer, static_cast<std::size_t>(size));
+  return Status::success();
+}
+
+} // namespace
+
+ProcReader::ProcReader(const std::string& pid)
+    : ProcReader(kLinuxProcPath, pid) {}
+
+ProcReader::ProcReader(const std::string& proc_path, const std::string& pid)
+    : pid_(pid), path_(proc_path + "/" + pid) {
+  fd_ = ::open(path_.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+ProcReader::~ProcReader() {
+  if (fd_ != -1) {
+    ::close(fd_);
+  }
+}
+
+bool ProcReader::isOpen() const {
+  return fd_ != -1;
+}
+
+const std::string& ProcReader::pid() const {
+  return pid_;
+}
+
+Status ProcReader::read(const char* name, std::string_view& content) const {
+  content = {};
+
+  auto file_fd = openat(fd_, name, O_RDONLY | O_CLOEXEC);
+  if (file_fd == -1) {
+    return Status::failure("Cannot open " + path_ + "/" + name + ": " +
+                           std::string(std::strerror(errno)));
+  }
+
+  // Files under /proc report a size of 0, so read until the end of the file
+  auto& buffer = getProcReaderBuffer();
+  std::size_t size{0U};
+
+  for (;;) {
+    if (size == buffer.size()) {
+      buffer.resize(buffer.size() * 2U);
+    }
+
+    auto bytes_read = ::read(file_fd, &buffer[size], buffer.size() - size);
+    if (bytes_read == 0) {
+      break;
+
+    } else if (bytes_read < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      auto error = errno;
+      ::close(file_fd);
+
+      return Status::failure("Cannot read " + path_ + "/" + name + ": " +
+                             std::string(std::strerror(error)));
+    }
+
+    size += static_cast<std::size_t>(bytes_read);
+  }
+
+  ::close(file_fd);
+
+  content = std::string_view(buffer.data(), size);
+  return Status::success();
+}
+
+Status ProcReader::readLink(const char* name, std::string& target) const {
+  target.clear();
+  return readLinkAt(fd_, name, target);
+}
+
+Status ProcReader::getInode(const char* name, ino_t& inode) const {
+  inode = 0;
+
+  struct stat file_stat;
+  if (fstatat(fd_, name, &file_stat, 0) != 0) {
+    return Status::failure("Cannot stat " + path_ + "/" + name + ": " +
+                           std::string(std::strerror(errno)));
+  }
+
+  inode = file_stat.st_ino;
+  return Status::success();
+}
+
+Status ProcReader::getDescriptors(
+    std::map<std::string, std::string>& descriptors) const {
+  auto dir_fd = openat(fd_, "fd", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dir_fd == -1) {
+    return Status::failure("Cannot open " + path_ +
+                           "/fd: " + std::string(std::strerror(errno)));
+  }
+
+  // The directory stream takes ownership of the descriptor
+  auto dir = fdopendir(dir_fd);
+  if (dir == nullptr) {
+    ::close(dir_fd);
+    return Status::failure("Cannot list " + path_ + "/fd");
+  }
+
+  for (auto entry = readdir(dir); entry != nullptr; entry = readdir(dir)) {
+    if (entry->d_name[0] == '.') {
+      continue;
+    }
+
+    std::string link;
+    auto status = readLinkAt(dir_fd, entry->d_name, link);
+    if (!status.ok()) {
+      // Likely because the file descriptor was closed before readlink.
+      continue;
+    }
+
+    descriptors[entry->d_name] = std::move(link);
+  }
+
+  closedir(dir);
+  return Status::success();
+}
+
+bool procNextLine(std::string_view& content, std::string_view& line) {
+  if (content.empty()) {
+    return false;
+  }
+
+  auto line_end = content.find('\n');
+  if (line_end == std::string_view::npos) {
+    line = content;
+    content = {};
+
+  } else {
+    line = content.substr(0, line_end);
+    content.remove_prefix(line_end + 1U);
+  }
+
+  return true;
+}
+
+bool procSplitKeyValue(std::string_view line,
+                       std::string_view& key,
+                       std::string_view& value) {
+  auto separator = line.find(':');
+  if (separator == std::string_view::npos) {
+    return false;
+  }
+
+  key = trim(line.substr(0, separator));
+  value = trim(line.substr(separator + 1U));
+
+  return !key.empty();
+}
+
+void procSplitFields(std::string_view line,
+                     std::vector<std::string_view>& field_list) {
+  field_list.clear();
+
+  auto field_start = line.find_first_not_of(kProcFieldSeparators);
+  while (field_start != std::string_view::npos) {
+    auto field_end = line.find_first_of(kProcFieldSeparators, field_start);
+    field_list.push_back(line.substr(field_start, field_end - field_start));
+
+    if (field_end == std::string_view::npos) {
+      break;
+    }
+
+    field_start = line.find_first_not_of(kProcFieldSeparators, field_end);
+  }
+}
+
+} // namespace osquery
@@ -0,0 +1,83 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sys/types.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <osquery/utils/status/status.h>
+
+namespace osquery {
+
+/**
+ * @brief Reads the files of a single /proc/<pid> directory
+ *
+ * The process directory is opened once, and every file below it is opened
+ * relative to it with openat. This avoids building and resolving a full
+ * path for each file, and guarantees that all the files belong to the same
+ * process even if its pid gets reused in the meantime.
+ *
+ * File contents are read into a thread-local buffer that keeps its capacity
+ * across reads, so parsing the files of many processes does not allocate.
+ */
+class ProcReader final : private boost::noncopyable {
+ public:
+  /// Opens /proc/<pid>; use isOpen() to know if the process still exists
+  explicit ProcReader(const std::string& pid);
+
+  /// Opens <proc_path>/<pid>, for procfs trees mounted somewhere else
+  ProcReader(const std::string& proc_path, const std::string& pid);
+  ~ProcReader();
+
+  bool isOpen() const;
+
+  const std::string& pid() const;
+
+  /// Reads a file, such as "status"; the content remains valid until the
+  /// next read made on this thread, by any reader
+  Status read(const char* name, std::string_view& content) const;
+
+  /// Reads the target of a symbolic link, such as "exe"
+  Status readLink(const char* name, std::string& target) const;
+
+  /// Returns the inode number of a file, such as "ns/net"
+  Status getInode(const char* name, ino_t& inode) const;
+
+  /// Lists the open file descriptors of the process, with their targets
+  Status getDescriptors(std::map<std::string, std::string>& descriptors) const;
+
+ private:
+  std::string pid_;
+
+  /// The process directory, used in error messages
+  std::string path_;
+
+  int fd_{-1};
+};
+
+/// Moves the first line of content into line; returns false at the end
+bool procNextLine(std::string_view& content, std::string_view& line);
+
+/// Splits a "Key:\tValue" line, as found in the status and io files
+bool procSplitKeyValue(std::string_view line,
+                       std::string_view& key,
+                       std::string_view& value);
+
+/// Splits a line on whitespace, reusing the capacity of the field list
+void procSplitFields(std::string_view line,
+                     std::vector<std::string_view>& field_list);
+
+} // namespace osquery
@@ -0,0 +1,89 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <gtest/gtest.h>
+
+#include <osquery/core/flags.h>
+#include <osquery/core/watcher.h>
+#include <osquery/filesystem/linux/proc_enumerator.h>
+#include <osquery/utils/scope_guard.h>
+
+namespace osquery {
+
+DECLARE_uint32(proc_enumeration_threads);
+
+namespace {
+
+class ProcEnumeratorTests : public testing::Test {};
+
+TEST_F(ProcEnumeratorTests, test_shard_count) {
+  EXPECT_EQ(procGetShardCount(0U, 4U), 1U);
+  EXPECT_EQ(procGetShardCount(1000U, 0U), 1U);
+  EXPECT_EQ(procGetShardCount(1000U, 1U), 1U);
+  EXPECT_EQ(procGetShardCount(1000U, 4U), 4U);
+
+  // Small pid lists are not worth the threads
+  EXPECT_EQ(procGetShardCount(10U, 4U), 1U);
+  EXPECT_EQ(procGetShardCount(130U, 4U), 2U);
+}
+
+TEST_F(ProcEnumeratorTests, test_thread_count) {
+  auto const thread_count = FLAGS_proc_enumeration_threads;
+  auto const guard = scope_guard::create(
+      [thread_count]() { FLAGS_proc_enumeration_threads = thread_count; });
+
+  // Threads are opt-in
+  FLAGS_proc_enumeration_threads = 1U;
+  EXPECT_EQ(procGetEnumerationThreadCount(8U), 1U);
+
+  // The default watchdog does not undo the opt-in
+  ASSERT_FALSE(FLAGS_disable_watchdog);
+  ASSERT_EQ(FLAGS_watchdog_level, 0);
+  FLAGS_proc_enumeration_threads = 4U;
+  EXPECT_EQ(procGetEnumerationThreadCount(8U), 4U);
+  EXPECT_EQ(procGetShardCount(1000U, procGetEnumerationThreadCount(8U)), 4U);
+
+  // Capped by the number of CPUs, when it is known
+  EXPECT_EQ(procGetEnumerationThreadCount(2U), 2U);
+  EXPECT_EQ(procGetEnumerationThreadCount(0U), 4U);
+}
+
+TEST_F(ProcEnumeratorTests, test_enumerate_shards) {
+  std::set<std::string> pid_list;
+  for (int pid = 1; pid <= 1000; ++pid) {
+    pid_list.insert(std::to_string(pid));
+  }
+
+  auto callback = [](const std::string& pid, std::vector<std::string>& result) {
+    result.push_back(pid);
+  };
+
+  for (std::size_t thread_count : {1U, 3U, 8U}) {
+    auto shard_list = procEnumerateShards<std::vector<std::string>>(
+        pid_list, thread_count, callback);
+    EXPECT_EQ(shard_list.size(), thread_count);
+
+    // Merging the shards gives back the pid list, in order
+    std::vector<std::string> merged_list;
+    for (const auto& shard : shard_list) {
+      merged_list.insert(merged_list.end(), shard.begin(), shard.end());
+    }
+
+    EXPECT_EQ(merged_list,
+              std::vector<std::string>(pid_list.begin(), pid_list.end()));
+  }
+
+  auto shard_list = procEnumerateShards<std::vector<std::string>>(
+      std::set<std::string>(), 4U, callback);
+  ASSERT_EQ(shard_list.size(), 1U);
+  EXPECT_TRUE(shard_list[0].empty());
+}
+
+} // namespace
+} // namespace osquery
@@ -0,0 +1,150 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include <osquery/filesystem/linux/proc_reader.h>
+
+namespace osquery {
+namespace {
+
+class ProcReaderTests : public testing::Test {};
+
+TEST_F(ProcReaderTests, test_next_line) {
+  std::string_view content = "Name:\tosqueryd\nUmask:\t0022\n\nState";
+  std::string_view line;
+
+  ASSERT_TRUE(procNextLine(content, line));
+  EXPECT_EQ(line, "Name:\tosqueryd");
+  ASSERT_TRUE(procNextLine(content, line));
+  EXPECT_EQ(line, "Umask:\t0022");
+  ASSERT_TRUE(procNextLine(content, line));
+  EXPECT_TRUE(line.empty());
+  ASSERT_TRUE(procNextLine(content, line));
+  EXPECT_EQ(line, "State");
+  EXPECT_FALSE(procNextLine(content, line));
+}
+
+TEST_F(ProcReaderTests, test_split_key_value) {
+  std::string_view key;
+  std::string_view value;
+
+  ASSERT_TRUE(procSplitKeyValue("VmRSS:\t    1234 kB", key, value));
+  EXPECT_EQ(key, "VmRSS");
+  EXPECT_EQ(value, "1234 kB");
+
+  // Only the first colon separates the key from the value
+  ASSERT_TRUE(procSplitKeyValue("Name:\ta:b", key, value));
+  EXPECT_EQ(key, "Name");
+  EXPECT_EQ(value, "a:b");
+
+  ASSERT_TRUE(procSplitKeyValue("read_bytes: 0", key, value));
+  EXPECT_EQ(value, "0");
+
+  EXPECT_FALSE(procSplitKeyValue("no separator", key, value));
+  EXPECT_FALSE(procSplitKeyValue(": no key", key, value));
+}
+
+TEST_F(ProcReaderTests, test_split_fields) {
+  std::vector<std::string_view> field_list;
+
+  procSplitFields("1000\t1000\t1001\t1000", field_list);
+  ASSERT_EQ(field_list.size(), 4U);
+  EXPECT_EQ(field_list[2], "1001");
+
+  procSplitFields(
+      "7f0c5e5d1000-7f0c5e5f3000 r-xp 00000000 fd:00 1234     /usr/lib/x.so\n",
+      field_list);
+  ASSERT_EQ(field_list.size(), 6U);
+  EXPECT_EQ(field_list[0], "7f0c5e5d1000-7f0c5e5f3000");
+  EXPECT_EQ(field_list[5], "/usr/lib/x.so");
+
+  procSplitFields("   ", field_list);
+  EXPECT_TRUE(field_list.empty());
+}
+
+TEST_F(ProcReaderTests, test_read_self) {
+  ProcReader reader(std::to_string(getpid()));
+  ASSERT_TRUE(reader.isOpen());
+
+  std::string_view content;
+  ASSERT_TRUE(reader.read("stat", content).ok());
+  EXPECT_EQ(content.substr(0, content.find(' ')), reader.pid());
+
+  // Files are read up to their end, whatever their size
+  ASSERT_TRUE(reader.read("maps", content).ok());
+  EXPECT_FALSE(content.empty());
+  EXPECT_EQ(content.back(), '\n');
+
+  EXPECT_FALSE(reader.read("missing", content).ok());
+  EXPECT_TRUE(content.empty());
+
+  std::string target;
+  EXPECT_TRUE(reader.readLink("exe", target).ok());
+  EXPECT_FALSE(target.empty());
+
+  ino_t inode{0};
+  EXPECT_TRUE(reader.getInode("ns/net", inode).ok());
+  EXPECT_NE(inode, 0U);
+}
+
+TEST_F(ProcReaderTests, test_get_descriptors) {
+  auto fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+  ASSERT_NE(fd, -1);
+
+  ProcReader reader(std::to_string(getpid()));
+
+  std::map<std::string, std::string> descriptors;
+  EXPECT_TRUE(reader.getDescriptors(descriptors).ok());
+  close(fd);
+
+  auto descriptor_it = descriptors.find(std::to_string(fd));
+  ASSERT_NE(descriptor_it, descriptors.end());
+  EXPECT_EQ(descriptor_it->second, "/dev/null");
+}
+
+TEST_F(ProcReaderTests, test_read_from_root) {
+  char root[] = "/tmp/osquery-proc-reader-XXXXXX";
+  ASSERT_NE(mkdtemp(root), nullptr);
+
+  auto process_path = std::string(root) + "/42";
+  ASSERT_EQ(mkdir(process_path.c_str(), 0700), 0);
+
+  auto stat_path = process_path + "/stat";
+  auto stat_fd = open(stat_path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
+  ASSERT_NE(stat_fd, -1);
+  ASSERT_EQ(write(stat_fd, "42 (init) S 0", 13), 13);
+  close(stat_fd);
+
+  ProcReader reader(root, "42");
+  ASSERT_TRUE(reader.isOpen());
+
+  std::string_view content;
+  ASSERT_TRUE(reader.read("stat", content).ok());
+  EXPECT_EQ(content, "42 (init) S 0");
+
+  unlink(stat_path.c_str());
+  rmdir(process_path.c_str());
+  rmdir(root);
+}
+
+TEST_F(ProcReaderTests, test_missing_process) {
+  ProcReader reader("-1");
+  EXPECT_FALSE(reader.isOpen());
+
+  std::string_view content;
+  EXPECT_FALSE(reader.read("stat", content).ok());
+}
+
+} // namespace
+} // namespace osquery
@@ -103,11 +103,15 @@ Status logQueryLogItem(const QueryLogItem& item, const std::string& receiver);
 /**
  * @brief Log raw results from a query (or a snapshot scheduled query).
  *
+ * The results of a large snapshot may be logged in several items, each with a
+ * chunk of the rows. Only the first chunk should be counted as a query.
+ *
  * @param item the unmangled results from the query planner.
+ * @param count [optional] Set false to not count the item as a logged query.
  *
  * @return Status indicating the success or failure of the operation
  */
-Status logSnapshotQuery(const QueryLogItem& item);
+Status logSnapshotQuery(const QueryLogItem& item, bool count = true);
 
 /**
  * @brief Sink a set of buffered status logs.
@@ -435,12 +435,12 @@ Status logQueryLogItem(const QueryLogItem& results,
   return status;
 }
 
-Status logSnapshotQuery(const QueryLogItem& item) {
+Status logSnapshotQuery(const QueryLogItem& item, bool count) {
   if (FLAGS_disable_logging) {
     return Status::success();
   }
 
-  if (FLAGS_enable_numeric_monitoring) {
+  if (count && FLAGS_enable_numeric_monitoring) {
     monitoring::record(
         kTotalQueryCounterMonitorPath, 1, monitoring::PreAggregationType::Sum);
   }
@@ -0,0 +1,123 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include <osquery/numeric_monitoring/histogram.h>
+
+namespace osquery {
+
+namespace monitoring {
+
+namespace {
+
+/// Number of bits used to split every power of two into sub-buckets.
+const unsigned kSubBucketBits = 4;
+const std::size_t kSubBuckets = std::size_t{1} << kSubBucketBits;
+
+unsigned mostSignificantBit(std::uint64_t value) {
+  auto msb = 0U;
+  while (value >>= 1) {
+    ++msb;
+  }
+  return msb;
+}
+
+} // namespace
+
+std::size_t Histogram::bucketIndex(ValueType value) {
+  if (value <= 0) {
+    return 0;
+  }
+  auto unsigned_value = static_cast<std::uint64_t>(value);
+  auto msb = mostSignificantBit(unsigned_value);
+  auto shift = msb > kSubBucketBits ? msb - kSubBucketBits : 0;
+  return shift * kSubBuckets + (unsigned_value >> shift);
+}
+
+ValueType Histogram::bucketValue(std::size_t index) {
+  auto shift = index < 2 * kSubBuckets ? 0 : index / kSubBuckets - 1;
+  auto lower = static_cast<std::uint64_t>(index - shift * kSubBuckets)
+               << shift;
+  auto width = std::uint64_t{1} << shift;
+  return static_cast<ValueType>(lower + (width - 1) / 2);
+}
+
+void Histogram::record(ValueType value) {
+  auto index = bucketIndex(value);
+  if (index >= buckets_.size()) {
+    buckets_.resize(index + 1, 0);
+  }
+  ++buckets_[index];
+  if (count_ == 0) {
+    min_ = value;
+    max_ = value;
+  } else {
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+  }
+  ++count_;
+}
+
+void Histogram::merge(const Histogram& other) {
+  if (other.count_ == 0) {
+    return;
+  }
+  if (other.buckets_.size() > buckets_.size()) {
+    buckets_.resize(other.buckets_.size(), 0);
+  }
+  for (std::size_t i = 0; i < other.buckets_.size(); ++i) {
+    buckets_[i] += other.buckets_[i];
+  }
+  if (count_ == 0) {
+    min_ = other.min_;
+    max_ = other.max_;
+  } else {
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+  }
+  count_ += other.count_;
+}
+
+ValueType Histogram::quantile(double q) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  q = std::min(std::max(q, 0.0), 1.0);
+  auto rank = static_cast<std::uint64_t>(std::ceil(q * count_));
+  // The extremes are tracked exactly, no need to estimate them.
+  if (rank <= 1) {
+    return min_;
+  }
+  if (rank >= count_) {
+    return max_;
+  }
+
+  auto seen = std::uint64_t{0};
+  for (std::size_t i = 0; i < buckets_.size(); ++i) {
+    seen += buckets_[i];
+    if (seen >= rank) {
+      return std::min(std::max(bucketValue(i), min_), max_);
+    }
+  }
+  return max_;
+}
+
+const std::vector<std::pair<std::string, double>>& histogramQuantiles() {
+  static const auto quantiles = std::vector<std::pair<std::string, double>>{
+      {"p50", 0.50},
+      {"p95", 0.95},
+      {"p99", 0.99},
+  };
+  return quantiles;
+}
+
+} // namespace monitoring
+} // namespace osquery
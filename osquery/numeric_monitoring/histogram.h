@@ -0,0 +1,84 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <osquery/numeric_monitoring/numeric_monitoring.h>
+
+namespace osquery {
+
+namespace monitoring {
+
+/**
+ * @brief Mergeable, fixed-memory histogram of monitoring values.
+ *
+ * Values are counted in log-linear buckets: every power of two is split into
+ * 16 equal sub-buckets, values below 32 are counted exactly. A quantile
+ * estimate is therefore within ~6% of the true value, and the whole histogram
+ * never needs more than 960 counters whatever the number of recorded values.
+ * Negative values are counted in the lowest bucket.
+ *
+ * Two histograms are merged by adding their counters, which makes it possible
+ * to record values on different threads and combine them at flush time.
+ */
+class Histogram {
+ public:
+  /// Count one more observed value.
+  void record(ValueType value);
+
+  /// Add all values counted by @param other into this histogram.
+  void merge(const Histogram& other);
+
+  /**
+   * @brief Estimate the value at quantile @param q, in the range [0, 1].
+   *
+   * The lowest and highest ranks are the exact smallest and largest recorded
+   * values, other estimates are clamped to them.
+   * An empty histogram estimates every quantile as 0.
+   */
+  ValueType quantile(double q) const;
+
+  std::uint64_t count() const noexcept {
+    return count_;
+  }
+
+  ValueType min() const noexcept {
+    return min_;
+  }
+
+  ValueType max() const noexcept {
+    return max_;
+  }
+
+ private:
+  static std::size_t bucketIndex(ValueType value);
+  static ValueType bucketValue(std::size_t index);
+
+ private:
+  /// Counters, only grown up to the highest bucket used.
+  std::vector<std::uint64_t> buckets_;
+  std::uint64_t count_{0};
+  ValueType min_{0};
+  ValueType max_{0};
+};
+
+/**
+ * @brief Quantiles reported for PreAggregationType::Histogram points.
+ *
+ * Each pair is the record request key, e.g. "p95", and the quantile itself.
+ */
+const std::vector<std::pair<std::string, double>>& histogramQuantiles();
+
+} // namespace monitoring
+} // namespace osquery
@@ -7,13 +7,19 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <vector>
 
 #include <boost/io/quoted.hpp>
 
 #include <osquery/core/flags.h>
 #include <osquery/dispatcher/dispatcher.h>
 #include <osquery/logger/logger.h>
+#include <osquery/numeric_monitoring/histogram.h>
 #include <osquery/numeric_monitoring/numeric_monitoring.h>
 #include <osquery/numeric_monitoring/plugin_interface.h>
 #include <osquery/numeric_monitoring/pre_aggregation_cache.h>
@@ -61,7 +67,8 @@ const auto& getAggregationTypeToStringTable() {
           {PreAggregationType::P10, "p10"},
           {PreAggregationType::P50, "p50"},
           {PreAggregationType::P95, "p95"},
-          {PreAggregationType::P99, "p99"}};
+          {PreAggregationType::P99, "p99"},
+          {PreAggregationType::Histogram, "histogram"}};
   return table;
 }
 
@@ -104,6 +111,13 @@ namespace {
 class FlusherIsScheduled {};
 FlusherIsScheduled schedule();
 
+/**
+ * Points recorded without `sync` are pre-aggregated here until the next flush.
+ *
+ * Every recording thread gets its own shard, so recording only contends with
+ * a flush of the same shard. The flush takes the points of all shards and
+ * merges them per path before dispatching.
+ */
 class PreAggregationBuffer final {
  public:
   static PreAggregationBuffer& get() {
@@ -119,44 +133,95 @@ class PreAggregationBuffer final {
               const bool sync,
               const TimePoint& time_point) {
     if (0 == FLAGS_numeric_monitoring_pre_aggregation_time || sync) {
-      dispatchOne(path, value, pre_aggregation, sync, time_point);
+      dispatchOne(Point(path, value, pre_aggregation, time_point), sync);
     } else {
-      std::lock_guard<std::mutex> lock(mutex_);
-      cache_.addPoint(Point(path, value, pre_aggregation, time_point));
+      auto& shard = localShard();
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      shard.cache.addPoint(Point(path, value, pre_aggregation, time_point));
     }
   }
 
   void flush() {
     auto points = takeCachedPoints();
     for (const auto& pt : points) {
-      dispatchOne(
-          pt.path_, pt.value_, pt.pre_aggregation_type_, false, pt.time_point_);
+      dispatchOne(pt, false);
     }
   }
 
+  std::size_t shardCount() {
+    std::lock_guard<std::mutex> lock(shards_mutex_);
+    return shards_.size();
+  }
+
  private:
+  struct Shard {
+    std::mutex mutex;
+    PreAggregationCache cache;
+  };
+
+  Shard& localShard() {
+    // The buffer holds the other reference, once the thread exits the shard
+    // is only kept until its points are flushed.
+    thread_local std::shared_ptr<Shard> shard;
+    if (shard == nullptr) {
+      shard = std::make_shared<Shard>();
+      std::lock_guard<std::mutex> lock(shards_mutex_);
+      shards_.push_back(shard);
+    }
+    return *shard;
+  }
+
   std::vector<Point> takeCachedPoints() {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto points = cache_.takePoints();
-    return points;
+    // Shards only referenced by the buffer belong to exited threads, they are
+    // released once their last points are taken.
+    auto shards = std::vector<std::shared_ptr<Shard>>{};
+    {
+      std::lock_guard<std::mutex> lock(shards_mutex_);
+      auto exited = std::partition(shards_.begin(),
+                                   shards_.end(),
+                                   [](const std::shared_ptr<Shard>& shard) {
+                                     return shard.use_count() > 1;
+                                   });
+      shards.assign(shards_.begin(), exited);
+      shards.insert(shards.end(),
+                    std::make_move_iterator(exited),
+                    std::make_move_iterator(shards_.end()));
+      shards_.erase(exited, shards_.end());
+    }
+
+    auto merged = PreAggregationCache{};
+    for (const auto& shard : shards) {
+      auto points = std::vector<Point>{};
+      {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        points = shard->cache.takePoints();
+      }
+      for (auto& pt : points) {
+        merged.addPoint(std::move(pt));
+      }
+    }
+    return merged.takePoints();
   }
 
-  void dispatchOne(const std::string& path,
-                   const ValueType& value,
-                   const PreAggregationType& pre_aggregation,
-                   const bool sync,
-                   const TimePoint& time_point) {
+  void dispatchOne(const Point& point, const bool sync) {
+    auto request = PluginRequest{
+        {recordKeys().path, point.path_},
+        {recordKeys().value, std::to_string(point.value_)},
+        {recordKeys().pre_aggregation,
+         to<std::string>(point.pre_aggregation_type_)},
+        {recordKeys().timestamp,
+         std::to_string(point.time_point_.time_since_epoch().count())},
+        {recordKeys().sync, sync ? "true" : "false"},
+    };
+    if (point.pre_aggregation_type_ == PreAggregationType::Histogram) {
+      for (const auto& quantile : histogramQuantiles()) {
+        request.emplace(
+            quantile.first,
+            std::to_string(point.histogram_.quantile(quantile.second)));
+      }
+    }
     auto status = Registry::call(
-        registryName(),
-        FLAGS_numeric_monitoring_plugins,
-        {
-            {recordKeys().path, path},
-            {recordKeys().value, std::to_string(value)},
-            {recordKeys().pre_aggregation, to<std::string>(pre_aggregation)},
-            {recordKeys().timestamp,
-             std::to_string(time_point.time_since_epoch().count())},
-            {recordKeys().sync, sync ? "true" : "false"},
-        });
+        registryName(), FLAGS_numeric_monitoring_plugins, request);
     if (!status.ok()) {
       LOG(ERROR) << "Data loss. Numeric monitoring point dispatch failed: "
                  << status.what();
@@ -164,8 +229,8 @@ class PreAggregationBuffer final {
   }
 
  private:
-  PreAggregationCache cache_;
-  std::mutex mutex_;
+  std::vector<std::shared_ptr<Shard>> shards_;
+  std::mutex shards_mutex_;
 };
 
 class PreAggregationFlusher : public InternalRunnable {
@@ -194,6 +259,10 @@ void flush() {
   PreAggregationBuffer::get().flush();
 }
 
+std::size_t bufferedThreadCount() {
+  return PreAggregationBuffer::get().shardCount();
+}
+
 void record(const std::string& path,
             ValueType value,
             PreAggregationType pre_aggregation,
@@ -10,6 +10,7 @@
 #pragma once
 
 #include <chrono>
+#include <cstddef>
 #include <string>
 
 #include "osquery/utils/conversions/tryto.h"
@@ -57,6 +58,9 @@ enum class PreAggregationType {
   P50, // Estimates 50th percentile
   P95, // Estimates 95th percentile
   P99, // Estimates 99th percentile
+  // Keeps a mergeable histogram of the values, the point value is the number
+  // of recorded values and p50, p95 and p99 estimates are sent along with it
+  Histogram,
   // not existing PreAggregationType, upper limit definition
   InvalidTypeUpperLimit,
 };
@@ -95,6 +99,12 @@ void record(const std::string& path,
  */
 void flush();
 
+/**
+ * Number of threads with a pre-aggregation buffer.
+ * Buffers of exited threads are released by the next flush.
+ */
+std::size_t bufferedThreadCount();
+
 }; // namespace monitoring
 
 /**
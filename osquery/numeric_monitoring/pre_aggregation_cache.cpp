@@ -23,7 +23,12 @@ Point::Point(std::string path,
     : path_(std::move(path)),
       value_(std::move(value)),
       pre_aggregation_type_(std::move(pre_aggregation_type)),
-      time_point_(std::move(time_point)) {}
+      time_point_(std::move(time_point)) {
+  if (pre_aggregation_type_ == PreAggregationType::Histogram) {
+    histogram_.record(value_);
+    value_ = static_cast<ValueType>(histogram_.count());
+  }
+}
 
 bool Point::tryToAggregate(const Point& new_point) {
   if (path_ != new_point.path_) {
@@ -62,6 +67,10 @@ bool Point::tryToAggregate(const Point& new_point) {
   case PreAggregationType::Max:
     value_ = std::max(value_, new_point.value_);
     break;
+  case PreAggregationType::Histogram:
+    histogram_.merge(new_point.histogram_);
+    value_ = static_cast<ValueType>(histogram_.count());
+    break;
   case PreAggregationType::InvalidTypeUpperLimit:
     // nothing to do, the type is invalid
     LOG(ERROR) << "Invalid Pre-aggregation type "
@@ -11,6 +11,7 @@
 
 #include <unordered_map>
 
+#include <osquery/numeric_monitoring/histogram.h>
 #include <osquery/numeric_monitoring/numeric_monitoring.h>
 
 namespace osquery {
@@ -34,6 +35,9 @@ class Point {
    * @param value Observed value
    * @param pre_aggregation_type Pre-aggregation type for the sequence
    * @param time_point Time point at which value was observed
+   *
+   * A PreAggregationType::Histogram point counts @param value in its
+   * histogram and keeps the number of counted values in `value`.
    */
   explicit Point(std::string path,
                  ValueType value,
@@ -45,6 +49,7 @@ class Point {
    * If `pre_aggregation_type` and `path` are the same in `new_point`, the value
    * of `new_point` will be aggregated with `value` from self and written to
    * self `value`.  `true` will be returned in this case.
+   * Histogram points merge their histograms.
    * Otherwise nothing will be changed and `false` will be returned.
    */
   bool tryToAggregate(const Point& new_point);
@@ -54,6 +59,7 @@ class Point {
   ValueType value_;
   PreAggregationType pre_aggregation_type_;
   TimePoint time_point_;
+  Histogram histogram_;
 };
 
 class PreAggregationCache {
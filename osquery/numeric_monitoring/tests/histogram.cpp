@@ -0,0 +1,90 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <cmath>
+#include <limits>
+
+#include <gtest/gtest.h>
+
+#include <osquery/numeric_monitoring/histogram.h>
+
+namespace osquery {
+
+GTEST_TEST(NumericMonitoringHistogram, empty) {
+  auto histogram = monitoring::Histogram{};
+  EXPECT_EQ(histogram.count(), 0);
+  EXPECT_EQ(histogram.quantile(0.5), 0);
+  EXPECT_EQ(histogram.quantile(0.99), 0);
+}
+
+GTEST_TEST(NumericMonitoringHistogram, small_values_are_exact) {
+  auto histogram = monitoring::Histogram{};
+  for (auto value = monitoring::ValueType{1}; value <= 20; ++value) {
+    histogram.record(value);
+  }
+  EXPECT_EQ(histogram.count(), 20);
+  EXPECT_EQ(histogram.min(), 1);
+  EXPECT_EQ(histogram.max(), 20);
+  EXPECT_EQ(histogram.quantile(0.0), 1);
+  EXPECT_EQ(histogram.quantile(0.5), 10);
+  EXPECT_EQ(histogram.quantile(0.95), 19);
+  EXPECT_EQ(histogram.quantile(1.0), 20);
+}
+
+GTEST_TEST(NumericMonitoringHistogram, relative_error) {
+  auto histogram = monitoring::Histogram{};
+  for (auto value = monitoring::ValueType{1}; value <= 100000; ++value) {
+    histogram.record(value);
+  }
+  for (const auto& quantile : monitoring::histogramQuantiles()) {
+    const auto expected = quantile.second * 100000;
+    const auto estimated = static_cast<double>(
+        histogram.quantile(quantile.second));
+    EXPECT_LE(std::abs(estimated - expected) / expected, 0.07)
+        << quantile.first;
+  }
+}
+
+GTEST_TEST(NumericMonitoringHistogram, extreme_values) {
+  auto histogram = monitoring::Histogram{};
+  histogram.record(-5);
+  histogram.record(std::numeric_limits<monitoring::ValueType>::max());
+  EXPECT_EQ(histogram.count(), 2);
+  EXPECT_EQ(histogram.quantile(0.0), -5);
+  EXPECT_EQ(histogram.quantile(1.0),
+            std::numeric_limits<monitoring::ValueType>::max());
+}
+
+GTEST_TEST(NumericMonitoringHistogram, merge) {
+  auto low = monitoring::Histogram{};
+  auto high = monitoring::Histogram{};
+  auto both = monitoring::Histogram{};
+  for (auto value = monitoring::ValueType{0}; value < 1000; ++value) {
+    low.record(value);
+    high.record(value + 1000);
+    both.record(value);
+    both.record(value + 1000);
+  }
+  low.merge(high);
+  EXPECT_EQ(low.count(), both.count());
+  EXPECT_EQ(low.min(), 0);
+  EXPECT_EQ(low.max(), 1999);
+  for (const auto& quantile : monitoring::histogramQuantiles()) {
+    EXPECT_EQ(low.quantile(quantile.second), both.quantile(quantile.second))
+        << quantile.first;
+  }
+
+  auto empty = monitoring::Histogram{};
+  empty.merge(low);
+  EXPECT_EQ(empty.count(), low.count());
+  EXPECT_EQ(empty.min(), low.min());
+  EXPECT_EQ(empty.quantile(0.5), low.quantile(0.5));
+}
+
+} // namespace osquery
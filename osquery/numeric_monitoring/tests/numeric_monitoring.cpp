@@ -7,6 +7,9 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <thread>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include <boost/filesystem.hpp>
@@ -187,4 +190,98 @@ TEST_F(NumericMonitoringTests, record_without_buffer) {
   Dispatcher::joinServices();
 }
 
+TEST_F(NumericMonitoringTests, record_histogram_from_many_threads) {
+  const auto isEnabled = FLAGS_enable_numeric_monitoring;
+  const auto plugins = FLAGS_numeric_monitoring_plugins;
+  const auto pre_aggregation_time =
+      FLAGS_numeric_monitoring_pre_aggregation_time;
+
+  FLAGS_enable_numeric_monitoring = true;
+  FLAGS_numeric_monitoring_plugins = kNameForTestPlugin;
+  FLAGS_numeric_monitoring_pre_aggregation_time = 1;
+
+  auto status = RegistryFactory::get().setActive(
+      monitoring::registryName(), FLAGS_numeric_monitoring_plugins);
+  ASSERT_TRUE(status.ok());
+
+  monitoring::flush();
+  NumericMonitoringInMemoryTestPlugin::points.clear();
+
+  // Every thread records into its own shard, the flush merges them.
+  const auto monitoring_path = "some.path.to.histogram";
+  auto threads = std::vector<std::thread>{};
+  for (auto t = 0; t < 4; ++t) {
+    threads.emplace_back([t, monitoring_path]() {
+      for (auto i = 1; i <= 25; ++i) {
+        monitoring::record(monitoring_path,
+                           monitoring::ValueType{t * 25 + i},
+                           monitoring::PreAggregationType::Histogram);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  monitoring::flush();
+
+  ASSERT_EQ(1, NumericMonitoringInMemoryTestPlugin::points.size());
+  const auto& point = NumericMonitoringInMemoryTestPlugin::points.back();
+  EXPECT_EQ(monitoring_path, point.at(monitoring::recordKeys().path));
+  EXPECT_EQ("histogram", point.at(monitoring::recordKeys().pre_aggregation));
+  EXPECT_EQ(100, std::stoll(point.at(monitoring::recordKeys().value)));
+  EXPECT_NEAR(50, std::stoll(point.at("p50")), 3);
+  EXPECT_NEAR(95, std::stoll(point.at("p95")), 6);
+  EXPECT_NEAR(99, std::stoll(point.at("p99")), 6);
+
+  FLAGS_enable_numeric_monitoring = isEnabled;
+  FLAGS_numeric_monitoring_plugins = plugins;
+  FLAGS_numeric_monitoring_pre_aggregation_time = pre_aggregation_time;
+
+  Dispatcher::stopServices();
+  Dispatcher::joinServices();
+}
+
+TEST_F(NumericMonitoringTests, release_buffer_of_exited_thread) {
+  const auto isEnabled = FLAGS_enable_numeric_monitoring;
+  const auto plugins = FLAGS_numeric_monitoring_plugins;
+  const auto pre_aggregation_time =
+      FLAGS_numeric_monitoring_pre_aggregation_time;
+
+  FLAGS_enable_numeric_monitoring = true;
+  FLAGS_numeric_monitoring_plugins = kNameForTestPlugin;
+  FLAGS_numeric_monitoring_pre_aggregation_time = 1;
+
+  auto status = RegistryFactory::get().setActive(
+      monitoring::registryName(), FLAGS_numeric_monitoring_plugins);
+  ASSERT_TRUE(status.ok());
+
+  monitoring::flush();
+  NumericMonitoringInMemoryTestPlugin::points.clear();
+  const auto thread_count = monitoring::bufferedThreadCount();
+
+  const auto monitoring_path = "some.path.to.exited.thread";
+  std::thread([monitoring_path]() {
+    monitoring::record(monitoring_path,
+                       monitoring::ValueType{17},
+                       monitoring::PreAggregationType::Sum);
+  }).join();
+  EXPECT_EQ(thread_count + 1, monitoring::bufferedThreadCount());
+
+  // The points of the exited thread are still flushed, then its buffer freed
+  monitoring::flush();
+  EXPECT_EQ(thread_count, monitoring::bufferedThreadCount());
+
+  ASSERT_EQ(1, NumericMonitoringInMemoryTestPlugin::points.size());
+  EXPECT_EQ(17,
+            std::stoll(NumericMonitoringInMemoryTestPlugin::points.back().at(
+                monitoring::recordKeys().value)));
+
+  FLAGS_enable_numeric_monitoring = isEnabled;
+  FLAGS_numeric_monitoring_plugins = plugins;
+  FLAGS_numeric_monitoring_pre_aggregation_time = pre_aggregation_time;
+
+  Dispatcher::stopServices();
+  Dispatcher::joinServices();
+}
+
 } // namespace osquery
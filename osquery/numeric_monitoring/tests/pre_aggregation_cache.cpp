@@ -111,6 +111,23 @@ GTEST_TEST(PreAggregationPoint, tryToUpdate_max) {
   EXPECT_EQ(42, prev_pt.value_);
 }
 
+GTEST_TEST(PreAggregationPoint, tryToUpdate_histogram) {
+  const auto now = monitoring::Clock::now();
+  const auto path = "test.path.to.nowhere";
+  auto prev_pt = monitoring::Point(
+      path, 3, monitoring::PreAggregationType::Histogram, now);
+  EXPECT_EQ(1, prev_pt.value_);
+  auto new_pt = monitoring::Point(path,
+                                  42,
+                                  monitoring::PreAggregationType::Histogram,
+                                  now - std::chrono::seconds{2});
+  ASSERT_TRUE(prev_pt.tryToAggregate(new_pt));
+  EXPECT_EQ(now, prev_pt.time_point_);
+  EXPECT_EQ(2, prev_pt.value_);
+  EXPECT_EQ(3, prev_pt.histogram_.min());
+  EXPECT_EQ(42, prev_pt.histogram_.max());
+}
+
 GTEST_TEST(PreAggregationCache, life_cycle) {
   const auto now = monitoring::Clock::now();
   auto cache = monitoring::PreAggregationCache{};
@@ -10,7 +10,10 @@
 #include <string>
 
 #include <dlfcn.h>
+#include <fcntl.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include <sys/resource.h>
 #include <sys/syscall.h>
@@ -18,6 +21,10 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
+
 #include <boost/optional.hpp>
 
 #include <osquery/core/flags.h>
@@ -71,4 +78,97 @@ int platformGetPid() {
 uint64_t platformGetTid() {
   return std::hash<std::thread::id>()(std::this_thread::get_id());
 }
+
+static inline uint64_t timevalToMilliseconds(const struct timeval& tv) {
+  return static_cast<uint64_t>(tv.tv_sec) * 1000 +
+         static_cast<uint64_t>(tv.tv_usec) / 1000;
+}
+
+bool platformGetResourceUsage(ProcessResourceUsage& usage) {
+  struct rusage ru {};
+  if (::getrusage(RUSAGE_SELF, &ru) != 0) {
+    return false;
+  }
+
+  usage.user_time = timevalToMilliseconds(ru.ru_utime);
+  usage.system_time = timevalToMilliseconds(ru.ru_stime);
+  usage.page_faults = static_cast<uint64_t>(ru.ru_minflt + ru.ru_majflt);
+  usage.voluntary_context_switches = static_cast<uint64_t>(ru.ru_nvcsw);
+  // Block input operations are counted in 512-byte units.
+  usage.bytes_read = static_cast<uint64_t>(ru.ru_inblock) * 512;
+
+#if defined(__linux__)
+  // The second field of statm is the number of resident pages.
+  char buffer[128] = {0};
+  auto fd = ::open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  auto bytes = ::read(fd, buffer, sizeof(buffer) - 1);
+  ::close(fd);
+  if (bytes <= 0) {
+    return false;
+  }
+
+  unsigned long long size = 0;
+  unsigned long long resident = 0;
+  if (sscanf(buffer, "%llu %llu", &size, &resident) != 2) {
+    return false;
+  }
+  usage.resident_size =
+      static_cast<uint64_t>(resident) * ::sysconf(_SC_PAGESIZE);
+#elif defined(__APPLE__)
+  mach_task_basic_info_data_t info{};
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+  if (::task_info(mach_task_self(),
+                  MACH_TASK_BASIC_INFO,
+                  reinterpret_cast<task_info_t>(&info),
+                  &count) != KERN_SUCCESS) {
+    return false;
+  }
+  usage.resident_size = static_cast<uint64_t>(info.resident_size);
+#else
+  // Only the maximum resident size, in kilobytes, is available.
+  usage.resident_size = static_cast<uint64_t>(ru.ru_maxrss) * 1024;
+#endif
+
+  return true;
+}
+
+bool platformGetThreadCpuTime(uint64_t& cpu_time) {
+#if defined(__APPLE__)
+  thread_basic_info_data_t info{};
+  mach_msg_type_number_t count = THREAD_BASIC_INFO_COUNT;
+  auto thread = mach_thread_self();
+  auto kr = ::thread_info(thread,
+                          THREAD_BASIC_INFO,
+                          reinterpret_cast<thread_info_t>(&info),
+                          &count);
+  mach_port_deallocate(mach_task_self(), thread);
+  if (kr != KERN_SUCCESS) {
+    return false;
+  }
+  cpu_time = static_cast<uint64_t>(info.user_time.seconds +
+                                   info.system_time.seconds) *
+                 1000 +
+             static_cast<uint64_t>(info.user_time.microseconds +
+                                   info.system_time.microseconds) /
+                 1000;
+  return true;
+#else
+  struct rusage ru {};
+#if defined(__linux__)
+  int who = RUSAGE_THREAD;
+#else
+  int who = RUSAGE_SELF;
+#endif
+  if (::getrusage(who, &ru) != 0) {
+    return false;
+  }
+
+  cpu_time = timevalToMilliseconds(ru.ru_utime) +
+             timevalToMilliseconds(ru.ru_stime);
+  return true;
+#endif
+}
 }
@@ -272,4 +272,48 @@ int platformGetPid();
  * and on posix platforms returns gettid()
  */
 uint64_t platformGetTid();
+
+/// Resource counters for the current process.
+struct ProcessResourceUsage {
+  /// Total user CPU time in milliseconds.
+  uint64_t user_time{0};
+
+  /// Total system CPU time in milliseconds.
+  uint64_t system_time{0};
+
+  /// Current resident memory in bytes.
+  uint64_t resident_size{0};
+
+  /// Total minor and major page faults.
+  uint64_t page_faults{0};
+
+  /// Total voluntary context switches, not available on Windows.
+  uint64_t voluntary_context_switches{0};
+
+  /// Total bytes read from storage.
+  uint64_t bytes_read{0};
+};
+
+/**
+ * @brief Sample the resource counters of the current process
+ *
+ * On posix platforms this uses getrusage, and on Linux the resident size
+ * is read from /proc/self/statm. On Windows it uses GetProcessTimes,
+ * GetProcessMemoryInfo and GetProcessIoCounters.
+ *
+ * This is much cheaper than selecting the current pid from the processes
+ * table, so it can run before and after every scheduled query.
+ */
+bool platformGetResourceUsage(ProcessResourceUsage& usage);
+
+/**
+ * @brief Sample the CPU time, user and system, used by the calling thread
+ *
+ * On Linux this uses getrusage with RUSAGE_THREAD, on macOS thread_info and
+ * on Windows GetThreadTimes. Other posix platforms fall back to the CPU time
+ * of the whole process.
+ *
+ * @param cpu_time [output] milliseconds of CPU time used by the thread.
+ */
+bool platformGetThreadCpuTime(uint64_t& cpu_time);
 } // namespace osquery
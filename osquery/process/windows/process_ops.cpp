@@ -14,6 +14,8 @@
 #include <osquery/utils/conversions/windows/strings.h>
 #include <osquery/utils/system/windows/users_groups_helpers.h>
 
+#include <psapi.h>
+
 namespace osquery {
 
 uint32_t platformGetUid() {
@@ -114,4 +116,57 @@ int platformGetPid() {
 uint64_t platformGetTid() {
   return GetCurrentThreadId();
 }
+
+static inline uint64_t fileTimeToMilliseconds(const FILETIME& ft) {
+  ULARGE_INTEGER value;
+  value.LowPart = ft.dwLowDateTime;
+  value.HighPart = ft.dwHighDateTime;
+  // FILETIME values are in 100-nanosecond intervals.
+  return value.QuadPart / 10000;
+}
+
+bool platformGetResourceUsage(ProcessResourceUsage& usage) {
+  auto process = GetCurrentProcess();
+
+  FILETIME create_time;
+  FILETIME exit_time;
+  FILETIME kernel_time;
+  FILETIME user_time;
+  if (!GetProcessTimes(
+          process, &create_time, &exit_time, &kernel_time, &user_time)) {
+    return false;
+  }
+  usage.user_time = fileTimeToMilliseconds(user_time);
+  usage.system_time = fileTimeToMilliseconds(kernel_time);
+
+  PROCESS_MEMORY_COUNTERS counters;
+  if (!GetProcessMemoryInfo(process, &counters, sizeof(counters))) {
+    return false;
+  }
+  usage.resident_size = static_cast<uint64_t>(counters.WorkingSetSize);
+  usage.page_faults = static_cast<uint64_t>(counters.PageFaultCount);
+
+  IO_COUNTERS io;
+  if (GetProcessIoCounters(process, &io)) {
+    usage.bytes_read = static_cast<uint64_t>(io.ReadTransferCount);
+  }
+  return true;
+}
+
+bool platformGetThreadCpuTime(uint64_t& cpu_time) {
+  FILETIME create_time;
+  FILETIME exit_time;
+  FILETIME kernel_time;
+  FILETIME user_time;
+  if (!GetThreadTimes(GetCurrentThread(),
+                      &create_time,
+                      &exit_time,
+                      &kernel_time,
+                      &user_time)) {
+    return false;
+  }
+  cpu_time =
+      fileTimeToMilliseconds(user_time) + fileTimeToMilliseconds(kernel_time);
+  return true;
+}
 } // namespace osquery
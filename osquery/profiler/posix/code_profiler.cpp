@@ -44,6 +44,17 @@ void record(const std::vector<std::string>& names,
   }
 }
 
+/// Buffered, so the wall time distribution is reported per flush period.
+void recordHistogram(const std::vector<std::string>& names,
+                     const std::string& metricName,
+                     monitoring::ValueType measurement) {
+  for (const std::string& name : names) {
+    monitoring::record(name + "." + metricName + ".histogram",
+                       measurement,
+                       monitoring::PreAggregationType::Histogram);
+  }
+}
+
 int getRusageWho() {
   return
 #ifdef __linux__
@@ -171,6 +182,7 @@ CodeProfiler::~CodeProfiler() {
             code_profiler_data_end.getWallTime() -
             code_profiler_data_->getWallTime());
     record(names_, "time.wall.millis", query_duration.count());
+    recordHistogram(names_, "time.wall.millis", query_duration.count());
   }
 }
 
@@ -52,5 +52,10 @@ CodeProfiler::~CodeProfiler() {
           code_profiler_data_->getWallTime());
 
   record(names_, ".time.wall.millis", query_duration.count());
+  for (const auto& name : names_) {
+    monitoring::record(name + ".time.wall.millis.histogram",
+                       query_duration.count(),
+                       monitoring::PreAggregationType::Histogram);
+  }
 }
 } // namespace osquery
@@ -33,21 +33,23 @@ std::string compressString(const std::string& data) {
   zs.next_in = (Bytef*)data.data();
   zs.avail_in = static_cast<uInt>(data.size());
 
-  int ret = Z_OK;
+  // Deflate straight into the output, which is sized up front to hold the
+  // whole compressed body, so no intermediate buffer is copied.
   std::string output;
+  output.resize(deflateBound(&zs, zs.avail_in));
+  zs.next_out = reinterpret_cast<Bytef*>(&output[0]);
+  zs.avail_out = static_cast<uInt>(output.size());
 
-  {
-    char buffer[16384] = {0};
-    while (ret == Z_OK) {
-      zs.next_out = reinterpret_cast<Bytef*>(buffer);
-      zs.avail_out = sizeof(buffer);
-
-      ret = deflate(&zs, Z_FINISH);
-      if (output.size() < zs.total_out) {
-        output.append(buffer, zs.total_out - output.size());
-      }
+  int ret = Z_OK;
+  while (ret == Z_OK) {
+    ret = deflate(&zs, Z_FINISH);
+    if (ret == Z_OK && zs.avail_out == 0) {
+      output.resize(output.size() * 2);
+      zs.next_out = reinterpret_cast<Bytef*>(&output[zs.total_out]);
+      zs.avail_out = static_cast<uInt>(output.size() - zs.total_out);
     }
   }
+  output.resize(zs.total_out);
 
   deflateEnd(&zs);
   if (ret != Z_STREAM_END) {
@@ -231,13 +231,21 @@ class Request {
       return s;
     }
 
-    bool compress = false;
-    auto it = options_.doc().FindMember("compress");
-    if (it != options_.doc().MemberEnd() && it->value.IsBool()) {
-      compress = it->value.GetBool();
-    }
+    return transport_->sendRequest(serialized, compress());
+  }
 
-    return transport_->sendRequest(serialized, compress);
+  /**
+   * @brief Send a request to the destination with serialized parameters
+   *
+   * Callers that assemble the request body themselves, in the format of the
+   * serializer, can avoid building and serializing a JSON document.
+   *
+   * @param serialized the serialized parameters
+   *
+   * @return success or failure of the operation
+   */
+  Status callSerialized(const std::string& serialized) {
+    return transport_->sendRequest(serialized, compress());
   }
 
   /**
@@ -256,6 +264,14 @@ class Request {
     transport_->setOption(name, value);
   }
 
+ private:
+  /// Check if the request body was requested to be compressed.
+  bool compress() const {
+    auto it = options_.doc().FindMember("compress");
+    return it != options_.doc().MemberEnd() && it->value.IsBool() &&
+           it->value.GetBool();
+  }
+
  private:
   /// storage for the resource destination
   std::string destination_;
@@ -89,7 +89,13 @@ TLSTransport::TLSTransport() {
 }
 
 void TLSTransport::decorateRequest(http::Request& r) {
-  r << http::Request::Header("Content-Type", serializer_->getContentType());
+  // Allow request calls to send a body not produced by the serializer.
+  auto it = options_.doc().FindMember("content_type");
+  if (it != options_.doc().MemberEnd() && it->value.IsString()) {
+    r << http::Request::Header("Content-Type", it->value.GetString());
+  } else {
+    r << http::Request::Header("Content-Type", serializer_->getContentType());
+  }
   r << http::Request::Header("Accept", serializer_->getContentType());
   r << http::Request::Header("User-Agent", kTLSUserAgentBase + kVersion);
 }
@@ -83,7 +83,6 @@ class TLSRequestHelper : private boost::noncopyable {
   template <class TSerializer>
   static Status go(const std::string& uri, JSON& params, JSON& output) {
     auto& params_doc = params.doc();
-    auto& output_doc = output.doc();
 
     auto node_key = getNodeKey("tls");
 
@@ -138,15 +137,61 @@ class TLSRequestHelper : private boost::noncopyable {
     if (!status.ok()) {
       return status;
     }
+    return getResponse(request, output);
+  }
+
+  /**
+   * @brief Send a TLS POST request with an already serialized body
+   *
+   * The body must include the node_key unless the tls_node_api flag is set,
+   * in which case it is appended to the URI variables.
+   *
+   * @param uri is the URI to send the request to
+   * @param body is the serialized params to send to the server
+   * @param compress set true to GZip compress the body
+   * @param output is the JSON which will be populated with the deserialized
+   * results
+   *
+   * @return a Status object indicating the success or failure of the operation
+   */
+  template <class TSerializer>
+  static Status goSerialized(const std::string& uri,
+                             const std::string& body,
+                             bool compress,
+                             JSON& output) {
+    std::string uri_suffix;
+    if (FLAGS_tls_node_api) {
+      uri_suffix = "&node_key=" + getNodeKey("tls");
+    }
+
+    Request<TLSTransport, TSerializer> request(uri + uri_suffix);
+    request.setOption("hostname", FLAGS_tls_hostname);
+    if (compress) {
+      request.setOption("compress", compress);
+    }
+
+    auto status = request.callSerialized(body);
+    if (!status.ok()) {
+      return status;
+    }
+    return getResponse(request, output);
+  }
+
+ private:
+  /// Read the response of a request and check for server-side errors.
+  template <class TSerializer>
+  static Status getResponse(Request<TLSTransport, TSerializer>& request,
+                            JSON& output) {
+    auto& output_doc = output.doc();
 
     // The call succeeded, store the enrolled key.
-    status = request.getResponse(output);
+    auto status = request.getResponse(output);
     if (!status.ok()) {
       return status;
     }
 
     // Receive config or key rejection
-    it = output_doc.FindMember("node_invalid");
+    auto it = output_doc.FindMember("node_invalid");
     if (it != output_doc.MemberEnd()) {
       assert(it->value.IsBool());
 
@@ -181,6 +226,7 @@ class TLSRequestHelper : private boost::noncopyable {
     return Status::success();
   }
 
+ public:
   /**
    * @brief Send a TLS request
    *
@@ -0,0 +1,112 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <osquery/core/query.h>
+#include <osquery/core/sql/diff_results.h>
+#include <osquery/database/database.h>
+
+namespace osquery {
+
+/// Generate rows shaped like a file or package listing.
+static QueryDataTyped getDiffRows(size_t count, size_t generation) {
+  QueryDataTyped rows;
+  rows.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    RowTyped r;
+    r["path"] = "/usr/lib/benchmark/file_" + std::to_string(i);
+    r["size"] = static_cast<long long>(i * 512);
+    r["mtime"] = static_cast<long long>(1600000000 + i);
+    r["sha256"] = std::string(64, 'a' + static_cast<char>(i % 26));
+    rows.push_back(std::move(r));
+  }
+
+  // Each generation changes a single row.
+  if (count > 0) {
+    rows[generation % count]["mtime"] = static_cast<long long>(generation);
+  }
+  return rows;
+}
+
+static void SQL_diff_multiset(benchmark::State& state) {
+  auto previous = getDiffRows(state.range(0), 0);
+  auto current = getDiffRows(state.range(0), 1);
+
+  while (state.KeepRunning()) {
+    QueryDataSet previous_qd(previous.begin(), previous.end());
+    auto dr = diff(previous_qd, current);
+    benchmark::DoNotOptimize(dr);
+  }
+}
+
+BENCHMARK(SQL_diff_multiset)->Arg(1000)->Arg(10000)->Arg(100000);
+
+static void SQL_diff_row_hashes(benchmark::State& state) {
+  auto previous = getDiffRows(state.range(0), 0);
+  auto current = getDiffRows(state.range(0), 1);
+  auto index = diffRowHashes(RowHashIndex(), previous).index;
+
+  while (state.KeepRunning()) {
+    auto hd = diffRowHashes(index, current);
+    benchmark::DoNotOptimize(hd);
+  }
+}
+
+BENCHMARK(SQL_diff_row_hashes)->Arg(1000)->Arg(10000)->Arg(100000);
+
+static void SQL_add_new_results_json(benchmark::State& state) {
+  // The previous storage path: the whole result set is a JSON array.
+  std::string json;
+  serializeQueryDataJSON(getDiffRows(state.range(0), 0), json, true);
+  setDatabaseValue(kQueries, "diff_benchmark_json", json);
+
+  size_t generation = 1;
+  while (state.KeepRunning()) {
+    state.PauseTiming();
+    auto current = getDiffRows(state.range(0), generation++);
+    state.ResumeTiming();
+
+    std::string raw;
+    getDatabaseValue(kQueries, "diff_benchmark_json", raw);
+    QueryDataSet previous_qd;
+    deserializeQueryDataJSON(raw, previous_qd);
+    auto dr = diff(previous_qd, current);
+
+    serializeQueryDataJSON(current, json, true);
+    setDatabaseValue(kQueries, "diff_benchmark_json", json);
+  }
+  deleteDatabaseValue(kQueries, "diff_benchmark_json");
+}
+
+BENCHMARK(SQL_add_new_results_json)->Arg(1000)->Arg(10000)->Arg(100000);
+
+static void SQL_add_new_results_hashed(benchmark::State& state) {
+  ScheduledQuery sq("benchmark", "diff_benchmark", "select * from files");
+  auto query = Query("diff_benchmark", sq);
+
+  uint64_t counter = 0;
+  DiffResults dr;
+  query.addNewResults(getDiffRows(state.range(0), 0), 0, counter, dr);
+
+  size_t generation = 1;
+  while (state.KeepRunning()) {
+    state.PauseTiming();
+    auto current = getDiffRows(state.range(0), generation++);
+    state.ResumeTiming();
+
+    query.addNewResults(std::move(current), 0, counter, dr);
+  }
+  Query::deleteStoredRows("diff_benchmark");
+  deleteDatabaseValue(kQueries, "diff_benchmark");
+}
+
+BENCHMARK(SQL_add_new_results_hashed)->Arg(1000)->Arg(10000)->Arg(100000);
+
+} // namespace osquery
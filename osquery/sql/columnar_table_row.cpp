@@ -0,0 +1,189 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include "columnar_table_row.h"
+#include "dynamic_table_row.h"
+#include "virtual_table.h"
+
+#include <cmath>
+
+#include <osquery/logger/logger.h>
+#include <osquery/utils/conversions/tryto.h>
+
+namespace rj = rapidjson;
+
+namespace osquery {
+
+namespace {
+
+class ColumnarStringVisitor : public boost::static_visitor<std::string> {
+ public:
+  std::string operator()(const boost::blank&) const {
+    return std::string();
+  }
+
+  std::string operator()(long long i) const {
+    return std::to_string(i);
+  }
+
+  std::string operator()(double d) const {
+    return std::to_string(d);
+  }
+
+  std::string operator()(const std::string& s) const {
+    return s;
+  }
+};
+
+class ColumnarWriterVisitor : public boost::static_visitor<void> {
+ public:
+  explicit ColumnarWriterVisitor(rj::Writer<rj::StringBuffer>& writer)
+      : writer_(writer) {}
+
+  void operator()(const boost::blank&) const {
+    writer_.Null();
+  }
+
+  void operator()(long long i) const {
+    writer_.Int64(i);
+  }
+
+  void operator()(double d) const {
+    // JSON cannot represent NaN or infinity.
+    if (std::isfinite(d)) {
+      writer_.Double(d);
+    } else {
+      writer_.Null();
+    }
+  }
+
+  void operator()(const std::string& s) const {
+    writer_.String(s.data(), static_cast<rj::SizeType>(s.size()));
+  }
+
+ private:
+  rj::Writer<rj::StringBuffer>& writer_;
+};
+
+} // namespace
+
+std::string columnarValueToString(const ColumnarValue& value) {
+  return boost::apply_visitor(ColumnarStringVisitor(), value);
+}
+
+int ColumnarTableRow::get_rowid(sqlite_int64 default_value,
+                                sqlite_int64* pRowid) const {
+  auto slot = schema_->rowidSlot();
+  if (!isSet(slot)) {
+    *pRowid = default_value;
+    return SQLITE_OK;
+  }
+
+  const auto& value = values_[slot];
+  if (const auto* i = boost::get<long long>(&value)) {
+    *pRowid = *i;
+    return SQLITE_OK;
+  }
+
+  auto exp = tryTo<long long>(columnarValueToString(value), 10);
+  if (exp.isError()) {
+    VLOG(1) << "Invalid rowid value returned " << exp.getError();
+    return SQLITE_ERROR;
+  }
+  *pRowid = exp.take();
+  return SQLITE_OK;
+}
+
+int ColumnarTableRow::get_column(sqlite3_context* ctx,
+                                 sqlite3_vtab* vtab,
+                                 int col) {
+  auto* pVtab = (VirtualTable*)vtab;
+  auto slot = schema_->target(static_cast<size_t>(col));
+  if (pVtab->content->schema != schema_) {
+    // The row was created with another layout, for example from an ephemeral
+    // context. Fall back to resolving the column by name.
+    slot = schema_->slot(std::get<0>(pVtab->content->columns[col]));
+  }
+
+  if (!isSet(slot)) {
+    sqlite3_result_null(ctx);
+    return SQLITE_OK;
+  }
+
+  auto type = schema_->type(slot);
+  const auto& value = values_[slot];
+  if (const auto* i = boost::get<long long>(&value)) {
+    if (type == TEXT_TYPE || type == BLOB_TYPE) {
+      auto text = std::to_string(*i);
+      sqlite3_result_text(
+          ctx, text.c_str(), static_cast<int>(text.size()), SQLITE_TRANSIENT);
+    } else if (type == DOUBLE_TYPE) {
+      sqlite3_result_double(ctx, static_cast<double>(*i));
+    } else {
+      sqlite3_result_int64(ctx, *i);
+    }
+  } else if (const auto* d = boost::get<double>(&value)) {
+    if (type == TEXT_TYPE || type == BLOB_TYPE) {
+      auto text = std::to_string(*d);
+      sqlite3_result_text(
+          ctx, text.c_str(), static_cast<int>(text.size()), SQLITE_TRANSIENT);
+    } else {
+      sqlite3_result_double(ctx, *d);
+    }
+  } else {
+    resultFromText(
+        ctx, schema_->name(slot), type, boost::get<std::string>(value));
+  }
+
+  return SQLITE_OK;
+}
+
+Status ColumnarTableRow::serialize(JSON& doc, rj::Value& obj) const {
+  for (size_t slot = 0; slot < values_.size(); ++slot) {
+    if (schema_->isAlias(slot) || !isSet(slot)) {
+      continue;
+    }
+    doc.add(schema_->name(slot), columnarValueToString(values_[slot]), obj);
+  }
+
+  return Status::success();
+}
+
+void ColumnarTableRow::serializeValues(
+    const std::vector<std::string>& columns,
+    rj::Writer<rj::StringBuffer>& writer) const {
+  ColumnarWriterVisitor visitor(writer);
+  writer.StartArray();
+  for (const auto& column : columns) {
+    auto slot = schema_->slot(column);
+    if (slot == ColumnarSchema::npos) {
+      writer.Null();
+    } else {
+      boost::apply_visitor(visitor, values_[slot]);
+    }
+  }
+  writer.EndArray();
+}
+
+TableRowHolder ColumnarTableRow::clone() const {
+  return TableRowHolder(new ColumnarTableRow(*this));
+}
+
+ColumnarTableRow::operator Row() const {
+  Row row;
+  for (size_t slot = 0; slot < values_.size(); ++slot) {
+    if (schema_->isAlias(slot) || !isSet(slot)) {
+      continue;
+    }
+    row[schema_->name(slot)] = columnarValueToString(values_[slot]);
+  }
+  return row;
+}
+
+} // namespace osquery
@@ -0,0 +1,131 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <limits>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <boost/variant.hpp>
+
+#include <osquery/core/sql/table_row.h>
+#include <osquery/core/tables.h>
+
+namespace osquery {
+
+/// A typed column value, boost::blank marks a column that was not generated.
+using ColumnarValue =
+    boost::variant<boost::blank, long long, double, std::string>;
+
+/**
+ * @brief A TableRow backed by a vector of typed values indexed by slot.
+ *
+ * Where DynamicTableRow keeps a std::map of column name to string, this row
+ * keeps one value per column of the table's ColumnarSchema. Numeric columns
+ * can be stored natively and are handed to SQLite without a string cast.
+ *
+ * Tables should resolve the slots they write once per generate call:
+ *
+ * @code{.cpp}
+ *   auto schema = context.rowSchema();
+ *   auto pid_slot = schema->slot("pid");
+ *   auto r = std::make_unique<ColumnarTableRow>(schema);
+ *   r->set(pid_slot, 1);
+ *   results.push_back(std::move(r));
+ * @endcode
+ */
+class ColumnarTableRow : public TableRow {
+ public:
+  explicit ColumnarTableRow(std::shared_ptr<const ColumnarSchema> schema)
+      : schema_(std::move(schema)), values_(schema_->size()) {}
+
+  /**
+   * @brief Set an INTEGER, BIGINT or UNSIGNED_BIGINT value.
+   *
+   * Unsigned values beyond the range of long long are kept as text, so they
+   * are read the same way as the string value of a DynamicTableRow.
+   */
+  template <typename T,
+            typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+  void set(size_t slot, T value) {
+    if (slot >= values_.size()) {
+      return;
+    }
+    if (std::is_unsigned<T>::value &&
+        static_cast<unsigned long long>(value) >
+            static_cast<unsigned long long>(
+                std::numeric_limits<long long>::max())) {
+      values_[slot] = std::to_string(value);
+    } else {
+      values_[slot] = static_cast<long long>(value);
+    }
+  }
+
+  /// Set a DOUBLE value.
+  void set(size_t slot, double value) {
+    if (slot < values_.size()) {
+      values_[slot] = value;
+    }
+  }
+
+  /// Set a TEXT value, numeric columns will be cast when read by SQLite.
+  void set(size_t slot, std::string value) {
+    if (slot < values_.size()) {
+      values_[slot] = std::move(value);
+    }
+  }
+
+  /// See ColumnarTableRow::set for TEXT values.
+  void set(size_t slot, const char* value) {
+    set(slot, std::string(value));
+  }
+
+  /// Access the value at a slot, unset slots hold boost::blank.
+  const ColumnarValue& get(size_t slot) const {
+    return values_.at(slot);
+  }
+
+  /// Check if a value was set for a slot.
+  bool isSet(size_t slot) const {
+    return slot < values_.size() && values_[slot].which() != 0;
+  }
+
+  /// The layout this row was created with.
+  const std::shared_ptr<const ColumnarSchema>& schema() const {
+    return schema_;
+  }
+
+  int get_rowid(sqlite_int64 default_value,
+                sqlite_int64* pRowid) const override;
+  int get_column(sqlite3_context* ctx, sqlite3_vtab* pVtab, int col) override;
+  Status serialize(JSON& doc, rapidjson::Value& obj) const override;
+  void serializeValues(
+      const std::vector<std::string>& columns,
+      rapidjson::Writer<rapidjson::StringBuffer>& writer) const override;
+  TableRowHolder clone() const override;
+  operator Row() const override;
+
+ private:
+  ColumnarTableRow(const ColumnarTableRow&) = default;
+
+ private:
+  /// Shared column layout, owned by the virtual table content.
+  std::shared_ptr<const ColumnarSchema> schema_;
+
+  /// Values indexed by slot.
+  std::vector<ColumnarValue> values_;
+};
+
+/// Convert a typed value to the string form used by Row and DynamicTableRow.
+std::string columnarValueToString(const ColumnarValue& value);
+
+} // namespace osquery
@@ -66,6 +66,51 @@ Status deserializeRow(const rj::Value& doc, DynamicTableRowHolder& r) {
   return Status::success();
 }
 
+void resultFromText(sqlite3_context* ctx,
+                    const std::string& column_name,
+                    ColumnType type,
+                    const std::string& value) {
+  if (type == TEXT_TYPE || type == BLOB_TYPE) {
+    sqlite3_result_text(
+        ctx, value.c_str(), static_cast<int>(value.size()), SQLITE_TRANSIENT);
+  } else if (value.empty() &&
+             (type == INTEGER_TYPE || type == BIGINT_TYPE ||
+              type == UNSIGNED_BIGINT_TYPE || type == DOUBLE_TYPE)) {
+    // Don't Log a casting error for a known type if the column row is empty
+    sqlite3_result_null(ctx);
+  } else if (type == INTEGER_TYPE) {
+    auto afinite = tryTo<long>(value, 0);
+    if (afinite.isError()) {
+      VLOG(1) << "Error casting " << column_name << " (" << value
+              << ") to INTEGER. " << afinite.getError();
+      sqlite3_result_null(ctx);
+    } else {
+      sqlite3_result_int(ctx, afinite.take());
+    }
+  } else if (type == BIGINT_TYPE || type == UNSIGNED_BIGINT_TYPE) {
+    auto afinite = tryTo<long long>(value, 0);
+    if (afinite.isError()) {
+      VLOG(1) << "Error casting " << column_name << " (" << value
+              << ") to BIGINT. " << afinite.getError();
+      sqlite3_result_null(ctx);
+    } else {
+      sqlite3_result_int64(ctx, afinite.take());
+    }
+  } else if (type == DOUBLE_TYPE) {
+    char* end = nullptr;
+    double afinite = strtod(value.c_str(), &end);
+    if (end == nullptr || end == value.c_str() || *end != '\0') {
+      VLOG(1) << "Error casting " << column_name << " (" << value
+              << ") to DOUBLE";
+      sqlite3_result_null(ctx);
+    } else {
+      sqlite3_result_double(ctx, afinite);
+    }
+  } else {
+    LOG(ERROR) << "Error unknown column type " << column_name;
+  }
+}
+
 int DynamicTableRow::get_rowid(sqlite_int64 default_value,
                                sqlite_int64* pRowid) const {
   auto& current_row = this->row;
@@ -101,49 +146,13 @@ int DynamicTableRow::get_column(sqlite3_context* ctx,
   }
 
   // Attempt to cast each xFilter-populated row/column to the SQLite type.
-  const auto& value = row[column_name];
-  if (this->row.count(column_name) == 0) {
+  auto value_it = row.find(column_name);
+  if (value_it == row.end()) {
     // Missing content.
     VLOG(1) << "Error " << column_name << " is empty";
     sqlite3_result_null(ctx);
-  } else if (type == TEXT_TYPE || type == BLOB_TYPE) {
-    sqlite3_result_text(
-        ctx, value.c_str(), static_cast<int>(value.size()), SQLITE_TRANSIENT);
-  } else if (value.empty() &&
-             (type == INTEGER_TYPE || type == BIGINT_TYPE ||
-              type == UNSIGNED_BIGINT_TYPE || type == DOUBLE_TYPE)) {
-    // Don't Log a casting error for a known type if the column row is empty
-    sqlite3_result_null(ctx);
-  } else if (type == INTEGER_TYPE) {
-    auto afinite = tryTo<long>(value, 0);
-    if (afinite.isError()) {
-      VLOG(1) << "Error casting " << column_name << " (" << value
-              << ") to INTEGER. " << afinite.getError();
-      sqlite3_result_null(ctx);
-    } else {
-      sqlite3_result_int(ctx, afinite.take());
-    }
-  } else if (type == BIGINT_TYPE || type == UNSIGNED_BIGINT_TYPE) {
-    auto afinite = tryTo<long long>(value, 0);
-    if (afinite.isError()) {
-      VLOG(1) << "Error casting " << column_name << " (" << value
-              << ") to BIGINT. " << afinite.getError();
-      sqlite3_result_null(ctx);
-    } else {
-      sqlite3_result_int64(ctx, afinite.take());
-    }
-  } else if (type == DOUBLE_TYPE) {
-    char* end = nullptr;
-    double afinite = strtod(value.c_str(), &end);
-    if (end == nullptr || end == value.c_str() || *end != '\0') {
-      VLOG(1) << "Error casting " << column_name << " (" << value
-              << ") to DOUBLE";
-      sqlite3_result_null(ctx);
-    } else {
-      sqlite3_result_double(ctx, afinite);
-    }
   } else {
-    LOG(ERROR) << "Error unknown column type " << column_name;
+    resultFromText(ctx, column_name, type, value_it->second);
   }
 
   return SQLITE_OK;
@@ -157,6 +166,22 @@ Status DynamicTableRow::serialize(JSON& doc, rj::Value& obj) const {
   return Status::success();
 }
 
+void DynamicTableRow::serializeValues(
+    const std::vector<std::string>& columns,
+    rj::Writer<rj::StringBuffer>& writer) const {
+  writer.StartArray();
+  for (const auto& column : columns) {
+    auto it = row.find(column);
+    if (it == row.end()) {
+      writer.Null();
+    } else {
+      writer.String(it->second.data(),
+                    static_cast<rj::SizeType>(it->second.size()));
+    }
+  }
+  writer.EndArray();
+}
+
 TableRowHolder DynamicTableRow::clone() const {
   Row new_row = row;
   return TableRowHolder(new DynamicTableRow(std::move(new_row)));
@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include <osquery/core/sql/column.h>
 #include <osquery/core/sql/table_row.h>
 #include <osquery/core/sql/table_rows.h>
 #include <osquery/utils/json/json.h>
@@ -31,6 +32,9 @@ class DynamicTableRow : public TableRow {
   virtual int get_rowid(sqlite_int64 default_value, sqlite_int64* pRowid) const;
   virtual int get_column(sqlite3_context* ctx, sqlite3_vtab* pVtab, int col);
   virtual Status serialize(JSON& doc, rapidjson::Value& obj) const;
+  virtual void serializeValues(
+      const std::vector<std::string>& columns,
+      rapidjson::Writer<rapidjson::StringBuffer>& writer) const;
   virtual TableRowHolder clone() const;
   inline std::string& operator[](const std::string& key) {
     return row[key];
@@ -84,6 +88,17 @@ inline DynamicTableRowHolder make_table_row(
   return DynamicTableRowHolder(init);
 }
 
+/**
+ * @brief Set the SQLite result for a TEXT-encoded column value.
+ *
+ * The value is cast to the column's affinity, a value that cannot be cast
+ * results in NULL.
+ */
+void resultFromText(sqlite3_context* ctx,
+                    const std::string& column_name,
+                    ColumnType type,
+                    const std::string& value);
+
 /// Converts a QueryData struct to TableRows. Intended for use only in
 /// generated code.
 TableRows tableRowsFromQueryData(QueryData&& rows);
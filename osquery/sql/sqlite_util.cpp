@@ -39,6 +39,11 @@ CLI_FLAG(string,
 
 FLAG(string, nullvalue, "", "Set string for NULL values, default ''");
 
+FLAG(uint64,
+     statement_cache_size,
+     256,
+     "Number of prepared statements kept per SQLite connection (0 = off)");
+
 using OpReg = QueryPlanner::Opcode::Register;
 
 using SQLiteDBInstanceRef = std::shared_ptr<SQLiteDBInstance>;
@@ -181,14 +186,24 @@ Status SQLiteSQLPlugin::getQueryTables(const std::string& query,
   return Status(0);
 }
 
-SQLInternal::SQLInternal(const std::string& query, bool use_cache) {
-  auto dbc = SQLiteDBManager::get();
+SQLInternal::SQLInternal(const std::string& query, bool use_cache)
+    : SQLInternal(query, SQLiteDBManager::get(), use_cache) {}
+
+SQLInternal::SQLInternal(const std::string& query,
+                         const SQLiteDBInstanceRef& dbc,
+                         bool use_cache) {
+  // The connection counters are cumulative, only this query's use is kept.
+  auto hits = dbc->statementCacheHits();
+  auto misses = dbc->statementCacheMisses();
+
   dbc->useCache(use_cache);
   status_ = queryInternal(query, resultsTyped_, dbc);
 
   // One of the advantages of using SQLInternal (aside from the Registry-bypass)
   // is the ability to "deep-inspect" the table attributes and actions.
   event_based_ = (dbc->getAttributes() & TableAttributes::EVENT_BASED) != 0;
+  statement_cache_hits_ = dbc->statementCacheHits() - hits;
+  statement_cache_misses_ = dbc->statementCacheMisses() - misses;
 
   dbc->clearAffectedTables();
 }
@@ -254,10 +269,10 @@ void SQLInternal::escapeResults() {
   }
 }
 
-uint64_t SQLInternal::getSize() {
+static uint64_t getRowsSize(const QueryDataTyped& rows) {
   SizeVisitor visitor;
   uint64_t size = 0;
-  for (const auto& row : rowsTyped()) {
+  for (const auto& row : rows) {
     for (const auto& column : row) {
       size += column.first.size();
       boost::apply_visitor(visitor, column.second);
@@ -267,6 +282,35 @@ uint64_t SQLInternal::getSize() {
   return size;
 }
 
+uint64_t SQLInternal::getSize() {
+  return streamed_size_ + getRowsSize(resultsTyped_);
+}
+
+SQLInternal::SQLInternal(const std::string& query,
+                         const SQLiteDBInstanceRef& dbc,
+                         bool use_cache,
+                         size_t chunk_size,
+                         const RowChunkCallback& callback) {
+  auto hits = dbc->statementCacheHits();
+  auto misses = dbc->statementCacheMisses();
+
+  dbc->useCache(use_cache);
+  status_ = queryInternal(
+      query,
+      chunk_size,
+      [this, &callback](QueryDataTyped& rows) {
+        streamed_size_ += getRowsSize(rows);
+        return callback(rows);
+      },
+      dbc);
+
+  event_based_ = (dbc->getAttributes() & TableAttributes::EVENT_BASED) != 0;
+  statement_cache_hits_ = dbc->statementCacheHits() - hits;
+  statement_cache_misses_ = dbc->statementCacheMisses() - misses;
+
+  dbc->clearAffectedTables();
+}
+
 Status SQLiteSQLPlugin::attach(const std::string& name) {
   PluginResponse response;
   auto status =
@@ -284,7 +328,12 @@ Status SQLiteSQLPlugin::attach(const std::string& name) {
   auto dbc = SQLiteDBManager::getConnection(true);
 
   // Attach as an extension, allowing read/write tables
-  return attachTableInternal(name, statement, dbc, is_extension);
+  status = attachTableInternal(name, statement, dbc, is_extension);
+  if (status.ok()) {
+    // Workers syncing on the generation must see the attached table.
+    SQLiteDBManager::instance().attach_generation_++;
+  }
+  return status;
 }
 
 Status SQLiteSQLPlugin::detach(const std::string& name) {
@@ -292,7 +341,11 @@ Status SQLiteSQLPlugin::detach(const std::string& name) {
   // primary database. To allow this, getConnection can explicitly request the
   // primary instance and avoid the contention decisions.
   auto dbc = SQLiteDBManager::getConnection(true);
-  return detachTableInternal(name, dbc);
+  auto status = detachTableInternal(name, dbc);
+  if (status.ok()) {
+    SQLiteDBManager::instance().attach_generation_++;
+  }
+  return status;
 }
 
 SQLiteDBInstance::SQLiteDBInstance(sqlite3*& db, Mutex& mtx)
@@ -375,6 +428,21 @@ bool SQLiteDBInstance::useCache() const {
   return use_cache_;
 }
 
+void SQLiteDBInstance::setCacheStep(uint64_t step, uint64_t interval) {
+  // Virtual tables read the step from the instance owning the database.
+  auto& instance = owner();
+  instance.cache_step_ = step;
+  instance.cache_interval_ = interval;
+}
+
+uint64_t SQLiteDBInstance::cacheStep() const {
+  return cache_step_;
+}
+
+uint64_t SQLiteDBInstance::cacheInterval() const {
+  return cache_interval_;
+}
+
 RecursiveLock SQLiteDBInstance::attachLock() const {
   if (isPrimary()) {
     return RecursiveLock(kPrimaryAttachMutex);
@@ -382,6 +450,120 @@ RecursiveLock SQLiteDBInstance::attachLock() const {
   return RecursiveLock(attach_mutex_);
 }
 
+bool SQLiteStatementCache::take(const std::string& sql, Entry& entry) {
+  auto it = index_.find(sql);
+  if (it == index_.end()) {
+    return false;
+  }
+
+  entry = std::move(it->second->second);
+  entries_.erase(it->second);
+  index_.erase(it);
+  return true;
+}
+
+void SQLiteStatementCache::put(const std::string& sql,
+                               Entry entry,
+                               size_t capacity) {
+  auto it = index_.find(sql);
+  if (capacity == 0 || it != index_.end()) {
+    // The same SQL text was prepared again while this statement was in use.
+    sqlite3_finalize(entry.stmt);
+    return;
+  }
+
+  while (index_.size() >= capacity) {
+    auto& last = entries_.back();
+    sqlite3_finalize(last.second.stmt);
+    index_.erase(last.first);
+    entries_.pop_back();
+  }
+
+  entries_.emplace_front(sql, std::move(entry));
+  index_[sql] = entries_.begin();
+}
+
+void SQLiteStatementCache::clear() {
+  for (auto& entry : entries_) {
+    sqlite3_finalize(entry.second.stmt);
+  }
+  entries_.clear();
+  index_.clear();
+}
+
+SQLiteDBInstance& SQLiteDBInstance::owner() {
+  if (isPrimary() && !managed_) {
+    // Similarly to clearAffectedTables, the primary database state belongs to
+    // the DB manager's 'connection' instance.
+    return *SQLiteDBManager::getConnection(true);
+  }
+  return *this;
+}
+
+bool SQLiteDBInstance::takeStatement(const std::string& sql,
+                                     SQLiteStatementCache::Entry& entry) {
+  if (FLAGS_statement_cache_size == 0) {
+    return false;
+  }
+
+  auto& dbc = owner();
+  if (!dbc.statements_.take(sql, entry)) {
+    statement_cache_misses_++;
+    return false;
+  }
+
+  // The saved plans replace any state left under the same index numbers.
+  for (const auto& plan : entry.plans) {
+    auto& content = *plan.content;
+    for (const auto& constraints : plan.constraints) {
+      content.constraints[constraints.first] = constraints.second;
+    }
+    for (const auto& columns : plan.colsUsed) {
+      content.colsUsed[columns.first] = columns.second;
+    }
+    for (const auto& bitset : plan.colsUsedBitsets) {
+      content.colsUsedBitsets[bitset.first] = bitset.second;
+    }
+    dbc.addAffectedTable(plan.content);
+  }
+  statement_cache_hits_++;
+  return true;
+}
+
+void SQLiteDBInstance::recordStatementPlans(
+    SQLiteStatementCache::Entry& entry) {
+  if (FLAGS_statement_cache_size == 0) {
+    return;
+  }
+
+  // Tables planned by earlier statements of the same query are included.
+  // Their index numbers are unique so restoring them is harmless.
+  entry.plans.clear();
+  for (const auto& table : owner().affected_tables_) {
+    SQLiteStatementCache::TablePlan plan;
+    plan.content = table.second;
+    plan.constraints = table.second->constraints;
+    plan.colsUsed = table.second->colsUsed;
+    plan.colsUsedBitsets = table.second->colsUsedBitsets;
+    entry.plans.push_back(std::move(plan));
+  }
+}
+
+void SQLiteDBInstance::returnStatement(const std::string& sql,
+                                       SQLiteStatementCache::Entry entry) {
+  if (entry.stmt == nullptr) {
+    return;
+  }
+
+  sqlite3_reset(entry.stmt);
+  sqlite3_clear_bindings(entry.stmt);
+  owner().statements_.put(sql, std::move(entry), FLAGS_statement_cache_size);
+}
+
+void SQLiteDBInstance::clearStatements() {
+  owner().statements_.clear();
+}
+
 void SQLiteDBInstance::addAffectedTable(
     std::shared_ptr<VirtualTableContent> table) {
   // An xFilter/scan was requested for this virtual table.
@@ -424,9 +606,14 @@ void SQLiteDBInstance::clearAffectedTables() {
   // There is no concept of compounding tables between queries.
   affected_tables_.clear();
   use_cache_ = false;
+  cache_step_ = 0;
+  cache_interval_ = 0;
 }
 
 SQLiteDBInstance::~SQLiteDBInstance() {
+  // Statements must be finalized before the database is closed.
+  statements_.clear();
+
   if (!isPrimary() && db_ != nullptr) {
     sqlite3_close(db_);
   } else {
@@ -480,6 +667,9 @@ void SQLiteDBManager::resetPrimary() {
   auto& self = instance();
 
   WriteLock connection_lock(self.mutex_);
+  if (self.connection_ != nullptr) {
+    self.connection_->clearStatements();
+  }
   self.connection_.reset();
 
   {
@@ -533,6 +723,9 @@ SQLiteDBInstanceRef SQLiteDBManager::getConnection(bool primary) {
 }
 
 SQLiteDBManager::~SQLiteDBManager() {
+  if (connection_ != nullptr) {
+    connection_->clearStatements();
+  }
   connection_ = nullptr;
   if (db_ != nullptr) {
     sqlite3_close(db_);
@@ -636,9 +829,17 @@ Status queryInternal(const std::string& query,
   return status;
 }
 
-Status readRows(sqlite3_stmt* prepared_statement,
-                QueryDataTyped& results,
-                const SQLiteDBInstanceRef& instance) {
+/**
+ * @brief Read the rows of a prepared statement into results.
+ *
+ * If a callback is provided, it is called and results are cleared each time
+ * chunk_size rows are read, and once more for any remaining rows.
+ */
+static Status readRows(sqlite3_stmt* prepared_statement,
+                       QueryDataTyped& results,
+                       size_t chunk_size,
+                       const RowChunkCallback& callback,
+                       const SQLiteDBInstanceRef& instance) {
   // Do nothing with a null prepared_statement (eg, if the sql was just
   // whitespace)
   if (prepared_statement == nullptr) {
@@ -677,28 +878,34 @@ Status readRows(sqlite3_stmt* prepared_statement,
         }
       }
       results.push_back(std::move(row));
+      if (callback != nullptr && results.size() >= chunk_size) {
+        auto status = callback(results);
+        results.clear();
+        if (!status.ok()) {
+          return status;
+        }
+      }
       rc = sqlite3_step(prepared_statement);
     } while (SQLITE_ROW == rc);
   }
   if (rc != SQLITE_DONE) {
-    auto s = Status::failure(sqlite3_errmsg(instance->db()));
-    sqlite3_finalize(prepared_statement);
-    return s;
-  }
-
-  rc = sqlite3_finalize(prepared_statement);
-  if (rc != SQLITE_OK) {
     return Status::failure(sqlite3_errmsg(instance->db()));
   }
 
+  if (callback != nullptr && !results.empty()) {
+    auto status = callback(results);
+    results.clear();
+    return status;
+  }
   return Status::success();
 }
 
-Status queryInternal(const std::string& query,
-                     QueryDataTyped& results,
-                     const SQLiteDBInstanceRef& instance) {
-  sqlite3_stmt* prepared_statement{nullptr}; /* Statement to execute. */
-
+/// Execute each statement of a query, see readRows.
+static Status queryStatements(const std::string& query,
+                              QueryDataTyped& results,
+                              size_t chunk_size,
+                              const RowChunkCallback& callback,
+                              const SQLiteDBInstanceRef& instance) {
   int rc = SQLITE_OK; /* Return Code */
   const char* leftover_sql = nullptr; /* Tail of unprocessed SQL */
   const char* sql = query.c_str(); /* SQL to be processed */
@@ -711,25 +918,65 @@ Status queryInternal(const std::string& query,
     while (isspace(sql[0])) {
       sql++;
     }
-    rc = sqlite3_prepare_v2(
-        instance->db(), sql, -1, &prepared_statement, &leftover_sql);
-    if (rc != SQLITE_OK) {
-      Status s = Status::failure(sqlite3_errmsg(instance->db()));
-      sqlite3_finalize(prepared_statement);
-      return s;
+
+    if (sql[0] == '\0') {
+      break;
     }
 
-    Status s = readRows(prepared_statement, results, instance);
+    // A statement is keyed by the remaining SQL text, the length consumed
+    // when it was prepared locates the next statement.
+    std::string key(sql);
+    SQLiteStatementCache::Entry entry; /* Statement to execute. */
+    if (instance->takeStatement(key, entry)) {
+      leftover_sql = sql + entry.length;
+    } else {
+      rc = sqlite3_prepare_v2(
+          instance->db(), sql, -1, &entry.stmt, &leftover_sql);
+      if (rc != SQLITE_OK) {
+        Status s = Status::failure(sqlite3_errmsg(instance->db()));
+        sqlite3_finalize(entry.stmt);
+        return s;
+      }
+      entry.length = static_cast<size_t>(leftover_sql - sql);
+      instance->recordStatementPlans(entry);
+    }
+
+    Status s = readRows(entry.stmt, results, chunk_size, callback, instance);
     if (!s.ok()) {
+      sqlite3_finalize(entry.stmt);
       return s;
     }
 
+    if (FLAGS_statement_cache_size == 0) {
+      rc = sqlite3_finalize(entry.stmt);
+      if (rc != SQLITE_OK) {
+        return Status::failure(sqlite3_errmsg(instance->db()));
+      }
+    } else {
+      instance->returnStatement(key, std::move(entry));
+    }
+
     sql = leftover_sql;
   } /* end while */
   sqlite3_db_release_memory(instance->db());
   return Status::success();
 }
 
+Status queryInternal(const std::string& query,
+                     QueryDataTyped& results,
+                     const SQLiteDBInstanceRef& instance) {
+  return queryStatements(query, results, 0, nullptr, instance);
+}
+
+Status queryInternal(const std::string& query,
+                     size_t chunk_size,
+                     const RowChunkCallback& callback,
+                     const SQLiteDBInstanceRef& instance) {
+  QueryDataTyped rows;
+  rows.reserve(chunk_size);
+  return queryStatements(query, rows, chunk_size, callback, instance);
+}
+
 Status getQueryColumnsInternal(const std::string& q,
                                TableColumns& columns,
                                const SQLiteDBInstanceRef& instance) {
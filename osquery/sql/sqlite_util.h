@@ -10,9 +10,13 @@
 #pragma once
 
 #include <atomic>
+#include <functional>
+#include <list>
 #include <map>
 #include <mutex>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include <sqlite3.h>
 
@@ -86,6 +90,75 @@ const std::unordered_set<std::string> kAllowedSQLitePragmas = {
 
 class SQLiteDBManager;
 
+/**
+ * @brief A least-recently-used set of prepared statements keyed by SQL text.
+ *
+ * The schedule and distributed queries run the same SQL many times. Keeping
+ * the prepared statement means a repeat execution only needs a reset instead
+ * of a parse and plan.
+ *
+ * SQLite does not call xBestIndex for a statement that was already prepared,
+ * so the constraints and used columns recorded for each virtual table while
+ * planning are kept with the statement and restored before it is stepped.
+ */
+class SQLiteStatementCache : private boost::noncopyable {
+ public:
+  /// The per-query planning state of a virtual table.
+  struct TablePlan {
+    std::shared_ptr<VirtualTableContent> content;
+    std::unordered_map<size_t, ConstraintSet> constraints;
+    std::unordered_map<size_t, UsedColumns> colsUsed;
+    std::unordered_map<size_t, UsedColumnsBitset> colsUsedBitsets;
+  };
+
+  /// A prepared statement and the state needed to reuse it.
+  struct Entry {
+    sqlite3_stmt* stmt{nullptr};
+
+    /// Number of bytes of SQL text consumed when preparing the statement.
+    size_t length{0};
+
+    /// Virtual table planning state saved after preparing.
+    std::vector<TablePlan> plans;
+  };
+
+ public:
+  SQLiteStatementCache() = default;
+  ~SQLiteStatementCache() {
+    clear();
+  }
+
+  /**
+   * @brief Remove a statement from the cache.
+   *
+   * The statement is owned by the caller until it is returned with `put`.
+   * This means a statement is never stepped by two queries at once.
+   *
+   * @return true if a statement was cached for the SQL text.
+   */
+  bool take(const std::string& sql, Entry& entry);
+
+  /// Return a reset statement, evicting the least recently used if full.
+  void put(const std::string& sql, Entry entry, size_t capacity);
+
+  /// Finalize all cached statements.
+  void clear();
+
+  /// The number of cached statements.
+  size_t size() const {
+    return index_.size();
+  }
+
+ private:
+  using EntryList = std::list<std::pair<std::string, Entry>>;
+
+  /// Most recently used statements are at the front.
+  EntryList entries_;
+
+  /// Lookup from SQL text into the list of entries.
+  std::unordered_map<std::string, EntryList::iterator> index_;
+};
+
 /**
  * @brief An RAII wrapper around an `sqlite3` object.
  *
@@ -136,13 +209,61 @@ class SQLiteDBInstance : private boost::noncopyable {
   /// Check if the query requested use of the warm query cache.
   bool useCache() const;
 
+  /**
+   * @brief Set the schedule step and interval of the next query.
+   *
+   * Virtual tables pass them to cacheable tables through the QueryContext.
+   * They are reset with the affected tables once the query completes.
+   */
+  void setCacheStep(uint64_t step, uint64_t interval);
+
+  /// The schedule step of the executing query.
+  uint64_t cacheStep() const;
+
+  /// The scheduled interval of the executing query.
+  uint64_t cacheInterval() const;
+
   /// Lock the database for attaching virtual tables.
   RecursiveLock attachLock() const;
 
+  /**
+   * @brief Request a cached prepared statement for the SQL text.
+   *
+   * On a hit the virtual table planning state saved with the statement is
+   * restored and will be cleared with the other affected tables.
+   *
+   * @return true if a statement was cached, otherwise the caller prepares.
+   */
+  bool takeStatement(const std::string& sql,
+                     SQLiteStatementCache::Entry& entry);
+
+  /// Save the virtual table planning state for a newly prepared statement.
+  void recordStatementPlans(SQLiteStatementCache::Entry& entry);
+
+  /// Reset and return a statement to the cache, or finalize if disabled.
+  void returnStatement(const std::string& sql,
+                       SQLiteStatementCache::Entry entry);
+
+  /// Finalize cached statements, required when virtual tables change.
+  void clearStatements();
+
+  /// Number of statements reused by queries on this instance.
+  size_t statementCacheHits() const {
+    return statement_cache_hits_;
+  }
+
+  /// Number of statements prepared by queries on this instance.
+  size_t statementCacheMisses() const {
+    return statement_cache_misses_;
+  }
+
  private:
   /// Handle the primary/forwarding requests for table attribute accesses.
   TableAttributes getAttributes() const;
 
+  /// The instance owning the database state, see clearAffectedTables.
+  SQLiteDBInstance& owner();
+
  private:
   /// An opaque constructor only used by the DBManager.
   explicit SQLiteDBInstance(sqlite3* db)
@@ -158,6 +279,10 @@ class SQLiteDBInstance : private boost::noncopyable {
   /// True if this query should bypass table cache.
   bool use_cache_{false};
 
+  /// The schedule step and interval of the executing query.
+  uint64_t cache_step_{0};
+  uint64_t cache_interval_{0};
+
   /// Either the managed primary database or an ephemeral instance.
   sqlite3* db_{nullptr};
 
@@ -184,12 +309,21 @@ class SQLiteDBInstance : private boost::noncopyable {
   /// Vector of tables that need their constraints cleared after execution.
   std::map<std::string, std::shared_ptr<VirtualTableContent>> affected_tables_;
 
+  /// Prepared statements for this instance's database.
+  SQLiteStatementCache statements_;
+
+  /// Statement cache accounting for queries using this instance.
+  size_t statement_cache_hits_{0};
+  size_t statement_cache_misses_{0};
+
  private:
   friend class SQLiteDBManager;
   friend class SQLInternal;
 
  private:
   FRIEND_TEST(SQLiteUtilTests, test_affected_tables);
+  FRIEND_TEST(SQLiteUtilTests, test_statement_cache);
+  FRIEND_TEST(SQLiteUtilTests, test_statement_cache_plan_collision);
 };
 
 using SQLiteDBInstanceRef = std::shared_ptr<SQLiteDBInstance>;
@@ -253,6 +387,17 @@ class SQLiteDBManager : private boost::noncopyable {
    */
   static bool isDisabled(const std::string& table_name);
 
+  /**
+   * @brief A counter incremented when tables are attached or detached.
+   *
+   * Long-lived transient connections, from getUnique, only include the tables
+   * registered when they were created. Compare generations to know when such
+   * a connection must be recreated, for example after an extension starts.
+   */
+  static size_t attachGeneration() {
+    return instance().attach_generation_;
+  }
+
  protected:
   SQLiteDBManager();
   virtual ~SQLiteDBManager();
@@ -274,6 +419,9 @@ class SQLiteDBManager : private boost::noncopyable {
   /// A write mutex for initializing the primary database.
   Mutex create_mutex_;
 
+  /// See attachGeneration.
+  std::atomic<size_t> attach_generation_{0};
+
   /// Member variable to hold set of disabled tables.
   std::unordered_set<std::string> disabled_tables_;
 
@@ -399,6 +547,32 @@ Status queryInternal(const std::string& q,
                      QueryData& results,
                      const SQLiteDBInstanceRef& instance);
 
+/// Receives each chunk of rows read while executing a query.
+using RowChunkCallback = std::function<Status(QueryDataTyped& rows)>;
+
+/**
+ * @brief SQLite Internal: Execute a query and handle rows in chunks.
+ *
+ * Rows are passed to the callback as soon as chunk_size rows are read, and
+ * the remaining rows are passed once the query completes. The chunk is
+ * cleared after each call, so the typed results are not accumulated. Tables
+ * using a generator yield their rows as SQLite steps, so memory follows the
+ * chunk size; other tables generate all of their rows before SQLite reads the
+ * first one. A failed status from the callback stops the query and is
+ * returned.
+ *
+ * @param q the query to execute
+ * @param chunk_size the maximum number of rows passed to the callback
+ * @param callback called with each chunk of rows
+ * @param db the SQLite3 database to execute query q against
+ *
+ * @return A status indicating SQL query results.
+ */
+Status queryInternal(const std::string& q,
+                     size_t chunk_size,
+                     const RowChunkCallback& callback,
+                     const SQLiteDBInstanceRef& instance);
+
 /**
  * @brief SQLite Intern: Analyze a query, providing information about the
  * result columns
@@ -432,6 +606,38 @@ class SQLInternal : private only_movable {
    */
   explicit SQLInternal(const std::string& query, bool use_cache = false);
 
+  /**
+   * @brief Instantiate an instance of the class using a specific connection.
+   *
+   * Callers running queries concurrently may keep their own transient
+   * connection, see SQLiteDBManager::getUnique.
+   *
+   * @param query An osquery SQL query.
+   * @param dbc The SQLite connection used to run the query.
+   * @param use_cache [optional] Set true to use the query cache.
+   */
+  SQLInternal(const std::string& query,
+              const SQLiteDBInstanceRef& dbc,
+              bool use_cache = false);
+
+  /**
+   * @brief Instantiate an instance of the class that streams the results.
+   *
+   * Rows are not kept, see the chunked queryInternal. The size of the
+   * streamed rows is still accounted for by getSize.
+   *
+   * @param query An osquery SQL query.
+   * @param dbc The SQLite connection used to run the query.
+   * @param use_cache Set true to use the query cache.
+   * @param chunk_size The maximum number of rows passed to the callback.
+   * @param callback Called with each chunk of rows.
+   */
+  SQLInternal(const std::string& query,
+              const SQLiteDBInstanceRef& dbc,
+              bool use_cache,
+              size_t chunk_size,
+              const RowChunkCallback& callback);
+
  public:
   /**
    * @brief Const accessor for the rows returned by the query.
@@ -461,14 +667,31 @@ class SQLInternal : private only_movable {
   /// Returns the size
   uint64_t getSize();
 
+  /// Number of statements executed from the prepared statement cache.
+  size_t statementCacheHits() const {
+    return statement_cache_hits_;
+  }
+
+  /// Number of statements that were prepared by the query.
+  size_t statementCacheMisses() const {
+    return statement_cache_misses_;
+  }
+
  private:
   /// The internal member which holds the typed results of the query.
   QueryDataTyped resultsTyped_;
 
+  /// Size of the rows passed to a chunk callback.
+  uint64_t streamed_size_{0};
+
   /// The internal member which holds the status of the query.
   Status status_;
   /// Before completing the execution, store a check for EVENT_BASED.
   bool event_based_{false};
+
+  /// Prepared statement cache accounting for the query.
+  size_t statement_cache_hits_{0};
+  size_t statement_cache_misses_{0};
 };
 
 /**
@@ -14,6 +14,7 @@
 #include <osquery/sql/sql.h>
 #include <osquery/sql/sqlite_util.h>
 #include <osquery/sql/tests/sql_test_utils.h>
+#include <osquery/sql/virtual_table.h>
 #include <osquery/utils/info/platform_type.h>
 
 #include <gtest/gtest.h>
@@ -124,6 +125,53 @@ TEST_F(SQLiteUtilTests, test_direct_query_execution) {
   EXPECT_EQ(results, getTestDBExpectedResults());
 }
 
+TEST_F(SQLiteUtilTests, test_chunked_query_execution) {
+  auto dbc = getTestDBC();
+  auto expected = getTestDBExpectedResults();
+  ASSERT_GT(expected.size(), 1U);
+
+  QueryDataTyped results;
+  size_t chunks = 0;
+  auto status = queryInternal(
+      kTestQuery,
+      1,
+      [&results, &chunks](QueryDataTyped& rows) {
+        EXPECT_EQ(rows.size(), 1U);
+        chunks++;
+        std::move(rows.begin(), rows.end(), std::back_inserter(results));
+        return Status::success();
+      },
+      dbc);
+  EXPECT_TRUE(status.ok());
+  EXPECT_EQ(chunks, expected.size());
+  EXPECT_EQ(results, expected);
+
+  // A chunk larger than the results is passed once the query completes.
+  chunks = 0;
+  status = queryInternal(kTestQuery,
+                         expected.size() + 1,
+                         [&chunks, &expected](QueryDataTyped& rows) {
+                           chunks++;
+                           EXPECT_EQ(rows, expected);
+                           return Status::success();
+                         },
+                         dbc);
+  EXPECT_TRUE(status.ok());
+  EXPECT_EQ(chunks, 1U);
+
+  // A failure from the callback stops the query.
+  chunks = 0;
+  status = queryInternal(kTestQuery,
+                         1,
+                         [&chunks](QueryDataTyped& rows) {
+                           chunks++;
+                           return Status::failure("stop");
+                         },
+                         dbc);
+  EXPECT_FALSE(status.ok());
+  EXPECT_EQ(chunks, 1U);
+}
+
 TEST_F(SQLiteUtilTests, test_aggregate_query) {
   auto dbc = getTestDBC();
   QueryDataTyped results;
@@ -185,6 +233,106 @@ TEST_F(SQLiteUtilTests, test_affected_tables) {
   EXPECT_EQ(dbc->affected_tables_.size(), 0U);
 }
 
+TEST_F(SQLiteUtilTests, test_statement_cache) {
+  auto dbc = getTestDBC();
+  std::string query = "SELECT hour FROM time WHERE hour >= 0";
+  QueryDataTyped results;
+  ASSERT_TRUE(queryInternal(query, results, dbc).ok());
+  EXPECT_EQ(dbc->statementCacheMisses(), 1U);
+  EXPECT_EQ(dbc->statementCacheHits(), 0U);
+  EXPECT_EQ(dbc->statements_.size(), 1U);
+  dbc->clearAffectedTables();
+
+  QueryDataTyped cached_results;
+  ASSERT_TRUE(queryInternal(query, cached_results, dbc).ok());
+  EXPECT_EQ(dbc->statementCacheMisses(), 1U);
+  EXPECT_EQ(dbc->statementCacheHits(), 1U);
+  EXPECT_EQ(results.size(), cached_results.size());
+
+  // The constraints planned when the statement was prepared are restored.
+  ASSERT_EQ(dbc->affected_tables_.count("time"), 1U);
+  EXPECT_FALSE(dbc->affected_tables_.at("time")->constraints.empty());
+  dbc->clearAffectedTables();
+
+  // Changing the set of virtual tables drops the prepared statements.
+  detachTableInternal("time", dbc);
+  EXPECT_EQ(dbc->statements_.size(), 0U);
+}
+
+TEST_F(SQLiteUtilTests, test_statement_cache_plan_collision) {
+  auto dbc = getTestDBC();
+  std::string query = "SELECT hour FROM time WHERE hour >= 0";
+  QueryDataTyped results;
+  ASSERT_TRUE(queryInternal(query, results, dbc).ok());
+  ASSERT_EQ(dbc->affected_tables_.count("time"), 1U);
+  auto content = dbc->affected_tables_.at("time");
+  auto constraints = content->constraints;
+  auto columns = content->colsUsed;
+  auto bitsets = content->colsUsedBitsets;
+  ASSERT_FALSE(constraints.empty());
+  dbc->clearAffectedTables();
+
+  // Plan another statement, and leave its state under the first indexes.
+  results.clear();
+  std::string other = "SELECT minutes, seconds FROM time WHERE minutes = 1";
+  ASSERT_TRUE(queryInternal(other, results, dbc).ok());
+  ASSERT_FALSE(content->constraints.empty());
+  auto other_idx = content->constraints.begin()->first;
+  ASSERT_EQ(constraints.count(other_idx), 0U);
+  for (const auto& plan : constraints) {
+    content->constraints[plan.first] = content->constraints.at(other_idx);
+    content->colsUsed[plan.first] = content->colsUsed.at(other_idx);
+    content->colsUsedBitsets[plan.first] =
+        content->colsUsedBitsets.at(other_idx);
+  }
+
+  // Reusing the first statement restores its own plans.
+  SQLiteStatementCache::Entry entry;
+  ASSERT_TRUE(dbc->takeStatement(query, entry));
+  for (const auto& plan : constraints) {
+    const auto& restored = content->constraints.at(plan.first);
+    ASSERT_EQ(restored.size(), plan.second.size());
+    for (size_t i = 0; i < restored.size(); ++i) {
+      EXPECT_EQ(restored[i].first, plan.second[i].first);
+      EXPECT_EQ(restored[i].second.expr, plan.second[i].second.expr);
+    }
+    EXPECT_EQ(content->colsUsed.at(plan.first), columns.at(plan.first));
+    EXPECT_EQ(content->colsUsedBitsets.at(plan.first),
+              bitsets.at(plan.first));
+  }
+
+  dbc->returnStatement(query, std::move(entry));
+  dbc->clearAffectedTables();
+}
+
+TEST_F(SQLiteUtilTests, test_statement_cache_query_counts) {
+  auto dbc = getTestDBC();
+  std::string query = "SELECT hour FROM time WHERE hour >= 0";
+
+  // Each query reports its own use of the connection's statement cache.
+  SQLInternal first(query, dbc, false);
+  EXPECT_EQ(first.statementCacheMisses(), 1U);
+  EXPECT_EQ(first.statementCacheHits(), 0U);
+
+  for (size_t i = 0; i < 2; ++i) {
+    SQLInternal sql(query, dbc, false);
+    EXPECT_EQ(sql.statementCacheMisses(), 0U);
+    EXPECT_EQ(sql.statementCacheHits(), 1U);
+  }
+}
+
+TEST_F(SQLiteUtilTests, test_cache_step) {
+  auto dbc = getTestDBC();
+  dbc->setCacheStep(7, 5);
+  EXPECT_EQ(dbc->cacheStep(), 7U);
+  EXPECT_EQ(dbc->cacheInterval(), 5U);
+
+  // The step only applies to the next query.
+  dbc->clearAffectedTables();
+  EXPECT_EQ(dbc->cacheStep(), 0U);
+  EXPECT_EQ(dbc->cacheInterval(), 0U);
+}
+
 TEST_F(SQLiteUtilTests, test_table_attributes_event_based) {
   {
     SQLInternal sql_internal("select * from process_events");
@@ -14,6 +14,7 @@
 #include <osquery/database/database.h>
 #include <osquery/logger/logger.h>
 #include <osquery/registry/registry.h>
+#include <osquery/sql/columnar_table_row.h>
 #include <osquery/sql/dynamic_table_row.h>
 #include <osquery/sql/sql.h>
 
@@ -22,6 +23,8 @@
 namespace osquery {
 
 DECLARE_bool(ignore_table_exceptions);
+DECLARE_bool(disable_caching);
+DECLARE_uint64(extensions_batch_rows);
 
 class VirtualTableTests : public testing::Test {
  public:
@@ -516,14 +519,14 @@ class tableCacheTablePlugin : public TablePlugin {
   }
 
   TableRows generate(QueryContext& ctx) override {
-    if (isCached(60, ctx)) {
-      return getCache();
+    TableRows result;
+    if (getCache(60, ctx, result)) {
+      return result;
     }
 
     generates_++;
     auto r = make_table_row();
     r["i"] = "1";
-    TableRows result;
     result.push_back(std::move(r));
     setCache(60, 1, ctx, result);
     return result;
@@ -597,6 +600,64 @@ TEST_F(VirtualTableTests, test_table_results_cache) {
   EXPECT_EQ(results.size(), 1U);
   // The table should NOT have used the cache.
   EXPECT_EQ(cache->generates_, 5U);
+
+  // Disabling caching will always generate results.
+  FLAGS_disable_caching = true;
+  results.clear();
+  statement = "SELECT * from table_cache;";
+  queryInternal(statement, results, dbc);
+  EXPECT_EQ(results.size(), 1U);
+  EXPECT_EQ(cache->generates_, 6U);
+  FLAGS_disable_caching = false;
+}
+
+class filterCacheTablePlugin : public tableCacheTablePlugin {
+ public:
+  TableColumns columns() const override {
+    return {
+        std::make_tuple("i",
+                        TEXT_TYPE,
+                        ColumnOptions::INDEX | ColumnOptions::FILTER_ONLY),
+        std::make_tuple("d", TEXT_TYPE, ColumnOptions::DEFAULT),
+    };
+  }
+};
+
+TEST_F(VirtualTableTests, test_table_results_cache_filter) {
+  auto tables = RegistryFactory::get().registry("table");
+  auto cache = std::make_shared<filterCacheTablePlugin>();
+  tables->add("table_cache_filter", cache);
+  auto dbc = SQLiteDBManager::getUnique();
+  attachTableInternal(
+      "table_cache_filter", cache->columnDefinition(false), dbc, false);
+  dbc->useCache(true);
+
+  QueryData results;
+  std::string statement = "SELECT * from table_cache_filter;";
+  auto status = queryInternal(statement, results, dbc);
+  ASSERT_TRUE(status.ok());
+  EXPECT_EQ(results.size(), 1U);
+  EXPECT_EQ(cache->generates_, 1U);
+
+  // The index only filters rows, so it is answered by the cached results.
+  results.clear();
+  statement = "SELECT * from table_cache_filter where i = '1';";
+  queryInternal(statement, results, dbc);
+  EXPECT_EQ(results.size(), 1U);
+  EXPECT_EQ(cache->generates_, 1U);
+
+  results.clear();
+  statement = "SELECT * from table_cache_filter where i = '2';";
+  queryInternal(statement, results, dbc);
+  EXPECT_EQ(results.size(), 0U);
+  EXPECT_EQ(cache->generates_, 1U);
+
+  // So is a constraint on a column without options.
+  results.clear();
+  statement = "SELECT * from table_cache_filter where d = 'x';";
+  queryInternal(statement, results, dbc);
+  EXPECT_EQ(results.size(), 0U);
+  EXPECT_EQ(cache->generates_, 1U);
 }
 
 TEST_F(VirtualTableTests, test_table_results_cache_colcheck) {
@@ -681,6 +742,337 @@ TEST_F(VirtualTableTests, test_yield_generator) {
   EXPECT_EQ(results[0]["index"], "10");
 }
 
+class countingYieldTablePlugin : public TablePlugin {
+ private:
+  TableColumns columns() const override {
+    return {
+        std::make_tuple("index", INTEGER_TYPE, ColumnOptions::DEFAULT),
+    };
+  }
+
+ public:
+  bool usesGenerator() const override {
+    return true;
+  }
+
+  void generator(RowYield& yield, QueryContext& qc) override {
+    for (size_t i = 0; i < 100; i++) {
+      auto r = make_table_row();
+      r["index"] = std::to_string(i);
+      ++yielded;
+      yield(std::move(r));
+    }
+  }
+
+  size_t yielded{0};
+};
+
+TEST_F(VirtualTableTests, test_chunked_yield_generator) {
+  auto table = std::make_shared<countingYieldTablePlugin>();
+  auto table_registry = RegistryFactory::get().registry("table");
+  table_registry->add("counting_yield", table);
+
+  auto dbc = SQLiteDBManager::getUnique();
+  attachTableInternal(
+      "counting_yield", table->columnDefinition(false), dbc, false);
+
+  // Each chunk is passed before the generator yields the rows of the next.
+  size_t read = 0;
+  auto status = queryInternal(
+      "SELECT * from counting_yield",
+      10,
+      [&table, &read](QueryDataTyped& rows) {
+        read += rows.size();
+        EXPECT_LE(table->yielded, read + 1);
+        return Status::success();
+      },
+      dbc);
+  dbc->clearAffectedTables();
+  EXPECT_TRUE(status.ok());
+  EXPECT_EQ(read, 100U);
+  EXPECT_EQ(table->yielded, 100U);
+}
+
+class columnarTablePlugin : public TablePlugin {
+ private:
+  TableColumns columns() const override {
+    return {
+        std::make_tuple("id", BIGINT_TYPE, ColumnOptions::DEFAULT),
+        std::make_tuple("name", TEXT_TYPE, ColumnOptions::DEFAULT),
+        std::make_tuple("ratio", DOUBLE_TYPE, ColumnOptions::DEFAULT),
+        std::make_tuple("size", INTEGER_TYPE, ColumnOptions::DEFAULT),
+    };
+  }
+
+  ColumnAliasSet columnAliases() const override {
+    return {
+        {"name", {"label"}},
+    };
+  }
+
+ public:
+  TableRows generate(QueryContext& context) override {
+    auto schema = context.rowSchema();
+    auto id = schema->slot("id");
+    auto name = schema->slot("name");
+    auto ratio = schema->slot("ratio");
+    auto size = schema->slot("size");
+
+    TableRows results;
+    for (int i = 0; i < 3; i++) {
+      auto r = std::make_unique<ColumnarTableRow>(schema);
+      r->set(id, i);
+      r->set(name, "row" + std::to_string(i));
+      r->set(ratio, i * 0.5);
+      if (i != 1) {
+        // A TEXT value in a numeric column is cast when read.
+        r->set(size, std::to_string(i * 10));
+      }
+      results.push_back(std::move(r));
+    }
+    return results;
+  }
+};
+
+TEST_F(VirtualTableTests, test_columnar_table_rows) {
+  auto table = std::make_shared<columnarTablePlugin>();
+  auto table_registry = RegistryFactory::get().registry("table");
+  table_registry->add("columnar", table);
+
+  auto dbc = SQLiteDBManager::getUnique();
+  PluginResponse response;
+  ASSERT_TRUE(table->call({{"action", "columns"}}, response).ok());
+  attachTableInternal(
+      "columnar", columnDefinition(response, true, false), dbc, false);
+
+  QueryDataTyped results;
+  auto status = queryInternal(
+      "SELECT id, name, label, ratio, size FROM columnar WHERE id > 0",
+      results,
+      dbc);
+  dbc->clearAffectedTables();
+  ASSERT_TRUE(status.ok()) << status.getMessage();
+  ASSERT_EQ(results.size(), 2U);
+
+  EXPECT_EQ(boost::get<long long>(results[0]["id"]), 1LL);
+  EXPECT_EQ(boost::get<std::string>(results[0]["name"]), "row1");
+  EXPECT_EQ(boost::get<std::string>(results[0]["label"]), "row1");
+  EXPECT_EQ(boost::get<double>(results[0]["ratio"]), 0.5);
+  // An unset slot is returned as NULL.
+  EXPECT_EQ(boost::get<std::string>(results[0]["size"]), "");
+  EXPECT_EQ(boost::get<long long>(results[1]["size"]), 20LL);
+
+  // The row adapts to the string map representation used by extensions.
+  response.clear();
+  ASSERT_TRUE(table->call({{"action", "generate"}}, response).ok());
+  ASSERT_EQ(response.size(), 3U);
+  EXPECT_EQ(response[2]["id"], "2");
+  EXPECT_EQ(response[2]["name"], "row2");
+  EXPECT_EQ(response[2]["size"], "20");
+  EXPECT_EQ(response[1].count("size"), 0U);
+  EXPECT_EQ(response[1].count("label"), 0U);
+}
+
+TEST_F(VirtualTableTests, test_generate_batch) {
+  auto table = std::make_shared<columnarTablePlugin>();
+
+  // Only the used columns are sent, values keep their types.
+  QueryContext context;
+  context.colsUsed = UsedColumns({"id", "ratio"});
+  PluginRequest request = {{"action", "generate_batch"}, {"batch_size", "2"}};
+  TablePlugin::setRequestFromContext(context, request);
+
+  PluginResponse response;
+  ASSERT_TRUE(table->call(request, response).ok());
+  ASSERT_EQ(response.size(), 1U);
+  EXPECT_EQ(response[0]["columns"], "[\"id\",\"ratio\"]");
+  EXPECT_EQ(response[0]["rows"], "[[0,0.0],[1,0.5]]");
+  ASSERT_EQ(response[0].count("cursor"), 1U);
+
+  // The cursor returns the remaining rows and is then released.
+  auto cursor = response[0]["cursor"];
+  request = {{"action", "generate_batch"}, {"cursor", cursor}};
+  response.clear();
+  ASSERT_TRUE(table->call(request, response).ok());
+  ASSERT_EQ(response.size(), 1U);
+  EXPECT_EQ(response[0].count("columns"), 0U);
+  EXPECT_EQ(response[0]["rows"], "[[2,1.0]]");
+  EXPECT_EQ(response[0].count("cursor"), 0U);
+
+  response.clear();
+  EXPECT_FALSE(table->call(request, response).ok());
+  EXPECT_TRUE(
+      table->call({{"action", "close_batch"}, {"cursor", cursor}}, response)
+          .ok());
+}
+
+class batchedTablePlugin : public TablePlugin {
+ private:
+  TableColumns columns() const override {
+    return {
+        std::make_tuple("id", INTEGER_TYPE, ColumnOptions::DEFAULT),
+        std::make_tuple("size", UNSIGNED_BIGINT_TYPE, ColumnOptions::DEFAULT),
+        std::make_tuple("name", TEXT_TYPE, ColumnOptions::DEFAULT),
+    };
+  }
+
+ public:
+  TableRows generate(QueryContext& context) override {
+    auto schema = context.rowSchema();
+    auto id = schema->slot("id");
+    auto size = schema->slot("size");
+    auto name = schema->slot("name");
+
+    TableRows results;
+    for (int i = 0; i < 5; i++) {
+      auto r = std::make_unique<ColumnarTableRow>(schema);
+      r->set(id, i);
+      r->set(name, "row" + std::to_string(i));
+      if (i < 4) {
+        r->set(size, static_cast<uint64_t>(i) * 1000);
+      } else {
+        // Past the range of a BIGINT, read as the row path reads it.
+        r->set(size, std::numeric_limits<uint64_t>::max());
+      }
+      results.push_back(std::move(r));
+    }
+    return results;
+  }
+
+  /// Record the actions, optionally act as an extension without batches.
+  Status call(const PluginRequest& request, PluginResponse& response) override {
+    const auto& action = request.at("action");
+    actions.push_back(action);
+    if (action == "generate_batch" && !batches) {
+      return Status::failure("Unknown table plugin action: " + action);
+    }
+    if (action == "generate_batch" && fail_batches) {
+      return Status::failure("The extension table failed");
+    }
+    return TablePlugin::call(request, response);
+  }
+
+ public:
+  std::vector<std::string> actions;
+  bool batches{true};
+  bool fail_batches{false};
+};
+
+/// Attach a table plugin the way tables from extensions are attached.
+static void attachExtensionTable(const std::string& name,
+                                 std::shared_ptr<TablePlugin> table,
+                                 const SQLiteDBInstanceRef& dbc) {
+  RegistryFactory::get().registry("table")->add(name, table);
+  PluginResponse response;
+  ASSERT_TRUE(table->call({{"action", "columns"}}, response).ok());
+  attachTableInternal(name, columnDefinition(response, false, true), dbc, true);
+}
+
+TEST_F(VirtualTableTests, test_extension_table_batches) {
+  auto table = std::make_shared<batchedTablePlugin>();
+  auto dbc = SQLiteDBManager::getUnique();
+  attachExtensionTable("batched_ext", table, dbc);
+  table->actions.clear();
+
+  auto batch_rows = FLAGS_extensions_batch_rows;
+  FLAGS_extensions_batch_rows = 2;
+  QueryDataTyped results;
+  auto status =
+      queryInternal("SELECT id, size, name FROM batched_ext", results, dbc);
+  ASSERT_TRUE(status.ok()) << status.getMessage();
+
+  // xFilter reads the first batch and xNext requests the two others.
+  EXPECT_EQ(table->actions,
+            std::vector<std::string>(3, std::string("generate_batch")));
+  ASSERT_EQ(results.size(), 5U);
+  for (size_t i = 0; i < 4; i++) {
+    EXPECT_EQ(boost::get<long long>(results[i]["id"]),
+              static_cast<long long>(i));
+    EXPECT_EQ(boost::get<long long>(results[i]["size"]),
+              static_cast<long long>(i) * 1000);
+    EXPECT_EQ(boost::get<std::string>(results[i]["name"]),
+              "row" + std::to_string(i));
+  }
+  QueryDataTyped batched_results = results;
+
+  // An unfinished scan releases the rows held by the extension.
+  table->actions.clear();
+  results.clear();
+  status = queryInternal("SELECT id FROM batched_ext LIMIT 1", results, dbc);
+  ASSERT_TRUE(status.ok()) << status.getMessage();
+  ASSERT_EQ(results.size(), 1U);
+  EXPECT_EQ(table->actions,
+            std::vector<std::string>({"generate_batch", "close_batch"}));
+
+  // The row path returns the same values, including the UNSIGNED_BIGINT
+  // value that does not fit in a long long.
+  FLAGS_extensions_batch_rows = 0;
+  table->actions.clear();
+  results.clear();
+  status =
+      queryInternal("SELECT id, size, name FROM batched_ext", results, dbc);
+  FLAGS_extensions_batch_rows = batch_rows;
+  ASSERT_TRUE(status.ok()) << status.getMessage();
+  EXPECT_EQ(table->actions, std::vector<std::string>({"generate"}));
+  EXPECT_EQ(results, batched_results);
+}
+
+TEST_F(VirtualTableTests, test_extension_table_batches_fallback) {
+  auto table = std::make_shared<batchedTablePlugin>();
+  table->batches = false;
+  auto dbc = SQLiteDBManager::getUnique();
+  attachExtensionTable("unbatched_ext", table, dbc);
+  table->actions.clear();
+
+  auto batch_rows = FLAGS_extensions_batch_rows;
+  FLAGS_extensions_batch_rows = 2;
+  QueryDataTyped results;
+  auto status = queryInternal("SELECT id FROM unbatched_ext", results, dbc);
+  ASSERT_TRUE(status.ok()) << status.getMessage();
+  ASSERT_EQ(results.size(), 5U);
+  EXPECT_EQ(boost::get<long long>(results[4]["id"]), 4LL);
+  EXPECT_EQ(table->actions,
+            std::vector<std::string>({"generate_batch", "generate"}));
+
+  // The table is not asked for batches again.
+  table->actions.clear();
+  results.clear();
+  status = queryInternal("SELECT id FROM unbatched_ext", results, dbc);
+  FLAGS_extensions_batch_rows = batch_rows;
+  ASSERT_TRUE(status.ok()) << status.getMessage();
+  EXPECT_EQ(results.size(), 5U);
+  EXPECT_EQ(table->actions, std::vector<std::string>({"generate"}));
+}
+
+TEST_F(VirtualTableTests, test_extension_table_batches_failure) {
+  auto table = std::make_shared<batchedTablePlugin>();
+  table->fail_batches = true;
+  auto dbc = SQLiteDBManager::getUnique();
+  attachExtensionTable("failing_batched_ext", table, dbc);
+  table->actions.clear();
+
+  auto batch_rows = FLAGS_extensions_batch_rows;
+  FLAGS_extensions_batch_rows = 2;
+  QueryDataTyped results;
+  auto status =
+      queryInternal("SELECT id FROM failing_batched_ext", results, dbc);
+
+  // Only an unknown action falls back to generate, other failures fail.
+  EXPECT_FALSE(status.ok());
+  EXPECT_EQ(table->actions, std::vector<std::string>({"generate_batch"}));
+
+  // The table is still asked for batches by the next query.
+  table->fail_batches = false;
+  table->actions.clear();
+  results.clear();
+  status = queryInternal("SELECT id FROM failing_batched_ext", results, dbc);
+  FLAGS_extensions_batch_rows = batch_rows;
+  ASSERT_TRUE(status.ok()) << status.getMessage();
+  EXPECT_EQ(results.size(), 5U);
+  EXPECT_EQ(table->actions,
+            std::vector<std::string>(3, std::string("generate_batch")));
+}
+
 class likeTablePlugin : public TablePlugin {
  private:
   TableColumns columns() const override {
@@ -10,6 +10,8 @@
 #include <atomic>
 #include <unordered_set>
 
+#include <boost/algorithm/string/case_conv.hpp>
+
 #include <osquery/core/core.h>
 #include <osquery/core/flagalias.h>
 #include <osquery/core/flags.h>
@@ -17,6 +19,7 @@
 #include <osquery/logger/logger.h>
 #include <osquery/process/process.h>
 #include <osquery/registry/registry_factory.h>
+#include <osquery/sql/columnar_table_row.h>
 #include <osquery/sql/dynamic_table_row.h>
 #include <osquery/sql/virtual_table.h>
 #include <osquery/utils/conversions/tryto.h>
@@ -35,6 +38,11 @@ FLAG(bool,
      true,
      "Enable INDEX on all extension table columns (default true)");
 
+FLAG(uint64,
+     extensions_batch_rows,
+     4096,
+     "Rows requested per batch from extension tables, 0 disables batching");
+
 /* NOTE: the default is false, because it's easier to enable it in one place
    when starting osquery, instead of having each test enable them,
    so that they are seen and fixed. */
@@ -301,6 +309,108 @@ static void plan(const std::string& output) {
   }
 }
 
+/**
+ * @brief Check if an extension failed a request because it has no such action.
+ *
+ * TablePlugin::call and the other SDKs word it differently, but all of them
+ * report an unknown action.
+ */
+static bool isUnknownActionError(const Status& status) {
+  auto message = boost::algorithm::to_lower_copy(status.getMessage());
+  return message.find("unknown") != std::string::npos &&
+         message.find("action") != std::string::npos;
+}
+
+/**
+ * @brief Read the next batch of an extension table's rows into a cursor.
+ *
+ * See TablePlugin::generateBatch for the request and response layout. Values
+ * are stored by slot, numbers keep the type the extension sent.
+ */
+static Status getExtensionBatch(BaseCursor* pCur,
+                                const VirtualTableContent& content,
+                                const PluginRequest& request) {
+  PluginResponse response;
+  auto status = Registry::call("table", content.name, request, response);
+  if (!status.ok()) {
+    return status;
+  }
+
+  if (response.size() != 1 || response[0].count("rows") == 0) {
+    return Status::failure("Invalid batch response from the extension table");
+  }
+
+  auto& item = response[0];
+  if (item.count("columns") > 0) {
+    auto doc = JSON::newArray();
+    status = doc.fromString(item.at("columns"));
+    if (!status.ok() || !doc.doc().IsArray()) {
+      return Status::failure("Invalid batch columns from the extension table");
+    }
+
+    pCur->batch_slots.clear();
+    for (const auto& name : doc.doc().GetArray()) {
+      pCur->batch_slots.push_back(name.IsString()
+                                      ? content.schema->slot(name.GetString())
+                                      : ColumnarSchema::npos);
+    }
+  }
+
+  // The response is owned here, parse the rows in place to avoid copies.
+  rapidjson::Document rows;
+  rows.ParseInsitu(&item.at("rows")[0]);
+  if (rows.HasParseError() || !rows.IsArray()) {
+    return Status::failure("Invalid batch rows from the extension table");
+  }
+
+  pCur->batch_offset += pCur->n;
+  pCur->rows.clear();
+  pCur->rows.reserve(rows.Size());
+  for (const auto& values : rows.GetArray()) {
+    if (!values.IsArray()) {
+      return Status::failure("Invalid batch row from the extension table");
+    }
+
+    auto row = std::make_unique<ColumnarTableRow>(content.schema);
+    auto count = std::min(static_cast<size_t>(values.Size()),
+                          pCur->batch_slots.size());
+    for (size_t i = 0; i < count; ++i) {
+      const auto& value = values[static_cast<rapidjson::SizeType>(i)];
+      auto slot = pCur->batch_slots[i];
+      if (value.IsString()) {
+        row->set(slot,
+                 std::string(value.GetString(), value.GetStringLength()));
+      } else if (value.IsInt64()) {
+        row->set(slot, value.GetInt64());
+      } else if (value.IsUint64()) {
+        // Beyond the range of long long, read it as text like generate rows.
+        row->set(slot, std::to_string(value.GetUint64()));
+      } else if (value.IsNumber()) {
+        row->set(slot, value.GetDouble());
+      }
+    }
+    pCur->rows.push_back(std::move(row));
+  }
+
+  pCur->row = 0;
+  pCur->n = pCur->rows.size();
+  pCur->batch_cursor =
+      (item.count("cursor") > 0) ? std::move(item.at("cursor")) : "";
+  return Status::success();
+}
+
+/// Release the rows an extension holds for an unfinished batched scan.
+static void closeExtensionBatch(BaseCursor* pCur, const std::string& name) {
+  if (pCur->batch_cursor.empty()) {
+    return;
+  }
+
+  PluginRequest request = {{"action", "close_batch"},
+                           {"cursor", pCur->batch_cursor}};
+  Registry::call("table", name, request);
+  pCur->batch_cursor.clear();
+}
+
 int xOpen(sqlite3_vtab* tab, sqlite3_vtab_cursor** ppCursor) {
   auto* pCur = new BaseCursor;
   auto* pVtab = (VirtualTable*)tab;
@@ -318,6 +428,7 @@ int xOpen(sqlite3_vtab* tab, sqlite3_vtab_cursor** ppCursor) {
 int xClose(sqlite3_vtab_cursor* cur) {
   BaseCursor* pCur = (BaseCursor*)cur;
   plan("Closing cursor (" + std::to_string(pCur->id) + ")");
+  closeExtensionBatch(pCur, ((VirtualTable*)cur->pVtab)->content->name);
   delete pCur;
   return SQLITE_OK;
 }
@@ -355,6 +466,23 @@ int xNext(sqlite3_vtab_cursor* cur) {
     }
   }
   pCur->row++;
+
+  // Request the next batch once an extension table's rows are consumed.
+  if (pCur->row >= pCur->n && !pCur->batch_cursor.empty()) {
+    auto* pVtab = (VirtualTable*)cur->pVtab;
+    PluginRequest request = {
+        {"action", "generate_batch"},
+        {"cursor", pCur->batch_cursor},
+        {"batch_size", std::to_string(FLAGS_extensions_batch_rows)}};
+    pCur->batch_cursor.clear();
+    auto status = getExtensionBatch(pCur, *pVtab->content, request);
+    if (!status.ok()) {
+      VLOG(1) << "Invalid batch from the extension table. Error "
+              << status.getCode() << ": " << status.getMessage();
+      setTableErrorMessage(cur->pVtab, status.getMessage());
+      return SQLITE_ERROR;
+    }
+  }
   return SQLITE_OK;
 }
 
@@ -370,7 +498,7 @@ int xRowid(sqlite3_vtab_cursor* cur, sqlite_int64* pRowid) {
   // Use the rowid returned by the extension, if available; most likely, this
   // will only be used by extensions providing read/write tables
   const auto& current_row = *data_it;
-  return current_row->get_rowid(pCur->row, pRowid);
+  return current_row->get_rowid(pCur->batch_offset + pCur->row, pRowid);
 }
 
 int xUpdate(sqlite3_vtab* p,
@@ -675,6 +803,10 @@ int xCreate(sqlite3* db,
     }
   }
 
+  // Rows may address columns by position, including the alias columns.
+  pVtab->content->schema = std::make_shared<ColumnarSchema>(
+      pVtab->content->columns, pVtab->content->aliases);
+
   // Create the requested 'aliases'.
   for (const auto& view : views) {
     statement = "CREATE VIEW " + view + " AS SELECT * FROM " + name;
@@ -871,6 +1003,8 @@ static int xFilter(sqlite3_vtab_cursor* pVtabCursor,
 
   // The SQLite instance communicates to the TablePlugin via the context.
   context.useCache(pVtab->instance->useCache());
+  context.setCacheStep(pVtab->instance->cacheStep(),
+                       pVtab->instance->cacheInterval());
 
   // Track required columns, this is different than the requirements check
   // that occurs within BestIndex because this scan includes a cursor.
@@ -964,7 +1098,10 @@ static int xFilter(sqlite3_vtab_cursor* pVtabCursor,
   }
 
   // Reset the virtual table contents.
+  closeExtensionBatch(pCur, pVtab->content->name);
   pCur->rows.clear();
+  pCur->n = 0;
+  pCur->batch_offset = 0;
   options.clear();
 
   if (!user_based_satisfied) {
@@ -995,7 +1132,9 @@ static int xFilter(sqlite3_vtab_cursor* pVtabCursor,
 
   // Generate the row data set.
   plan("Scanning rows for cursor (" + std::to_string(pCur->id) + ")");
-  if (Registry::get().exists("table", pVtab->content->name, true)) {
+  // Tables attached from extensions always read through the plugin call API.
+  if (!extension_table_list.contains(pVtab->content->name) &&
+      Registry::get().exists("table", pVtab->content->name, true)) {
     auto plugin = Registry::get().plugin("table", pVtab->content->name);
     auto table = std::dynamic_pointer_cast<TablePlugin>(plugin);
     try {
@@ -1024,6 +1163,33 @@ static int xFilter(sqlite3_vtab_cursor* pVtabCursor,
   } else {
     PluginRequest request = {{"action", "generate"}};
     TablePlugin::setRequestFromContext(context, request);
+    if (FLAGS_extensions_batch_rows > 0 && pVtab->content->batches) {
+      request["action"] = "generate_batch";
+      request["batch_size"] = std::to_string(FLAGS_extensions_batch_rows);
+      auto status = getExtensionBatch(pCur, *pVtab->content, request);
+      if (status.ok()) {
+        if (FLAGS_planner) {
+          plan("xFilter " + pVtab->content->name +
+               " generate_batch returned row count:" + std::to_string(pCur->n));
+        }
+        return SQLITE_OK;
+      }
+
+      if (!isUnknownActionError(status)) {
+        VLOG(1) << "Invalid batch from the extension table. Error "
+                << status.getCode() << ": " << status.getMessage();
+        setTableErrorMessage(pVtabCursor->pVtab, status.getMessage());
+        return SQLITE_ERROR;
+      }
+
+      // Extensions built with an older SDK only support generate.
+      VLOG(1) << "Extension table " << pVtab->content->name
+              << " does not support batches: " << status.getMessage();
+      pVtab->content->batches = false;
+      request["action"] = "generate";
+      request.erase("batch_size");
+    }
+
     QueryData qd;
     auto status = Registry::call("table", pVtab->content->name, request, qd);
     if (!status.ok()) {
@@ -1104,6 +1270,9 @@ Status attachTableInternal(const std::string& name,
   // within xCreate.
   auto lock(instance->attachLock());
 
+  // Prepared statements hold plans for the previous set of virtual tables.
+  instance->clearStatements();
+
   int rc = sqlite3_create_module(
       instance->db(), name.c_str(), module, (void*)&(*instance));
 
@@ -1124,6 +1293,7 @@ Status attachTableInternal(const std::string& name,
 Status detachTableInternal(const std::string& name,
                            const SQLiteDBInstanceRef& instance) {
   auto lock(instance->attachLock());
+  instance->clearStatements();
   auto format = "DROP TABLE IF EXISTS temp." + name;
   int rc = sqlite3_exec(instance->db(), format.c_str(), nullptr, nullptr, 0);
   if (rc != SQLITE_OK) {
@@ -58,6 +58,15 @@ struct BaseCursor : private boost::noncopyable {
 
   /// Total number of rows.
   size_t n{0};
+
+  /// An extension table's cursor for its remaining batches, if any.
+  std::string batch_cursor;
+
+  /// Schema slots of the values in each batch row, in the extension's order.
+  std::vector<size_t> batch_slots;
+
+  /// Rows read in previous batches, keeps default rowids unique.
+  size_t batch_offset{0};
 };
 
 /**
@@ -7,43 +7,37 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <memory>
 #include <string>
 #include <vector>
 
 #include <osquery/config/config.h>
+#include <osquery/core/flags.h>
 #include <osquery/core/tables.h>
-#include <osquery/events/eventsubscriber.h>
-#include <osquery/events/linux/inotify.h>
 #include <osquery/logger/logger.h>
+#include <osquery/numeric_monitoring/numeric_monitoring.h>
 #include <osquery/registry/registry_factory.h>
 #include <osquery/tables/events/event_utils.h>
+#include <osquery/tables/events/linux/file_events.h>
 
 namespace osquery {
 
-/**
- * @brief Track time, action changes to /etc/passwd
- *
- * This is mostly an example EventSubscriber implementation.
- */
-class FileEventSubscriber : public EventSubscriber<INotifyEventPublisher> {
- public:
-  Status init() override {
-    return Status(0);
-  }
+FLAG(uint32,
+     file_events_hash_threads,
+     1,
+     "Threads hashing files for file_events (0 hashes on the inotify thread)");
 
-  /// Walk the configuration's file paths, create subscriptions.
-  void configure() override;
+FLAG(uint32,
+     file_events_hash_queue_size,
+     4096,
+     "Maximum number of file_events waiting to be hashed");
 
-  /**
-   * @brief This exports a single Callback for INotifyEventPublisher events.
-   *
-   * @param ec The EventCallback type receives an EventContextRef substruct
-   * for the INotifyEventPublisher declared in this EventSubscriber subclass.
-   *
-   * @return Was the callback successful.
-   */
-  Status Callback(const ECRef& ec, const SCRef& sc);
-};
+FLAG(uint32,
+     file_events_coalesce_window,
+     0,
+     "Milliseconds during which writes to a file are merged into one event");
+
+DECLARE_bool(enable_numeric_monitoring);
 
 /**
  * @brief EventSubscribers must register so their init method is called.
@@ -53,6 +47,56 @@ class FileEventSubscriber : public EventSubscriber<INotifyEventPublisher> {
  */
 REGISTER(FileEventSubscriber, "event_subscriber", "file_events");
 
+Status FileEventSubscriber::init() {
+  if (hash_queue_ != nullptr || FLAGS_file_events_hash_threads == 0) {
+    return Status::success();
+  }
+
+  hash_queue_ = std::make_unique<FileHashQueue>(
+      decorateFileEvent,
+      [this](std::vector<Row>& row_list) { storeHashedRows(row_list); },
+      FLAGS_file_events_hash_queue_size,
+      std::chrono::milliseconds(FLAGS_file_events_coalesce_window));
+
+  // The workers use the queue as soon as they start.
+  auto status = hash_queue_->start(FLAGS_file_events_hash_threads);
+  if (!status.ok()) {
+    LOG(WARNING) << "Hashing file_events on the inotify thread: "
+                 << status.getMessage();
+    hash_queue_.reset();
+  }
+
+  return Status::success();
+}
+
+void FileEventSubscriber::tearDown() {
+  if (hash_queue_ == nullptr) {
+    return;
+  }
+
+  recordDroppedHashes(hash_queue_->stop());
+  hash_queue_.reset();
+  recordQueueDepth(0);
+}
+
+void FileEventSubscriber::storeHashedRows(std::vector<Row>& row_list) {
+  // Not at the time they were received, see FileHashQueue.
+  addBatch(row_list);
+  if (hash_queue_ != nullptr) {
+    recordQueueDepth(hash_queue_->queueDepth());
+  }
+}
+
+void FileEventSubscriber::recordDroppedHashes(std::size_t count) {
+  if (count == 0 || !FLAGS_enable_numeric_monitoring) {
+    return;
+  }
+
+  monitoring::record("events." + dbNamespace() + ".dropped_hashes",
+                     static_cast<monitoring::ValueType>(count),
+                     monitoring::PreAggregationType::Sum);
+}
+
 void FileEventSubscriber::configure() {
   // Clear all monitors from INotify.
   // There may be a better way to find the set intersection/difference.
@@ -114,18 +158,35 @@ Status FileEventSubscriber::Callback(const ECRef& ec, const SCRef& sc) {
   r["category"] = sc->category;
   r["transaction_id"] = INTEGER(ec->event->cookie);
 
-  if ((sc->mask & kFileAccessMasks) != kFileAccessMasks) {
-    // Add hashing and 'join' against the file table for stat-information.
-    decorateFileEvent(
-        ec->path, (ec->action == "CREATED" || ec->action == "UPDATED"), r);
-  } else {
-    // The access event on Linux would generate additional events if hashed.
+  // The access event on Linux would generate additional events if hashed.
+  auto hash = (sc->mask & kFileAccessMasks) != kFileAccessMasks &&
+              (ec->action == "CREATED" || ec->action == "UPDATED");
+
+  if (hash_queue_ != nullptr && !hash) {
+    // Writes that are still waiting to be hashed happened before this event.
+    hash_queue_->detach(ec->path);
+  }
+
+  if (hash && hash_queue_ != nullptr) {
+    if (hash_queue_->push(ec->path, r)) {
+      recordQueueDepth(hash_queue_->queueDepth());
+      return Status::success();
+    }
+
+    // The workers are behind, keep the event but skip its hashes.
     decorateFileEvent(ec->path, false, r);
+    r["hashed"] = "-1";
+    recordDroppedHashes(1);
+
+  } else {
+    // Add hashing and 'join' against the file table for stat-information.
+    decorateFileEvent(ec->path, hash, r);
   }
 
   // A callback is somewhat useless unless it changes the EventSubscriber
-  // state or calls `add` to store a marked up event.
-  add(r);
+  // state or calls `addBatch` to store a marked up event.
+  std::vector<Row> row_list = {std::move(r)};
+  addBatch(row_list);
   return Status::success();
 }
 } // namespace osquery
@@ -0,0 +1,57 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <osquery/events/eventsubscriber.h>
+#include <osquery/events/linux/inotify.h>
+#include <osquery/tables/events/linux/file_hash_queue.h>
+
+namespace osquery {
+
+/**
+ * @brief Track time, action changes to /etc/passwd
+ *
+ * This is mostly an example EventSubscriber implementation.
+ */
+class FileEventSubscriber : public EventSubscriber<INotifyEventPublisher> {
+ public:
+  /// Start the hashing workers.
+  Status init() override;
+
+  /// Stop the hashing workers, the queued events are stored without hashes.
+  void tearDown() override;
+
+  /// Walk the configuration's file paths, create subscriptions.
+  void configure() override;
+
+  /**
+   * @brief This exports a single Callback for INotifyEventPublisher events.
+   *
+   * @param ec The EventCallback type receives an EventContextRef substruct
+   * for the INotifyEventPublisher declared in this EventSubscriber subclass.
+   *
+   * @return Was the callback successful.
+   */
+  Status Callback(const ECRef& ec, const SCRef& sc);
+
+ private:
+  /// Store rows hashed by the workers, with the time they are stored at.
+  void storeHashedRows(std::vector<Row>& row_list);
+
+  /// Count the events that were stored without being hashed.
+  void recordDroppedHashes(std::size_t count);
+
+  /// Hashes files away from the inotify thread, null if disabled.
+  std::unique_ptr<FileHashQueue> hash_queue_;
+};
+} // namespace osquery
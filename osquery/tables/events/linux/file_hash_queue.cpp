@@ -0,0 +1,207 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <system_error>
+#include <utility>
+
+#include <osquery/tables/events/linux/file_hash_queue.h>
+
+namespace osquery {
+
+namespace {
+
+/// Hashed events are stored together once this many are waiting
+const std::size_t kFileHashBatchSize{64U};
+
+} // namespace
+
+FileHashQueue::FileHashQueue(FileEventDecorator decorator,
+                             FileEventSink sink,
+                             std::size_t max_queue_size,
+                             std::chrono::milliseconds coalesce_window)
+    : decorator_(std::move(decorator)),
+      sink_(std::move(sink)),
+      max_queue_size_(max_queue_size),
+      coalesce_window_(coalesce_window) {}
+
+FileHashQueue::~FileHashQueue() {
+  stop();
+}
+
+Status FileHashQueue::start(std::size_t thread_count) {
+  for (std::size_t i = 0; i < thread_count; ++i) {
+    try {
+      worker_list_.emplace_back(&FileHashQueue::work, this);
+
+    } catch (const std::system_error& e) {
+      if (worker_list_.empty()) {
+        return Status::failure("Failed to start the file hashing threads: " +
+                               std::string(e.what()));
+      }
+
+      break;
+    }
+  }
+
+  return Status::success();
+}
+
+bool FileHashQueue::push(const std::string& path, Row& row) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (coalesce_window_.count() > 0) {
+      auto index_it = path_index_.find(path);
+      if (index_it != path_index_.end()) {
+        // The queued event is hashed once the burst of writes is over. A file
+        // that was created during the window is still reported as created
+        auto& queued_row = queue_.at(index_it->second).row;
+        if (row["action"] == "CREATED") {
+          queued_row["action"] = "CREATED";
+        }
+
+        return true;
+      }
+    }
+
+    if (queue_.size() >= max_queue_size_) {
+      return false;
+    }
+
+    auto sequence = next_sequence_++;
+
+    auto& queued_event = queue_[sequence];
+    queued_event.path = path;
+    queued_event.row = std::move(row);
+    queued_event.deadline = EventClock::now() + coalesce_window_;
+
+    if (coalesce_window_.count() > 0) {
+      path_index_[path] = sequence;
+    }
+  }
+
+  condition_.notify_one();
+  return true;
+}
+
+void FileHashQueue::detach(const std::string& path) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // The event stays queued until the end of its window, it is only no longer
+  // merged with new writes
+  path_index_.erase(path);
+}
+
+std::size_t FileHashQueue::queueDepth() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return queue_.size() + hashing_count_ + completed_list_.size();
+}
+
+std::size_t FileHashQueue::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+
+  condition_.notify_all();
+  for (auto& worker : worker_list_) {
+    worker.join();
+  }
+
+  worker_list_.clear();
+
+  // The workers are gone, what remains can be stored from this thread
+  std::vector<QueuedEvent> event_list = std::move(completed_list_);
+  completed_list_.clear();
+
+  std::size_t unhashed_count{queue_.size()};
+  for (auto& queued_event : queue_) {
+    auto& event = queued_event.second;
+    decorator_(event.path, false, event.row);
+    event.row["hashed"] = "-1";
+
+    event_list.push_back(std::move(event));
+  }
+
+  queue_.clear();
+  path_index_.clear();
+
+  store(event_list);
+  return unhashed_count;
+}
+
+bool FileHashQueue::isFrontDue(EventClock::time_point now) const {
+  return !queue_.empty() && queue_.begin()->second.deadline <= now;
+}
+
+void FileHashQueue::work() {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  while (!stopping_) {
+    if (queue_.empty()) {
+      condition_.wait(lock);
+      continue;
+    }
+
+    // Events share the same window, so the oldest one is due first
+    auto deadline = queue_.begin()->second.deadline;
+    if (EventClock::now() < deadline) {
+      condition_.wait_until(lock, deadline);
+      continue;
+    }
+
+    auto queue_it = queue_.begin();
+    auto event = std::move(queue_it->second);
+
+    auto index_it = path_index_.find(event.path);
+    if (index_it != path_index_.end() && index_it->second == queue_it->first) {
+      path_index_.erase(index_it);
+    }
+
+    queue_.erase(queue_it);
+    ++hashing_count_;
+
+    lock.unlock();
+    decorator_(event.path, true, event.row);
+    lock.lock();
+
+    --hashing_count_;
+    completed_list_.push_back(std::move(event));
+
+    // Keep batching while there are more events ready to be hashed
+    if (completed_list_.size() < kFileHashBatchSize &&
+        isFrontDue(EventClock::now())) {
+      continue;
+    }
+
+    auto event_list = std::move(completed_list_);
+    completed_list_.clear();
+
+    lock.unlock();
+    store(event_list);
+    lock.lock();
+  }
+}
+
+void FileHashQueue::store(std::vector<QueuedEvent>& event_list) {
+  if (event_list.empty()) {
+    return;
+  }
+
+  std::vector<Row> row_list;
+  row_list.reserve(event_list.size());
+
+  for (auto& event : event_list) {
+    row_list.push_back(std::move(event.row));
+  }
+
+  sink_(row_list);
+}
+
+} // namespace osquery
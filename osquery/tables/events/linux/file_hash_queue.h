@@ -0,0 +1,137 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include <osquery/core/sql/row.h>
+#include <osquery/events/types.h>
+#include <osquery/utils/status/status.h>
+
+namespace osquery {
+
+/// Adds the file information to an event row, with its hashes if requested
+using FileEventDecorator =
+    std::function<void(const std::string& path, bool hash, Row& row)>;
+
+/// Stores decorated rows, in the order their events were received
+using FileEventSink = std::function<void(std::vector<Row>& row_list)>;
+
+/**
+ * @brief Hashes the files of file events on a pool of worker threads
+ *
+ * Hashing a file can take much longer than receiving an inotify event, so
+ * hashing on the publisher thread lets the inotify queue overflow when many
+ * files are written at once. Events are instead queued here, and decorated
+ * then stored by the workers.
+ *
+ * When a coalescing window is set, an event is held for that long after it
+ * was received. Writes to the same file during that time are merged into the
+ * queued event, so that a burst of writes is hashed only once.
+ *
+ * The queue is bounded, and events that do not fit are refused: the caller
+ * is expected to store them without hashes.
+ *
+ * Rows reach the sink after they were received, possibly much later when
+ * coalescing, so the sink must store them with the time they are stored at:
+ * an optimized query may already have read past the time they were received.
+ */
+class FileHashQueue final : private boost::noncopyable {
+ public:
+  FileHashQueue(FileEventDecorator decorator,
+                FileEventSink sink,
+                std::size_t max_queue_size,
+                std::chrono::milliseconds coalesce_window);
+
+  ~FileHashQueue();
+
+  /// Starts up to thread_count workers; fails if none could be started
+  Status start(std::size_t thread_count);
+
+  /**
+   * @brief Queues a CREATED or UPDATED event row
+   *
+   * The row is moved into the queue on success. False is returned, and the
+   * row left untouched, when the queue is full.
+   */
+  bool push(const std::string& path, Row& row);
+
+  /**
+   * @brief Stops merging new writes into the queued event of path
+   *
+   * Call this before storing an event that is not queued, such as a delete,
+   * so that the writes that came before it are not merged with the ones that
+   * come after it. The queued event is still hashed at the end of its window.
+   */
+  void detach(const std::string& path);
+
+  /// Number of events queued or being hashed
+  std::size_t queueDepth() const;
+
+  /**
+   * @brief Stops the workers, and stores the queued events without hashes
+   *
+   * Returns the number of events that were stored without being hashed.
+   */
+  std::size_t stop();
+
+ private:
+  struct QueuedEvent final {
+    std::string path;
+    Row row;
+
+    /// When the event can be hashed, at the end of its coalescing window
+    EventClock::time_point deadline;
+  };
+
+  /// The worker thread entry point
+  void work();
+
+  /// Stores the decorated events as one batch
+  void store(std::vector<QueuedEvent>& event_list);
+
+  /// Returns true if the oldest queued event can be hashed
+  bool isFrontDue(EventClock::time_point now) const;
+
+  FileEventDecorator decorator_;
+  FileEventSink sink_;
+  const std::size_t max_queue_size_;
+  const std::chrono::milliseconds coalesce_window_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable condition_;
+  bool stopping_{false};
+
+  /// Queued events, in the order they were received
+  std::map<std::uint64_t, QueuedEvent> queue_;
+  std::uint64_t next_sequence_{0};
+
+  /// The queued event of each path, used to coalesce writes
+  std::unordered_map<std::string, std::uint64_t> path_index_;
+
+  /// Events being hashed, and hashed events waiting to be stored
+  std::size_t hashing_count_{0};
+  std::vector<QueuedEvent> completed_list_;
+
+  std::vector<std::thread> worker_list_;
+};
+
+} // namespace osquery
@@ -0,0 +1,232 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <atomic>
+#include <fstream>
+
+#include <gtest/gtest.h>
+
+#include <boost/filesystem.hpp>
+
+#include <osquery/config/config.h>
+#include <osquery/core/flags.h>
+#include <osquery/core/system.h>
+#include <osquery/database/database.h>
+#include <osquery/registry/registry.h>
+#include <osquery/sql/dynamic_table_row.h>
+#include <osquery/tables/events/linux/file_events.h>
+
+namespace fs = boost::filesystem;
+
+namespace osquery {
+
+DECLARE_uint32(file_events_hash_threads);
+DECLARE_uint32(file_events_hash_queue_size);
+DECLARE_uint32(file_events_coalesce_window);
+
+namespace {
+
+/// Stores the events of each test in its own database namespace
+class MockFileEventSubscriber : public FileEventSubscriber {
+ public:
+  explicit MockFileEventSubscriber(const std::string& name) {
+    setName(name);
+    setDatabaseNamespace();
+  }
+
+  /// Reads the rows back as a scheduled query would
+  QueryData getRows() {
+    QueryContext context;
+    RowGenerator::pull_type generator(
+        [this, &context](RowYield& yield) { genTable(yield, context); });
+
+    QueryData row_list;
+    while (generator) {
+      auto& row = static_cast<DynamicTableRow&>(*generator.get());
+      row_list.push_back(static_cast<Row>(row));
+      generator();
+    }
+
+    return row_list;
+  }
+
+  bool optimize{false};
+
+  /// The time events are stored at, the current time if 0
+  std::atomic<uint64_t> time{0};
+
+ private:
+  bool shouldOptimize() const override {
+    return optimize;
+  }
+
+  uint64_t getTime() const override {
+    return time != 0 ? time.load() : FileEventSubscriber::getTime();
+  }
+};
+
+} // namespace
+
+class FileEventsLinuxTests : public testing::Test {
+ protected:
+  void SetUp() override {
+    platformSetup();
+    registryAndPluginInit();
+    initDatabasePluginForTesting();
+
+    hash_threads_ = FLAGS_file_events_hash_threads;
+    hash_queue_size_ = FLAGS_file_events_hash_queue_size;
+    coalesce_window_ = FLAGS_file_events_coalesce_window;
+
+    path_ = (fs::temp_directory_path() /
+             fs::unique_path("osquery.file_events.%%%%.%%%%"))
+                .string();
+
+    std::ofstream file(path_);
+    file << "file_events";
+  }
+
+  void TearDown() override {
+    FLAGS_file_events_hash_threads = hash_threads_;
+    FLAGS_file_events_hash_queue_size = hash_queue_size_;
+    FLAGS_file_events_coalesce_window = coalesce_window_;
+
+    fs::remove(path_);
+  }
+
+  void callback(MockFileEventSubscriber& sub,
+                const std::string& path,
+                const std::string& action) {
+    auto ec = std::make_shared<INotifyEventContext>();
+    ec->event = std::make_unique<struct inotify_event>();
+    ec->path = path;
+    ec->action = action;
+
+    auto sc = std::make_shared<INotifySubscriptionContext>();
+    sc->category = "tests";
+    sc->mask = kFileDefaultMasks;
+
+    EXPECT_TRUE(sub.Callback(ec, sc).ok());
+  }
+
+  std::string path_;
+
+ private:
+  std::uint32_t hash_threads_{0};
+  std::uint32_t hash_queue_size_{0};
+  std::uint32_t coalesce_window_{0};
+};
+
+TEST_F(FileEventsLinuxTests, test_hash_inline) {
+  // Without workers the files are hashed from the inotify thread
+  FLAGS_file_events_hash_threads = 0;
+
+  MockFileEventSubscriber sub("file_events_hash_inline");
+  ASSERT_TRUE(sub.init().ok());
+
+  callback(sub, path_, "CREATED");
+  callback(sub, path_, "ATTRIBUTES_MODIFIED");
+
+  auto row_list = sub.getRows();
+  ASSERT_EQ(row_list.size(), 2U);
+  EXPECT_EQ(row_list[0].at("action"), "CREATED");
+  EXPECT_EQ(row_list[0].at("hashed"), "1");
+  EXPECT_FALSE(row_list[0].at("md5").empty());
+  EXPECT_EQ(row_list[1].at("hashed"), "0");
+
+  sub.tearDown();
+}
+
+TEST_F(FileEventsLinuxTests, test_queue_full) {
+  FLAGS_file_events_hash_threads = 1;
+  FLAGS_file_events_hash_queue_size = 1;
+  FLAGS_file_events_coalesce_window = 3600000;
+
+  MockFileEventSubscriber sub("file_events_queue_full");
+  ASSERT_TRUE(sub.init().ok());
+
+  callback(sub, path_, "UPDATED");
+  EXPECT_TRUE(sub.getRows().empty());
+
+  // The queue is full, the event is stored right away without hashes
+  callback(sub, path_ + ".other", "CREATED");
+
+  auto row_list = sub.getRows();
+  ASSERT_EQ(row_list.size(), 1U);
+  EXPECT_EQ(row_list[0].at("target_path"), path_ + ".other");
+  EXPECT_EQ(row_list[0].at("hashed"), "-1");
+
+  sub.tearDown();
+
+  row_list = sub.getRows();
+  ASSERT_EQ(row_list.size(), 2U);
+  EXPECT_EQ(row_list[1].at("target_path"), path_);
+  EXPECT_EQ(row_list[1].at("hashed"), "-1");
+}
+
+TEST_F(FileEventsLinuxTests, test_delete_detaches_writes) {
+  FLAGS_file_events_hash_threads = 1;
+  FLAGS_file_events_coalesce_window = 3600000;
+
+  MockFileEventSubscriber sub("file_events_delete");
+  ASSERT_TRUE(sub.init().ok());
+
+  callback(sub, path_, "UPDATED");
+  callback(sub, path_, "DELETED");
+
+  // The pending write keeps its window, it is not stored early
+  auto row_list = sub.getRows();
+  ASSERT_EQ(row_list.size(), 1U);
+  EXPECT_EQ(row_list[0].at("action"), "DELETED");
+
+  callback(sub, path_, "CREATED");
+  callback(sub, path_, "UPDATED");
+  sub.tearDown();
+
+  // The file created after the delete is not merged into the earlier write
+  row_list = sub.getRows();
+  ASSERT_EQ(row_list.size(), 3U);
+  EXPECT_EQ(row_list[0].at("action"), "DELETED");
+  EXPECT_EQ(row_list[1].at("action"), "UPDATED");
+  EXPECT_EQ(row_list[2].at("action"), "CREATED");
+}
+
+TEST_F(FileEventsLinuxTests, test_hashed_rows_optimize) {
+  FLAGS_file_events_hash_threads = 1;
+  FLAGS_file_events_coalesce_window = 3600000;
+
+  MockFileEventSubscriber sub("file_events_optimize");
+  sub.optimize = true;
+  setDatabaseValue(
+      kPersistentSettings, getExecutingQueryKey(), "file_events_optimize");
+  ASSERT_TRUE(sub.init().ok());
+
+  // The write waits in its window while a later event is stored and read
+  sub.time = 100;
+  callback(sub, path_, "UPDATED");
+  sub.time = 101;
+  callback(sub, path_ + ".other", "DELETED");
+
+  auto row_list = sub.getRows();
+  ASSERT_EQ(row_list.size(), 1U);
+  EXPECT_EQ(row_list[0].at("action"), "DELETED");
+
+  // The queued row must be newer than what the query has already read
+  sub.time = 102;
+  sub.tearDown();
+
+  row_list = sub.getRows();
+  ASSERT_EQ(row_list.size(), 1U);
+  EXPECT_EQ(row_list[0].at("action"), "UPDATED");
+  EXPECT_EQ(row_list[0].at("time"), "102");
+
+  deleteDatabaseValue(kPersistentSettings, getExecutingQueryKey());
+}
+
+} // namespace osquery
@@ -0,0 +1,151 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <gtest/gtest.h>
+
+#include <osquery/tables/events/linux/file_hash_queue.h>
+
+namespace osquery {
+namespace {
+
+Row makeEventRow(const std::string& path, const std::string& action) {
+  Row r;
+  r["target_path"] = path;
+  r["action"] = action;
+  return r;
+}
+
+void fakeDecorator(const std::string& path, bool hash, Row& row) {
+  row["md5"] = hash ? "md5:" + path : "";
+  row["hashed"] = hash ? "1" : "0";
+}
+
+} // namespace
+
+class FileHashQueueTests : public testing::Test {
+ protected:
+  FileEventSink getSink() {
+    return [this](std::vector<Row>& row_list) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto& row : row_list) {
+        row_list_.push_back(std::move(row));
+      }
+
+      ++batch_count_;
+    };
+  }
+
+  std::mutex mutex_;
+  std::vector<Row> row_list_;
+  std::size_t batch_count_{0};
+};
+
+TEST_F(FileHashQueueTests, test_hash_events) {
+  FileHashQueue queue(
+      fakeDecorator, getSink(), 16U, std::chrono::milliseconds(0));
+  ASSERT_TRUE(queue.start(2U).ok());
+
+  auto r1 = makeEventRow("/tmp/a", "CREATED");
+  auto r2 = makeEventRow("/tmp/b", "UPDATED");
+  auto r3 = makeEventRow("/tmp/a", "UPDATED");
+  EXPECT_TRUE(queue.push("/tmp/a", r1));
+  EXPECT_TRUE(queue.push("/tmp/b", r2));
+  EXPECT_TRUE(queue.push("/tmp/a", r3));
+
+  for (std::size_t i = 0; i < 1000U && queue.queueDepth() != 0U; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+
+  EXPECT_EQ(queue.queueDepth(), 0U);
+  EXPECT_EQ(queue.stop(), 0U);
+
+  // Without a window, every write is hashed
+  ASSERT_EQ(row_list_.size(), 3U);
+  for (const auto& row : row_list_) {
+    EXPECT_EQ(row.at("hashed"), "1");
+    EXPECT_EQ(row.at("md5"), "md5:" + row.at("target_path"));
+  }
+}
+
+TEST_F(FileHashQueueTests, test_coalesce_writes) {
+  FileHashQueue queue(fakeDecorator, getSink(), 16U, std::chrono::hours(1));
+  ASSERT_TRUE(queue.start(1U).ok());
+
+  for (const auto& action : {"UPDATED", "UPDATED", "CREATED", "UPDATED"}) {
+    auto r = makeEventRow("/tmp/a", action);
+    EXPECT_TRUE(queue.push("/tmp/a", r));
+  }
+
+  auto r = makeEventRow("/tmp/b", "UPDATED");
+  EXPECT_TRUE(queue.push("/tmp/b", r));
+  EXPECT_EQ(queue.queueDepth(), 2U);
+
+  // The window has not elapsed, so stopping stores the events unhashed
+  EXPECT_EQ(queue.stop(), 2U);
+  EXPECT_EQ(batch_count_, 1U);
+
+  ASSERT_EQ(row_list_.size(), 2U);
+  EXPECT_EQ(row_list_[0].at("target_path"), "/tmp/a");
+  EXPECT_EQ(row_list_[0].at("action"), "CREATED");
+  EXPECT_EQ(row_list_[0].at("hashed"), "-1");
+  EXPECT_EQ(row_list_[1].at("target_path"), "/tmp/b");
+}
+
+TEST_F(FileHashQueueTests, test_detach_path) {
+  FileHashQueue queue(fakeDecorator, getSink(), 16U, std::chrono::hours(1));
+  ASSERT_TRUE(queue.start(1U).ok());
+
+  auto r1 = makeEventRow("/tmp/a", "UPDATED");
+  auto r2 = makeEventRow("/tmp/b", "UPDATED");
+  EXPECT_TRUE(queue.push("/tmp/a", r1));
+  EXPECT_TRUE(queue.push("/tmp/b", r2));
+
+  // The detached event keeps waiting in its window
+  queue.detach("/tmp/a");
+  queue.detach("/tmp/c");
+  EXPECT_EQ(queue.queueDepth(), 2U);
+  EXPECT_TRUE(row_list_.empty());
+
+  // Later writes start a new event instead of joining the detached one
+  auto r3 = makeEventRow("/tmp/a", "CREATED");
+  EXPECT_TRUE(queue.push("/tmp/a", r3));
+  auto r4 = makeEventRow("/tmp/b", "CREATED");
+  EXPECT_TRUE(queue.push("/tmp/b", r4));
+  EXPECT_EQ(queue.queueDepth(), 3U);
+
+  EXPECT_EQ(queue.stop(), 3U);
+  ASSERT_EQ(row_list_.size(), 3U);
+  EXPECT_EQ(row_list_[0].at("target_path"), "/tmp/a");
+  EXPECT_EQ(row_list_[0].at("action"), "UPDATED");
+  EXPECT_EQ(row_list_[1].at("target_path"), "/tmp/b");
+  EXPECT_EQ(row_list_[1].at("action"), "CREATED");
+  EXPECT_EQ(row_list_[2].at("target_path"), "/tmp/a");
+  EXPECT_EQ(row_list_[2].at("action"), "CREATED");
+}
+
+TEST_F(FileHashQueueTests, test_queue_full) {
+  FileHashQueue queue(fakeDecorator, getSink(), 1U, std::chrono::hours(1));
+  ASSERT_TRUE(queue.start(1U).ok());
+
+  auto r1 = makeEventRow("/tmp/a", "UPDATED");
+  EXPECT_TRUE(queue.push("/tmp/a", r1));
+
+  // Writes to a queued file still coalesce, other files are refused
+  auto r2 = makeEventRow("/tmp/a", "UPDATED");
+  EXPECT_TRUE(queue.push("/tmp/a", r2));
+
+  auto r3 = makeEventRow("/tmp/b", "UPDATED");
+  EXPECT_FALSE(queue.push("/tmp/b", r3));
+  EXPECT_EQ(r3.at("target_path"), "/tmp/b");
+
+  EXPECT_EQ(queue.stop(), 1U);
+  EXPECT_EQ(row_list_.size(), 1U);
+}
+
+} // namespace osquery
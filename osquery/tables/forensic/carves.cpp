@@ -62,6 +62,7 @@ void enumerateCarves(QueryData& results, const std::string& new_guid) {
     stringToRow("request_id", r, tree);
     stringToRow("status", r, tree);
     stringToRow("path", r, tree);
+    stringToRow("throughput", r, tree);
 
     // This table can be used to request a new carve.
     // If this is the case then return this single result.
@@ -8,13 +8,143 @@
  */
 
 #include <osquery/core/core.h>
+#include <osquery/core/flags.h>
 #include <osquery/core/tables.h>
 #include <osquery/filesystem/filesystem.h>
 #include <osquery/filesystem/linux/proc.h>
+#include <osquery/filesystem/linux/proc_enumerator.h>
+#include <osquery/tables/networking/linux/process_open_sockets.h>
 
 namespace osquery {
+
+HIDDEN_FLAG(bool,
+            disable_sock_diag,
+            false,
+            "Read the TCP and UDP socket lists from procfs only");
+
 namespace tables {
 
+namespace {
+
+/// Socket inodes and network namespaces collected from a shard of the pids
+struct ProcessSocketShard final {
+  SocketInodeToProcessInfoMap inode_map;
+
+  /// The network namespace of each pid, in the order of the pid list
+  std::vector<std::pair<std::string, ino_t>> netns_list;
+};
+
+boost::optional<std::uint16_t> getPortConstraint(QueryContext& context,
+                                                 const std::string& column) {
+  auto port_list = context.constraints[column].getAll<int>(EQUALS);
+  if (port_list.size() != 1U) {
+    return boost::none;
+  }
+
+  auto port = *port_list.begin();
+  if (port < 0 || port > 65535) {
+    return boost::none;
+  }
+
+  return static_cast<std::uint16_t>(port);
+}
+
+} // namespace
+
+SocketListConstraints getSocketListConstraints(QueryContext& context) {
+  SocketListConstraints constraints;
+  constraints.family_list = context.constraints["family"].getAll<int>(EQUALS);
+  constraints.protocol_list =
+      context.constraints["protocol"].getAll<int>(EQUALS);
+
+  auto& state_constraints = context.constraints["state"];
+  if (state_constraints.exists(EQUALS)) {
+    std::uint32_t states{0U};
+    constraints.stateless = false;
+
+    for (const auto& state : state_constraints.getAll(EQUALS)) {
+      if (state.empty()) {
+        constraints.stateless = true;
+        continue;
+      }
+
+      auto state_mask = sockDiagGetStateMask(state);
+      if (state_mask != 0U) {
+        states |= state_mask;
+        continue;
+      }
+
+      // States such as NONE, used by packet sockets, or UNKNOWN have no
+      // kernel equivalent; dump all the TCP states and the other lists
+      constraints.stateless = true;
+      states |= kSockDiagAllStates;
+    }
+
+    constraints.filter.states = states;
+  }
+
+  constraints.filter.local_port = getPortConstraint(context, "local_port");
+  constraints.filter.remote_port = getPortConstraint(context, "remote_port");
+
+  return constraints;
+}
+
+bool isSocketListWanted(const SocketListConstraints& constraints,
+                        int family,
+                        int protocol) {
+  if (!constraints.family_list.empty() &&
+      constraints.family_list.count(family) == 0) {
+    return false;
+  }
+
+  // Only the AF_INET and AF_INET6 protocols are known in advance
+  if (family != AF_INET && family != AF_INET6) {
+    return constraints.stateless;
+  }
+
+  if (!constraints.protocol_list.empty() &&
+      constraints.protocol_list.count(protocol) == 0) {
+    return false;
+  }
+
+  if (protocol == IPPROTO_TCP) {
+    return constraints.filter.states != 0U;
+  }
+
+  return constraints.stateless;
+}
+
+namespace {
+
+Status getInetSocketList(SockDiagConnection& sock_diag,
+                         const SocketListConstraints& constraints,
+                         int family,
+                         int protocol,
+                         ino_t ns,
+                         const std::string& pid,
+                         SocketInfoList& socket_list) {
+  if (sock_diag.isOpen() && sockDiagSupportsProtocol(protocol)) {
+    // Only TCP sockets report their state in this table
+    auto filter = constraints.filter;
+    if (protocol != IPPROTO_TCP) {
+      filter.states = kSockDiagAllStates;
+    }
+
+    auto status =
+        sock_diag.getSocketList(family, protocol, ns, filter, socket_list);
+    if (status.ok()) {
+      return status;
+    }
+
+    VLOG(1) << "Falling back to procfs for the process_open_sockets table: "
+            << status.what();
+  }
+
+  return procGetSocketList(family, protocol, ns, pid, socket_list);
+}
+
+} // namespace
+
 QueryData genOpenSockets(QueryContext& context) {
   Status status;
   QueryData results;
@@ -63,74 +193,140 @@ QueryData genOpenSockets(QueryContext& context) {
    * this step we collect the inodes of each of the sockets, and will use that
    * to correlate the socket information with the information collect on steps
    * 1 and 2.
+   *
+   * TCP and UDP sockets are preferably dumped through NETLINK_SOCK_DIAG
+   * instead, which lets the kernel skip the sockets that cannot match the
+   * state, family and port constraints of the query. The procfs tables are
+   * still used as a fallback, for instance without the privileges needed to
+   * enter another network namespace.
    */
 
-  /* Use a set to record the namespaces already processed */
-  std::set<ino_t> netns_list;
+  auto constraints = getSocketListConstraints(context);
+
+  /* Steps 1 and 2 only read the files of each pid, so they can be spread
+   * across threads. Step 3 runs afterwards, in the order of the pid list.
+   */
+  auto shard_list = procEnumerateShards<ProcessSocketShard>(
+      pids,
+      procGetEnumerationThreadCount(),
+      [](const std::string& pid, ProcessSocketShard& shard) {
+        /* Step 1 */
+        auto status = procGetSocketInodeToProcessInfoMap(pid, shard.inode_map);
+        if (!status.ok()) {
+          VLOG(1) << "Results for process_open_sockets might be incomplete. "
+                     "Failed to acquire socket inode to process map for pid "
+                  << pid << ": " << status.what();
+        }
+
+        /* Step 2 */
+        ino_t ns;
+        ProcessNamespaceList namespaces;
+        status = procGetProcessNamespaces(pid, namespaces, {"net"});
+        if (status.ok()) {
+          ns = namespaces["net"];
+        } else {
+          /* If namespaces are not available we allways set ns to 0 and step 3
+           * will run once for the first pid in the list.
+           */
+          ns = 0;
+          VLOG(1) << "Results for the process_open_sockets might be "
+                     "incomplete. Failed to acquire network namespace "
+                     "information for process with pid "
+                  << pid << ": " << status.what();
+        }
+
+        shard.netns_list.emplace_back(pid, ns);
+      });
+
+  /* Later pids replace the entries of earlier ones, as they would have if the
+   * pids had been enumerated sequentially
+   */
   SocketInodeToProcessInfoMap inode_proc_map;
-  SocketInfoList socket_list;
-  for (const auto& pid : pids) {
-    /* Step 1 */
-    status = procGetSocketInodeToProcessInfoMap(pid, inode_proc_map);
-    if (!status.ok()) {
-      VLOG(1) << "Results for process_open_sockets might be incomplete. Failed "
-                 "to acquire socket inode to process map for pid "
-              << pid << ": " << status.what();
+  std::vector<std::pair<std::string, ino_t>> pid_netns_list;
+  for (auto& shard : shard_list) {
+    for (auto& inode : shard.inode_map) {
+      inode_proc_map[inode.first] = std::move(inode.second);
     }
 
-    /* Step 2 */
-    ino_t ns;
-    ProcessNamespaceList namespaces;
-    status = procGetProcessNamespaces(pid, namespaces, {"net"});
-    if (status.ok()) {
-      ns = namespaces["net"];
-    } else {
-      /* If namespaces are not available we allways set ns to 0 and step 3 will
-       * run once for the first pid in the list.
-       */
-      ns = 0;
-      VLOG(1) << "Results for the process_open_sockets might be incomplete."
-                 "Failed to acquire network namespace information for process "
-                 "with pid "
-              << pid << ": " << status.what();
-    }
+    pid_netns_list.insert(pid_netns_list.end(),
+                          std::make_move_iterator(shard.netns_list.begin()),
+                          std::make_move_iterator(shard.netns_list.end()));
+  }
+
+  /* Use a set to record the namespaces already processed */
+  std::set<ino_t> netns_list;
+  SocketInfoList socket_list;
+  for (const auto& pid_netns : pid_netns_list) {
+    const auto& pid = pid_netns.first;
+    auto ns = pid_netns.second;
 
     if (netns_list.count(ns) == 0) {
       netns_list.insert(ns);
 
       /* Step 3 */
-      for (const auto& pair : kLinuxProtocolNames) {
-        status = procGetSocketList(AF_INET, pair.first, ns, pid, socket_list);
+      SockDiagConnection sock_diag;
+      if (!FLAGS_disable_sock_diag) {
+        status = sock_diag.open(pid, ns);
         if (!status.ok()) {
-          VLOG(1)
-              << "Results for process_open_sockets might be incomplete. Failed "
-                 "to acquire basic socket information for AF_INET "
-              << pair.second << ": " << status.what();
+          VLOG(1) << "Falling back to procfs for the process_open_sockets "
+                     "table: "
+                  << status.what();
+        }
+      }
+
+      for (const auto& pair : kLinuxProtocolNames) {
+        if (isSocketListWanted(constraints, AF_INET, pair.first)) {
+          status = getInetSocketList(sock_diag,
+                                     constraints,
+                                     AF_INET,
+                                     pair.first,
+                                     ns,
+                                     pid,
+                                     socket_list);
+          if (!status.ok()) {
+            VLOG(1)
+                << "Results for process_open_sockets might be incomplete. "
+                   "Failed to acquire basic socket information for AF_INET "
+                << pair.second << ": " << status.what();
+          }
         }
 
-        status = procGetSocketList(AF_INET6, pair.first, ns, pid, socket_list);
+        if (isSocketListWanted(constraints, AF_INET6, pair.first)) {
+          status = getInetSocketList(sock_diag,
+                                     constraints,
+                                     AF_INET6,
+                                     pair.first,
+                                     ns,
+                                     pid,
+                                     socket_list);
+          if (!status.ok()) {
+            VLOG(1)
+                << "Results for process_open_sockets might be incomplete. "
+                   "Failed to acquire basic socket information for AF_INET6 "
+                << pair.second << ": " << status.what();
+          }
+        }
+      }
+
+      if (isSocketListWanted(constraints, AF_UNIX, IPPROTO_IP)) {
+        status = procGetSocketList(AF_UNIX, IPPROTO_IP, ns, pid, socket_list);
         if (!status.ok()) {
           VLOG(1)
               << "Results for process_open_sockets might be incomplete. Failed "
-                 "to acquire basic socket information for AF_INET6 "
-              << pair.second << ": " << status.what();
+                 "to acquire basic socket information for AF_UNIX: "
+              << status.what();
         }
       }
-      status = procGetSocketList(AF_UNIX, IPPROTO_IP, ns, pid, socket_list);
-      if (!status.ok()) {
-        VLOG(1)
-            << "Results for process_open_sockets might be incomplete. Failed "
-               "to acquire basic socket information for AF_UNIX: "
-            << status.what();
-      }
 
       // protocol is 0, we want all protocols here.
-      status = procGetSocketList(AF_PACKET, 0, ns, pid, socket_list);
-      if (!status.ok()) {
-        VLOG(1)
-            << "Results for process_open_sockets might be incomplete. Failed "
-               "to acquire basic socket information for AF_PACKET: "
-            << status.what();
+      if (isSocketListWanted(constraints, AF_PACKET, 0)) {
+        status = procGetSocketList(AF_PACKET, 0, ns, pid, socket_list);
+        if (!status.ok()) {
+          VLOG(1)
+              << "Results for process_open_sockets might be incomplete. Failed "
+                 "to acquire basic socket information for AF_PACKET: "
+              << status.what();
+        }
       }
     }
   }
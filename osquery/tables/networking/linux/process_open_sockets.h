@@ -0,0 +1,42 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <set>
+
+#include <osquery/core/tables.h>
+#include <osquery/tables/networking/linux/sock_diag.h>
+
+namespace osquery {
+namespace tables {
+
+/// Socket lists that can hold rows matching the query constraints
+struct SocketListConstraints final {
+  /// Families and protocols to collect; empty sets match everything
+  std::set<int> family_list;
+  std::set<int> protocol_list;
+
+  /// False if the query only matches sockets with a (TCP) state
+  bool stateless{true};
+
+  /// Filter applied by the kernel to the TCP and UDP socket dumps
+  SockDiagFilter filter;
+};
+
+/// Maps the family, protocol, state and port constraints to socket lists
+SocketListConstraints getSocketListConstraints(QueryContext& context);
+
+/// Returns true if the socket list of a family and protocol must be read
+bool isSocketListWanted(const SocketListConstraints& constraints,
+                        int family,
+                        int protocol);
+
+} // namespace tables
+} // namespace osquery
@@ -0,0 +1,337 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <thread>
+
+#include <fcntl.h>
+#include <linux/netlink.h>
+#include <linux/sock_diag.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <osquery/tables/networking/linux/inet_diag.h>
+#include <osquery/tables/networking/linux/sock_diag.h>
+
+namespace osquery {
+
+namespace {
+
+/// Large enough for the biggest datagram sent by the kernel during a dump
+const std::size_t kSockDiagBufferSize{65536U};
+
+int createSockDiagSocket() {
+  return socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+}
+
+std::string decodeSockDiagAddress(int family, const __be32* address) {
+  char buffer[INET6_ADDRSTRLEN] = {0};
+  if (inet_ntop(family, address, buffer, sizeof(buffer)) == nullptr) {
+    return std::string();
+  }
+
+  return buffer;
+}
+
+void appendPortCondition(std::vector<inet_diag_bc_op>& op_list,
+                         unsigned char code,
+                         std::uint16_t port) {
+  // The jump offsets are set once the full program size is known
+  op_list.push_back({code, 0U, 0U});
+  op_list.push_back({INET_DIAG_BC_NOP, 0U, port});
+}
+
+} // namespace
+
+bool sockDiagSupportsProtocol(int protocol) {
+  return protocol == IPPROTO_TCP || protocol == IPPROTO_UDP;
+}
+
+std::uint32_t sockDiagGetStateMask(const std::string& state) {
+  // The first entry is the placeholder for invalid states
+  for (std::size_t i = 1U; i < tcp_states.size(); ++i) {
+    if (tcp_states[i] == state) {
+      return 1U << i;
+    }
+  }
+
+  return 0U;
+}
+
+std::vector<std::uint8_t> sockDiagGenerateBytecode(
+    const SockDiagFilter& filter) {
+  std::vector<inet_diag_bc_op> op_list;
+  if (filter.local_port) {
+    appendPortCondition(op_list, INET_DIAG_BC_S_GE, *filter.local_port);
+    appendPortCondition(op_list, INET_DIAG_BC_S_LE, *filter.local_port);
+  }
+
+  if (filter.remote_port) {
+    appendPortCondition(op_list, INET_DIAG_BC_D_GE, *filter.remote_port);
+    appendPortCondition(op_list, INET_DIAG_BC_D_LE, *filter.remote_port);
+  }
+
+  // Every condition moves on to the next one when it is met; jumping to the
+  // end of the program accepts the socket, jumping past it rejects it
+  auto program_size = op_list.size() * sizeof(inet_diag_bc_op);
+  for (std::size_t i = 0U; i < op_list.size(); i += 2U) {
+    auto remaining_size = program_size - (i * sizeof(inet_diag_bc_op));
+
+    op_list[i].yes = 2U * sizeof(inet_diag_bc_op);
+    op_list[i].no =
+        static_cast<unsigned short>(remaining_size + sizeof(inet_diag_bc_op));
+  }
+
+  std::vector<std::uint8_t> bytecode(program_size);
+  if (program_size != 0U) {
+    std::memcpy(bytecode.data(), op_list.data(), program_size);
+  }
+
+  return bytecode;
+}
+
+Status sockDiagParseReply(const std::uint8_t* buffer,
+                          std::size_t size,
+                          int protocol,
+                          ino_t net_ns,
+                          SocketInfoList& result,
+                          bool& done) {
+  done = false;
+
+  auto remaining_size = static_cast<int>(size);
+  auto header = reinterpret_cast<const nlmsghdr*>(buffer);
+
+  for (; NLMSG_OK(header, remaining_size);
+       header = NLMSG_NEXT(header, remaining_size)) {
+    if (header->nlmsg_type == NLMSG_DONE) {
+      done = true;
+      return Status::success();
+    }
+
+    if (header->nlmsg_type == NLMSG_ERROR) {
+      if (header->nlmsg_len < NLMSG_LENGTH(sizeof(nlmsgerr))) {
+        return Status::failure("Truncated sock_diag error message");
+      }
+
+      auto error = static_cast<const nlmsgerr*>(NLMSG_DATA(header));
+      return Status::failure("The sock_diag request has failed: " +
+                             std::string(std::strerror(-error->error)));
+    }
+
+    if (header->nlmsg_type != SOCK_DIAG_BY_FAMILY) {
+      continue;
+    }
+
+    if (header->nlmsg_len < NLMSG_LENGTH(sizeof(inet_diag_msg))) {
+      return Status::failure("Truncated sock_diag socket message");
+    }
+
+    const auto& message =
+        *static_cast<const inet_diag_msg*>(NLMSG_DATA(header));
+
+    SocketInfo socket_info = {};
+    socket_info.socket = std::to_string(message.idiag_inode);
+    socket_info.net_ns = net_ns;
+    socket_info.family = message.idiag_family;
+    socket_info.protocol = protocol;
+    socket_info.local_address =
+        decodeSockDiagAddress(message.idiag_family, message.id.idiag_src);
+    socket_info.local_port = ntohs(message.id.idiag_sport);
+    socket_info.remote_address =
+        decodeSockDiagAddress(message.idiag_family, message.id.idiag_dst);
+    socket_info.remote_port = ntohs(message.id.idiag_dport);
+
+    // Only TCP sockets report a state, as done by the procfs parser
+    if (protocol == IPPROTO_TCP) {
+      if (message.idiag_state == 0 ||
+          message.idiag_state >= tcp_states.size()) {
+        socket_info.state = "UNKNOWN";
+      } else {
+        socket_info.state = tcp_states[message.idiag_state];
+      }
+    }
+
+    result.push_back(std::move(socket_info));
+  }
+
+  return Status::success();
+}
+
+SockDiagConnection::~SockDiagConnection() {
+  close();
+}
+
+Status SockDiagConnection::open(const std::string& pid, ino_t net_ns) {
+  close();
+
+  ProcessNamespaceList namespace_list;
+  procGetProcessNamespaces("self", namespace_list, {"net"});
+
+  auto own_net_ns_it = namespace_list.find("net");
+  if (net_ns == 0 || (own_net_ns_it != namespace_list.end() &&
+                      own_net_ns_it->second == net_ns)) {
+    fd_ = createSockDiagSocket();
+    if (fd_ == -1) {
+      return Status::failure("Failed to create the sock_diag socket: " +
+                             std::string(std::strerror(errno)));
+    }
+
+    return Status::success();
+  }
+
+  auto net_ns_path = kLinuxProcPath + "/" + pid + "/ns/net";
+  auto net_ns_fd = ::open(net_ns_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (net_ns_fd == -1) {
+    return Status::failure("Failed to open " + net_ns_path + ": " +
+                           std::string(std::strerror(errno)));
+  }
+
+  // Joining a namespace only affects the calling thread, so the socket is
+  // created from a short-lived one. It keeps the namespace it was created in
+  int error{0};
+
+  try {
+    std::thread worker([this, net_ns_fd, &error]() {
+      if (setns(net_ns_fd, CLONE_NEWNET) != 0) {
+        error = errno;
+        return;
+      }
+
+      fd_ = createSockDiagSocket();
+      if (fd_ == -1) {
+        error = errno;
+      }
+    });
+
+    worker.join();
+
+  } catch (const std::system_error& e) {
+    error = e.code().value();
+  }
+
+  ::close(net_ns_fd);
+
+  if (fd_ == -1) {
+    return Status::failure("Failed to create the sock_diag socket in " +
+                           net_ns_path + ": " +
+                           std::string(std::strerror(error)));
+  }
+
+  return Status::success();
+}
+
+bool SockDiagConnection::isOpen() const {
+  return fd_ != -1;
+}
+
+Status SockDiagConnection::getSocketList(int family,
+                                         int protocol,
+                                         ino_t net_ns,
+                                         const SockDiagFilter& filter,
+                                         SocketInfoList& result) {
+  if (fd_ == -1) {
+    return Status::failure("The sock_diag socket is not open");
+  }
+
+  auto bytecode = sockDiagGenerateBytecode(filter);
+
+  inet_diag_req_v2 request = {};
+  request.sdiag_family = static_cast<__u8>(family);
+  request.sdiag_protocol = static_cast<__u8>(protocol);
+  request.idiag_states = filter.states;
+
+  nlattr bytecode_attribute = {};
+  bytecode_attribute.nla_type = INET_DIAG_REQ_BYTECODE;
+  bytecode_attribute.nla_len =
+      static_cast<__u16>(NLA_HDRLEN + bytecode.size());
+
+  nlmsghdr header = {};
+  header.nlmsg_len = NLMSG_LENGTH(sizeof(request));
+  header.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+  header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+  header.nlmsg_seq = ++sequence_;
+
+  std::vector<iovec> iov_list = {
+      {&header, sizeof(header)},
+      {&request, sizeof(request)},
+  };
+
+  if (!bytecode.empty()) {
+    header.nlmsg_len += NLA_ALIGN(bytecode_attribute.nla_len);
+
+    iov_list.push_back({&bytecode_attribute, sizeof(bytecode_attribute)});
+    iov_list.push_back({bytecode.data(), bytecode.size()});
+  }
+
+  sockaddr_nl kernel_address = {};
+  kernel_address.nl_family = AF_NETLINK;
+
+  msghdr message = {};
+  message.msg_name = &kernel_address;
+  message.msg_namelen = sizeof(kernel_address);
+  message.msg_iov = iov_list.data();
+  message.msg_iovlen = iov_list.size();
+
+  if (sendmsg(fd_, &message, 0) == -1) {
+    auto error = errno;
+    close();
+
+    return Status::failure("Failed to send the sock_diag request: " +
+                           std::string(std::strerror(error)));
+  }
+
+  // Only hand out the sockets once the whole dump has been received, so that
+  // a failure can fall back to procfs without duplicating entries
+  SocketInfoList socket_list;
+  std::vector<std::uint8_t> buffer(kSockDiagBufferSize);
+
+  for (bool done = false; !done;) {
+    auto size = recv(fd_, buffer.data(), buffer.size(), MSG_TRUNC);
+    if (size == -1 && errno == EINTR) {
+      continue;
+    }
+
+    Status status;
+    if (size == -1) {
+      status = Status::failure("Failed to receive the sock_diag reply: " +
+                               std::string(std::strerror(errno)));
+
+    } else if (size == 0 || static_cast<std::size_t>(size) > buffer.size()) {
+      status = Status::failure("Invalid sock_diag reply size");
+
+    } else {
+      status = sockDiagParseReply(
+          buffer.data(), size, protocol, net_ns, socket_list, done);
+    }
+
+    if (!status.ok()) {
+      // The rest of the dump may still be queued on the socket
+      close();
+      return status;
+    }
+  }
+
+  result.insert(result.end(),
+                std::make_move_iterator(socket_list.begin()),
+                std::make_move_iterator(socket_list.end()));
+
+  return Status::success();
+}
+
+void SockDiagConnection::close() {
+  if (fd_ != -1) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+}
+
+} // namespace osquery
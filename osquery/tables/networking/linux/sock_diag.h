@@ -0,0 +1,95 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
+
+#include <osquery/filesystem/linux/proc.h>
+#include <osquery/utils/status/status.h>
+
+namespace osquery {
+
+/// Bitmask of all the TCP states, from TCP_ESTABLISHED to TCP_CLOSING
+const std::uint32_t kSockDiagAllStates{0xFFEU};
+
+/// \brief Filters applied by the kernel while it dumps a socket table
+struct SockDiagFilter final {
+  /// States to dump, one bit for each TCP state number
+  std::uint32_t states{kSockDiagAllStates};
+
+  /// If set, only dump the sockets bound to this local port
+  boost::optional<std::uint16_t> local_port;
+
+  /// If set, only dump the sockets connected to this remote port
+  boost::optional<std::uint16_t> remote_port;
+};
+
+/// Returns true if the protocol can be enumerated with NETLINK_SOCK_DIAG
+bool sockDiagSupportsProtocol(int protocol);
+
+/// Returns the SockDiagFilter::states bit of a process_open_sockets state
+/// name, or 0 if the name does not match a single TCP state
+std::uint32_t sockDiagGetStateMask(const std::string& state);
+
+/// \brief Encodes the port filters as inet_diag bytecode
+/// Returns an empty buffer if the filter has no port conditions
+std::vector<std::uint8_t> sockDiagGenerateBytecode(
+    const SockDiagFilter& filter);
+
+/// \brief Parses a buffer of inet_diag_msg netlink replies
+/// Sockets are appended to the list, and done is set once the end of the
+/// dump has been reached
+Status sockDiagParseReply(const std::uint8_t* buffer,
+                          std::size_t size,
+                          int protocol,
+                          ino_t net_ns,
+                          SocketInfoList& result,
+                          bool& done);
+
+/**
+ * @brief A NETLINK_SOCK_DIAG socket bound to a network namespace
+ *
+ * The sockets of a namespace are dumped by the kernel in binary form, which
+ * avoids formatting and parsing the /proc/<pid>/net tables. The netlink
+ * socket is created from within the namespace of the given process, and
+ * keeps reporting on it for its whole lifetime.
+ */
+class SockDiagConnection final : private boost::noncopyable {
+ public:
+  SockDiagConnection() = default;
+  ~SockDiagConnection();
+
+  /// Opens the netlink socket in the network namespace of the given process
+  Status open(const std::string& pid, ino_t net_ns);
+
+  /// Returns false if the socket could not be opened or has failed
+  bool isOpen() const;
+
+  /// Dumps the sockets of the given family and protocol matching the filter
+  Status getSocketList(int family,
+                       int protocol,
+                       ino_t net_ns,
+                       const SockDiagFilter& filter,
+                       SocketInfoList& result);
+
+ private:
+  void close();
+
+  int fd_{-1};
+  std::uint32_t sequence_{0U};
+};
+
+} // namespace osquery
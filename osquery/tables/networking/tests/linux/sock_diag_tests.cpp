@@ -0,0 +1,227 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+#include <linux/netlink.h>
+#include <linux/sock_diag.h>
+#include <netinet/in.h>
+
+#include <osquery/tables/networking/linux/inet_diag.h>
+#include <osquery/tables/networking/linux/process_open_sockets.h>
+#include <osquery/tables/networking/linux/sock_diag.h>
+
+namespace osquery {
+
+namespace {
+
+/// Appends a netlink message with the given payload to the buffer
+template <typename PayloadType>
+void appendNetlinkMessage(std::vector<std::uint32_t>& buffer,
+                          std::uint16_t type,
+                          const PayloadType& payload) {
+  nlmsghdr header = {};
+  header.nlmsg_len = NLMSG_LENGTH(sizeof(payload));
+  header.nlmsg_type = type;
+
+  auto offset = buffer.size() * sizeof(std::uint32_t);
+  buffer.resize(buffer.size() +
+                NLMSG_ALIGN(header.nlmsg_len) / sizeof(std::uint32_t));
+
+  auto data = reinterpret_cast<std::uint8_t*>(buffer.data()) + offset;
+  std::memcpy(data, &header, sizeof(header));
+  std::memcpy(data + NLMSG_HDRLEN, &payload, sizeof(payload));
+}
+
+} // namespace
+
+class SockDiagTests : public testing::Test {};
+
+TEST_F(SockDiagTests, test_state_mask) {
+  EXPECT_EQ(sockDiagGetStateMask("ESTABLISHED"), 1U << 1);
+  EXPECT_EQ(sockDiagGetStateMask("LISTEN"), 1U << 10);
+  EXPECT_EQ(sockDiagGetStateMask("CLOSING"), 1U << 11);
+
+  EXPECT_EQ(sockDiagGetStateMask("UNKNOWN"), 0U);
+  EXPECT_EQ(sockDiagGetStateMask(""), 0U);
+  EXPECT_EQ(sockDiagGetStateMask("listen"), 0U);
+}
+
+TEST_F(SockDiagTests, test_generate_bytecode) {
+  SockDiagFilter filter;
+  EXPECT_TRUE(sockDiagGenerateBytecode(filter).empty());
+
+  filter.local_port = 22;
+  filter.remote_port = 0;
+
+  auto bytecode = sockDiagGenerateBytecode(filter);
+  ASSERT_EQ(bytecode.size(), 8U * sizeof(inet_diag_bc_op));
+
+  std::vector<inet_diag_bc_op> op_list(8U);
+  std::memcpy(op_list.data(), bytecode.data(), bytecode.size());
+
+  const std::vector<unsigned char> expected_code_list = {INET_DIAG_BC_S_GE,
+                                                         INET_DIAG_BC_S_LE,
+                                                         INET_DIAG_BC_D_GE,
+                                                         INET_DIAG_BC_D_LE};
+
+  for (std::size_t i = 0U; i < expected_code_list.size(); ++i) {
+    const auto& condition = op_list.at(i * 2U);
+    const auto& argument = op_list.at((i * 2U) + 1U);
+
+    EXPECT_EQ(condition.code, expected_code_list.at(i));
+    EXPECT_EQ(argument.no, (i < 2U) ? 22U : 0U);
+
+    // Matches move on to the next condition, anything else jumps past the end
+    auto remaining_size = bytecode.size() - (i * 2U * sizeof(inet_diag_bc_op));
+    EXPECT_EQ(condition.yes, 2U * sizeof(inet_diag_bc_op));
+    EXPECT_EQ(condition.no, remaining_size + sizeof(inet_diag_bc_op));
+  }
+}
+
+TEST_F(SockDiagTests, test_parse_reply) {
+  std::vector<std::uint32_t> buffer;
+
+  inet_diag_msg listening_socket = {};
+  listening_socket.idiag_family = AF_INET;
+  listening_socket.idiag_state = 10;
+  listening_socket.idiag_inode = 1234;
+  listening_socket.id.idiag_sport = htons(22);
+  listening_socket.id.idiag_src[0] = htonl(INADDR_LOOPBACK);
+  appendNetlinkMessage(buffer, SOCK_DIAG_BY_FAMILY, listening_socket);
+
+  inet_diag_msg connected_socket = {};
+  connected_socket.idiag_family = AF_INET6;
+  connected_socket.idiag_state = 1;
+  connected_socket.idiag_inode = 5678;
+  connected_socket.id.idiag_sport = htons(40000);
+  connected_socket.id.idiag_dport = htons(443);
+  connected_socket.id.idiag_src[3] = htonl(1);
+  appendNetlinkMessage(buffer, SOCK_DIAG_BY_FAMILY, connected_socket);
+
+  SocketInfoList socket_list;
+  bool done{false};
+
+  auto status =
+      sockDiagParseReply(reinterpret_cast<const std::uint8_t*>(buffer.data()),
+                         buffer.size() * sizeof(std::uint32_t),
+                         IPPROTO_TCP,
+                         42,
+                         socket_list,
+                         done);
+
+  ASSERT_TRUE(status.ok());
+  EXPECT_FALSE(done);
+  ASSERT_EQ(socket_list.size(), 2U);
+
+  EXPECT_EQ(socket_list[0].socket, "1234");
+  EXPECT_EQ(socket_list[0].net_ns, 42U);
+  EXPECT_EQ(socket_list[0].family, AF_INET);
+  EXPECT_EQ(socket_list[0].protocol, IPPROTO_TCP);
+  EXPECT_EQ(socket_list[0].local_address, "127.0.0.1");
+  EXPECT_EQ(socket_list[0].local_port, 22U);
+  EXPECT_EQ(socket_list[0].remote_address, "0.0.0.0");
+  EXPECT_EQ(socket_list[0].remote_port, 0U);
+  EXPECT_EQ(socket_list[0].state, "LISTEN");
+
+  EXPECT_EQ(socket_list[1].socket, "5678");
+  EXPECT_EQ(socket_list[1].family, AF_INET6);
+  EXPECT_EQ(socket_list[1].local_address, "::1");
+  EXPECT_EQ(socket_list[1].local_port, 40000U);
+  EXPECT_EQ(socket_list[1].remote_address, "::");
+  EXPECT_EQ(socket_list[1].remote_port, 443U);
+  EXPECT_EQ(socket_list[1].state, "ESTABLISHED");
+
+  // UDP sockets have no state, and the dump ends with NLMSG_DONE
+  buffer.clear();
+  appendNetlinkMessage(buffer, SOCK_DIAG_BY_FAMILY, listening_socket);
+  appendNetlinkMessage(buffer, NLMSG_DONE, 0);
+
+  socket_list.clear();
+  status =
+      sockDiagParseReply(reinterpret_cast<const std::uint8_t*>(buffer.data()),
+                         buffer.size() * sizeof(std::uint32_t),
+                         IPPROTO_UDP,
+                         42,
+                         socket_list,
+                         done);
+
+  ASSERT_TRUE(status.ok());
+  EXPECT_TRUE(done);
+  ASSERT_EQ(socket_list.size(), 1U);
+  EXPECT_TRUE(socket_list[0].state.empty());
+
+  // Errors reported by the kernel fail the whole dump
+  nlmsgerr error = {};
+  error.error = -EPERM;
+
+  buffer.clear();
+  appendNetlinkMessage(buffer, NLMSG_ERROR, error);
+
+  status =
+      sockDiagParseReply(reinterpret_cast<const std::uint8_t*>(buffer.data()),
+                         buffer.size() * sizeof(std::uint32_t),
+                         IPPROTO_TCP,
+                         42,
+                         socket_list,
+                         done);
+
+  EXPECT_FALSE(status.ok());
+}
+
+TEST_F(SockDiagTests, test_socket_list_constraints) {
+  using namespace tables;
+
+  QueryContext context;
+  auto constraints = getSocketListConstraints(context);
+  EXPECT_TRUE(isSocketListWanted(constraints, AF_INET, IPPROTO_TCP));
+  EXPECT_TRUE(isSocketListWanted(constraints, AF_INET6, IPPROTO_UDP));
+  EXPECT_TRUE(isSocketListWanted(constraints, AF_UNIX, IPPROTO_IP));
+  EXPECT_TRUE(isSocketListWanted(constraints, AF_PACKET, 0));
+
+  // A TCP state only reads the TCP lists, filtered by the kernel
+  context.constraints["state"].add(Constraint(EQUALS, "LISTEN"));
+  constraints = getSocketListConstraints(context);
+  EXPECT_EQ(constraints.filter.states, sockDiagGetStateMask("LISTEN"));
+  EXPECT_TRUE(isSocketListWanted(constraints, AF_INET, IPPROTO_TCP));
+  EXPECT_FALSE(isSocketListWanted(constraints, AF_INET, IPPROTO_UDP));
+  EXPECT_FALSE(isSocketListWanted(constraints, AF_PACKET, 0));
+
+  // Packet sockets have the NONE state, which is not a TCP state
+  context.constraints.erase("state");
+  context.constraints["state"].add(Constraint(EQUALS, "NONE"));
+  constraints = getSocketListConstraints(context);
+  EXPECT_TRUE(constraints.stateless);
+  EXPECT_TRUE(isSocketListWanted(constraints, AF_PACKET, 0));
+  EXPECT_TRUE(isSocketListWanted(constraints, AF_UNIX, IPPROTO_IP));
+  EXPECT_TRUE(isSocketListWanted(constraints, AF_INET, IPPROTO_TCP));
+
+  // The family and protocol constraints select the lists
+  context.constraints.erase("state");
+  context.constraints["family"].add(
+      Constraint(EQUALS, std::to_string(AF_INET6)));
+  context.constraints["protocol"].add(
+      Constraint(EQUALS, std::to_string(IPPROTO_UDP)));
+  constraints = getSocketListConstraints(context);
+  EXPECT_TRUE(isSocketListWanted(constraints, AF_INET6, IPPROTO_UDP));
+  EXPECT_FALSE(isSocketListWanted(constraints, AF_INET6, IPPROTO_TCP));
+  EXPECT_FALSE(isSocketListWanted(constraints, AF_INET, IPPROTO_UDP));
+  EXPECT_FALSE(isSocketListWanted(constraints, AF_PACKET, 0));
+
+  // Ports are pushed to the kernel filter
+  context.constraints["local_port"].add(Constraint(EQUALS, "443"));
+  constraints = getSocketListConstraints(context);
+  ASSERT_TRUE(constraints.filter.local_port.is_initialized());
+  EXPECT_EQ(*constraints.filter.local_port, 443U);
+  EXPECT_FALSE(constraints.filter.remote_port.is_initialized());
+}
+
+} // namespace osquery
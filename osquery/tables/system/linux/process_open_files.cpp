@@ -10,6 +10,8 @@
 #include <osquery/core/core.h>
 #include <osquery/core/tables.h>
 #include <osquery/filesystem/filesystem.h>
+#include <osquery/filesystem/linux/proc_enumerator.h>
+#include <osquery/filesystem/linux/proc_reader.h>
 #include <osquery/logger/logger.h>
 
 namespace osquery {
@@ -46,11 +48,21 @@ QueryData genOpenFiles(QueryContext& context) {
     osquery::procProcesses(pids);
   }
 
-  for (const auto& process : pids) {
-    std::map<std::string, std::string> descriptors;
-    if (osquery::procDescriptors(process, descriptors).ok()) {
-      genDescriptors(process, descriptors, results);
-    }
+  auto shard_list = procEnumerateShards<QueryData>(
+      pids,
+      procGetEnumerationThreadCount(),
+      [](const std::string& process, QueryData& shard_results) {
+        ProcReader reader(process);
+        std::map<std::string, std::string> descriptors;
+        if (reader.isOpen() && reader.getDescriptors(descriptors).ok()) {
+          genDescriptors(process, descriptors, shard_results);
+        }
+      });
+
+  for (auto& shard_results : shard_list) {
+    results.insert(results.end(),
+                   std::make_move_iterator(shard_results.begin()),
+                   std::make_move_iterator(shard_results.end()));
   }
 
   return results;
@@ -25,10 +25,12 @@
 #include <osquery/core/tables.h>
 #include <osquery/filesystem/filesystem.h>
 #include <osquery/filesystem/linux/proc.h>
+#include <osquery/filesystem/linux/proc_enumerator.h>
+#include <osquery/filesystem/linux/proc_reader.h>
 #include <osquery/logger/logger.h>
-#include <osquery/sql/dynamic_table_row.h>
+#include <osquery/rows/processes.h>
+#include <osquery/sql/columnar_table_row.h>
 #include <osquery/tables/system/linux/processes.h>
-#include <osquery/utils/conversions/split.h>
 #include <osquery/utils/system/boottime.h>
 
 #include <ctime>
@@ -38,16 +40,13 @@ namespace tables {
 
 const int kMSIn1CLKTCK = (1000 / sysconf(_SC_CLK_TCK));
 
-inline std::string getProcAttr(const std::string& attr,
-                               const std::string& pid) {
-  return "/proc/" + pid + "/" + attr;
-}
-
-inline std::string readProcCMDLine(const std::string& pid) {
-  auto attr = getProcAttr("cmdline", pid);
+inline std::string readProcCMDLine(const ProcReader& reader) {
+  std::string_view cmdline;
+  if (!reader.read("cmdline", cmdline).ok()) {
+    return {};
+  }
 
-  std::string content;
-  readFile(attr, content);
+  std::string content(cmdline);
   // Remove \0 delimiters.
   std::replace_if(
       content.begin(),
@@ -59,7 +58,7 @@ inline std::string readProcCMDLine(const std::string& pid) {
   return content;
 }
 
-std::string parseProcCGroup(const std::string& content) {
+std::string parseProcCGroup(std::string_view content) {
   // Get only the first line
   // with v1 cgroups we'll have separate lines for different cgroup types
   auto end_pos = content.find('\n');
@@ -74,69 +73,46 @@ std::string parseProcCGroup(const std::string& content) {
   }
   auto second_colon = content.find(':', first_colon + 1);
   if (second_colon != std::string::npos && second_colon < end_pos) {
-    return content.substr(second_colon + 1, end_pos - second_colon - 1);
+    return std::string(
+        content.substr(second_colon + 1, end_pos - second_colon - 1));
   } else {
     return {};
   }
 }
 
-inline std::string readProcCgroup(const std::string& pid) {
-  auto attr = getProcAttr("cgroup", pid);
-
-  std::string content;
-  if (!readFile(attr, content).ok()) {
+inline std::string readProcCgroup(const ProcReader& reader) {
+  std::string_view content;
+  if (!reader.read("cgroup", content).ok()) {
     return {};
   };
   return parseProcCGroup(content);
 }
 
-inline std::string readProcLink(const std::string& attr,
-                                const std::string& pid) {
+inline std::string readProcLink(const char* attr, const ProcReader& reader) {
   // The exe is a symlink to the binary on-disk.
-  auto attr_path = getProcAttr(attr, pid);
-
-  std::string result = "";
-  struct stat sb;
-  if (lstat(attr_path.c_str(), &sb) != -1) {
-    // Some symlinks may report 'st_size' as zero
-    // Use PATH_MAX as best guess
-    // For cases when 'st_size' is not zero but smaller than
-    // PATH_MAX we will still use PATH_MAX to minimize chance
-    // of output trucation during race condition
-    ssize_t buf_size = sb.st_size < PATH_MAX ? PATH_MAX : sb.st_size;
-    // +1 for \0, since readlink does not append a null
-    char* linkname = static_cast<char*>(malloc(buf_size + 1));
-    ssize_t r = readlink(attr_path.c_str(), linkname, buf_size);
-
-    if (r > 0) { // Success check
-      // r may not be equal to buf_size
-      // if r == buf_size there was race condition
-      // and link is longer than buf_size and because of this
-      // truncated
-      linkname[r] = '\0';
-      result = std::string(linkname);
-    }
-    free(linkname);
-  }
-
+  std::string result;
+  reader.readLink(attr, result);
   return result;
 }
 
 // In the case where the linked binary path ends in " (deleted)", and a file
 // actually exists at that path, check whether the inode of that file matches
 // the inode of the mapped file in /proc/%pid/maps
-Status deletedMatchesInode(const std::string& path, const std::string& pid) {
-  const std::string maps_path = getProcAttr("maps", pid);
-  std::string maps_contents;
-  auto s = osquery::readFile(maps_path, maps_contents);
+Status deletedMatchesInode(const std::string& path, const ProcReader& reader) {
+  const std::string maps_path = "/proc/" + reader.pid() + "/maps";
+  std::string_view maps_contents;
+  auto s = reader.read("maps", maps_contents);
   if (!s.ok()) {
     return Status(-1, "Cannot read maps file: " + maps_path);
   }
 
   // Extract the expected inode of the binary file from /proc/%pid/maps
-  std::smatch what;
+  std::cmatch what;
   std::regex expression("([0-9]+)\\h+\\Q" + path + "\\E");
-  if (!std::regex_search(maps_contents, what, expression)) {
+  if (!std::regex_search(maps_contents.data(),
+                         maps_contents.data() + maps_contents.size(),
+                         what,
+                         expression)) {
     return Status(-1, "Could not find binary inode in maps file: " + maps_path);
   }
   std::string inode = what[1];
@@ -171,62 +147,58 @@ std::set<std::string> getProcList(const QueryContext& context) {
   return pidlist;
 }
 
-void genProcessEnvironment(const std::string& pid, QueryData& results) {
-  auto attr = getProcAttr("environ", pid);
-
-  std::string content;
-  readFile(attr, content);
-  const char* variable = content.c_str();
+void genProcessEnvironment(const ProcReader& reader, QueryData& results) {
+  std::string_view content;
+  reader.read("environ", content);
 
   // Stop at the end of nul-delimited string content.
-  while (*variable > 0) {
-    auto buf = std::string(variable);
-    size_t idx = buf.find_first_of("=");
+  while (!content.empty() && content.front() != '\0') {
+    auto variable = content.substr(0, content.find('\0'));
+    size_t idx = variable.find_first_of("=");
 
     Row r;
-    r["pid"] = pid;
-    r["key"] = buf.substr(0, idx);
-    r["value"] = buf.substr(idx + 1);
-    results.push_back(r);
-    variable += buf.size() + 1;
+    r["pid"] = reader.pid();
+    r["key"] = std::string(variable.substr(0, idx));
+    r["value"] = std::string(variable.substr(idx + 1));
+    results.push_back(std::move(r));
+    content.remove_prefix(std::min(variable.size() + 1, content.size()));
   }
 }
 
-void genProcessMap(const std::string& pid, QueryData& results) {
-  auto map = getProcAttr("maps", pid);
+void genProcessMap(const ProcReader& reader, QueryData& results) {
+  std::string_view content;
+  reader.read("maps", content);
 
-  std::string content;
-  readFile(map, content);
-  for (auto& line : osquery::split(content, "\n")) {
-    auto fields = osquery::split(line, " ");
+  std::string_view line;
+  std::vector<std::string_view> fields;
+  while (procNextLine(content, line)) {
+    procSplitFields(line, fields);
     // If can't read address, not sure.
     if (fields.size() < 5) {
       continue;
     }
 
     Row r;
-    r["pid"] = pid;
-    if (!fields[0].empty()) {
-      auto addresses = osquery::split(fields[0], "-");
-      if (addresses.size() >= 2) {
-        r["start"] = "0x" + addresses[0];
-        r["end"] = "0x" + addresses[1];
-      } else {
-        // Problem with the address format.
-        continue;
-      }
+    r["pid"] = reader.pid();
+    auto separator = fields[0].find('-');
+    if (separator == std::string_view::npos || separator == 0 ||
+        separator + 1 == fields[0].size()) {
+      // Problem with the address format.
+      continue;
     }
 
-    r["permissions"] = fields[1];
-    auto offset = tryTo<long long>(fields[2], 16);
+    r["start"] = "0x" + std::string(fields[0].substr(0, separator));
+    r["end"] = "0x" + std::string(fields[0].substr(separator + 1));
+
+    r["permissions"] = std::string(fields[1]);
+    auto offset = tryTo<long long>(std::string(fields[2]), 16);
     r["offset"] = BIGINT((offset) ? offset.take() : -1);
-    r["device"] = fields[3];
-    r["inode"] = fields[4];
+    r["device"] = std::string(fields[3]);
+    r["inode"] = std::string(fields[4]);
 
     // Path name must be trimmed.
     if (fields.size() > 5) {
-      boost::trim(fields[5]);
-      r["path"] = fields[5];
+      r["path"] = std::string(fields[5]);
     }
 
     // BSS with name in pathname.
@@ -235,8 +207,25 @@ void genProcessMap(const std::string& pid, QueryData& results) {
   }
 }
 
+/// Converts a memory size of the status file, in kB (1024 bytes), to bytes
+Status parseProcStatusMemorySize(std::string_view value, std::string& bytes) {
+  if (value.size() < 3) {
+    return Status::failure("Invalid memory size");
+  }
+
+  // Remove the " kB" suffix
+  auto size =
+      tryTo<std::uint64_t>(std::string(value.substr(0, value.size() - 3)));
+  if (size.isError()) {
+    return Status::failure("Invalid memory size");
+  }
+
+  bytes = std::to_string(size.get() * 1024);
+  return Status::success();
+}
+
 /**
- *  Output from string parsing /proc/<pid>/status.
+ *  Output from string parsing /proc/<pid>/stat and /proc/<pid>/status.
  */
 struct SimpleProcStat : private boost::noncopyable {
  public:
@@ -261,20 +250,26 @@ struct SimpleProcStat : private boost::noncopyable {
   /// For errors processing proc data.
   Status status;
 
-  explicit SimpleProcStat(const std::string& pid);
+  /// Only the requested files are read
+  SimpleProcStat(const ProcReader& reader, bool read_stat, bool read_status);
 };
 
-SimpleProcStat::SimpleProcStat(const std::string& pid) {
-  std::string content;
-  if (readFile(getProcAttr("stat", pid), content).ok()) {
-    auto start = content.find_last_of(")");
+SimpleProcStat::SimpleProcStat(const ProcReader& reader,
+                               bool read_stat,
+                               bool read_status) {
+  // The field lists keep their capacity across processes
+  static thread_local std::vector<std::string_view> details;
+
+  std::string_view content;
+  if (read_stat && reader.read("stat", content).ok()) {
+    auto start = content.find_last_of(')');
     // Start parsing stats from ") <MODE>..."
-    if (start == std::string::npos || content.size() <= start + 2) {
+    if (start == std::string_view::npos || content.size() <= start + 2) {
       status = Status(1, "Invalid /proc/stat header");
       return;
     }
 
-    auto details = osquery::split(content.substr(start + 2), " ");
+    procSplitFields(content.substr(start + 2), details);
     if (details.size() <= 19) {
       status = Status(1, "Invalid /proc/stat content");
       return;
@@ -290,64 +285,55 @@ SimpleProcStat::SimpleProcStat(const std::string& pid) {
     this->start_time = details.at(19);
   }
 
+  if (!read_status) {
+    return;
+  }
+
   // /proc/N/status may be not available, or readable by this user.
-  if (!readFile(getProcAttr("status", pid), content).ok()) {
+  if (!reader.read("status", content).ok()) {
     status = Status(1, "Cannot read /proc/status");
     return;
   }
 
-  for (const auto& line : osquery::split(content, "\n")) {
+  std::string_view line;
+  std::string_view key;
+  std::string_view value;
+
+  while (procNextLine(content, line)) {
     // Status lines are formatted: Key: Value....\n.
-    auto detail = osquery::split(line, ':', 1);
-    if (detail.size() != 2) {
+    if (!procSplitKeyValue(line, key, value)) {
       continue;
     }
 
     // There are specific fields from each detail.
-    if (detail.at(0) == "Name") {
-      this->name = detail.at(1);
-    } else if (detail.at(0) == "VmRSS") {
-      detail[1].erase(detail.at(1).end() - 3, detail.at(1).end());
-      // Memory is reported in kB (1024 bytes).
-      auto resident_size_result = osquery::tryTo<std::uint64_t>(detail.at(1));
-
-      if (resident_size_result.isError()) {
+    if (key == "Name") {
+      this->name = value;
+    } else if (key == "VmRSS") {
+      if (!parseProcStatusMemorySize(value, this->resident_size).ok()) {
         status =
             Status::failure("Failed to convert VmRSS string value to integer");
         return;
       }
-
-      const auto resident_size = resident_size_result.get() * 1024;
-
-      this->resident_size = std::to_string(resident_size);
-    } else if (detail.at(0) == "VmSize") {
-      detail[1].erase(detail.at(1).end() - 3, detail.at(1).end());
-      // Memory is reported in kB (1024 bytes).
-      auto virtual_size_result = osquery::tryTo<std::uint64_t>(detail.at(1));
-
-      if (virtual_size_result.isError()) {
+    } else if (key == "VmSize") {
+      if (!parseProcStatusMemorySize(value, this->total_size).ok()) {
         status =
             Status::failure("Failed to convert VmSize string value to integer");
         return;
       }
-
-      const auto virtual_size = virtual_size_result.get() * 1024;
-
-      this->total_size = std::to_string(virtual_size);
-    } else if (detail.at(0) == "Gid") {
+    } else if (key == "Gid") {
       // Format is: R E - -
-      auto gid_detail = osquery::split(detail.at(1), "\t");
-      if (gid_detail.size() == 4) {
-        this->real_gid = gid_detail.at(0);
-        this->effective_gid = gid_detail.at(1);
-        this->saved_gid = gid_detail.at(2);
+      procSplitFields(value, details);
+      if (details.size() == 4) {
+        this->real_gid = details.at(0);
+        this->effective_gid = details.at(1);
+        this->saved_gid = details.at(2);
       }
-    } else if (detail.at(0) == "Uid") {
-      auto uid_detail = osquery::split(detail.at(1), "\t");
-      if (uid_detail.size() == 4) {
-        this->real_uid = uid_detail.at(0);
-        this->effective_uid = uid_detail.at(1);
-        this->saved_uid = uid_detail.at(2);
+    } else if (key == "Uid") {
+      procSplitFields(value, details);
+      if (details.size() == 4) {
+        this->real_uid = details.at(0);
+        this->effective_uid = details.at(1);
+        this->saved_uid = details.at(2);
       }
     }
   }
@@ -365,31 +351,35 @@ struct SimpleProcIo : private boost::noncopyable {
   /// For errors processing proc data.
   Status status;
 
-  explicit SimpleProcIo(const std::string& pid);
+  explicit SimpleProcIo(const ProcReader& reader);
 };
 
-SimpleProcIo::SimpleProcIo(const std::string& pid) {
-  std::string content;
-  if (!readFile(getProcAttr("io", pid), content).ok()) {
-    status = Status(
-        1, "Cannot read /proc/" + pid + "/io (is osquery running as root?)");
+SimpleProcIo::SimpleProcIo(const ProcReader& reader) {
+  std::string_view content;
+  if (!reader.read("io", content).ok()) {
+    status = Status(1,
+                    "Cannot read /proc/" + reader.pid() +
+                        "/io (is osquery running as root?)");
     return;
   }
 
-  for (const auto& line : osquery::split(content, "\n")) {
+  std::string_view line;
+  std::string_view key;
+  std::string_view value;
+
+  while (procNextLine(content, line)) {
     // IO lines are formatted: Key: Value....\n.
-    auto detail = osquery::split(line, ':', 1);
-    if (detail.size() != 2) {
+    if (!procSplitKeyValue(line, key, value)) {
       continue;
     }
 
     // There are specific fields from each detail
-    if (detail.at(0) == "read_bytes") {
-      this->read_bytes = detail.at(1);
-    } else if (detail.at(0) == "write_bytes") {
-      this->write_bytes = detail.at(1);
-    } else if (detail.at(0) == "cancelled_write_bytes") {
-      this->cancelled_write_bytes = detail.at(1);
+    if (key == "read_bytes") {
+      this->read_bytes = value;
+    } else if (key == "write_bytes") {
+      this->write_bytes = value;
+    } else if (key == "cancelled_write_bytes") {
+      this->cancelled_write_bytes = value;
     }
   }
 }
@@ -403,12 +393,12 @@ SimpleProcIo::SimpleProcIo(const std::string& pid) {
  * executable is available and the file does NOT exist on disk, set on_disk
  * to 0.
  *
- * @param pid The string (because we're referencing file path) pid.
+ * @param reader The reader of the process directory.
  * @param path A mutable string found from /proc/N/exe. If this is found
  *             to contain the (deleted) suffix, it will be removed.
  * @return A tristate -1 error, 1 yes, 0 nope.
  */
-int getOnDisk(const std::string& pid, std::string& path) {
+int getOnDisk(const ProcReader& reader, std::string& path) {
   if (path.empty()) {
     return -1;
   }
@@ -429,8 +419,7 @@ int getOnDisk(const std::string& pid, std::string& path) {
   // Special case in which we have to check the inode to see whether the
   // process is actually running from a binary file ending with
   // " (deleted)". See #1607
-  std::string maps_contents;
-  Status deleted = deletedMatchesInode(path, pid);
+  Status deleted = deletedMatchesInode(path, reader);
   if (deleted.getCode() == -1) {
     LOG(ERROR) << deleted.getMessage();
     return -1;
@@ -446,94 +435,219 @@ int getOnDisk(const std::string& pid, std::string& path) {
   }
 }
 
-void genProcess(const std::string& pid,
+/// Slots of the processes columns, resolved once per generate call.
+struct ProcessColumnSlots {
+  size_t pid;
+  size_t name;
+  size_t path;
+  size_t cmdline;
+  size_t state;
+  size_t cwd;
+  size_t root;
+  size_t uid;
+  size_t gid;
+  size_t euid;
+  size_t egid;
+  size_t suid;
+  size_t sgid;
+  size_t on_disk;
+  size_t wired_size;
+  size_t resident_size;
+  size_t total_size;
+  size_t user_time;
+  size_t system_time;
+  size_t disk_bytes_read;
+  size_t disk_bytes_written;
+  size_t start_time;
+  size_t parent;
+  size_t pgroup;
+  size_t threads;
+  size_t nice;
+  size_t cgroup_path;
+
+  explicit ProcessColumnSlots(const ColumnarSchema& schema)
+      : pid(schema.slot("pid")),
+        name(schema.slot("name")),
+        path(schema.slot("path")),
+        cmdline(schema.slot("cmdline")),
+        state(schema.slot("state")),
+        cwd(schema.slot("cwd")),
+        root(schema.slot("root")),
+        uid(schema.slot("uid")),
+        gid(schema.slot("gid")),
+        euid(schema.slot("euid")),
+        egid(schema.slot("egid")),
+        suid(schema.slot("suid")),
+        sgid(schema.slot("sgid")),
+        on_disk(schema.slot("on_disk")),
+        wired_size(schema.slot("wired_size")),
+        resident_size(schema.slot("resident_size")),
+        total_size(schema.slot("total_size")),
+        user_time(schema.slot("user_time")),
+        system_time(schema.slot("system_time")),
+        disk_bytes_read(schema.slot("disk_bytes_read")),
+        disk_bytes_written(schema.slot("disk_bytes_written")),
+        start_time(schema.slot("start_time")),
+        parent(schema.slot("parent")),
+        pgroup(schema.slot("pgroup")),
+        threads(schema.slot("threads")),
+        nice(schema.slot("nice")),
+        cgroup_path(schema.slot("cgroup_path")) {}
+};
+
+/// The procfs files to read for the columns used by the query.
+struct ProcessFileSet {
+  bool stat;
+  bool status;
+  bool io;
+  bool cmdline;
+  bool cgroup;
+  bool cwd;
+  bool root;
+  bool exe;
+
+  explicit ProcessFileSet(const QueryContext& context)
+      : stat(context.isAnyColumnUsed(
+            ProcessesRow::STATE | ProcessesRow::PARENT | ProcessesRow::PGROUP |
+            ProcessesRow::NICE | ProcessesRow::THREADS |
+            ProcessesRow::USER_TIME | ProcessesRow::SYSTEM_TIME |
+            ProcessesRow::START_TIME)),
+        status(context.isAnyColumnUsed(
+            ProcessesRow::NAME | ProcessesRow::UID | ProcessesRow::GID |
+            ProcessesRow::EUID | ProcessesRow::EGID | ProcessesRow::SUID |
+            ProcessesRow::SGID | ProcessesRow::RESIDENT_SIZE |
+            ProcessesRow::TOTAL_SIZE)),
+        io(context.isAnyColumnUsed(ProcessesRow::DISK_BYTES_READ |
+                                   ProcessesRow::DISK_BYTES_WRITTEN)),
+        cmdline(context.isAnyColumnUsed(ProcessesRow::CMDLINE)),
+        cgroup(context.isAnyColumnUsed(ProcessesRow::CGROUP_PATH)),
+        cwd(context.isAnyColumnUsed(ProcessesRow::CWD)),
+        root(context.isAnyColumnUsed(ProcessesRow::ROOT)),
+        exe(context.isAnyColumnUsed(ProcessesRow::PATH |
+                                    ProcessesRow::ON_DISK)) {}
+};
+
+void genProcess(const ProcReader& reader,
                 std::uint64_t system_boot_time,
-                QueryContext& context,
+                const ProcessFileSet& files,
+                const std::shared_ptr<const ColumnarSchema>& schema,
+                const ProcessColumnSlots& slots,
                 TableRows& results) {
   // Parse the process stat and status.
-  SimpleProcStat proc_stat(pid);
-  // Parse the process io
-  SimpleProcIo proc_io(pid);
+  SimpleProcStat proc_stat(reader, files.stat, files.status);
 
   if (!proc_stat.status.ok()) {
-    VLOG(1) << proc_stat.status.getMessage() << " for pid " << pid;
+    VLOG(1) << proc_stat.status.getMessage() << " for pid " << reader.pid();
     return;
   }
 
-  auto r = make_table_row();
-  r["pid"] = pid;
-  r["parent"] = proc_stat.parent;
-  r["path"] = readProcLink("exe", pid);
-  r["name"] = proc_stat.name;
-  r["pgroup"] = proc_stat.group;
-  r["state"] = proc_stat.state;
-  r["nice"] = proc_stat.nice;
-  r["threads"] = proc_stat.threads;
+  auto r = std::make_unique<ColumnarTableRow>(schema);
+  r->set(slots.pid, reader.pid());
+  r->set(slots.wired_size, 0); // No support for unpagable counters in linux.
+
+  if (files.stat) {
+    r->set(slots.parent, proc_stat.parent);
+    r->set(slots.pgroup, proc_stat.group);
+    r->set(slots.state, proc_stat.state);
+    r->set(slots.nice, proc_stat.nice);
+    r->set(slots.threads, proc_stat.threads);
+
+    // time information
+    auto usr_time = std::strtoull(proc_stat.user_time.data(), nullptr, 10);
+    r->set(slots.user_time, usr_time * kMSIn1CLKTCK);
+    auto sys_time = std::strtoull(proc_stat.system_time.data(), nullptr, 10);
+    r->set(slots.system_time, sys_time * kMSIn1CLKTCK);
+
+    auto proc_start_time_exp = tryTo<long>(proc_stat.start_time);
+    if (proc_start_time_exp.isValue() && system_boot_time > 0) {
+      auto proc_start_time = proc_start_time_exp.take() / sysconf(_SC_CLK_TCK);
+
+      r->set(slots.start_time, system_boot_time + proc_start_time);
+    } else {
+      r->set(slots.start_time, -1);
+    }
+  }
+
+  if (files.status) {
+    r->set(slots.name, proc_stat.name);
+    r->set(slots.uid, proc_stat.real_uid);
+    r->set(slots.euid, proc_stat.effective_uid);
+    r->set(slots.suid, proc_stat.saved_uid);
+    r->set(slots.gid, proc_stat.real_gid);
+    r->set(slots.egid, proc_stat.effective_gid);
+    r->set(slots.sgid, proc_stat.saved_gid);
+
+    // size/memory information
+    r->set(slots.resident_size, proc_stat.resident_size);
+    r->set(slots.total_size, proc_stat.total_size);
+  }
+
   // Read/parse cmdline arguments.
-  r["cmdline"] = readProcCMDLine(pid);
-  if (context.isColumnUsed("cgroup_path")) {
-    r["cgroup_path"] = readProcCgroup(pid);
-  }
-  r["cwd"] = readProcLink("cwd", pid);
-  r["root"] = readProcLink("root", pid);
-  r["uid"] = proc_stat.real_uid;
-  r["euid"] = proc_stat.effective_uid;
-  r["suid"] = proc_stat.saved_uid;
-  r["gid"] = proc_stat.real_gid;
-  r["egid"] = proc_stat.effective_gid;
-  r["sgid"] = proc_stat.saved_gid;
-
-  r["on_disk"] = INTEGER(getOnDisk(pid, r["path"]));
-
-  // size/memory information
-  r["wired_size"] = "0"; // No support for unpagable counters in linux.
-  r["resident_size"] = proc_stat.resident_size;
-  r["total_size"] = proc_stat.total_size;
-
-  // time information
-  auto usr_time = std::strtoull(proc_stat.user_time.data(), nullptr, 10);
-  r["user_time"] = std::to_string(usr_time * kMSIn1CLKTCK);
-  auto sys_time = std::strtoull(proc_stat.system_time.data(), nullptr, 10);
-  r["system_time"] = std::to_string(sys_time * kMSIn1CLKTCK);
-
-  auto proc_start_time_exp = tryTo<long>(proc_stat.start_time);
-  if (proc_start_time_exp.isValue() && system_boot_time > 0) {
-    auto proc_start_time = proc_start_time_exp.take() / sysconf(_SC_CLK_TCK);
-
-    r["start_time"] = BIGINT(system_boot_time + proc_start_time);
-  } else {
-    r["start_time"] = "-1";
+  if (files.cmdline) {
+    r->set(slots.cmdline, readProcCMDLine(reader));
   }
 
-  if (!proc_io.status.ok()) {
-    // /proc/<pid>/io can require root to access, so don't fail if we can't
-    VLOG(1) << proc_io.status.getMessage();
-  } else {
-    r["disk_bytes_read"] = proc_io.read_bytes;
-    long long write_bytes = tryTo<long long>(proc_io.write_bytes).takeOr(0ll);
-    long long cancelled_write_bytes =
-        tryTo<long long>(proc_io.cancelled_write_bytes).takeOr(0ll);
+  if (files.cgroup) {
+    r->set(slots.cgroup_path, readProcCgroup(reader));
+  }
 
-    r["disk_bytes_written"] =
-        std::to_string(write_bytes - cancelled_write_bytes);
+  if (files.cwd) {
+    r->set(slots.cwd, readProcLink("cwd", reader));
   }
 
-  results.push_back(r);
+  if (files.root) {
+    r->set(slots.root, readProcLink("root", reader));
+  }
+
+  if (files.exe) {
+    auto path = readProcLink("exe", reader);
+    r->set(slots.on_disk, getOnDisk(reader, path));
+    r->set(slots.path, std::move(path));
+  }
+
+  if (files.io) {
+    // Parse the process io
+    SimpleProcIo proc_io(reader);
+
+    if (!proc_io.status.ok()) {
+      // /proc/<pid>/io can require root to access, so don't fail if we can't
+      VLOG(1) << proc_io.status.getMessage();
+    } else {
+      r->set(slots.disk_bytes_read, proc_io.read_bytes);
+      long long write_bytes =
+          tryTo<long long>(proc_io.write_bytes).takeOr(0ll);
+      long long cancelled_write_bytes =
+          tryTo<long long>(proc_io.cancelled_write_bytes).takeOr(0ll);
+
+      r->set(slots.disk_bytes_written, write_bytes - cancelled_write_bytes);
+    }
+  }
+
+  results.push_back(std::move(r));
 }
 
-void genNamespaces(const std::string& pid, QueryData& results) {
+void genNamespaces(const ProcReader& reader,
+                   const QueryContext& context,
+                   QueryData& results) {
   Row r;
+  r["pid"] = reader.pid();
 
-  ProcessNamespaceList proc_ns;
-  Status status = procGetProcessNamespaces(pid, proc_ns);
-  if (!status.ok()) {
-    VLOG(1) << "Namespaces for pid " << pid
-            << " are incomplete: " << status.what();
-  }
+  for (const auto& namespace_name : kUserNamespaceList) {
+    auto column = namespace_name + "_namespace";
+    if (!context.isColumnUsed(column)) {
+      continue;
+    }
 
-  r["pid"] = pid;
-  for (const auto& pair : proc_ns) {
-    r[pair.first + "_namespace"] = std::to_string(pair.second);
+    ino_t namespace_inode;
+    auto path = "ns/" + namespace_name;
+    auto status = reader.getInode(path.c_str(), namespace_inode);
+    if (!status.ok()) {
+      VLOG(1) << "Namespaces for pid " << reader.pid()
+              << " are incomplete: " << status.what();
+      continue;
+    }
+
+    r[column] = std::to_string(namespace_inode);
   }
 
   results.push_back(r);
@@ -543,9 +657,26 @@ TableRows genProcesses(QueryContext& context) {
   TableRows results;
   static const std::uint64_t system_boot_time = getBootTime();
 
+  auto schema = context.rowSchema();
+  ProcessColumnSlots slots(*schema);
+  ProcessFileSet files(context);
+
   auto pidlist = getProcList(context);
-  for (const auto& pid : pidlist) {
-    genProcess(pid, system_boot_time, context, results);
+  auto shard_list = procEnumerateShards<TableRows>(
+      pidlist,
+      procGetEnumerationThreadCount(),
+      [&](const std::string& pid, TableRows& shard_results) {
+        ProcReader reader(pid);
+        if (reader.isOpen()) {
+          genProcess(
+              reader, system_boot_time, files, schema, slots, shard_results);
+        }
+      });
+
+  for (auto& shard_results : shard_list) {
+    results.insert(results.end(),
+                   std::make_move_iterator(shard_results.begin()),
+                   std::make_move_iterator(shard_results.end()));
   }
 
   return results;
@@ -556,7 +687,10 @@ QueryData genProcessEnvs(QueryContext& context) {
 
   auto pidlist = getProcList(context);
   for (const auto& pid : pidlist) {
-    genProcessEnvironment(pid, results);
+    ProcReader reader(pid);
+    if (reader.isOpen()) {
+      genProcessEnvironment(reader, results);
+    }
   }
 
   return results;
@@ -567,7 +701,10 @@ QueryData genProcessMemoryMap(QueryContext& context) {
 
   auto pidlist = getProcList(context);
   for (const auto& pid : pidlist) {
-    genProcessMap(pid, results);
+    ProcReader reader(pid);
+    if (reader.isOpen()) {
+      genProcessMap(reader, results);
+    }
   }
 
   return results;
@@ -578,7 +715,10 @@ QueryData genProcessNamespaces(QueryContext& context) {
 
   const auto pidlist = getProcList(context);
   for (const auto& pid : pidlist) {
-    genNamespaces(pid, results);
+    ProcReader reader(pid);
+    if (reader.isOpen()) {
+      genNamespaces(reader, context, results);
+    }
   }
 
   return results;
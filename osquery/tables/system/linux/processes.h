@@ -7,8 +7,11 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <string>
+#include <string_view>
+
 namespace osquery {
 namespace tables {
-std::string parseProcCGroup(const std::string& content);
+std::string parseProcCGroup(std::string_view content);
 } // namespace tables
 } // namespace osquery
@@ -11,13 +11,15 @@
 #include <sys/stat.h>
 #endif
 
+#include <functional>
+
 #include <osquery/core/system.h>
 #include <osquery/core/tables.h>
 #include <osquery/filesystem/fileops.h>
 #include <osquery/filesystem/filesystem.h>
 #include <osquery/logger/logger.h>
+#include <osquery/sql/dynamic_table_row.h>
 #include <osquery/worker/ipc/platform_table_container_ipc.h>
-#include <osquery/worker/logging/glog/glog_logger.h>
 
 namespace fs = boost::filesystem;
 
@@ -41,10 +43,13 @@ const std::map<fs::file_type, std::string> kTypeNames{
 
 #endif
 
+/// Receives each row generated for the file table.
+using FileRowCallback = std::function<void(Row&)>;
+
 void genFileInfo(const fs::path& path,
                  const fs::path& parent,
                  const std::string& pattern,
-                 QueryData& results) {
+                 const FileRowCallback& callback) {
   // Must provide the path, filename, directory separate from boost path->string
   // helpers to match any explicit (query-parsed) predicate constraints.
 
@@ -146,12 +151,10 @@ void genFileInfo(const fs::path& path,
 
 #endif
 
-  results.push_back(r);
+  callback(r);
 }
 
-QueryData genFileImpl(QueryContext& context, Logger& logger) {
-  QueryData results;
-
+void genFileRows(QueryContext& context, const FileRowCallback& callback) {
   // Resolve file paths for EQUALS and LIKE operations.
   auto paths = context.constraints["path"].getAll(EQUALS);
   context.expandConstraints(
@@ -173,7 +176,7 @@ QueryData genFileImpl(QueryContext& context, Logger& logger) {
   // Iterate through each of the resolved/supplied paths.
   for (const auto& path_string : paths) {
     fs::path path = path_string;
-    genFileInfo(path, path.parent_path(), "", results);
+    genFileInfo(path, path.parent_path(), "", callback);
   }
 
   // Resolve directories for EQUALS and LIKE operations.
@@ -204,23 +207,35 @@ QueryData genFileImpl(QueryContext& context, Logger& logger) {
       // Iterate over the directory and generate info for each regular file.
       fs::directory_iterator begin(directory_string), end;
       for (; begin != end; ++begin) {
-        genFileInfo(begin->path(), directory_string, "", results);
+        genFileInfo(begin->path(), directory_string, "", callback);
       }
     } catch (const fs::filesystem_error& /* e */) {
       continue;
     }
   }
+}
 
+QueryData genFileImpl(QueryContext& context, Logger& logger) {
+  QueryData results;
+  genFileRows(context, [&results](Row& r) { results.push_back(std::move(r)); });
   return results;
 }
 
-QueryData genFile(QueryContext& context) {
+void genFile(RowYield& yield, QueryContext& context) {
   if (hasNamespaceConstraint(context)) {
-    return generateInNamespace(context, "file", genFileImpl);
-  } else {
-    GLOGLogger logger;
-    return genFileImpl(context, logger);
+    // Rows generated in another namespace are returned all at once.
+    auto results = generateInNamespace(context, "file", genFileImpl);
+    for (auto& r : results) {
+      yield(TableRowHolder(new DynamicTableRow(std::move(r))));
+    }
+    return;
   }
+
+  // Yield each row as it is read, so a large directory is never held in
+  // memory at once when the rows are consumed as they are generated.
+  genFileRows(context, [&yield](Row& r) {
+    yield(TableRowHolder(new DynamicTableRow(std::move(r))));
+  });
 }
 } // namespace tables
 } // namespace osquery
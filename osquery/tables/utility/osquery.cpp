@@ -13,6 +13,7 @@
 #include <osquery/core/flags.h>
 #include <osquery/core/system.h>
 #include <osquery/core/tables.h>
+#include <osquery/database/database.h>
 #include <osquery/events/eventfactory.h>
 #include <osquery/events/eventpublisher.h>
 #include <osquery/events/eventsubscriber.h>
@@ -33,6 +34,25 @@ DECLARE_bool(disable_events);
 
 namespace tables {
 
+namespace {
+
+void genEventStatistics(const EventStatistics& statistics, Row& r) {
+  r["dropped"] = BIGINT(statistics.droppedEvents());
+  auto latency = statistics.latency();
+  r["latency_p50"] = BIGINT(latency.quantile(0.50));
+  r["latency_p95"] = BIGINT(latency.quantile(0.95));
+  r["latency_p99"] = BIGINT(latency.quantile(0.99));
+}
+
+void genEmptyEventStatistics(Row& r) {
+  r["dropped"] = "0";
+  r["latency_p50"] = "0";
+  r["latency_p95"] = "0";
+  r["latency_p99"] = "0";
+}
+
+} // namespace
+
 QueryData genOsqueryEvents(QueryContext& context) {
   QueryData results;
 
@@ -49,11 +69,15 @@ QueryData genOsqueryEvents(QueryContext& context) {
       r["events"] = INTEGER(pubref->numEvents());
       r["refreshes"] = INTEGER(pubref->restartCount());
       r["active"] = (pubref->hasStarted() && !pubref->isEnding()) ? "1" : "0";
+      r["queue_depth"] = BIGINT(pubref->statistics().queueDepth());
+      genEventStatistics(pubref->statistics(), r);
     } else {
       r["subscriptions"] = "0";
       r["events"] = "0";
       r["refreshes"] = "0";
       r["active"] = "-1";
+      r["queue_depth"] = "0";
+      genEmptyEventStatistics(r);
     }
     results.push_back(r);
   }
@@ -74,10 +98,14 @@ QueryData genOsqueryEvents(QueryContext& context) {
 
       // Subscribers are always active, even if their publisher is not.
       r["active"] = (subref->state() == EventState::EVENT_RUNNING) ? "1" : "0";
+      r["queue_depth"] = BIGINT(subref->statistics().queueDepth());
+      genEventStatistics(subref->statistics(), r);
     } else {
       r["subscriptions"] = "0";
       r["events"] = "0";
       r["active"] = "-1";
+      r["queue_depth"] = "0";
+      genEmptyEventStatistics(r);
     }
     results.push_back(r);
   }
@@ -253,6 +281,14 @@ QueryData genOsquerySchedule(QueryContext& context) {
         r["last_system_time"] = "0";
         r["average_memory"] = "0";
         r["last_memory"] = "0";
+        r["page_faults"] = "0";
+        r["last_page_faults"] = "0";
+        r["voluntary_context_switches"] = "0";
+        r["last_voluntary_context_switches"] = "0";
+        r["bytes_read"] = "0";
+        r["last_bytes_read"] = "0";
+        r["statement_cache_hits"] = "0";
+        r["statement_cache_misses"] = "0";
         r["last_executed"] = "0";
 
         // Report optional performance information.
@@ -270,6 +306,17 @@ QueryData genOsquerySchedule(QueryContext& context) {
               r["last_system_time"] = BIGINT(perf.last_system_time);
               r["average_memory"] = BIGINT(perf.average_memory);
               r["last_memory"] = BIGINT(perf.last_memory);
+              r["page_faults"] = BIGINT(perf.page_faults);
+              r["last_page_faults"] = BIGINT(perf.last_page_faults);
+              r["voluntary_context_switches"] =
+                  BIGINT(perf.voluntary_context_switches);
+              r["last_voluntary_context_switches"] =
+                  BIGINT(perf.last_voluntary_context_switches);
+              r["bytes_read"] = BIGINT(perf.bytes_read);
+              r["last_bytes_read"] = BIGINT(perf.last_bytes_read);
+              r["statement_cache_hits"] = BIGINT(perf.statement_cache_hits);
+              r["statement_cache_misses"] =
+                  BIGINT(perf.statement_cache_misses);
             });
 
         results.push_back(r);
@@ -277,5 +324,24 @@ QueryData genOsquerySchedule(QueryContext& context) {
       true);
   return results;
 }
+
+QueryData genRocksDBStats(QueryContext& context) {
+  QueryData results;
+
+  DatabaseStatistics stats;
+  auto status = getDatabaseStatistics(stats);
+  if (!status.ok()) {
+    VLOG(1) << "Cannot read database statistics: " << status.getMessage();
+  }
+
+  for (const auto& stat : stats) {
+    Row r;
+    r["domain"] = stat.domain;
+    r["name"] = stat.name;
+    r["value"] = BIGINT(stat.value);
+    results.push_back(r);
+  }
+  return results;
+}
 } // namespace tables
 } // namespace osquery
@@ -15,6 +15,8 @@
 #include <boost/filesystem.hpp>
 
 #include <fstream>
+#include <string>
+#include <vector>
 
 namespace fs = boost::filesystem;
 
@@ -185,4 +187,127 @@ TEST_F(YARATest, test_rule_compilation_failures) {
   EXPECT_TRUE(compiler_result.isError());
 }
 
+TEST_F(YARATest, test_scanner_scan_file) {
+  ASSERT_EQ(yr_initialize(), ERROR_SUCCESS);
+
+  auto compiler_result = compileFromString(
+      "rule needle { strings: $a = \"needle\" condition: $a }");
+  ASSERT_TRUE(compiler_result.isValue())
+      << compiler_result.getError().getMessage();
+
+  auto rules_handle = compiler_result.take();
+
+  YaraScannerHandle scanner;
+  ASSERT_TRUE(yaraCreateScanner(rules_handle.get(), scanner).ok());
+
+  // Small files are read and scanned from memory, large ones are mapped
+  std::string buffer;
+  for (std::size_t size : {16U, 4U * 1024U * 1024U}) {
+    const auto file_to_scan =
+        fs::temp_directory_path() /
+        fs::unique_path("osquery.tests.yara.%%%%.%%%%.bin");
+    {
+      std::ofstream test_file(file_to_scan.string(), std::ios::binary);
+      test_file << std::string(size - 6U, 'x') << "needle";
+    }
+
+    Row r;
+    r["count"] = "0";
+    r["matches"] = "";
+
+    std::uint64_t byte_count{0U};
+    auto status = yaraScanFile(
+        scanner.get(), file_to_scan.string(), buffer, r, byte_count);
+    EXPECT_TRUE(status.ok()) << status.getMessage();
+    EXPECT_EQ(byte_count, size);
+    EXPECT_EQ(r["count"], "1");
+    EXPECT_EQ(r["matches"], "needle");
+
+    fs::remove_all(file_to_scan);
+  }
+
+  Row r;
+  std::uint64_t byte_count{0U};
+  auto status = yaraScanFile(
+      scanner.get(), "/tmp/this_path_doesnt_exists", buffer, r, byte_count);
+  EXPECT_FALSE(status.ok());
+}
+
+TEST_F(YARATest, test_scan_throttle) {
+  using namespace std::chrono_literals;
+  const auto start_time = YaraScanThrottle::Clock::now();
+
+  // 10ms of work in the first 10ms: another 10ms are needed to be at 50%
+  YaraScanThrottle cpu_throttle(50U, 0U, start_time);
+  EXPECT_EQ(cpu_throttle.getDelay(10ms, 0U, start_time + 10ms), 10ms);
+
+  // The budget accumulates over the scan
+  EXPECT_EQ(cpu_throttle.getDelay(5ms, 0U, start_time + 40ms), 0ms);
+  EXPECT_EQ(cpu_throttle.getDelay(10ms, 0U, start_time + 40ms), 10ms);
+
+  // 500KB at 1MB/s take 500ms, 100ms of which have already elapsed
+  YaraScanThrottle io_throttle(0U, 1000000U, start_time);
+  EXPECT_EQ(io_throttle.getDelay(1ms, 500000U, start_time + 100ms), 400ms);
+
+  YaraScanThrottle no_throttle(0U, 0U, start_time);
+  EXPECT_EQ(no_throttle.getDelay(1h, 1000000000U, start_time), 0ms);
+
+  // Without a utilization limit, yara_delay pauses after every file
+  YaraScanThrottle file_throttle(0U, 0U, start_time, 50ms);
+  EXPECT_EQ(file_throttle.getDelay(1h, 0U, start_time), 50ms);
+  EXPECT_EQ(file_throttle.getDelay(0ms, 0U, start_time + 1h), 50ms);
+}
+
+TEST_F(YARATest, test_scan_tasks_order) {
+  ASSERT_EQ(yr_initialize(), ERROR_SUCCESS);
+
+  auto compiler_result = compileFromString(
+      "rule needle { strings: $a = \"needle\" condition: $a }");
+  ASSERT_TRUE(compiler_result.isValue())
+      << compiler_result.getError().getMessage();
+
+  auto rules_handle = compiler_result.take();
+
+  // Every third file matches
+  std::vector<std::string> path_list;
+  for (std::size_t i = 0; i < 24U; ++i) {
+    const auto file_to_scan =
+        fs::temp_directory_path() /
+        fs::unique_path("osquery.tests.yara.%%%%.%%%%.bin");
+    std::ofstream test_file(file_to_scan.string(), std::ios::binary);
+    test_file << std::string(i * 1024U, 'x') << ((i % 3 == 0) ? "needle" : "");
+    path_list.push_back(file_to_scan.string());
+  }
+  path_list.push_back("/tmp/this_path_doesnt_exists");
+
+  for (std::size_t thread_count : {1U, 4U}) {
+    std::vector<YaraScanTask> task_list;
+    for (const auto& path : path_list) {
+      Row r;
+      r["path"] = path;
+      r["count"] = "0";
+      r["matches"] = "";
+      task_list.push_back({path, rules_handle.get(), std::move(r)});
+    }
+
+    YaraScanThrottle throttle(0U, 0U);
+    EXPECT_EQ(yaraScanTasks(task_list, thread_count, throttle), 0U);
+
+    // Each row stays with its task, whichever thread scanned it
+    ASSERT_EQ(task_list.size(), path_list.size());
+    for (std::size_t i = 0; i < 24U; ++i) {
+      const auto& task = task_list[i];
+      EXPECT_TRUE(task.scanned);
+      EXPECT_EQ(task.row.at("path"), path_list[i]);
+      EXPECT_EQ(task.row.at("count"), (i % 3 == 0) ? "1" : "0");
+      EXPECT_EQ(task.row.at("matches"), (i % 3 == 0) ? "needle" : "");
+    }
+    EXPECT_FALSE(task_list.back().scanned);
+  }
+
+  for (const auto& path : path_list) {
+    fs::remove_all(path);
+  }
+}
+
 } // namespace osquery
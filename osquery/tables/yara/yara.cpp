@@ -12,8 +12,12 @@
 
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <chrono>
 #include <regex>
 #include <thread>
+#include <vector>
 
 #ifdef LINUX
 #include <malloc.h>
@@ -46,11 +50,28 @@ HIDDEN_FLAG(bool,
             "Deprecated in favor of malloc_trim_threshold.");
 #endif
 
+HIDDEN_FLAG(uint32,
+            yara_delay,
+            50,
+            "Time in ms to pause after each file scanned with YARA, unless "
+            "yara_scan_utilization_limit is set");
+
 FLAG(uint32,
-     yara_delay,
-     50,
-     "Time in ms to sleep after scan of each file (default 50) to reduce "
-     "memory spikes");
+     yara_scan_threads,
+     1,
+     "Number of threads used to scan files with YARA (default 1)");
+
+FLAG(uint32,
+     yara_scan_utilization_limit,
+     0,
+     "Percentage of one CPU core each YARA scan thread may use on average, "
+     "instead of pausing yara_delay after each file (default 0 to disable)");
+
+FLAG(uint64,
+     yara_scan_bytes_per_second,
+     0,
+     "Maximum average rate, in bytes per second, at which YARA scans read "
+     "files (default 0 to disable)");
 
 HIDDEN_FLAG(bool,
             enable_yara_string,
@@ -153,9 +174,7 @@ Status getRuleFromURL(const std::string& url, std::string& rule) {
   return Status::success();
 }
 
-void doYARAScan(YR_RULES* rules,
-                const std::string& path,
-                QueryData& results,
+Row makeYaraRow(const std::string& path,
                 YaraRuleType yr_type,
                 const std::string& sigfile) {
   Row row;
@@ -191,12 +210,36 @@ void doYARAScan(YR_RULES* rules,
     break;
   }
 
-  // Perform the scan, using the static YARA subscriber callback.
-  int result = yr_rules_scan_file(
-      rules, path.c_str(), SCAN_FLAGS_FAST_MODE, YARACallback, (void*)&row, 0);
-  if (result == ERROR_SUCCESS) {
-    results.push_back(std::move(row));
+  return row;
+}
+
+std::size_t getYaraScanThreadCount(std::size_t task_count) {
+  auto thread_count = std::max<std::size_t>(FLAGS_yara_scan_threads, 1U);
+
+  std::size_t cpu_count{std::thread::hardware_concurrency()};
+  if (cpu_count != 0U) {
+    thread_count = std::min(thread_count, cpu_count);
   }
+
+  return std::max<std::size_t>(std::min(thread_count, task_count), 1U);
+}
+
+/// Paces the scans of a query, see the yara_scan_* flags
+YaraScanThrottle makeYaraScanThrottle(std::size_t thread_count) {
+  // Each scan thread gets the utilization limit, of one core, to itself
+  auto utilization_limit = FLAGS_yara_scan_utilization_limit *
+                           static_cast<std::uint32_t>(thread_count);
+  std::chrono::milliseconds file_delay{0};
+
+  // Without a utilization budget, pause after each file as before
+  if (utilization_limit == 0U) {
+    file_delay = std::chrono::milliseconds(FLAGS_yara_delay);
+  }
+
+  return YaraScanThrottle(utilization_limit,
+                          FLAGS_yara_scan_bytes_per_second,
+                          YaraScanThrottle::Clock::now(),
+                          file_delay);
 }
 
 Status getYaraRules(YARAConfigParser parser,
@@ -375,24 +418,35 @@ QueryData genYaraImpl(QueryContext& context, Logger& logger) {
 
   // Scan every path pair with the yara rules
   auto& rules = yaraParser->rules();
+  std::vector<YaraScanTask> task_list;
   for (const auto& path : paths) {
     for (const auto& sign : scanContext) {
       auto hash = hashStr(sign.second, sign.first);
       auto rules_it = rules.find(hash);
       if (rules_it != rules.end()) {
-        doYARAScan(rules_it->second.get(),
-                   path.c_str(),
-                   results,
-                   sign.first,
-                   sign.second);
-
-        // sleep between each file to help smooth out malloc spikes
-        std::this_thread::sleep_for(
-            std::chrono::milliseconds(FLAGS_yara_delay));
+        task_list.push_back({path,
+                             rules_it->second.get(),
+                             makeYaraRow(path, sign.first, sign.second)});
       }
     }
   }
 
+  // Results are returned in the task order, whichever thread scanned them
+  auto thread_count = getYaraScanThreadCount(task_list.size());
+  auto throttle = makeYaraScanThrottle(thread_count);
+  auto scanner_error_count = yaraScanTasks(task_list, thread_count, throttle);
+  if (scanner_error_count != 0U) {
+    logger.log(google::GLOG_WARNING,
+               "Failed to create " + std::to_string(scanner_error_count) +
+                   " YARA scanner(s)");
+  }
+
+  for (auto& task : task_list) {
+    if (task.scanned) {
+      results.push_back(std::move(task.row));
+    }
+  }
+
   // Rule string is hashed before adding to the cache. There are
   // possibilities of collision when arbitrary queries are executed
   // with distributed API. Clear the hash string from the cache
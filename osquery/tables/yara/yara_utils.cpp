@@ -7,12 +7,18 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <algorithm>
+#include <atomic>
+#include <fstream>
 #include <map>
 #include <string>
+#include <thread>
 
 #include <cerrno>
 #include <sys/stat.h>
 
+#include <boost/filesystem.hpp>
+
 #include <osquery/config/config.h>
 #include <osquery/filesystem/fileops.h>
 #include <osquery/logger/logger.h>
@@ -21,12 +27,36 @@
 #include <osquery/tables/yara/yara_utils.h>
 #include <osquery/utils/expected/expected.h>
 #include <osquery/utils/status/status.h>
+#include <osquery/utils/system/worker_pool.h>
 
 namespace osquery {
 
 DECLARE_bool(enable_yara_string);
 
 namespace {
+
+/// Files up to this size are read rather than mapped into memory
+const std::uintmax_t kYaraReadMaxSize{1024U * 1024U};
+
+bool readYaraFile(const std::string& path,
+                  std::uintmax_t size,
+                  std::string& buffer) {
+  std::ifstream stream(path, std::ios::in | std::ios::binary);
+  if (!stream) {
+    return false;
+  }
+
+  buffer.resize(static_cast<std::size_t>(size));
+  stream.read(&buffer[0], static_cast<std::streamsize>(buffer.size()));
+  if (stream.bad()) {
+    return false;
+  }
+
+  // The file may have been truncated since its size was read
+  buffer.resize(static_cast<std::size_t>(stream.gcount()));
+  return true;
+}
+
 Status verifyRuleFilePointer(FILE* rule_file, const std::string& file_path) {
   int file_fd = -1;
 
@@ -83,6 +113,151 @@ bool yaraShouldSkipFile(const std::string& path, mode_t st_mode) {
   return false;
 }
 
+Status yaraCreateScanner(YR_RULES* rules, YaraScannerHandle& scanner) {
+  YR_SCANNER* yara_scanner = nullptr;
+
+  auto result = yr_scanner_create(rules, &yara_scanner);
+  if (result != ERROR_SUCCESS) {
+    return Status::failure("Unable to create a YARA scanner (" +
+                           std::to_string(result) + ")");
+  }
+
+  yr_scanner_set_flags(yara_scanner, SCAN_FLAGS_FAST_MODE);
+  scanner = YaraScannerHandle(yara_scanner);
+  return Status::success();
+}
+
+Status yaraScanFile(YR_SCANNER* scanner,
+                    const std::string& path,
+                    std::string& buffer,
+                    Row& row,
+                    std::uint64_t& byte_count) {
+  yr_scanner_set_callback(scanner, YARACallback, &row);
+
+  boost::system::error_code error;
+  auto size = boost::filesystem::file_size(path, error);
+
+  int result{ERROR_SUCCESS};
+  if (!error && size <= kYaraReadMaxSize && readYaraFile(path, size, buffer)) {
+    byte_count = buffer.size();
+    result = yr_scanner_scan_mem(
+        scanner,
+        reinterpret_cast<const std::uint8_t*>(buffer.data()),
+        buffer.size());
+
+  } else {
+    // Let YARA map the file, large files are not copied into memory
+    byte_count = error ? 0U : static_cast<std::uint64_t>(size);
+    result = yr_scanner_scan_file(scanner, path.c_str());
+  }
+
+  if (result != ERROR_SUCCESS) {
+    return Status::failure("YARA scan error (" + std::to_string(result) + ")");
+  }
+
+  return Status::success();
+}
+
+YaraScanThrottle::YaraScanThrottle(std::uint32_t utilization_limit,
+                                   std::uint64_t bytes_per_second,
+                                   Clock::time_point start_time,
+                                   Clock::duration file_delay)
+    : utilization_limit_(utilization_limit),
+      bytes_per_second_(bytes_per_second),
+      start_time_(start_time),
+      file_delay_(file_delay) {}
+
+YaraScanThrottle::Clock::duration YaraScanThrottle::getDelay(
+    Clock::duration busy_time,
+    std::uint64_t byte_count,
+    Clock::time_point now) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  busy_time_ += busy_time;
+  byte_count_ += byte_count;
+
+  // The earliest time at which the work done so far fits in the budget
+  auto resume_time = now + file_delay_;
+  if (utilization_limit_ != 0U) {
+    resume_time =
+        std::max(resume_time,
+                 start_time_ + busy_time_ * 100U / utilization_limit_);
+  }
+
+  if (bytes_per_second_ != 0U) {
+    auto io_time = std::chrono::duration<double>(
+        static_cast<double>(byte_count_) / bytes_per_second_);
+    resume_time = std::max(
+        resume_time,
+        start_time_ + std::chrono::duration_cast<Clock::duration>(io_time));
+  }
+
+  return resume_time - now;
+}
+
+std::size_t yaraScanTasks(std::vector<YaraScanTask>& task_list,
+                          std::size_t thread_count,
+                          YaraScanThrottle& throttle) {
+  std::atomic<std::size_t> next_task{0U};
+
+  auto scan_tasks = [&]() -> std::size_t {
+    std::map<YR_RULES*, YaraScannerHandle> scanner_map;
+    std::string buffer;
+    std::size_t scanner_error_count{0U};
+
+    for (auto i = next_task++; i < task_list.size(); i = next_task++) {
+      auto& task = task_list[i];
+
+      auto scanner_it = scanner_map.find(task.rules);
+      if (scanner_it == scanner_map.end()) {
+        YaraScannerHandle scanner;
+        if (!yaraCreateScanner(task.rules, scanner).ok()) {
+          ++scanner_error_count;
+          continue;
+        }
+
+        scanner_it = scanner_map.emplace(task.rules, std::move(scanner)).first;
+      }
+
+      auto start_time = YaraScanThrottle::Clock::now();
+
+      std::uint64_t byte_count{0U};
+      auto status = yaraScanFile(
+          scanner_it->second.get(), task.path, buffer, task.row, byte_count);
+      task.scanned = status.ok();
+
+      auto delay = throttle.getDelay(
+          YaraScanThrottle::Clock::now() - start_time, byte_count);
+
+      // Nothing is left to pace once the last task was taken
+      if (delay > YaraScanThrottle::Clock::duration::zero() &&
+          next_task.load() < task_list.size()) {
+        std::this_thread::sleep_for(delay);
+      }
+    }
+
+    return scanner_error_count;
+  };
+
+  thread_count =
+      std::max<std::size_t>(std::min(thread_count, task_list.size()), 1U);
+
+  // Each worker takes tasks until none are left, the calling thread is one
+  // of them and the others run on the shared worker pool
+  std::vector<std::size_t> scanner_error_list(thread_count, 0U);
+  WorkerPool::instance().run(
+      thread_count, [&scan_tasks, &scanner_error_list](std::size_t worker) {
+        scanner_error_list[worker] = scan_tasks();
+      });
+
+  std::size_t scanner_error_count{0U};
+  for (const auto& count : scanner_error_list) {
+    scanner_error_count += count;
+  }
+
+  return scanner_error_count;
+}
+
 /**
  * The callback used when there are compilation problems in the rules.
  */
@@ -9,6 +9,12 @@
 
 #pragma once
 
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
 #include <boost/property_tree/ptree.hpp>
 
 #include <osquery/config/config.h>
@@ -61,6 +67,90 @@ class YaraRulesHandle {
   YR_RULES* rules_;
 };
 
+/**
+ * @brief A YR_SCANNER bound to one compiled rule set
+ *
+ * Scanners hold the state of a scan, so each thread scans with its own
+ * scanner while the compiled rules are shared.
+ */
+class YaraScannerHandle {
+ public:
+  YaraScannerHandle() = default;
+  YaraScannerHandle(YR_SCANNER* scanner) : scanner_(scanner) {}
+  ~YaraScannerHandle() {
+    if (scanner_) {
+      yr_scanner_destroy(scanner_);
+    }
+  }
+
+  YaraScannerHandle(const YaraScannerHandle&) = delete;
+
+  YaraScannerHandle& operator=(const YaraScannerHandle&) = delete;
+
+  YaraScannerHandle(YaraScannerHandle&& other) noexcept {
+    scanner_ = other.scanner_;
+    other.scanner_ = nullptr;
+  }
+
+  YaraScannerHandle& operator=(YaraScannerHandle&& other) noexcept {
+    std::swap(scanner_, other.scanner_);
+    return *this;
+  }
+
+  YR_SCANNER* get() const {
+    return scanner_;
+  }
+
+ private:
+  YR_SCANNER* scanner_{nullptr};
+};
+
+/**
+ * @brief Paces scans so that they stay within a CPU and IO budget
+ *
+ * The budget is shared by all the threads of a scan. The time spent scanning
+ * is kept under utilization_limit percent of the time elapsed since the
+ * throttle was created, and the bytes scanned under bytes_per_second. A limit
+ * of 0 disables the corresponding budget. A file_delay adds a fixed pause
+ * after every file, as yara_delay does without a utilization limit.
+ */
+class YaraScanThrottle final {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  YaraScanThrottle(std::uint32_t utilization_limit,
+                   std::uint64_t bytes_per_second,
+                   Clock::time_point start_time = Clock::now(),
+                   Clock::duration file_delay = Clock::duration::zero());
+
+  /// Accounts for a scan, returns how long to pause to stay within budget
+  Clock::duration getDelay(Clock::duration busy_time,
+                           std::uint64_t byte_count,
+                           Clock::time_point now = Clock::now());
+
+ private:
+  const std::uint32_t utilization_limit_;
+  const std::uint64_t bytes_per_second_;
+  const Clock::time_point start_time_;
+  const Clock::duration file_delay_;
+
+  std::mutex mutex_;
+  Clock::duration busy_time_{0};
+  std::uint64_t byte_count_{0};
+};
+
+/// A file to scan with a compiled rule set
+struct YaraScanTask final {
+  std::string path;
+  YR_RULES* rules{nullptr};
+
+  /// Holds the default column values, the scan adds the matches
+  Row row;
+
+  /// Set when the file was scanned
+  bool scanned{false};
+};
+
 enum class YaraCompilerError {
   GenericError,
 };
@@ -90,6 +180,40 @@ Status handleRuleFiles(const std::string& category,
  */
 bool yaraShouldSkipFile(const std::string& path, mode_t st_mode);
 
+/// Creates a scanner for the rules, reporting matches with YARACallback
+Status yaraCreateScanner(YR_RULES* rules, YaraScannerHandle& scanner);
+
+/**
+ * @brief Scans a file, adding the matches to the row
+ *
+ * Small files are read into the buffer, which is reused across calls, and
+ * scanned from memory. Larger files are mapped into memory by YARA, so the
+ * buffer never grows past the size of the largest file it read (1 MiB).
+ *
+ * @param byte_count Set to the number of bytes scanned.
+ */
+Status yaraScanFile(YR_SCANNER* scanner,
+                    const std::string& path,
+                    std::string& buffer,
+                    Row& row,
+                    std::uint64_t& byte_count);
+
+/**
+ * @brief Scans the tasks on up to thread_count threads
+ *
+ * The calling thread scans along with threads of the shared WorkerPool.
+ * Every thread creates its own scanners for the shared compiled rules, and
+ * takes the next task when it is done with the previous one. Each task keeps
+ * its own row, so the results stay in the task order whichever thread
+ * scanned them. Threads pause between files as the throttle requires, but
+ * not after the last file.
+ *
+ * @return the number of scanners that could not be created.
+ */
+std::size_t yaraScanTasks(std::vector<YaraScanTask>& task_list,
+                          std::size_t thread_count,
+                          YaraScanThrottle& throttle);
+
 int YARACallback(YR_SCAN_CONTEXT* context,
                  int message,
                  void* message_data,
@@ -0,0 +1,88 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <atomic>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <osquery/utils/system/worker_pool.h>
+
+namespace osquery {
+
+class WorkerPoolTests : public testing::Test {};
+
+TEST_F(WorkerPoolTests, test_run_every_task) {
+  WorkerPool worker_pool(4U);
+
+  std::vector<int> result_list(100U, 0);
+  worker_pool.run(result_list.size(),
+                  [&result_list](std::size_t index) { ++result_list[index]; });
+
+  for (const auto& result : result_list) {
+    EXPECT_EQ(result, 1);
+  }
+
+  // No task, nothing to run
+  worker_pool.run(0U, [](std::size_t) { FAIL(); });
+}
+
+TEST_F(WorkerPoolTests, test_threads_are_reused) {
+  WorkerPool worker_pool(2U);
+  EXPECT_EQ(worker_pool.threadCount(), 0U);
+
+  // A single task runs on the calling thread
+  auto caller_id = std::this_thread::get_id();
+  worker_pool.run(1U, [caller_id](std::size_t) {
+    EXPECT_EQ(std::this_thread::get_id(), caller_id);
+  });
+  EXPECT_EQ(worker_pool.threadCount(), 0U);
+
+  for (int i = 0; i < 10; ++i) {
+    std::atomic<std::size_t> task_count{0U};
+    worker_pool.run(8U, [&task_count](std::size_t) { ++task_count; });
+    EXPECT_EQ(task_count, 8U);
+  }
+
+  // The threads are started once, and never beyond the limit
+  EXPECT_EQ(worker_pool.threadCount(), 2U);
+}
+
+TEST_F(WorkerPoolTests, test_nested_run) {
+  WorkerPool worker_pool(1U);
+
+  std::atomic<std::size_t> task_count{0U};
+  worker_pool.run(4U, [&worker_pool, &task_count](std::size_t) {
+    worker_pool.run(4U, [&task_count](std::size_t) { ++task_count; });
+  });
+
+  EXPECT_EQ(task_count, 16U);
+}
+
+TEST_F(WorkerPoolTests, test_task_exception) {
+  WorkerPool worker_pool(4U);
+
+  std::atomic<std::size_t> task_count{0U};
+  EXPECT_THROW(worker_pool.run(16U,
+                               [&task_count](std::size_t index) {
+                                 ++task_count;
+                                 if (index == 3U) {
+                                   throw std::runtime_error("task failed");
+                                 }
+                               }),
+               std::runtime_error);
+
+  // The other tasks still complete before run() returns
+  EXPECT_EQ(task_count, 16U);
+}
+
+} // namespace osquery
@@ -0,0 +1,156 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <system_error>
+
+#include <osquery/utils/system/worker_pool.h>
+
+namespace osquery {
+
+namespace {
+
+/// State of a run() call, shared with the jobs that may outlive it.
+struct WorkerPoolBatch final {
+  std::size_t task_count{0U};
+  const std::function<void(std::size_t)>* task{nullptr};
+
+  std::atomic<std::size_t> next_index{0U};
+
+  std::mutex mutex;
+  std::condition_variable completed_cv;
+  std::size_t completed_count{0U};
+  std::exception_ptr error;
+};
+
+/// Run the unclaimed tasks of a batch.
+void drainBatch(WorkerPoolBatch& batch) {
+  // The task is only accessed after claiming an index, run() cannot have
+  // returned before every index has been claimed and completed
+  for (auto index = batch.next_index++; index < batch.task_count;
+       index = batch.next_index++) {
+    std::exception_ptr error;
+    try {
+      (*batch.task)(index);
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> lock(batch.mutex);
+    if (error && !batch.error) {
+      batch.error = error;
+    }
+
+    if (++batch.completed_count == batch.task_count) {
+      batch.completed_cv.notify_all();
+    }
+  }
+}
+
+} // namespace
+
+WorkerPool& WorkerPool::instance() {
+  static WorkerPool worker_pool(
+      std::max(std::thread::hardware_concurrency(), 1U));
+  return worker_pool;
+}
+
+WorkerPool::WorkerPool(std::size_t thread_limit)
+    : thread_limit_(thread_limit) {}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+
+  job_cv_.notify_all();
+  for (auto& thread : thread_list_) {
+    thread.join();
+  }
+}
+
+void WorkerPool::run(std::size_t task_count,
+                     const std::function<void(std::size_t)>& task) {
+  if (task_count == 0U) {
+    return;
+  }
+
+  auto batch = std::make_shared<WorkerPoolBatch>();
+  batch->task_count = task_count;
+  batch->task = &task;
+
+  if (task_count > 1U) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // The calling thread is one of the workers
+    startThreads(task_count - 1U);
+
+    auto helper_count = std::min(task_count - 1U, thread_list_.size());
+    for (std::size_t i = 0; i < helper_count; ++i) {
+      job_queue_.push_back([batch]() { drainBatch(*batch); });
+    }
+  }
+
+  job_cv_.notify_all();
+  drainBatch(*batch);
+
+  std::unique_lock<std::mutex> lock(batch->mutex);
+  batch->completed_cv.wait(lock, [&batch]() {
+    return batch->completed_count == batch->task_count;
+  });
+
+  if (batch->error) {
+    std::rethrow_exception(batch->error);
+  }
+}
+
+std::size_t WorkerPool::threadCount() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return thread_list_.size();
+}
+
+void WorkerPool::startThreads(std::size_t thread_count) {
+  thread_count = std::min(thread_count, thread_limit_);
+
+  while (thread_list_.size() < thread_count) {
+    try {
+      thread_list_.emplace_back(&WorkerPool::work, this);
+    } catch (const std::system_error&) {
+      // Do with the threads we have, the caller completes the work anyway
+      break;
+    }
+  }
+}
+
+void WorkerPool::work() {
+  for (;;) {
+    std::function<void()> job;
+
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      job_cv_.wait(lock,
+                   [this]() { return stopping_ || !job_queue_.empty(); });
+
+      if (stopping_) {
+        return;
+      }
+
+      job = std::move(job_queue_.front());
+      job_queue_.pop_front();
+    }
+
+    job();
+  }
+}
+
+} // namespace osquery
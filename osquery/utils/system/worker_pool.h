@@ -0,0 +1,69 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace osquery {
+
+/**
+ * @brief A small pool of threads for splitting work across CPUs.
+ *
+ * Threads are started on demand, up to the limit given on construction, and
+ * are kept for the following calls instead of being started for each one.
+ */
+class WorkerPool final {
+ public:
+  /// The pool shared by the process, limited to the number of CPUs.
+  static WorkerPool& instance();
+
+  explicit WorkerPool(std::size_t thread_limit);
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  /**
+   * @brief Calls task(index) for every index in [0, task_count).
+   *
+   * The calling thread takes part in the work, so the tasks always complete
+   * even if no thread could be started, and run() returns once every task
+   * has. The first exception thrown by a task is rethrown.
+   */
+  void run(std::size_t task_count,
+           const std::function<void(std::size_t)>& task);
+
+  /// Number of threads currently started.
+  std::size_t threadCount();
+
+ private:
+  /// Start threads, without exceeding the limit, until there are thread_count.
+  void startThreads(std::size_t thread_count);
+
+  /// Thread body, runs the queued jobs until the pool is destroyed.
+  void work();
+
+ private:
+  std::size_t thread_limit_{0U};
+
+  std::mutex mutex_;
+  std::condition_variable job_cv_;
+  std::deque<std::function<void()>> job_queue_;
+  std::vector<std::thread> thread_list_;
+  bool stopping_{false};
+};
+
+} // namespace osquery
@@ -9,9 +9,14 @@
 
 #include <sys/stat.h>
 
+#include <rocksdb/cache.h>
 #include <rocksdb/db.h>
 #include <rocksdb/env.h>
+#include <rocksdb/experimental.h>
+#include <rocksdb/filter_policy.h>
 #include <rocksdb/options.h>
+#include <rocksdb/statistics.h>
+#include <rocksdb/table.h>
 
 #include <osquery/core/flags.h>
 #include <osquery/filesystem/fileops.h>
@@ -30,6 +35,9 @@ HIDDEN_FLAG(int32, rocksdb_write_buffer, 16, "Max write buffer number");
 HIDDEN_FLAG(int32, rocksdb_merge_number, 4, "Min write buffer number to merge");
 HIDDEN_FLAG(int32, rocksdb_background_flushes, 4, "Max background flushes");
 HIDDEN_FLAG(int32, rocksdb_buffer_blocks, 256, "Write buffer blocks (4k)");
+HIDDEN_FLAG(uint64, rocksdb_block_cache, 8, "Shared block cache size (MB)");
+HIDDEN_FLAG(bool, rocksdb_compression, false, "Compress RocksDB files (ZSTD)");
+HIDDEN_FLAG(bool, rocksdb_statistics, false, "Collect RocksDB ticker counts");
 
 DECLARE_string(database_path);
 
@@ -44,6 +52,24 @@ std::atomic<bool> kRocksDBCorruptionIndicator{false};
 /// Backing-storage provider for osquery internal/core.
 REGISTER_INTERNAL(RocksDBDatabasePlugin, "database", "rocksdb");
 
+/// Tickers reported by getStatistics, named as in RocksDB's own dumps.
+const std::vector<std::pair<rocksdb::Tickers, std::string>> kRocksDBTickers = {
+    {rocksdb::BLOCK_CACHE_HIT, "rocksdb.block.cache.hit"},
+    {rocksdb::BLOCK_CACHE_MISS, "rocksdb.block.cache.miss"},
+    {rocksdb::BLOOM_FILTER_USEFUL, "rocksdb.bloom.filter.useful"},
+    {rocksdb::STALL_MICROS, "rocksdb.stall.micros"},
+    {rocksdb::COMPACT_READ_BYTES, "rocksdb.compact.read.bytes"},
+    {rocksdb::COMPACT_WRITE_BYTES, "rocksdb.compact.write.bytes"},
+    {rocksdb::FLUSH_WRITE_BYTES, "rocksdb.flush.write.bytes"},
+    {rocksdb::BYTES_WRITTEN, "rocksdb.bytes.written"},
+    {rocksdb::BYTES_READ, "rocksdb.bytes.read"},
+};
+
+/// Domains that are written in bulk, range scanned, and expired.
+inline bool isStreamingDomain(const std::string& domain) {
+  return (kEvents == domain || kLogs == domain);
+}
+
 void GlogRocksDBLogger::Logv(const char* format, va_list ap) {
   // Convert RocksDB log to string and check if header or level-ed log.
   std::string log_line;
@@ -105,7 +131,7 @@ Status RocksDBDatabasePlugin::setUp() {
     options_.max_manifest_file_size = 1024 * 500;
 
     // Performance and optimization settings.
-    // Use rocksdb::kZSTD to use ZSTD database compression
+    // Compression is chosen per column family, see getColumnFamilyOptions.
     options_.compression = rocksdb::kNoCompression;
     options_.compaction_style = rocksdb::kCompactionStyleLevel;
     options_.arena_block_size = (4 * 1024);
@@ -123,15 +149,28 @@ Status RocksDBDatabasePlugin::setUp() {
     }
     options_.info_log = logger_;
 
+    if (FLAGS_rocksdb_statistics) {
+      options_.statistics = rocksdb::CreateDBStatistics();
+    }
+
+    if (FLAGS_rocksdb_block_cache > 0) {
+      block_cache_ = rocksdb::NewLRUCache(
+          static_cast<size_t>(FLAGS_rocksdb_block_cache) * 1024 * 1024);
+    }
+
+    // The handle for a domain is the one preceding its column family name,
+    // see getHandleForColumnFamily. Tune each family for the domain it holds.
     std::set<std::string> domain_set;
     column_families_.push_back(rocksdb::ColumnFamilyDescriptor(
-        rocksdb::kDefaultColumnFamilyName, options_));
+        rocksdb::kDefaultColumnFamilyName,
+        getColumnFamilyOptions(kDomains.front())));
     domain_set.insert(rocksdb::kDefaultColumnFamilyName);
 
-    for (const auto& cf_name : kDomains) {
-      column_families_.push_back(
-          rocksdb::ColumnFamilyDescriptor(cf_name, options_));
-      domain_set.insert(cf_name);
+    for (size_t i = 0; i < kDomains.size(); i++) {
+      auto domain = (i + 1 < kDomains.size()) ? kDomains[i + 1] : "";
+      column_families_.push_back(rocksdb::ColumnFamilyDescriptor(
+          kDomains[i], getColumnFamilyOptions(domain)));
+      domain_set.insert(kDomains[i]);
     }
 
     // To support osquery rollbacks, meaning running with a database
@@ -157,8 +196,8 @@ Status RocksDBDatabasePlugin::setUp() {
         if (domain_set.find(column_family_in_db) == domain_set.end()) {
           VLOG(1) << "Adding unknown column family from DB: "
                   << column_family_in_db;
-          column_families_.push_back(
-              rocksdb::ColumnFamilyDescriptor(column_family_in_db, options_));
+          column_families_.push_back(rocksdb::ColumnFamilyDescriptor(
+              column_family_in_db, getColumnFamilyOptions("")));
         }
       }
     }
@@ -292,6 +331,37 @@ rocksdb::DB* RocksDBDatabasePlugin::getDB() const {
   return db_;
 }
 
+rocksdb::ColumnFamilyOptions RocksDBDatabasePlugin::getColumnFamilyOptions(
+    const std::string& domain) const {
+  rocksdb::ColumnFamilyOptions options(options_);
+
+  // Without an explicit cache RocksDB allocates one per column family.
+  rocksdb::BlockBasedTableOptions table_options;
+  if (block_cache_ != nullptr) {
+    table_options.block_cache = block_cache_;
+  } else {
+    table_options.no_block_cache = true;
+  }
+  table_options.filter_policy.reset(rocksdb::NewBloomFilterPolicy(10, false));
+
+  // Off by default, builds without ZSTD cannot open compressed files.
+  auto compression =
+      FLAGS_rocksdb_compression ? rocksdb::kZSTD : rocksdb::kNoCompression;
+  if (isStreamingDomain(domain)) {
+    // Most rows expire before reaching the last level, only compress there.
+    options.compression = rocksdb::kNoCompression;
+    options.bottommost_compression = compression;
+    // Lookups are for keys known to exist, skip filters on the last level.
+    options.optimize_filters_for_hits = true;
+  } else {
+    options.compression = compression;
+  }
+
+  options.table_factory.reset(
+      rocksdb::NewBlockBasedTableFactory(table_options));
+  return options;
+}
+
 rocksdb::ColumnFamilyHandle* RocksDBDatabasePlugin::getHandleForColumnFamily(
     const std::string& cf) const {
   size_t i = std::find(kDomains.begin(), kDomains.end(), cf) - kDomains.begin();
@@ -403,6 +473,28 @@ Status RocksDBDatabasePlugin::remove(const std::string& domain,
   return Status(s.code(), s.ToString());
 }
 
+Status RocksDBDatabasePlugin::removeBatch(
+    const std::string& domain, const std::vector<std::string>& keys) {
+  auto cfh = getHandleForColumnFamily(domain);
+  if (cfh == nullptr) {
+    return Status(1, "Could not get column family for " + domain);
+  }
+  auto options = rocksdb::WriteOptions();
+  if (skipWal(domain)) {
+    options.disableWAL = true;
+  } else {
+    options.sync = false;
+  }
+
+  rocksdb::WriteBatch batch;
+  for (const auto& key : keys) {
+    batch.Delete(cfh, key);
+  }
+
+  auto s = getDB()->Write(options, &batch);
+  return Status(s.code(), s.ToString());
+}
+
 Status RocksDBDatabasePlugin::removeRange(const std::string& domain,
                                           const std::string& low,
                                           const std::string& high) {
@@ -452,17 +544,149 @@ Status RocksDBDatabasePlugin::scan(const std::string& domain,
     return Status(1, "Could not get iterator for " + domain);
   }
 
+  // Keys are ordered bytewise, those sharing the prefix are contiguous.
   size_t count = 0;
-  for (it->SeekToFirst(); it->Valid(); it->Next()) {
-    auto key = it->key().ToString();
-    if (key.find(prefix) == 0) {
-      results.push_back(std::move(key));
-      if (max > 0 && ++count >= max) {
-        break;
-      }
+  for (it->Seek(prefix); it->Valid(); it->Next()) {
+    if (!it->key().starts_with(prefix)) {
+      break;
+    }
+    results.push_back(it->key().ToString());
+    if (max > 0 && ++count >= max) {
+      break;
+    }
+  }
+  delete it;
+  return Status::success();
+}
+
+Status RocksDBDatabasePlugin::scanRange(const std::string& domain,
+                                        const std::string& low,
+                                        const std::string& high,
+                                        DatabaseStringValueList& results,
+                                        uint64_t max) const {
+  if (low > high) {
+    return Status::failure("Invalid range: low > high");
+  }
+
+  if (getDB() == nullptr) {
+    return Status(1, "Database not opened");
+  }
+
+  auto cfh = getHandleForColumnFamily(domain);
+  if (cfh == nullptr) {
+    return Status(1, "Could not get column family for " + domain);
+  }
+  auto options = rocksdb::ReadOptions();
+  options.verify_checksums = false;
+  options.fill_cache = false;
+  auto it = getDB()->NewIterator(options, cfh);
+  if (it == nullptr) {
+    return Status(1, "Could not get iterator for " + domain);
+  }
+
+  size_t count = 0;
+  rocksdb::Slice upper(high);
+  for (it->Seek(low); it->Valid(); it->Next()) {
+    if (it->key().compare(upper) > 0) {
+      break;
+    }
+    results.push_back(
+        std::make_pair(it->key().ToString(), it->value().ToString()));
+    if (max > 0 && ++count >= max) {
+      break;
     }
   }
   delete it;
   return Status::success();
 }
+
+Status RocksDBDatabasePlugin::getRangeSize(const std::string& domain,
+                                           const std::string& low,
+                                           const std::string& high,
+                                           uint64_t& size) const {
+  size = 0;
+  if (low > high) {
+    return Status::failure("Invalid range: low > high");
+  }
+
+  if (getDB() == nullptr) {
+    return Status(1, "Database not opened");
+  }
+
+  auto cfh = getHandleForColumnFamily(domain);
+  if (cfh == nullptr) {
+    return Status(1, "Could not get column family for " + domain);
+  }
+
+  // The estimate uses file and memtable metadata, no keys are read.
+  rocksdb::SizeApproximationOptions options;
+  options.include_memtabtles = true;
+  options.include_files = true;
+  rocksdb::Range range(low, high);
+  auto s = getDB()->GetApproximateSizes(options, cfh, &range, 1, &size);
+  return Status(s.code(), s.ToString());
+}
+
+Status RocksDBDatabasePlugin::compactRange(const std::string& domain,
+                                           const std::string& low,
+                                           const std::string& high) {
+  if (low > high) {
+    return Status::failure("Invalid range: low > high");
+  }
+
+  if (getDB() == nullptr) {
+    return Status(1, "Database not opened");
+  }
+
+  auto cfh = getHandleForColumnFamily(domain);
+  if (cfh == nullptr) {
+    return Status(1, "Could not get column family for " + domain);
+  }
+
+  // Files are only marked for compaction, the work happens in the background.
+  rocksdb::Slice begin(low);
+  rocksdb::Slice end(high);
+  auto s =
+      rocksdb::experimental::SuggestCompactRange(getDB(), cfh, &begin, &end);
+  return Status(s.code(), s.ToString());
+}
+
+Status RocksDBDatabasePlugin::getStatistics(DatabaseStatistics& stats) const {
+  if (getDB() == nullptr) {
+    return Status(1, "Database not opened");
+  }
+
+  if (options_.statistics != nullptr) {
+    for (const auto& ticker : kRocksDBTickers) {
+      auto count = options_.statistics->getTickerCount(ticker.first);
+      stats.push_back({"", ticker.second, count});
+    }
+  }
+
+  if (block_cache_ != nullptr) {
+    stats.push_back(
+        {"", "rocksdb.block-cache-capacity", block_cache_->GetCapacity()});
+    stats.push_back(
+        {"", "rocksdb.block-cache-usage", block_cache_->GetUsage()});
+  }
+
+  const std::vector<std::string> properties = {
+      rocksdb::DB::Properties::kEstimateNumKeys,
+      rocksdb::DB::Properties::kEstimateLiveDataSize,
+      rocksdb::DB::Properties::kTotalSstFilesSize,
+      rocksdb::DB::Properties::kCurSizeAllMemTables,
+      rocksdb::DB::Properties::kEstimatePendingCompactionBytes,
+  };
+
+  for (const auto& domain : kDomains) {
+    auto cfh = getHandleForColumnFamily(domain);
+    for (const auto& property : properties) {
+      uint64_t value = 0;
+      if (getDB()->GetIntProperty(cfh, property, &value)) {
+        stats.push_back({domain, property, value});
+      }
+    }
+  }
+  return Status::success();
+}
 } // namespace osquery
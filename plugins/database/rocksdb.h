@@ -8,7 +8,9 @@
  */
 
 #include <atomic>
+#include <memory>
 
+#include <rocksdb/cache.h>
 #include <rocksdb/db.h>
 
 #include <osquery/core/core.h>
@@ -60,6 +62,10 @@ class RocksDBDatabasePlugin : public DatabasePlugin {
   /// Data removal method.
   Status remove(const std::string& domain, const std::string& k) override;
 
+  /// Remove a list of keys in a single write batch.
+  Status removeBatch(const std::string& domain,
+                     const std::vector<std::string>& keys) override;
+
   /// Data range removal method.
   Status removeRange(const std::string& domain,
                      const std::string& low,
@@ -71,6 +77,27 @@ class RocksDBDatabasePlugin : public DatabasePlugin {
               const std::string& prefix,
               uint64_t max) const override;
 
+  /// Key and value range lookup method.
+  Status scanRange(const std::string& domain,
+                   const std::string& low,
+                   const std::string& high,
+                   DatabaseStringValueList& results,
+                   uint64_t max) const override;
+
+  /// Key range size estimate method.
+  Status getRangeSize(const std::string& domain,
+                      const std::string& low,
+                      const std::string& high,
+                      uint64_t& size) const override;
+
+  /// Suggest RocksDB compact the files overlapping a removed range.
+  Status compactRange(const std::string& domain,
+                      const std::string& low,
+                      const std::string& high) override;
+
+  /// Report RocksDB tickers, block cache use, and per-domain properties.
+  Status getStatistics(DatabaseStatistics& stats) const override;
+
  public:
   /// Database workflow: open and setup.
   Status setUp() override;
@@ -102,6 +129,15 @@ class RocksDBDatabasePlugin : public DatabasePlugin {
    */
   rocksdb::DB* getDB() const;
 
+  /**
+   * @brief Build the column family options tuned for a domain's access.
+   *
+   * Events and logs are written in bulk, range scanned, and expire quickly.
+   * The remaining domains are small and mostly read by key.
+   */
+  rocksdb::ColumnFamilyOptions getColumnFamilyOptions(
+      const std::string& domain) const;
+
   /// Request RocksDB compact each domain and level to that same level.
   Status compactFiles(const std::string& domain);
 
@@ -145,6 +181,9 @@ class RocksDBDatabasePlugin : public DatabasePlugin {
   /// The RocksDB connection options that are used to connect to RocksDB
   rocksdb::Options options_;
 
+  /// Block cache shared by every column family, may be empty.
+  std::shared_ptr<rocksdb::Cache> block_cache_{nullptr};
+
   /// Deconstruction mutex.
   Mutex close_mutex_;
 
@@ -112,23 +112,55 @@ static int getData(void* argument, int argc, char* argv[], char* column[]) {
   return 0;
 }
 
+/**
+ * @brief Bind a string parameter using its length.
+ *
+ * Keys and binary event rows may contain NUL bytes. With an explicit length
+ * nothing is truncated, and the BINARY collation compares keys with memcmp
+ * over their whole length, the same bytewise order as a blob comparison.
+ */
+static void bindString(sqlite3_stmt* stmt,
+                       int index,
+                       const std::string& value) {
+  sqlite3_bind_text(stmt,
+                    index,
+                    value.data(),
+                    static_cast<int>(value.size()),
+                    SQLITE_STATIC);
+}
+
+/// Read a string column using its length, see bindString.
+static std::string getColumnString(sqlite3_stmt* stmt, int column) {
+  auto data = sqlite3_column_blob(stmt, column);
+  auto size = sqlite3_column_bytes(stmt, column);
+  if (data == nullptr || size <= 0) {
+    return {};
+  }
+
+  return std::string(static_cast<const char*>(data),
+                     static_cast<std::size_t>(size));
+}
+
 Status SQLiteDatabasePlugin::get(const std::string& domain,
                                  const std::string& key,
                                  std::string& value) const {
-  QueryData results;
-  char* err = nullptr;
-  std::string q = "select value from " + domain + " where key = '" + key + "';";
-  sqlite3_exec(db_, q.c_str(), getData, &results, &err);
-  if (err != nullptr) {
-    sqlite3_free(err);
+  sqlite3_stmt* stmt = nullptr;
+  std::string q = "select value from " + domain + " where key = ?1;";
+  if (sqlite3_prepare_v2(db_, q.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    sqlite3_finalize(stmt);
+    return Status(1, "Cannot read from domain: " + domain);
   }
 
+  bindString(stmt, 1, key);
+
   // Only assign value if the query found a result.
-  if (results.size() > 0) {
-    value = std::move(results[0]["value"]);
-    return Status(0);
+  auto found = sqlite3_step(stmt) == SQLITE_ROW;
+  if (found) {
+    value = getColumnString(stmt, 0);
   }
-  return Status(1);
+
+  sqlite3_finalize(stmt);
+  return Status(found ? 0 : 1);
 }
 
 Status SQLiteDatabasePlugin::get(const std::string& domain,
@@ -204,8 +236,8 @@ Status SQLiteDatabasePlugin::putBatch(const std::string& domain,
       const auto& key = p.first;
       const auto& value = p.second;
 
-      sqlite3_bind_text(stmt, i, key.c_str(), -1, SQLITE_STATIC);
-      sqlite3_bind_text(stmt, i + 1, value.c_str(), -1, SQLITE_STATIC);
+      bindString(stmt, i, key);
+      bindString(stmt, i + 1, value);
 
       i += 2;
     }
@@ -230,7 +262,7 @@ Status SQLiteDatabasePlugin::remove(const std::string& domain,
   std::string q = "delete from " + domain + " where key IN (?1);";
   sqlite3_prepare_v2(db_, q.c_str(), -1, &stmt, nullptr);
 
-  sqlite3_bind_text(stmt, 1, key.c_str(), -1, SQLITE_STATIC);
+  bindString(stmt, 1, key);
   auto rc = sqlite3_step(stmt);
   if (rc != SQLITE_DONE) {
     return Status(1);
@@ -254,8 +286,8 @@ Status SQLiteDatabasePlugin::removeRange(const std::string& domain,
   std::string q = "delete from " + domain + " where key >= ?1 and key <= ?2;";
   sqlite3_prepare_v2(db_, q.c_str(), -1, &stmt, nullptr);
 
-  sqlite3_bind_text(stmt, 1, low.c_str(), -1, SQLITE_STATIC);
-  sqlite3_bind_text(stmt, 2, high.c_str(), -1, SQLITE_STATIC);
+  bindString(stmt, 1, low);
+  bindString(stmt, 2, high);
   auto rc = sqlite3_step(stmt);
   if (rc != SQLITE_DONE) {
     return Status(1);
@@ -292,4 +324,36 @@ Status SQLiteDatabasePlugin::scan(const std::string& domain,
 
   return Status::success();
 }
+
+Status SQLiteDatabasePlugin::scanRange(const std::string& domain,
+                                       const std::string& low,
+                                       const std::string& high,
+                                       DatabaseStringValueList& results,
+                                       uint64_t max) const {
+  if (low > high) {
+    return Status::failure("Invalid range: low > high");
+  }
+
+  std::string q = "select key, value from " + domain +
+                  " where key >= ?1 and key <= ?2 order by key";
+  if (max > 0) {
+    q += " limit " + std::to_string(max);
+  }
+
+  sqlite3_stmt* stmt = nullptr;
+  if (sqlite3_prepare_v2(db_, q.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    sqlite3_finalize(stmt);
+    return Status(1, "Cannot scan domain: " + domain);
+  }
+
+  bindString(stmt, 1, low);
+  bindString(stmt, 2, high);
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    results.push_back(
+        std::make_pair(getColumnString(stmt, 0), getColumnString(stmt, 1)));
+  }
+
+  sqlite3_finalize(stmt);
+  return Status::success();
+}
 } // namespace osquery
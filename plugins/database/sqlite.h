@@ -55,6 +55,13 @@ class SQLiteDatabasePlugin : public DatabasePlugin {
               const std::string& prefix,
               uint64_t max) const override;
 
+  /// Key and value range lookup method.
+  Status scanRange(const std::string& domain,
+                   const std::string& low,
+                   const std::string& high,
+                   DatabaseStringValueList& results,
+                   uint64_t max) const override;
+
  public:
   /// Database workflow: open and setup.
   Status setUp() override;
@@ -10,6 +10,7 @@
 #include <osquery/database/tests/test_utils.h>
 #include <osquery/filesystem/filesystem.h>
 #include <osquery/sql/sql.h>
+#include <osquery/utils/scope_guard.h>
 #include <plugins/database/rocksdb.h>
 
 #include <boost/filesystem.hpp>
@@ -17,6 +18,7 @@
 namespace osquery {
 
 DECLARE_string(database_path);
+DECLARE_bool(rocksdb_statistics);
 
 class RocksDBDatabasePluginTests : public DatabasePluginTests {
  protected:
@@ -94,4 +96,73 @@ TEST_F(RocksDBDatabasePluginTests, test_column_families_rollback) {
   ASSERT_TRUE(s.ok()) << s.getMessage();
   db2.tearDown();
 }
+
+TEST_F(RocksDBDatabasePluginTests, test_statistics) {
+  auto plugin = getPlugin();
+  ASSERT_TRUE(plugin->put(kQueries, "test_statistics", "value").ok());
+  std::string value;
+  ASSERT_TRUE(plugin->get(kQueries, "test_statistics", value).ok());
+
+  DatabaseStatistics stats;
+  auto s = plugin->getStatistics(stats);
+  ASSERT_TRUE(s.ok()) << s.getMessage();
+
+  std::map<std::string, uint64_t> database_stats;
+  std::set<std::string> domains;
+  for (const auto& stat : stats) {
+    if (stat.domain.empty()) {
+      database_stats[stat.name] = stat.value;
+    } else {
+      domains.insert(stat.domain);
+    }
+  }
+
+  // Ticker counts are only collected with --rocksdb_statistics.
+  EXPECT_EQ(database_stats.count("rocksdb.block.cache.hit"), 0U);
+  EXPECT_GT(database_stats["rocksdb.block-cache-capacity"], 0U);
+  EXPECT_EQ(domains.size(), kDomains.size());
+
+  auto results = SQL::selectAllFrom("rocksdb_stats");
+  EXPECT_EQ(results.size(), stats.size());
+}
+
+TEST_F(RocksDBDatabasePluginTests, test_statistics_tickers) {
+  auto const statistics = FLAGS_rocksdb_statistics;
+  auto const guard = scope_guard::create(
+      [statistics]() { FLAGS_rocksdb_statistics = statistics; });
+  FLAGS_rocksdb_statistics = true;
+
+  // Options are read once per plugin, use a plugin that was never set up.
+  auto db = RocksDBDatabasePlugin();
+  const auto test_db_path =
+      (boost::filesystem::temp_directory_path() /
+       boost::filesystem::unique_path(
+           "osquery.test_statistics_tickers.%%%%.%%%%.%%%%.%%%%.db"))
+          .string();
+  FLAGS_database_path = test_db_path;
+
+  auto s = db.setUp();
+  ASSERT_TRUE(s.ok()) << s.getMessage();
+  db_dirs_.push_back(test_db_path);
+
+  ASSERT_TRUE(db.put(kQueries, "test_statistics", "value").ok());
+  std::string value;
+  ASSERT_TRUE(db.get(kQueries, "test_statistics", value).ok());
+
+  DatabaseStatistics stats;
+  s = db.getStatistics(stats);
+  db.tearDown();
+  ASSERT_TRUE(s.ok()) << s.getMessage();
+
+  std::map<std::string, uint64_t> database_stats;
+  for (const auto& stat : stats) {
+    if (stat.domain.empty()) {
+      database_stats[stat.name] = stat.value;
+    }
+  }
+
+  EXPECT_EQ(database_stats.count("rocksdb.block.cache.hit"), 1U);
+  EXPECT_EQ(database_stats.count("rocksdb.stall.micros"), 1U);
+  EXPECT_GT(database_stats["rocksdb.bytes.written"], 0U);
+}
 } // namespace osquery
@@ -11,7 +11,6 @@
 
 #include <algorithm>
 #include <chrono>
-#include <thread>
 
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
@@ -20,6 +19,7 @@
 #include <osquery/core/system.h>
 #include <osquery/database/database.h>
 #include <osquery/logger/logger.h>
+#include <osquery/process/process.h>
 #include <osquery/registry/registry.h>
 #include <osquery/utils/info/version.h>
 #include <osquery/utils/json/json.h>
@@ -35,6 +35,11 @@ FLAG(uint64,
      1000000,
      "Maximum number of logs in buffered output plugins (0 = unlimited)");
 
+FLAG(uint64,
+     buffered_log_drain_cpu,
+     50,
+     "Max percent of a CPU to use when sending a backlog of buffered logs");
+
 const std::chrono::seconds BufferedLogForwarder::kLogPeriod{
     std::chrono::seconds(4)};
 const uint64_t BufferedLogForwarder::kMaxLogLines{1024};
@@ -42,7 +47,12 @@ const uint64_t BufferedLogForwarder::kMaxLogLines{1024};
 Status BufferedLogForwarder::setUp() {
   // initialize buffer_count_ by scanning the DB
   std::vector<std::string> indexes;
-  auto status = scanDatabaseKeys(kLogs, indexes, index_name_, (uint64_t)0);
+  auto status =
+      scanDatabaseKeys(kLogs, indexes, genIndexPrefix(true), (uint64_t)0);
+  if (status.ok()) {
+    status =
+        scanDatabaseKeys(kLogs, indexes, genIndexPrefix(false), (uint64_t)0);
+  }
 
   if (!status.ok()) {
     return Status(1, "Error scanning for buffered log count");
@@ -53,38 +63,55 @@ Status BufferedLogForwarder::setUp() {
   return Status(0);
 }
 
-void BufferedLogForwarder::check() {
-  // Get a list of all the buffered log items, with a max of 1024 lines.
-  std::vector<std::string> indexes;
-  auto status = scanDatabaseKeys(kLogs, indexes, index_name_, max_log_lines_);
+bool BufferedLogForwarder::check() {
+  // Read up to max_log_lines_ buffered log items, results before statuses as
+  // they are ordered in the logs domain. Each type is read with one range
+  // scan of its full index prefix, so forwarders whose names share a prefix
+  // never read each other's logs.
+  DatabaseStringValueList result_items, status_items;
+  auto prefix = genIndexPrefix(true);
+  auto status = scanDatabaseRange(
+      kLogs, prefix, prefix + '\xff', result_items, max_log_lines_);
+  if (status.ok() &&
+      (max_log_lines_ == 0 || result_items.size() < max_log_lines_)) {
+    prefix = genIndexPrefix(false);
+    auto remaining =
+        (max_log_lines_ == 0) ? 0 : max_log_lines_ - result_items.size();
+    status = scanDatabaseRange(
+        kLogs, prefix, prefix + '\xff', status_items, remaining);
+  }
+  if (!status.ok()) {
+    VLOG(1) << "Error reading buffered logs: " << status.getMessage();
+    return false;
+  }
 
-  // For each index, accumulate the log line into the result or status set.
+  // Accumulate the log lines into the result and status sets.
   std::vector<std::string> results, statuses;
-  iterate(indexes, ([&results, &statuses, this](std::string& index) {
-            std::string value;
-            auto& target = isResultIndex(index) ? results : statuses;
-            if (getDatabaseValue(kLogs, index, value)) {
-              target.emplace_back(std::move(value));
-            }
-          }));
+  std::vector<std::string> result_indexes, status_indexes;
+  for (auto& item : result_items) {
+    result_indexes.push_back(std::move(item.first));
+    results.push_back(std::move(item.second));
+  }
+  for (auto& item : status_items) {
+    status_indexes.push_back(std::move(item.first));
+    statuses.push_back(std::move(item.second));
+  }
+
+  bool sent = true;
 
   // If any results/statuses were found in the flushed buffer, send.
   if (results.size() > 0) {
     status = send(results, "result");
     if (!status.ok()) {
       VLOG(1) << "Error sending results to logger: " << status.getMessage();
+      sent = false;
 
       if (interrupted()) {
-        return;
+        return false;
       }
     } else {
       // Clear the results logs once they were sent.
-      iterate(indexes, ([this](std::string& index) {
-                if (!isResultIndex(index)) {
-                  return;
-                }
-                deleteValueWithCount(kLogs, index);
-              }));
+      deleteValuesWithCount(kLogs, result_indexes);
     }
   }
 
@@ -92,18 +119,14 @@ void BufferedLogForwarder::check() {
     status = send(statuses, "status");
     if (!status.ok()) {
       VLOG(1) << "Error sending status to logger: " << status.getMessage();
+      sent = false;
 
       if (interrupted()) {
-        return;
+        return false;
       }
     } else {
       // Clear the status logs once they were sent.
-      iterate(indexes, ([this](std::string& index) {
-                if (!isStatusIndex(index)) {
-                  return;
-                }
-                deleteValueWithCount(kLogs, index);
-              }));
+      deleteValuesWithCount(kLogs, status_indexes);
     }
   }
 
@@ -111,6 +134,9 @@ void BufferedLogForwarder::check() {
   if (FLAGS_buffered_log_max > 0) {
     purge();
   }
+
+  return sent && max_log_lines_ > 0 &&
+         result_items.size() + status_items.size() >= max_log_lines_;
 }
 
 void BufferedLogForwarder::purge() {
@@ -168,19 +194,34 @@ void BufferedLogForwarder::purge() {
   indexes.erase(indexes.begin() + (unsigned int)purge_count, indexes.end());
 
   // Now only indexes of logs to be deleted remain
-  iterate(indexes, [this](const std::string& index) {
-    if (!deleteValueWithCount(kLogs, index).ok()) {
-      LOG(ERROR) << "Error deleting value during buffered log purge";
-    }
-  });
+  if (!deleteValuesWithCount(kLogs, indexes).ok()) {
+    LOG(ERROR) << "Error deleting values during buffered log purge";
+  }
 }
 
 void BufferedLogForwarder::start() {
   while (!interrupted()) {
-    check();
+    uint64_t cpu_before = 0;
+    bool measured = platformGetThreadCpuTime(cpu_before);
+    if (!check()) {
+      // Cool off and time wait the configured period.
+      pause(std::chrono::milliseconds(log_period_));
+      continue;
+    }
+
+    // A full batch was sent and a backlog remains, send the next batch as
+    // soon as the CPU time this thread used for the batch allows.
+    uint64_t cpu_after = 0;
+    if (!measured || !platformGetThreadCpuTime(cpu_after) ||
+        FLAGS_buffered_log_drain_cpu == 0) {
+      pause(std::chrono::milliseconds(log_period_));
+      continue;
+    }
 
-    // Cool off and time wait the configured period.
-    pause(std::chrono::milliseconds(log_period_));
+    auto cpu_ms = cpu_after - std::min(cpu_after, cpu_before);
+    auto limit = std::min<uint64_t>(FLAGS_buffered_log_drain_cpu, 100);
+    std::chrono::milliseconds cool_off(cpu_ms * (100 - limit) / limit);
+    pause(std::min<std::chrono::milliseconds>(cool_off, log_period_));
   }
 }
 
@@ -285,14 +326,13 @@ Status BufferedLogForwarder::addValueWithCount(const std::string& domain,
   return status;
 }
 
-Status BufferedLogForwarder::deleteValueWithCount(const std::string& domain,
-                                                  const std::string& key) {
-  Status status = deleteDatabaseValue(domain, key);
+Status BufferedLogForwarder::deleteValuesWithCount(
+    const std::string& domain, const std::vector<std::string>& keys) {
+  Status status = deleteDatabaseBatch(domain, keys);
   if (status.ok()) {
     RecursiveLock lock(count_mutex_);
-    if (buffer_count_ > 0) {
-      buffer_count_--;
-    }
+    buffer_count_ -=
+        std::min<unsigned long long int>(buffer_count_, keys.size());
   }
   return status;
 }
@@ -10,10 +10,8 @@
 #pragma once
 
 #include <chrono>
-#include <functional>
 #include <mutex>
 #include <string>
-#include <thread>
 #include <vector>
 
 #include <osquery/core/plugins/logger.h>
@@ -21,22 +19,6 @@
 
 namespace osquery {
 
-/// Iterate through a vector, yielding during high utilization
-inline void iterate(std::vector<std::string>& input,
-                    std::function<void(std::string&)> predicate) {
-  // Since there are no 'multi-do' APIs, keep a count of consecutive actions.
-  // This count allows us to sleep the thread to prevent utilization thrash.
-  size_t count = 0;
-  for (auto& item : input) {
-    // The predicate is provided a mutable string.
-    // It may choose to clear/move the data.
-    predicate(item);
-    if (++count % 100 == 0) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(20));
-    }
-  }
-}
-
 /**
  * @brief A log forwarder thread flushing database-buffered logs.
  *
@@ -86,7 +68,13 @@ class BufferedLogForwarder : public InternalRunnable {
         index_name_(name) {}
 
  public:
-  /// A simple wait lock, and flush based on settings.
+  /**
+   * @brief A simple wait lock, and flush based on settings.
+   *
+   * While a backlog of buffered logs remains, batches are sent without
+   * waiting for the log period. Each batch is followed by a cool off sized
+   * from the CPU time it used, see the buffered_log_drain_cpu flag.
+   */
   void start() override;
 
   /**
@@ -133,11 +121,14 @@ class BufferedLogForwarder : public InternalRunnable {
   /**
    * @brief Check for new logs and send.
    *
-   * Scan the logs domain for up to max_log_lines_ log lines.
-   * Sort those lines into status and request types then forward (send) each
-   * set. On success, clear the data and indexes. Calls purge upon completion.
+   * Read up to max_log_lines_ log lines from the logs domain in a single
+   * range scan. Sort those lines into status and request types then forward
+   * (send) each set. On success, clear the data and indexes in a single batch
+   * removal. Calls purge upon completion.
+   *
+   * @return true if a full batch was sent and more logs may be buffered.
    */
-  void check();
+  bool check();
 
   /**
    * @brief Purge the oldest logs, if the max is exceeded
@@ -180,11 +171,11 @@ class BufferedLogForwarder : public InternalRunnable {
                            const std::string& value);
 
   /**
-   * @brief Delete a database value while maintaining count
+   * @brief Delete a list of database values while maintaining count
    *
    */
-  Status deleteValueWithCount(const std::string& domain,
-                              const std::string& key);
+  Status deleteValuesWithCount(const std::string& domain,
+                               const std::vector<std::string>& keys);
 
  protected:
   /// Seconds between flushing logs
@@ -8,6 +8,7 @@
  */
 
 #include <chrono>
+#include <future>
 #include <thread>
 
 #include <gmock/gmock.h>
@@ -105,6 +106,8 @@ class MockBufferedLogForwarder : public BufferedLogForwarder {
   FRIEND_TEST(BufferedLogForwarderTests, test_split);
   FRIEND_TEST(BufferedLogForwarderTests, test_purge);
   FRIEND_TEST(BufferedLogForwarderTests, test_purge_max);
+  FRIEND_TEST(BufferedLogForwarderTests, test_drain);
+  FRIEND_TEST(BufferedLogForwarderTests, test_shared_prefix);
 
  private:
   bool checked_{false};
@@ -300,6 +303,88 @@ TEST_F(BufferedLogForwarderTests, test_split) {
   runner2.check();
 }
 
+// Verify that check reports a backlog only after sending a full batch
+TEST_F(BufferedLogForwarderTests, test_drain) {
+  StrictMock<MockBufferedLogForwarder> runner("mock", kLogPeriod, 2);
+  StatusLogLine log1 = makeStatusLogLine(O_INFO, "foo", 1, "foo status");
+  runner.logString("foo");
+  runner.logString("bar");
+  runner.logString("baz");
+  runner.logStatus({log1});
+
+  EXPECT_CALL(runner, send(ElementsAre("foo", "bar"), "result"))
+      .WillOnce(Return(Status(0)));
+  EXPECT_TRUE(runner.check());
+
+  // The next batch holds the last result and the status, a failed send
+  // waits for the log period.
+  EXPECT_CALL(runner, send(ElementsAre("baz"), "result"))
+      .WillOnce(Return(Status(0)));
+  EXPECT_CALL(runner, send(ElementsAre(MatchesStatus(log1)), "status"))
+      .WillOnce(Return(Status(1, "fail")));
+  EXPECT_FALSE(runner.check());
+
+  // A partial batch means the backlog is drained.
+  EXPECT_CALL(runner, send(ElementsAre(MatchesStatus(log1)), "status"))
+      .WillOnce(Return(Status(0)));
+  EXPECT_FALSE(runner.check());
+  EXPECT_FALSE(runner.check());
+}
+
+// Verify that a backlog is sent without waiting for the log period
+TEST_F(BufferedLogForwarderTests, test_async_drain) {
+  auto runner = std::make_shared<StrictMock<MockBufferedLogForwarder>>(
+      "mock", std::chrono::milliseconds(60000), 2);
+  runner->logString("foo");
+  runner->logString("bar");
+  runner->logString("baz");
+
+  std::promise<void> drained;
+  {
+    InSequence sequence;
+    EXPECT_CALL(*runner, send(ElementsAre("foo", "bar"), "result"))
+        .WillOnce(Return(Status(0)));
+    EXPECT_CALL(*runner, send(ElementsAre("baz"), "result"))
+        .WillOnce(
+            DoAll(InvokeWithoutArgs([&drained]() { drained.set_value(); }),
+                  Return(Status(0))));
+  }
+
+  Dispatcher::addService(runner);
+  EXPECT_EQ(drained.get_future().wait_for(std::chrono::seconds(10)),
+            std::future_status::ready);
+  runner->interrupt();
+  Dispatcher::joinServices();
+}
+
+// Verify that forwarders whose names share a prefix keep their logs apart
+TEST_F(BufferedLogForwarderTests, test_shared_prefix) {
+  StrictMock<MockBufferedLogForwarder> runner("mock");
+  StrictMock<MockBufferedLogForwarder> runner_extra("mock_extra");
+  StrictMock<MockBufferedLogForwarder> runner_long("mockery");
+  StatusLogLine log1 = makeStatusLogLine(O_INFO, "foo", 1, "foo status");
+  runner_extra.logString("extra");
+  runner_extra.logStatus({log1});
+  runner_long.logString("long");
+  runner.logString("foo");
+
+  EXPECT_CALL(runner, send(ElementsAre("foo"), "result"))
+      .WillOnce(Return(Status(0)));
+  runner.check();
+  runner.check();
+
+  EXPECT_CALL(runner_long, send(ElementsAre("long"), "result"))
+      .WillOnce(Return(Status(0)));
+  runner_long.check();
+
+  EXPECT_CALL(runner_extra, send(ElementsAre("extra"), "result"))
+      .WillOnce(Return(Status(0)));
+  EXPECT_CALL(runner_extra, send(ElementsAre(MatchesStatus(log1)), "status"))
+      .WillOnce(Return(Status(0)));
+  runner_extra.check();
+  runner_extra.check();
+}
+
 // Test the purge() function independently of check()
 TEST_F(BufferedLogForwarderTests, test_purge) {
   FLAGS_buffered_log_max = 3;
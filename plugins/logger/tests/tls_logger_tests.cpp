@@ -14,11 +14,13 @@
 #include <osquery/database/database.h>
 #include <osquery/registry/registry_interface.h>
 #include <osquery/remote/tests/test_utils.h>
+#include <osquery/utils/json/json.h>
 
 #include "plugins/logger/tls_logger.h"
 
 namespace osquery {
 DECLARE_bool(disable_database);
+DECLARE_bool(logger_tls_validate);
 
 class TLSLoggerTests : public testing::Test {
  protected:
@@ -32,6 +34,10 @@ class TLSLoggerTests : public testing::Test {
   void runCheck(const std::shared_ptr<TLSLogForwarder>& runner) {
     runner->check();
   }
+
+  std::string serializeLogs(std::vector<std::string>& log_data) {
+    return TLSLogForwarder::serializeLogs("node", "result", log_data);
+  }
 };
 
 TEST_F(TLSLoggerTests, test_database) {
@@ -83,4 +89,49 @@ TEST_F(TLSLoggerTests, test_send) {
   TLSServerRunner::unsetClientConfig();
   TLSServerRunner::stop();
 }
+
+TEST_F(TLSLoggerTests, test_serialize_drops_invalid_lines) {
+  std::vector<std::string> log_data = {
+      "{\"first\": 1}", "{\"broken\": ", "{\"second\": [2]}"};
+
+  auto body = serializeLogs(log_data);
+
+  JSON doc;
+  ASSERT_TRUE(doc.fromString(body).ok());
+  EXPECT_STREQ(doc.doc()["node_key"].GetString(), "node");
+  EXPECT_STREQ(doc.doc()["log_type"].GetString(), "result");
+
+  // The invalid line is dropped, the others are kept in order.
+  const auto& data = doc.doc()["data"];
+  ASSERT_TRUE(data.IsArray());
+  ASSERT_EQ(data.Size(), 2U);
+  EXPECT_EQ(data[0]["first"].GetInt(), 1);
+  EXPECT_EQ(data[1]["second"][0].GetInt(), 2);
+}
+
+TEST_F(TLSLoggerTests, test_serialize_without_validation) {
+  auto validate = FLAGS_logger_tls_validate;
+  FLAGS_logger_tls_validate = false;
+
+  std::vector<std::string> log_data = {"{\"first\": 1}",
+                                       "{\"second\": [2]}"};
+  auto body = serializeLogs(log_data);
+
+  // The lines are copied into the request as they are.
+  JSON doc;
+  ASSERT_TRUE(doc.fromString(body).ok());
+  const auto& data = doc.doc()["data"];
+  ASSERT_TRUE(data.IsArray());
+  ASSERT_EQ(data.Size(), 2U);
+  EXPECT_EQ(data[0]["first"].GetInt(), 1);
+  EXPECT_EQ(data[1]["second"][0].GetInt(), 2);
+
+  // Nothing checks them, an invalid line makes the whole body invalid.
+  log_data = {"{\"first\": 1}", "{\"broken\": "};
+  body = serializeLogs(log_data);
+  EXPECT_NE(body.find("{\"broken\": "), std::string::npos);
+  EXPECT_FALSE(doc.fromString(body).ok());
+
+  FLAGS_logger_tls_validate = validate;
+}
 } // namespace osquery
@@ -27,6 +27,9 @@
 #include <plugins/config/parsers/decorators.h>
 #include <osquery/utils/json/json.h>
 
+#include <rapidjson/memorystream.h>
+#include <rapidjson/reader.h>
+
 namespace osquery {
 
 FLAG(uint64,
@@ -53,8 +56,26 @@ FLAG_ALIAS(google::uint64, logger_tls_max, logger_tls_max_linesize);
 
 FLAG(bool, logger_tls_compress, false, "GZip compress TLS/HTTPS request body");
 
+FLAG(bool,
+     logger_tls_validate,
+     true,
+     "Check that each log line is valid JSON before sending");
+
 REGISTER(TLSLoggerPlugin, "logger", "tls");
 
+namespace {
+
+/// Check a log line is valid JSON with a SAX pass, without building a document.
+bool isValidLogLine(const std::string& line) {
+  rapidjson::Reader reader;
+  rapidjson::BaseReaderHandler<> handler;
+  rapidjson::MemoryStream stream(line.data(), line.size());
+  return !reader.Parse<rapidjson::kParseIterativeFlag>(stream, handler)
+              .IsError();
+}
+
+} // namespace
+
 TLSLogForwarder::TLSLogForwarder()
     : BufferedLogForwarder("TLSLogForwarder",
                            "tls",
@@ -103,40 +124,53 @@ Status TLSLogForwarder::send(std::vector<std::string>& log_data,
     return Status::success();
   }
 
-  JSON params;
-  params.add("node_key", getNodeKey("tls"));
-  params.add("log_type", log_type);
-
-  {
-    // Read each logged line into JSON and populate a list of lines.
-    // The result list will use the 'data' key.
-    auto children = params.newArray();
-    iterate(log_data, ([&params, &children](std::string& item) {
-              // Enforce a max log line size for TLS logging.
-              if (item.size() > FLAGS_logger_tls_max_linesize) {
-                LOG(WARNING)
-                    << "Linesize exceeds TLS logger maximum: " << item.size();
-                return;
-              }
-
-              JSON child;
-              Status s = child.fromString(item);
-              if (!s.ok()) {
-                // The log line entered was not valid JSON, skip it.
-                return;
-              }
-              std::string().swap(item);
-              params.push(child.doc(), children.doc());
-            }));
-    params.add("data", children.doc());
+  // The response body is ignored (status is set appropriately by
+  // TLSRequestHelper::goSerialized())
+  JSON response;
+  return TLSRequestHelper::goSerialized<JSONSerializer>(
+      uri_,
+      serializeLogs(getNodeKey("tls"), log_type, log_data),
+      FLAGS_logger_tls_compress,
+      response);
+}
+
+std::string TLSLogForwarder::serializeLogs(
+    const std::string& node_key,
+    const std::string& log_type,
+    std::vector<std::string>& log_data) {
+  // Write the request envelope and splice each already serialized log line
+  // into the 'data' list, instead of parsing and re-serializing every line.
+  size_t capacity = node_key.size() + log_type.size() + 64;
+  for (const auto& item : log_data) {
+    capacity += item.size() + 1;
   }
 
-  // The response body is ignored (status is set appropriately by
-  // TLSRequestHelper::go())
-  std::string response;
-  if (FLAGS_logger_tls_compress) {
-    params.add("_compress", true);
+  rapidjson::StringBuffer body(nullptr, capacity);
+  rapidjson::Writer<rapidjson::StringBuffer> writer(body);
+  writer.StartObject();
+  writer.Key("node_key");
+  writer.String(node_key.c_str(), node_key.size());
+  writer.Key("log_type");
+  writer.String(log_type.c_str(), log_type.size());
+  writer.Key("data");
+  writer.StartArray();
+  for (auto& item : log_data) {
+    // Enforce a max log line size for TLS logging.
+    if (item.size() > FLAGS_logger_tls_max_linesize) {
+      LOG(WARNING) << "Linesize exceeds TLS logger maximum: " << item.size();
+      continue;
+    }
+
+    if (FLAGS_logger_tls_validate && !isValidLogLine(item)) {
+      // The log line entered was not valid JSON, skip it.
+      continue;
+    }
+    writer.RawValue(item.data(), item.size(), rapidjson::kObjectType);
+    std::string().swap(item);
   }
-  return TLSRequestHelper::go<JSONSerializer>(uri_, params, response);
+  writer.EndArray();
+  writer.EndObject();
+
+  return std::string(body.GetString(), body.GetSize());
 }
 } // namespace osquery
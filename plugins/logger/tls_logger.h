@@ -31,6 +31,16 @@ class TLSLogForwarder : public BufferedLogForwarder {
   Status send(std::vector<std::string>& log_data,
               const std::string& log_type) override;
 
+  /**
+   * @brief Write the request body for a batch of serialized log lines.
+   *
+   * Lines over the maximum size are dropped, and so are lines that are not
+   * valid JSON unless logger_tls_validate is disabled.
+   */
+  static std::string serializeLogs(const std::string& node_key,
+                                   const std::string& log_type,
+                                   std::vector<std::string>& log_data);
+
   /// Endpoint URI
   std::string uri_;
 
@@ -10,6 +10,7 @@
 #include <boost/format.hpp>
 
 #include <osquery/core/flags.h>
+#include <osquery/numeric_monitoring/histogram.h>
 #include <osquery/registry/registry_factory.h>
 #include <osquery/utils/config/default_paths.h>
 #include <plugins/numeric_monitoring/filesystem.h>
@@ -22,7 +23,8 @@ FLAG(string,
      numeric_monitoring_filesystem_path,
      OSQUERY_LOG_HOME "numeric_monitoring.log",
      "File to dump numeric monitoring records one per line. "
-     "The format of the line is <PATH><TAB><VALUE><TAB><TIMESTAMP>.");
+     "The format of the line is <PATH><TAB><VALUE><TAB><TIMESTAMP>. "
+     "Histogram points add a <PATH>.<QUANTILE> line per estimated quantile.");
 
 REGISTER(NumericMonitoringFilesystemPlugin,
          monitoring::registryName(),
@@ -69,10 +71,29 @@ Status NumericMonitoringFilesystemPlugin::call(const PluginRequest& request,
   }
   auto line = std::string{};
   auto status = formTheLine(line, request);
-  if (status.ok()) {
-    std::unique_lock<std::mutex> lock(output_file_mutex_);
-    output_file_stream_ << line << std::endl;
+  if (!status.ok()) {
+    return status;
   }
+
+  // Histogram points carry quantile estimates, each one gets its own line
+  // with the quantile name appended to the path.
+  for (const auto& quantile : monitoring::histogramQuantiles()) {
+    auto it = request.find(quantile.first);
+    if (it == request.end()) {
+      continue;
+    }
+    auto quantile_request = request;
+    quantile_request[monitoring::recordKeys().path] += "." + quantile.first;
+    quantile_request[monitoring::recordKeys().value] = it->second;
+    line.push_back('\n');
+    status = formTheLine(line, quantile_request);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+
+  std::unique_lock<std::mutex> lock(output_file_mutex_);
+  output_file_stream_ << line << std::endl;
   return status;
 }
 
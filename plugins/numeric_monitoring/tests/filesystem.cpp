@@ -96,4 +96,53 @@ TEST_F(NumericMonitoringFilesystemPluginTests, simple_workflow) {
   fs::remove(log_path);
 }
 
+TEST_F(NumericMonitoringFilesystemPluginTests, histogram_quantiles) {
+  const auto log_path =
+      fs::temp_directory_path() /
+      fs::unique_path(
+          "osquery.numeric_monitoring_filesystem_plugin_test.%%%%-%%%%%%.log");
+  FLAGS_numeric_monitoring_filesystem_path = log_path.string();
+  {
+    NumericMonitoringFilesystemPlugin plugin{};
+    ASSERT_TRUE(plugin.setUp().ok());
+    const auto path = std::string{"scheduler.query.time.wall.millis"};
+    const auto request = PluginRequest{
+        {monitoring::recordKeys().path, path},
+        {monitoring::recordKeys().value, "120"},
+        {monitoring::recordKeys().pre_aggregation, "histogram"},
+        {monitoring::recordKeys().timestamp, "1051"},
+        {monitoring::recordKeys().sync, "false"},
+        {"p50", "12"},
+        {"p95", "95"},
+        {"p99", "230"},
+    };
+    auto response = PluginResponse{};
+    EXPECT_TRUE(plugin.call(request, response).ok());
+
+    auto fin =
+        std::ifstream(log_path.native(), std::ios::in | std::ios::binary);
+    auto lines = std::vector<std::vector<std::string>>{};
+    auto line = std::string{};
+    while (std::getline(fin, line)) {
+      lines.push_back(split(line, "\t"));
+    }
+
+    const auto expected = std::vector<std::pair<std::string, std::string>>{
+        {path, "120"},
+        {path + ".p50", "12"},
+        {path + ".p95", "95"},
+        {path + ".p99", "230"},
+    };
+    ASSERT_EQ(lines.size(), expected.size());
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+      ASSERT_EQ(lines[i].size(), 4);
+      EXPECT_EQ(lines[i][0], expected[i].first);
+      EXPECT_EQ(lines[i][1], expected[i].second);
+      EXPECT_EQ(lines[i][2], "1051");
+      EXPECT_EQ(lines[i][3], "false");
+    }
+  }
+  fs::remove(log_path);
+}
+
 } // namespace osquery
@@ -74,6 +74,7 @@ COLUMN_OPTIONS = {
     "optimized": "OPTIMIZED",
     "hidden": "HIDDEN",
     "collate_nocase": "COLLATENOCASE",
+    "filter_only": "FILTER_ONLY",
 }
 
 # Column options that render tables uncacheable.